@@ -50,9 +50,80 @@ extern "C"
  * results or upon error.
  *
  * @return 0 on success (including none found), negative on error.
+ * @note If the policy is frozen, the query is compiled once into a
+ * plan of type and class bitsets and the plan is kept within the
+ * query for later runs, until the query is next modified.  Thus one
+ * query must not be run by several threads at once.
  */
 	extern int apol_avrule_get_by_query(const apol_policy_t * p, const apol_avrule_query_t * a, apol_vector_t ** v);
 
+/**
+ * Execute a query against all access vector rules within the policy,
+ * calling a function for each matching rule as it is found rather
+ * than gathering the rules into a vector.  The rules are passed in
+ * the same order as apol_avrule_get_by_query() would return them.
+ * When the query runs on several threads (see
+ * apol_avrule_query_set_threads()), each walk over the rule tables
+ * is finished before its rules are passed on; the function is always
+ * called from the calling thread.
+ *
+ * @param p Policy within which to look up avrules.
+ * @param a Structure containing parameters for query.	If this is
+ * NULL then consider all avrules.
+ * @param fn Function to call with each matching rule, of type
+ * qpol_avrule_t.  If it returns non-zero the search stops.
+ * @param arg Argument passed to fn.
+ *
+ * @return 0 on success (including none found), negative on error, or
+ * the non-zero value returned by fn to stop the search.
+ */
+	extern int apol_avrule_foreach_by_query(const apol_policy_t * p, const apol_avrule_query_t * a,
+						 apol_query_result_fn_t fn, void *arg);
+
+/**
+ * Execute several queries against all access vector rules within the
+ * policy in a single pass over the rules, rather than one pass per
+ * query.  Each rule is passed to fn once for every query that it
+ * matches, in the order of the queries.  Each query's rules come in
+ * the order of the policy's rule tables, which may differ from the
+ * order in which apol_avrule_foreach_by_query() would give them when
+ * the query names a source or target.  The pass always runs on the
+ * calling thread.
+ *
+ * @param p Policy within which to look up avrules.
+ * @param queries Array of queries to execute.  An element that is
+ * NULL matches every avrule.
+ * @param num_queries Number of queries in the array.
+ * @param fn Function to call for each rule matching a query, of type
+ * qpol_avrule_t.  If it returns non-zero the pass stops.
+ * @param args Array of num_queries arguments; fn is passed the one at
+ * the index of the query matched.  If NULL, fn is passed NULL.
+ *
+ * @return 0 on success (including none found), negative on error, or
+ * the non-zero value returned by fn to stop the pass.
+ */
+	extern int apol_avrule_foreach_by_queries(const apol_policy_t * p, apol_avrule_query_t * const *queries, size_t num_queries,
+						  apol_query_result_fn_t fn, void *const *args);
+
+/**
+ * Execute several queries against all access vector rules within the
+ * policy in a single pass over the rules, gathering each query's
+ * results into its own vector.  See apol_avrule_foreach_by_queries().
+ *
+ * @param p Policy within which to look up avrules.
+ * @param queries Array of queries to execute.  An element that is
+ * NULL matches every avrule.
+ * @param num_queries Number of queries in the array.
+ * @param v Array of num_queries references to vectors of
+ * qpol_avrule_t, one for each query.  The vectors will be allocated
+ * by this function.  The caller must call apol_vector_destroy() on
+ * each afterwards.  They will all be set to NULL upon error.
+ *
+ * @return 0 on success (including none found), negative on error.
+ */
+	extern int apol_avrule_get_by_queries(const apol_policy_t * p, apol_avrule_query_t * const *queries, size_t num_queries,
+					      apol_vector_t ** v);
+
 /**
  * Execute a query against all syntactic access vector rules within
  * the policy.  If the policy has line numbers, then the returned list
@@ -300,6 +371,23 @@ extern "C"
  */
 	extern int apol_avrule_query_set_regex(const apol_policy_t * p, apol_avrule_query_t * a, int is_regex);
 
+/**
+ * Set the number of threads with which to run an avrule query.  Once the
+ * policy's qpol policy has been frozen (see qpol_policy_freeze()), the
+ * rules are searched in parts by up to that many threads at once, and
+ * the results of the parts are merged so that they are in the same
+ * order as from a search by one thread.  Otherwise the query always
+ * runs on the calling thread.  The default is 1.
+ *
+ * @param p Policy handler, to report errors.
+ * @param a AV rule query to set.
+ * @param num_threads Maximum number of threads, or 0 for one per
+ * online processor.
+ *
+ * @return Always 0.
+ */
+	extern int apol_avrule_query_set_threads(const apol_policy_t * p, apol_avrule_query_t * a, size_t num_threads);
+
 /**
  * Given a single avrule, return a newly allocated vector of
  * qpol_syn_avrule_t pointers (relative to the given policy) which
@@ -33,6 +33,7 @@ extern "C"
 #include "policy.h"
 #include "mls-query.h"
 #include <qpol/policy.h>
+#include <qpol/constraint_eval.h>
 
 	typedef struct apol_context apol_context_t;
 
@@ -254,6 +255,24 @@ extern "C"
  */
 	extern int apol_context_convert(const apol_policy_t * p, apol_context_t * context);
 
+/**
+ * Compile a context for evaluation by a constraint engine, such as
+ * one read from an audit message.  The context must be complete and,
+ * if the policy is MLS, have a range that is not literal (see
+ * apol_context_convert()).
+ *
+ * @param p Policy containing the context's components.
+ * @param engine Engine that will evaluate the context.
+ * @param context Context to compile.
+ * @param ctx Pointer in which to store the compiled context.  The
+ * caller must call qpol_constraint_ctx_destroy() afterwards.
+ *
+ * @return 0 on success, < 0 on error (EINVAL if the context is
+ * incomplete or names something not in the policy).
+ */
+	extern int apol_context_create_constraint_ctx(const apol_policy_t * p, const qpol_constraint_engine_t * engine,
+						      const apol_context_t * context, qpol_constraint_ctx_t ** ctx);
+
 #ifdef	__cplusplus
 }
 #endif
@@ -68,7 +68,8 @@ extern "C"
  *  in a previous call.  If calls are to be considered independent or
  *  calls in a different direction are desired, call this function
  *  prior to apol_domain_trans_analysis_do().  If the table was not
- *  built yet then this function does nothing.
+ *  built yet then this function does nothing.  (A frozen policy's
+ *  table is reset by every analysis; see apol_policy_freeze().)
  *
  *  @param policy Policy containing the table for which the state
  *  should be reset.
@@ -249,6 +250,9 @@ extern "C"
  *  afterwards. This will be set to NULL upon error.
  *  @return 0 on success and < 0 on failure; if the call fails,
  *  errno will be set and *results will be NULL.
+ *  @note Analyses of the same policy from several threads take turns
+ *  with its table.  On a frozen policy each analysis starts from a
+ *  reset table, so its results do not depend on earlier calls.
  *
  *  @see apol_policy_reset_domain_trans_table()
  */
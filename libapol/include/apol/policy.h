@@ -42,6 +42,22 @@ extern "C"
 
 	typedef void (*apol_callback_fn_t) (void *varg, const apol_policy_t * p, int level, const char *fmt, va_list argp);
 
+/**
+ * Function called for each result of a query run by one of the
+ * foreach_by_query functions, such as apol_avrule_foreach_by_query(),
+ * in the order in which the corresponding get_by_query function would
+ * have appended it to its vector.
+ *
+ * @param p Policy being searched.
+ * @param result One result, of the type held by the vector that the
+ * corresponding get_by_query function returns.
+ * @param arg Argument given to the foreach_by_query function.
+ *
+ * @return 0 to continue searching, or non-zero to stop the search;
+ * the foreach_by_query function then returns this value.
+ */
+	typedef int (*apol_query_result_fn_t) (const apol_policy_t * p, void *result, void *arg);
+
 /**
  * When creating an apol_policy, load all components except rules
  * (both AV and TE rules).  For modular policies, this affects both
@@ -99,6 +115,57 @@ extern "C"
  */
 	extern int apol_policy_get_policy_handle_unknown(const apol_policy_t * policy);
 
+/**
+ * Make a policy read only, so that one loaded policy may serve a pool
+ * of query threads.  The underlying qpol policy is frozen (see
+ * qpol_policy_freeze()) and, if rules were loaded, the domain
+ * transition table is built.  Afterwards all queries and analyses
+ * that take a const apol_policy_t may run concurrently, domain
+ * transition analyses take turns with the table, and loading or
+ * changing the permission map fails with EPERM; load one before
+ * freezing if information flow analysis is wanted.  The policy's
+ * message callback must itself be thread safe.
+ *
+ * @param policy Policy to freeze.
+ *
+ * @return 0 on success (including if already frozen), < 0 on error.
+ */
+	extern int apol_policy_freeze(apol_policy_t * policy);
+
+/**
+ * Determine if a policy has been frozen by apol_policy_freeze().
+ *
+ * @param policy Policy to check.
+ *
+ * @return Non-zero if the policy is frozen, and zero otherwise.
+ */
+	extern int apol_policy_is_frozen(const apol_policy_t * policy);
+
+/**
+ * Get the fingerprint of a policy, which is the same for any two
+ * policies loaded from the same files with the same options.  Caches
+ * of analysis results, such as a domain transition table or an
+ * information flow graph, may be keyed on it and reused across
+ * processes.  See qpol_policy_get_fingerprint() for details.
+ *
+ * @param policy Policy whose fingerprint to get.
+ * @param fingerprint Pointer in which to store the fingerprint.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+	extern int apol_policy_get_fingerprint(const apol_policy_t * policy, uint64_t * fingerprint);
+
+/**
+ * Get the fingerprint of a policy as a string of 16 hexadecimal
+ * digits, suitable for use in a file name.
+ *
+ * @param policy Policy whose fingerprint to get.
+ *
+ * @return Fingerprint string, or NULL upon error.  The caller must
+ * free() this afterwards.
+ */
+	extern char *apol_policy_get_fingerprint_str(const apol_policy_t * policy);
+
 /**
  * Given a policy, return a pointer to the underlying qpol_policy.
  * This is needed, for example, to access details of particulary qpol
@@ -50,9 +50,36 @@ extern "C"
  * results or upon error.
  *
  * @return 0 on success (including none found), negative on error.
+ * @note If the policy is frozen, the query is compiled once into a
+ * plan of type and class bitsets and the plan is kept within the
+ * query for later runs, until the query is next modified.  Thus one
+ * query must not be run by several threads at once.
  */
 	extern int apol_terule_get_by_query(const apol_policy_t * p, const apol_terule_query_t * t, apol_vector_t ** v);
 
+/**
+ * Execute a query against all type enforcement rules within the policy,
+ * calling a function for each matching rule as it is found rather
+ * than gathering the rules into a vector.  The rules are passed in
+ * the same order as apol_terule_get_by_query() would return them.
+ * When the query runs on several threads (see
+ * apol_terule_query_set_threads()), each walk over the rule tables
+ * is finished before its rules are passed on; the function is always
+ * called from the calling thread.
+ *
+ * @param p Policy within which to look up terules.
+ * @param t Structure containing parameters for query.	If this is
+ * NULL then consider all terules.
+ * @param fn Function to call with each matching rule, of type
+ * qpol_terule_t.  If it returns non-zero the search stops.
+ * @param arg Argument passed to fn.
+ *
+ * @return 0 on success (including none found), negative on error, or
+ * the non-zero value returned by fn to stop the search.
+ */
+	extern int apol_terule_foreach_by_query(const apol_policy_t * p, const apol_terule_query_t * t,
+						 apol_query_result_fn_t fn, void *arg);
+
 /**
  * Execute a query against all syntactic type enforcement rules within
  * the policy.  If the policy has line numbers, then the returned list
@@ -261,6 +288,23 @@ extern "C"
  */
 	extern int apol_terule_query_set_regex(const apol_policy_t * p, apol_terule_query_t * t, int is_regex);
 
+/**
+ * Set the number of threads with which to run a terule query.  Once the
+ * policy's qpol policy has been frozen (see qpol_policy_freeze()), the
+ * rules are searched in parts by up to that many threads at once, and
+ * the results of the parts are merged so that they are in the same
+ * order as from a search by one thread.  Otherwise the query always
+ * runs on the calling thread.  The default is 1.
+ *
+ * @param p Policy handler, to report errors.
+ * @param t TE rule query to set.
+ * @param num_threads Maximum number of threads, or 0 for one per
+ * online processor.
+ *
+ * @return Always 0.
+ */
+	extern int apol_terule_query_set_threads(const apol_policy_t * p, apol_terule_query_t * t, size_t num_threads);
+
 /**
  * Given a single terule, return a newly allocated vector of
  * qpol_syn_terule_t pointers (relative to the given policy) which
@@ -296,7 +296,8 @@ extern "C"
 
 /**
  *  Sort the vector's elements within place, using an unstable sorting
- *  algorithm.
+ *  algorithm (introsort, taking O(n log n) time even on sorted or
+ *  reversed input).
  *
  *  @param v The vector to sort.
  *  @param cmp A comparison call back for the type of element stored
@@ -311,8 +312,51 @@ extern "C"
 	extern void apol_vector_sort(apol_vector_t * v, apol_vector_comp_func * cmp, void *data);
 
 /**
- *  Sort the vector's elements within place (see apol_vector_sort()),
- *  and then compact vector by removing duplicate entries.  The
+ *  Sort the vector's elements within place, using a stable sorting
+ *  algorithm (merge sort); elements that compare equal keep their
+ *  relative order.  The sort needs scratch space of one pointer per
+ *  element.
+ *
+ *  @param v The vector to sort.
+ *  @param cmp A comparison call back for the type of element stored
+ *  in the vector, as for apol_vector_sort().  If this is NULL then
+ *  treat the vector's contents as unsigned integers and sort in
+ *  increasing order.
+ *  @param data Arbitrary data to pass as the comparison function's
+ *  third paramater.
+ *
+ *  @return 0 on success, < 0 on error (with errno set and the vector
+ *  unchanged).
+ */
+	extern int apol_vector_sort_stable(apol_vector_t * v, apol_vector_comp_func * cmp, void *data);
+
+/**
+ *  Sort the vector's elements within place, as apol_vector_sort()
+ *  does, but split among several threads: each thread sorts a run of
+ *  the vector, then pairs of runs are merged, a thread for each pair.
+ *  Vectors too small to gain from threads are sorted by the calling
+ *  thread alone.  The comparison function must be safe to call from
+ *  several threads at once.
+ *
+ *  @param v The vector to sort.
+ *  @param cmp A comparison call back for the type of element stored
+ *  in the vector, as for apol_vector_sort().  If this is NULL then
+ *  treat the vector's contents as unsigned integers and sort in
+ *  increasing order.
+ *  @param data Arbitrary data to pass as the comparison function's
+ *  third paramater.
+ *  @param num_threads Maximum number of threads to sort with, or 0
+ *  for one per online processor.
+ *
+ *  @return 0 on success, < 0 on error (with errno set and the vector
+ *  unchanged).
+ */
+	extern int apol_vector_sort_parallel(apol_vector_t * v, apol_vector_comp_func * cmp, void *data, size_t num_threads);
+
+/**
+ *  Sort the vector's elements within place (see
+ *  apol_vector_sort_stable()), and then compact vector by removing
+ *  duplicate entries; of equal elements, the first is kept.  The
  *  vector's free function will be used to free the memory used by
  *  non-unique elements.
  *
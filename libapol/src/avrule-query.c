@@ -33,285 +33,706 @@
 #include <errno.h>
 #include <string.h>
 
+/**
+ * A query compiled against a policy.  The candidate types are kept
+ * as lists, which choose the parts of the rule index to walk, and as
+ * bitsets by type value, against which each rule's source and target
+ * are matched; the classes become a bitset by class value and the
+ * permissions a mask for each class.  A query keeps its plan for
+ * later runs against the same frozen policy.
+ */
+typedef struct avrule_plan
+{
+	/** serial number of the frozen policy against which the plan
+	 *  was compiled, or 0 if the policy was not frozen */
+	unsigned long policy_serial;
+	uint32_t rule_type;
+	unsigned int flags;
+	/** candidate source and target types, or NULL to accept all
+	 *  types; the same list when treating the source as any field */
+	apol_vector_t *source_list, *target_list;
+	apol_query_bitset_t sources, targets, classes;
+	/** permission masks indexed by class value - 1, as returned by
+	 *  perm_list_to_class_masks(), or NULL to accept all permissions */
+	uint32_t *perm_masks;
+	size_t num_classes;
+	char *bool_name;
+	/** compiled boolean regex, compiled upon first use by a
+	 *  search on one thread */
+	regex_t *bool_regex;
+} avrule_plan_t;
+
 struct apol_avrule_query
 {
 	char *source, *target, *bool_name;
 	apol_vector_t *classes, *perms;
 	unsigned int rules;
 	unsigned int flags;
+	size_t num_threads;
+	/** plan from the last run, if against a frozen policy */
+	avrule_plan_t *plan;
 };
 
 /**
- *  Common semantic rule selection routine used in get*rule_by_query.
+ *  Determine if a rule matches a compiled query.  The rule's type is
+ *  not checked; the caller only considers rules of the query's types.
  *  @param p Policy to search.
- *  @param v Vector of rules to populate (of type qpol_avrule_t).
- *  @param rule_type Mask of rules to search.
- *  @param flags Query options as specified by the apol_avrule_query.
- *  @param source_list If non-NULL, list of types to use as source.
- *  If NULL, accept all types.
- *  @param target_list If non-NULL, list of types to use as target.
- *  If NULL, accept all types.
- *  @param class_list If non-NULL, list of classes to use.
- *  If NULL, accept all classes.
- *  @param perm_list If non-NULL, list of permisions to use.
- *  If NULL, accept all permissions.
- *  @param bool_name If non-NULL, find conditional rules affected by this boolean.
- *  If NULL, all rules will be considered (including unconditional rules).
- *  @return 0 on success and < 0 on failure.
+ *  @param rule Rule to check.
+ *  @param plan Compiled query.
+ *  @param bool_regex Reference to the compiled boolean regex, compiled
+ *  upon first use.
+ *  @param skip_sources If non-zero, reject rules whose source is a
+ *  candidate source, and otherwise match by target alone; used when
+ *  treating the source as any field to avoid returning a rule twice.
+ *  @return 1 if the rule matches, 0 if not, and < 0 on failure.
  */
-static int rule_select(const apol_policy_t * p, apol_vector_t * v, uint32_t rule_type, unsigned int flags,
-		       const apol_vector_t * source_list, const apol_vector_t * target_list, const apol_vector_t * class_list,
-		       const apol_vector_t * perm_list, const char *bool_name)
+static int rule_matches(const apol_policy_t * p, const qpol_avrule_t * rule, const avrule_plan_t * plan, regex_t ** bool_regex,
+			int skip_sources)
 {
-	qpol_iterator_t *iter = NULL, *perm_iter = NULL;
-	const int only_enabled = flags & APOL_QUERY_ONLY_ENABLED;
-	const int is_regex = flags & APOL_QUERY_REGEX;
-	const int source_as_any = flags & APOL_QUERY_SOURCE_AS_ANY;
-	size_t num_perms_to_match = 1;
-	int retv = -1;
-	regex_t *bool_regex = NULL;
-
-	if ((flags & APOL_QUERY_MATCH_ALL_PERMS) && perm_list != NULL) {
-		num_perms_to_match = apol_vector_get_size(perm_list);
+	const int only_enabled = plan->flags & APOL_QUERY_ONLY_ENABLED;
+	const int is_regex = plan->flags & APOL_QUERY_REGEX;
+	const int source_as_any = plan->flags & APOL_QUERY_SOURCE_AS_ANY;
+	const int match_all_perms = plan->flags & APOL_QUERY_MATCH_ALL_PERMS;
+	uint32_t is_enabled;
+	const qpol_cond_t *cond = NULL;
+	int match_source = 1, match_target = 1, match_bool = 0;
+
+	if (qpol_avrule_get_is_enabled(p->p, rule, &is_enabled) < 0) {
+		return -1;
 	}
-	if (qpol_policy_get_avrule_iter(p->p, rule_type, &iter) < 0) {
-		goto cleanup;
+	if (!is_enabled && only_enabled) {
+		return 0;
 	}
-	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
-		qpol_avrule_t *rule;
-		uint32_t is_enabled;
-		const qpol_cond_t *cond = NULL;
-		int match_source = 0, match_target = 0, match_bool = 0;
-		size_t match_perm = 0, i;
-		if (qpol_iterator_get_item(iter, (void **)&rule) < 0) {
-			goto cleanup;
+
+	if (plan->bool_name != NULL) {
+		if (qpol_avrule_get_cond(p->p, rule, &cond) < 0) {
+			return -1;
+		}
+		if (cond == NULL) {
+			return 0;	/* skip unconditional rule */
 		}
+		match_bool = apol_compare_cond_expr(p, cond, plan->bool_name, is_regex, bool_regex);
+		if (match_bool < 0) {
+			return -1;
+		} else if (match_bool == 0) {
+			return 0;
+		}
+	}
 
-		if (qpol_avrule_get_is_enabled(p->p, rule, &is_enabled) < 0) {
-			goto cleanup;
+	if (plan->sources.bits != NULL) {
+		const qpol_type_t *source_type;
+		uint32_t source_val;
+		if (qpol_avrule_get_source_type(p->p, rule, &source_type) < 0 ||
+		    qpol_type_get_value(p->p, source_type, &source_val) < 0) {
+			return -1;
 		}
-		if (!is_enabled && only_enabled) {
-			continue;
+		match_source = apol_query_bitset_test(&plan->sources, source_val);
+		if (skip_sources && match_source) {
+			return 0;
 		}
+	}
 
-		if (bool_name != NULL) {
-			if (qpol_avrule_get_cond(p->p, rule, &cond) < 0) {
-				goto cleanup;
-			}
-			if (cond == NULL) {
-				continue;	/* skip unconditional rule */
-			}
-			match_bool = apol_compare_cond_expr(p, cond, bool_name, is_regex, &bool_regex);
-			if (match_bool < 0) {
-				goto cleanup;
-			} else if (match_bool == 0) {
-				continue;
-			}
+	/* if source did not match, but treating source symbol
+	 * as any field, then delay rejecting this rule until
+	 * the target has been checked */
+	if (!source_as_any && !match_source) {
+		return 0;
+	}
+
+	if (plan->targets.bits != NULL && !(source_as_any && match_source)) {
+		const qpol_type_t *target_type;
+		uint32_t target_val;
+		if (qpol_avrule_get_target_type(p->p, rule, &target_type) < 0 ||
+		    qpol_type_get_value(p->p, target_type, &target_val) < 0) {
+			return -1;
 		}
+		match_target = apol_query_bitset_test(&plan->targets, target_val);
+	}
 
-		if (source_list == NULL) {
-			match_source = 1;
-		} else {
-			const qpol_type_t *source_type;
-			if (qpol_avrule_get_source_type(p->p, rule, &source_type) < 0) {
-				goto cleanup;
+	if (!match_target) {
+		return 0;
+	}
+
+	if (plan->classes.bits != NULL || plan->perm_masks != NULL) {
+		const qpol_class_t *obj_class;
+		uint32_t class_val;
+		if (qpol_avrule_get_object_class(p->p, rule, &obj_class) < 0 ||
+		    qpol_class_get_value(p->p, obj_class, &class_val) < 0) {
+			return -1;
+		}
+		if (!apol_query_bitset_test(&plan->classes, class_val)) {
+			return 0;
+		}
+		if (plan->perm_masks != NULL) {
+			uint32_t rule_perms, wanted = 0;
+			if (qpol_avrule_get_perm_mask(p->p, rule, &rule_perms) < 0) {
+				return -1;
+			}
+			if (class_val >= 1 && class_val <= plan->num_classes) {
+				wanted = plan->perm_masks[class_val - 1];
 			}
-			if (apol_vector_get_index(source_list, source_type, NULL, NULL, &i) == 0) {
-				match_source = 1;
+			if (match_all_perms ? (wanted == 0 || (rule_perms & wanted) != wanted) : !(rule_perms & wanted)) {
+				return 0;
 			}
 		}
+	}
 
-		/* if source did not match, but treating source symbol
-		 * as any field, then delay rejecting this rule until
-		 * the target has been checked */
-		if (!source_as_any && !match_source) {
-			continue;
-		}
+	return 1;
+}
 
-		if (target_list == NULL || (source_as_any && match_source)) {
-			match_target = 1;
-		} else {
-			const qpol_type_t *target_type;
-			if (qpol_avrule_get_target_type(p->p, rule, &target_type) < 0) {
-				goto cleanup;
+/**
+ *  Pass to a function those rules from an iterator that match a
+ *  compiled query.
+ *  @param p Policy to search.
+ *  @param iter Iterator over rules (of type qpol_avrule_t) to consider.
+ *  @param fn Function to call for each matching rule.
+ *  @param arg Argument passed to fn.
+ *  @param plan Compiled query.
+ *  @param bool_regex Reference to the compiled boolean regex, compiled
+ *  upon first use.
+ *  @param skip_sources Passed to rule_matches().
+ *  @return 0 on success, < 0 on failure, or the non-zero value
+ *  returned by fn to stop.
+ */
+static int rule_select_from_iter(const apol_policy_t * p, qpol_iterator_t * iter, apol_query_result_fn_t fn, void *arg,
+				 const avrule_plan_t * plan, regex_t ** bool_regex, int skip_sources)
+{
+	void *rules[APOL_QUERY_BATCH_SIZE];
+	size_t num_rules, r;
+	int ret;
+
+	for (;;) {
+		if (qpol_iterator_get_items(iter, rules, APOL_QUERY_BATCH_SIZE, &num_rules) < 0) {
+			return -1;
+		}
+		if (num_rules == 0) {
+			break;
+		}
+		for (r = 0; r < num_rules; r++) {
+			if ((ret = rule_matches(p, rules[r], plan, bool_regex, skip_sources)) < 0) {
+				return -1;
 			}
-			if (apol_vector_get_index(target_list, target_type, NULL, NULL, &i) == 0) {
-				match_target = 1;
+			if (ret && (ret = fn(p, rules[r], arg)) != 0) {
+				return ret;
 			}
 		}
+	}
+	return 0;
+}
 
-		if (!match_target) {
-			continue;
-		}
+/**
+ *  Resolve a list of permission names into, for each class in the
+ *  policy, the mask of those permissions within the class.  When all
+ *  permissions must match, a class lacking any of them gets a mask of
+ *  0 so that none of its rules can match.
+ *  @param p Policy containing the classes.
+ *  @param perm_list List of permission names.
+ *  @param match_all If non-zero all permissions must match.
+ *  @param num_classes Reference to the number of classes in the policy.
+ *  @return An array of masks indexed by class value - 1, which the
+ *  caller must free, or NULL on error.
+ */
+static uint32_t *perm_list_to_class_masks(const apol_policy_t * p, const apol_vector_t * perm_list, int match_all,
+					  size_t * num_classes)
+{
+	qpol_iterator_t *iter = NULL;
+	uint32_t *masks = NULL;
+	int retv = -1;
+	size_t i;
 
-		if (class_list != NULL) {
-			const qpol_class_t *obj_class;
-			if (qpol_avrule_get_object_class(p->p, rule, &obj_class) < 0) {
+	if (qpol_policy_get_class_iter(p->p, &iter) < 0 || qpol_iterator_get_size(iter, num_classes) < 0) {
+		goto cleanup;
+	}
+	if ((masks = calloc(*num_classes + 1, sizeof(*masks))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		const qpol_class_t *obj_class;
+		uint32_t class_val, mask = 0, perm_mask;
+		if (qpol_iterator_get_item(iter, (void **)&obj_class) < 0 || qpol_class_get_value(p->p, obj_class, &class_val) < 0) {
+			goto cleanup;
+		}
+		for (i = 0; i < apol_vector_get_size(perm_list); i++) {
+			const char *perm = apol_vector_get_element(perm_list, i);
+			if (qpol_class_get_perm_mask(p->p, obj_class, perm, &perm_mask) < 0) {
 				goto cleanup;
 			}
-			if (apol_vector_get_index(class_list, obj_class, NULL, NULL, &i) < 0) {
-				continue;
-			}
-		}
-
-		if (perm_list != NULL) {
-			for (i = 0; i < apol_vector_get_size(perm_list) && match_perm < num_perms_to_match; i++) {
-				char *perm = (char *)apol_vector_get_element(perm_list, i);
-				if (qpol_avrule_get_perm_iter(p->p, rule, &perm_iter) < 0) {
-					goto cleanup;
-				}
-				int match = apol_compare_iter(p, perm_iter, perm, 0, NULL, 1);
-				if (match < 0) {
-					goto cleanup;
-				} else if (match > 0) {
-					match_perm++;
-				}
-				qpol_iterator_destroy(&perm_iter);
+			if (perm_mask == 0 && match_all) {
+				mask = 0;
+				break;
 			}
-		} else {
-			match_perm = num_perms_to_match;
-		}
-		if (match_perm < num_perms_to_match) {
-			continue;
+			mask |= perm_mask;
 		}
-
-		if (apol_vector_append(v, rule)) {
-			ERR(p, "%s", strerror(ENOMEM));
-			goto cleanup;
+		if (class_val >= 1 && class_val <= *num_classes) {
+			masks[class_val - 1] = mask;
 		}
 	}
 
 	retv = 0;
       cleanup:
-	apol_regex_destroy(&bool_regex);
 	qpol_iterator_destroy(&iter);
-	qpol_iterator_destroy(&perm_iter);
-	return retv;
+	if (retv < 0) {
+		free(masks);
+		return NULL;
+	}
+	return masks;
 }
 
-int apol_avrule_get_by_query(const apol_policy_t * p, const apol_avrule_query_t * a, apol_vector_t ** v)
+/**
+ *  Free all memory used by a compiled query and set it to NULL.  Does
+ *  nothing if the reference is already NULL.
+ *  @param plan Reference to the plan to destroy.
+ */
+static void avrule_plan_destroy(avrule_plan_t ** plan)
 {
-	apol_vector_t *source_list = NULL, *target_list = NULL, *class_list = NULL, *perm_list = NULL;
-	int retval = -1, source_as_any = 0, is_regex = 0;
-	char *bool_name = NULL;
-	*v = NULL;
-	unsigned int flags = 0;
+	if (*plan != NULL) {
+		if ((*plan)->target_list == (*plan)->source_list) {
+			(*plan)->target_list = NULL;
+		}
+		apol_vector_destroy(&(*plan)->source_list);
+		apol_vector_destroy(&(*plan)->target_list);
+		apol_query_bitset_destroy(&(*plan)->sources);
+		apol_query_bitset_destroy(&(*plan)->targets);
+		apol_query_bitset_destroy(&(*plan)->classes);
+		free((*plan)->perm_masks);
+		free((*plan)->bool_name);
+		apol_regex_destroy(&(*plan)->bool_regex);
+		free(*plan);
+		*plan = NULL;
+	}
+}
 
-	uint32_t rule_type = QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT;
-//	if (qpol_policy_has_capability(apol_policy_get_qpol(p), QPOL_CAP_NEVERALLOW)) {
-		rule_type |= QPOL_RULE_NEVERALLOW;
-//	}
+/**
+ *  Compile a query against a policy.
+ *  @param p Policy to be searched.
+ *  @param a Query to compile, or NULL to match all rules.
+ *  @param is_syn If non-zero, the candidate types will include those
+ *  needed for syntactic rule searching.
+ *  @return The compiled query, to be destroyed by
+ *  avrule_plan_destroy(), or NULL on error.
+ */
+static avrule_plan_t *avrule_plan_create(const apol_policy_t * p, const apol_avrule_query_t * a, int is_syn)
+{
+	apol_vector_t *(*create_type_list) (const apol_policy_t *, const char *, int, int, unsigned int) =
+		(is_syn ? apol_query_create_candidate_syn_type_list : apol_query_create_candidate_type_list);
+	apol_vector_t *class_list = NULL;
+	avrule_plan_t *plan = NULL;
+	int retval = -1, is_regex;
+
+	if ((plan = calloc(1, sizeof(*plan))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	plan->policy_serial = p->frozen;
+	plan->rule_type = QPOL_RULE_ALLOW | QPOL_RULE_NEVERALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT;
 	if (a != NULL) {
 		if (a->rules != 0) {
-			rule_type &= a->rules;
+			plan->rule_type &= a->rules;
 		}
-		flags = a->flags;
+		plan->flags = a->flags;
 		is_regex = a->flags & APOL_QUERY_REGEX;
-		bool_name = a->bool_name;
+		if (a->bool_name != NULL && (plan->bool_name = strdup(a->bool_name)) == NULL) {
+			ERR(p, "%s", strerror(errno));
+			goto cleanup;
+		}
 		if (a->source != NULL &&
-		    (source_list =
-		     apol_query_create_candidate_type_list(p, a->source, is_regex,
-							   a->flags & APOL_QUERY_SOURCE_INDIRECT,
-							   ((a->flags & (APOL_QUERY_SOURCE_TYPE | APOL_QUERY_SOURCE_ATTRIBUTE)) /
-							    APOL_QUERY_SOURCE_TYPE))) == NULL) {
+		    (plan->source_list =
+		     create_type_list(p, a->source, is_regex,
+				      a->flags & APOL_QUERY_SOURCE_INDIRECT,
+				      ((a->flags & (APOL_QUERY_SOURCE_TYPE | APOL_QUERY_SOURCE_ATTRIBUTE)) /
+				       APOL_QUERY_SOURCE_TYPE))) == NULL) {
 			goto cleanup;
 		}
 		if ((a->flags & APOL_QUERY_SOURCE_AS_ANY) && a->source != NULL) {
-			target_list = source_list;
-			source_as_any = 1;
-		} else if (a->target != NULL &&
-			   (target_list =
-			    apol_query_create_candidate_type_list(p, a->target, is_regex,
-								  a->flags & APOL_QUERY_TARGET_INDIRECT,
-								  ((a->
-								    flags & (APOL_QUERY_TARGET_TYPE | APOL_QUERY_TARGET_ATTRIBUTE))
-								   / APOL_QUERY_TARGET_TYPE))) == NULL) {
-			goto cleanup;
+			plan->target_list = plan->source_list;
+		} else {
+			plan->flags &= ~APOL_QUERY_SOURCE_AS_ANY;
+			if (a->target != NULL &&
+			    (plan->target_list =
+			     create_type_list(p, a->target, is_regex,
+					      a->flags & APOL_QUERY_TARGET_INDIRECT,
+					      ((a->flags & (APOL_QUERY_TARGET_TYPE | APOL_QUERY_TARGET_ATTRIBUTE)) /
+					       APOL_QUERY_TARGET_TYPE))) == NULL) {
+				goto cleanup;
+			}
 		}
 		if (a->classes != NULL &&
 		    apol_vector_get_size(a->classes) > 0 &&
 		    (class_list = apol_query_create_candidate_class_list(p, a->classes)) == NULL) {
 			goto cleanup;
 		}
-		if (a->perms != NULL && apol_vector_get_size(a->perms) > 0) {
-			perm_list = a->perms;
+		if (a->perms != NULL && apol_vector_get_size(a->perms) > 0 &&
+		    (plan->perm_masks =
+		     perm_list_to_class_masks(p, a->perms, a->flags & APOL_QUERY_MATCH_ALL_PERMS, &plan->num_classes)) == NULL) {
+			goto cleanup;
+		}
+	}
+	if (apol_query_create_type_bitset(p, plan->source_list, &plan->sources) < 0 ||
+	    apol_query_create_type_bitset(p, plan->target_list, &plan->targets) < 0 ||
+	    apol_query_create_class_bitset(p, class_list, &plan->classes) < 0) {
+		goto cleanup;
+	}
+
+	retval = 0;
+      cleanup:
+	apol_vector_destroy(&class_list);
+	if (retval != 0) {
+		avrule_plan_destroy(&plan);
+	}
+	return plan;
+}
+
+/** Walks over the rule tables that rule_select() may take. */
+#define RULE_WALK_ALL 0
+#define RULE_WALK_BY_SOURCE 1
+#define RULE_WALK_BY_TARGET 2
+
+/**
+ *  Select the rules matching a compiled query from one part of one
+ *  walk over the rule tables.
+ *  @param p Policy to search.
+ *  @param fn Function to call for each matching rule.
+ *  @param arg Argument passed to fn.
+ *  @param plan Compiled query.
+ *  @param bool_regex Reference to the compiled boolean regex, compiled
+ *  upon first use.
+ *  @param walk RULE_WALK_ALL to examine every rule, or
+ *  RULE_WALK_BY_SOURCE or RULE_WALK_BY_TARGET to examine the rules
+ *  indexed under each candidate source or target type.
+ *  @param part Part of the walk to take: a range of the buckets of the
+ *  rule tables, or of the candidate types.
+ *  @param num_parts Number of parts into which the walk is split.
+ *  @return 0 on success, < 0 on failure, or the non-zero value
+ *  returned by fn to stop.
+ */
+static int rule_select_part(const apol_policy_t * p, apol_query_result_fn_t fn, void *arg, avrule_plan_t * plan,
+			    regex_t ** bool_regex, int walk, size_t part, size_t num_parts)
+{
+	qpol_iterator_t *iter = NULL;
+	const apol_vector_t *list = (walk == RULE_WALK_BY_SOURCE ? plan->source_list : plan->target_list);
+	int retv = -1, ret;
+	size_t i, num;
+
+	if (walk == RULE_WALK_ALL) {
+		if (qpol_policy_get_avrule_iter_part(p->p, plan->rule_type, part, num_parts, &iter) < 0) {
+			goto cleanup;
+		}
+		if ((ret = rule_select_from_iter(p, iter, fn, arg, plan, bool_regex, 0)) != 0) {
+			retv = ret;
+			goto cleanup;
+		}
+	} else {
+		num = apol_vector_get_size(list);
+		for (i = num * part / num_parts; i < num * (part + 1) / num_parts; i++) {
+			const qpol_type_t *type = apol_vector_get_element(list, i);
+			if ((walk == RULE_WALK_BY_SOURCE ?
+			     qpol_policy_get_avrule_iter_by_source(p->p, plan->rule_type, type, &iter) :
+			     qpol_policy_get_avrule_iter_by_target(p->p, plan->rule_type, type, &iter)) < 0) {
+				goto cleanup;
+			}
+			if ((ret = rule_select_from_iter(p, iter, fn, arg, plan, bool_regex, walk == RULE_WALK_BY_TARGET
+							 && (plan->flags & APOL_QUERY_SOURCE_AS_ANY))) != 0) {
+				retv = ret;
+				goto cleanup;
+			}
+			qpol_iterator_destroy(&iter);
+		}
+	}
+
+	retv = 0;
+      cleanup:
+	qpol_iterator_destroy(&iter);
+	return retv;
+}
+
+/** One walk over the rule tables, to be split among threads. */
+typedef struct rule_select_walk
+{
+	const apol_policy_t *p;
+	avrule_plan_t *plan;
+	int walk;
+	size_t num_parts;
+} rule_select_walk_t;
+
+/**
+ *  Select the rules from one part of a walk, as called by
+ *  apol_query_select_parallel().  Each part compiles its own boolean
+ *  regex, so that parts running at once share nothing they modify.
+ */
+static int rule_select_walk_part(size_t part, apol_vector_t * v, void *arg)
+{
+	rule_select_walk_t *w = arg;
+	regex_t *bool_regex = NULL;
+	int retv;
+
+	retv = rule_select_part(w->p, apol_query_append_result, v, w->plan, &bool_regex, w->walk, part, w->num_parts);
+	apol_regex_destroy(&bool_regex);
+	return retv;
+}
+
+/**
+ *  Common semantic rule selection routine used in get*rule_by_query.
+ *  If the query names source or target types then only the rules
+ *  indexed under those types are examined; otherwise every rule in
+ *  the policy is.  Each walk over the rules may be split among
+ *  several threads, with the results passed on in the same order as
+ *  if one thread had taken the whole walk.
+ *  @param p Policy to search.
+ *  @param fn Function to call for each matching rule.
+ *  @param arg Argument passed to fn.
+ *  @param plan Compiled query.
+ *  @param num_threads Number of threads requested, as given to
+ *  apol_query_get_num_threads().
+ *  @return 0 on success, < 0 on failure, or the non-zero value
+ *  returned by fn to stop.
+ */
+static int rule_select(const apol_policy_t * p, apol_query_result_fn_t fn, void *arg, avrule_plan_t * plan,
+		       size_t num_threads)
+{
+	const int source_as_any = plan->flags & APOL_QUERY_SOURCE_AS_ANY;
+	int walks[2], num_walks = 0, i;
+	rule_select_walk_t w;
+	int retv;
+
+	if (plan->source_list == NULL && plan->target_list == NULL) {
+		walks[num_walks++] = RULE_WALK_ALL;
+	}
+	if (plan->source_list != NULL) {
+		walks[num_walks++] = RULE_WALK_BY_SOURCE;
+	}
+	/* when treating the source as any field, also find rules
+	 * whose target matches but whose source did not (those were
+	 * already found above) */
+	if (plan->target_list != NULL && (plan->source_list == NULL || source_as_any)) {
+		walks[num_walks++] = RULE_WALK_BY_TARGET;
+	}
+
+	num_threads = apol_query_get_num_threads(p, num_threads);
+	for (i = 0; i < num_walks; i++) {
+		if (num_threads <= 1) {
+			if ((retv = rule_select_part(p, fn, arg, plan, &plan->bool_regex, walks[i], 0, 1)) != 0) {
+				return retv;
+			}
+			continue;
+		}
+		w.p = p;
+		w.plan = plan;
+		w.walk = walks[i];
+		w.num_parts = num_threads * APOL_QUERY_PARTS_PER_THREAD;
+		if (w.walk != RULE_WALK_ALL) {
+			size_t num = apol_vector_get_size(w.walk == RULE_WALK_BY_SOURCE ? plan->source_list : plan->target_list);
+			if (num < w.num_parts) {
+				w.num_parts = num;
+			}
+		}
+		if (w.num_parts > 0 &&
+		    (retv = apol_query_select_parallel(p, fn, arg, w.num_parts, num_threads, rule_select_walk_part, &w)) != 0) {
+			return retv;
 		}
 	}
+	return 0;
+}
+
+/**
+ *  Get the compiled form of a query: the query's own plan if it was
+ *  compiled against this frozen policy, and a newly compiled plan
+ *  otherwise.  A new plan for a frozen policy is kept in the query.
+ *  @param p Policy to be searched.
+ *  @param a Query to compile, or NULL to match all rules.
+ *  @return The plan, to be released by avrule_plan_release(), or NULL
+ *  on error.
+ */
+static avrule_plan_t *avrule_plan_get(const apol_policy_t * p, const apol_avrule_query_t * a)
+{
+	avrule_plan_t *plan;
 
+	if (a != NULL && a->plan != NULL && apol_policy_is_frozen(p) && a->plan->policy_serial == p->frozen) {
+		return a->plan;
+	}
+	if ((plan = avrule_plan_create(p, a, 0)) != NULL && a != NULL && plan->policy_serial != 0) {
+		/* the policy can no longer change, so keep the plan
+		 * for the query's next run */
+		avrule_plan_destroy(&((apol_avrule_query_t *) a)->plan);
+		((apol_avrule_query_t *) a)->plan = plan;
+	}
+	return plan;
+}
+
+/**
+ *  Release a plan obtained from avrule_plan_get(), destroying it
+ *  unless the query keeps it, and set the reference to NULL.
+ *  @param a Query from which the plan was compiled.
+ *  @param plan Reference to the plan to release.
+ */
+static void avrule_plan_release(const apol_avrule_query_t * a, avrule_plan_t ** plan)
+{
+	if (a == NULL || *plan != a->plan) {
+		avrule_plan_destroy(plan);
+	}
+	*plan = NULL;
+}
+
+int apol_avrule_foreach_by_query(const apol_policy_t * p, const apol_avrule_query_t * a, apol_query_result_fn_t fn, void *arg)
+{
+	avrule_plan_t *plan;
+	int retval;
+
+	if ((plan = avrule_plan_get(p, a)) == NULL) {
+		return -1;
+	}
+	retval = rule_select(p, fn, arg, plan, (a != NULL ? a->num_threads : 1));
+	avrule_plan_release(a, &plan);
+	return retval;
+}
+
+int apol_avrule_get_by_query(const apol_policy_t * p, const apol_avrule_query_t * a, apol_vector_t ** v)
+{
 	if ((*v = apol_vector_create(NULL)) == NULL) {
 		ERR(p, "%s", strerror(errno));
+		return -1;
+	}
+	if (apol_avrule_foreach_by_query(p, a, apol_query_append_result, *v)) {
+		apol_vector_destroy(v);
+		return -1;
+	}
+	return 0;
+}
+
+int apol_avrule_foreach_by_queries(const apol_policy_t * p, apol_avrule_query_t * const *queries, size_t num_queries,
+				   apol_query_result_fn_t fn, void *const *args)
+{
+	avrule_plan_t **plans = NULL;
+	qpol_iterator_t *iter = NULL;
+	void *rules[APOL_QUERY_BATCH_SIZE];
+	uint32_t rule_types = 0, rule_type;
+	size_t num_rules, r, i;
+	int retval = -1, ret;
+
+	if (p == NULL || (num_queries > 0 && (queries == NULL || fn == NULL))) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	if (num_queries == 0) {
+		return 0;
+	}
+
+	if ((plans = calloc(num_queries, sizeof(*plans))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	for (i = 0; i < num_queries; i++) {
+		if ((plans[i] = avrule_plan_get(p, queries[i])) == NULL) {
+			goto cleanup;
+		}
+		rule_types |= plans[i]->rule_type;
+	}
+	if (rule_types == 0) {
+		retval = 0;
 		goto cleanup;
 	}
 
-	if (rule_select(p, *v, rule_type, flags, source_list, target_list, class_list, perm_list, bool_name)) {
+	/* one walk over every rule of any of the queries' types; a
+	 * rule goes to each query it matches */
+	if (qpol_policy_get_avrule_iter(p->p, rule_types, &iter) < 0) {
 		goto cleanup;
 	}
+	for (;;) {
+		if (qpol_iterator_get_items(iter, rules, APOL_QUERY_BATCH_SIZE, &num_rules) < 0) {
+			goto cleanup;
+		}
+		if (num_rules == 0) {
+			break;
+		}
+		for (r = 0; r < num_rules; r++) {
+			if (qpol_avrule_get_rule_type(p->p, rules[r], &rule_type) < 0) {
+				goto cleanup;
+			}
+			for (i = 0; i < num_queries; i++) {
+				if (!(plans[i]->rule_type & rule_type)) {
+					continue;
+				}
+				if ((ret = rule_matches(p, rules[r], plans[i], &plans[i]->bool_regex, 0)) < 0) {
+					goto cleanup;
+				}
+				if (ret && (ret = fn(p, rules[r], (args != NULL ? args[i] : NULL))) != 0) {
+					retval = ret;
+					goto cleanup;
+				}
+			}
+		}
+	}
 
 	retval = 0;
       cleanup:
-	if (retval != 0) {
-		apol_vector_destroy(v);
+	qpol_iterator_destroy(&iter);
+	for (i = 0; plans != NULL && i < num_queries; i++) {
+		if (plans[i] != NULL) {
+			avrule_plan_release(queries[i], &plans[i]);
+		}
 	}
-	apol_vector_destroy(&source_list);
-	if (!source_as_any) {
-		apol_vector_destroy(&target_list);
+	free(plans);
+	return retval;
+}
+
+int apol_avrule_get_by_queries(const apol_policy_t * p, apol_avrule_query_t * const *queries, size_t num_queries,
+			       apol_vector_t ** v)
+{
+	void **args = NULL;
+	size_t i;
+	int retval = -1;
+
+	for (i = 0; i < num_queries; i++) {
+		v[i] = NULL;
+	}
+	if (num_queries > 0 && (args = calloc(num_queries, sizeof(*args))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	for (i = 0; i < num_queries; i++) {
+		if ((v[i] = apol_vector_create(NULL)) == NULL) {
+			ERR(p, "%s", strerror(errno));
+			goto cleanup;
+		}
+		args[i] = v[i];
+	}
+	if (apol_avrule_foreach_by_queries(p, queries, num_queries, apol_query_append_result, args)) {
+		goto cleanup;
+	}
+
+	retval = 0;
+      cleanup:
+	free(args);
+	if (retval != 0) {
+		for (i = 0; i < num_queries; i++) {
+			apol_vector_destroy(&v[i]);
+		}
 	}
-	apol_vector_destroy(&class_list);
-	/* don't destroy perm_list - it points to query's permission list */
 	return retval;
 }
 
 int apol_syn_avrule_get_by_query(const apol_policy_t * p, const apol_avrule_query_t * a, apol_vector_t ** v)
 {
 	qpol_iterator_t *iter = NULL, *perm_iter = NULL;
-	apol_vector_t *source_list = NULL, *target_list = NULL, *class_list = NULL, *perm_list = NULL, *syn_v = NULL;
+	apol_vector_t *source_list = NULL, *target_list = NULL, *perm_list = NULL, *syn_v = NULL;
 	apol_vector_t *target_types_list = NULL;
+	avrule_plan_t *plan = NULL;
 	int retval = -1, source_as_any = 0, is_regex = 0;
-	char *bool_name = NULL;
 	regex_t *bool_regex = NULL;
 	*v = NULL;
 	size_t i;
-	unsigned int flags = 0;
 
 	if (!p || !qpol_policy_has_capability(apol_policy_get_qpol(p), QPOL_CAP_SYN_RULES)) {
 		ERR(p, "%s", strerror(EINVAL));
 		goto cleanup;
 	}
 
-	uint32_t rule_type = QPOL_RULE_ALLOW | QPOL_RULE_NEVERALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT;
+	if ((plan = avrule_plan_create(p, a, 1)) == NULL) {
+		goto cleanup;
+	}
 	if (a != NULL) {
-		if (a->rules != 0) {
-			rule_type &= a->rules;
-		}
-		flags = a->flags;
 		is_regex = a->flags & APOL_QUERY_REGEX;
-		bool_name = a->bool_name;
-		if (a->source != NULL &&
-		    (source_list =
-		     apol_query_create_candidate_syn_type_list(p, a->source, is_regex,
-							       a->flags & APOL_QUERY_SOURCE_INDIRECT,
-							       ((a->flags & (APOL_QUERY_SOURCE_TYPE |
-									     APOL_QUERY_SOURCE_ATTRIBUTE)) /
-								APOL_QUERY_SOURCE_TYPE))) == NULL) {
-			goto cleanup;
-		}
-		if ((a->flags & APOL_QUERY_SOURCE_AS_ANY) && a->source != NULL) {
-			target_list = source_list;
-			source_as_any = 1;
-		} else if (a->target != NULL &&
-			   (target_list =
-			    apol_query_create_candidate_syn_type_list(p, a->target, is_regex,
-								      a->flags & APOL_QUERY_TARGET_INDIRECT,
-								      ((a->flags & (APOL_QUERY_TARGET_TYPE |
-										    APOL_QUERY_TARGET_ATTRIBUTE))
-								       / APOL_QUERY_TARGET_TYPE))) == NULL) {
-			goto cleanup;
-		}
-		if (a->classes != NULL &&
-		    apol_vector_get_size(a->classes) > 0 &&
-		    (class_list = apol_query_create_candidate_class_list(p, a->classes)) == NULL) {
-			goto cleanup;
-		}
 		if (a->perms != NULL && apol_vector_get_size(a->perms) > 0) {
 			perm_list = a->perms;
 		}
@@ -322,10 +743,16 @@ int apol_syn_avrule_get_by_query(const apol_policy_t * p, const apol_avrule_quer
 		goto cleanup;
 	}
 
-	if (rule_select(p, *v, rule_type, flags, source_list, target_list, class_list, perm_list, bool_name)) {
+	if (rule_select(p, apol_query_append_result, *v, plan, (a != NULL ? a->num_threads : 1))) {
 		goto cleanup;
 	}
 
+	/* keep the candidate types for post filtering */
+	source_list = plan->source_list;
+	target_list = plan->target_list;
+	source_as_any = (source_list != NULL && source_list == target_list);
+	plan->source_list = plan->target_list = NULL;
+
 	syn_v = apol_avrule_list_to_syn_avrules(p, *v, perm_list);
 	if (!syn_v) {
 		goto cleanup;
@@ -437,7 +864,7 @@ int apol_syn_avrule_get_by_query(const apol_policy_t * p, const apol_avrule_quer
 	if (!source_as_any) {
 		apol_vector_destroy(&target_list);
 	}
-	apol_vector_destroy(&class_list);
+	avrule_plan_destroy(&plan);
 	/* don't destroy perm_list - it points to query's permission list */
 	apol_regex_destroy(&bool_regex);
 	qpol_iterator_destroy(&iter);
@@ -453,6 +880,7 @@ apol_avrule_query_t *apol_avrule_query_create(void)
 		a->flags =
 			(APOL_QUERY_SOURCE_TYPE | APOL_QUERY_SOURCE_ATTRIBUTE | APOL_QUERY_TARGET_TYPE |
 			 APOL_QUERY_TARGET_ATTRIBUTE);
+		a->num_threads = 1;
 	}
 	return a;
 }
@@ -465,6 +893,7 @@ void apol_avrule_query_destroy(apol_avrule_query_t ** a)
 		free((*a)->bool_name);
 		apol_vector_destroy(&(*a)->classes);
 		apol_vector_destroy(&(*a)->perms);
+		avrule_plan_destroy(&(*a)->plan);
 		free(*a);
 		*a = NULL;
 	}
@@ -472,6 +901,7 @@ void apol_avrule_query_destroy(apol_avrule_query_t ** a)
 
 int apol_avrule_query_set_rules(const apol_policy_t * p __attribute__ ((unused)), apol_avrule_query_t * a, unsigned int rules)
 {
+	avrule_plan_destroy(&a->plan);
 	if (rules != 0) {
 		a->rules = rules;
 	} else {
@@ -482,6 +912,7 @@ int apol_avrule_query_set_rules(const apol_policy_t * p __attribute__ ((unused))
 
 int apol_avrule_query_set_source(const apol_policy_t * p, apol_avrule_query_t * a, const char *symbol, int is_indirect)
 {
+	avrule_plan_destroy(&a->plan);
 	apol_query_set_flag(p, &a->flags, is_indirect, APOL_QUERY_SOURCE_INDIRECT);
 	return apol_query_set(p, &a->source, NULL, symbol);
 }
@@ -493,6 +924,7 @@ int apol_avrule_query_set_source_component(const apol_policy_t * p, apol_avrule_
 		errno = EINVAL;
 		return -1;
 	}
+	avrule_plan_destroy(&a->plan);
 	apol_query_set_flag(p, &a->flags, component & APOL_QUERY_SYMBOL_IS_TYPE, APOL_QUERY_SOURCE_TYPE);
 	apol_query_set_flag(p, &a->flags, component & APOL_QUERY_SYMBOL_IS_ATTRIBUTE, APOL_QUERY_SOURCE_ATTRIBUTE);
 	return 0;
@@ -500,6 +932,7 @@ int apol_avrule_query_set_source_component(const apol_policy_t * p, apol_avrule_
 
 int apol_avrule_query_set_target(const apol_policy_t * p, apol_avrule_query_t * a, const char *symbol, int is_indirect)
 {
+	avrule_plan_destroy(&a->plan);
 	apol_query_set_flag(p, &a->flags, is_indirect, APOL_QUERY_TARGET_INDIRECT);
 	return apol_query_set(p, &a->target, NULL, symbol);
 }
@@ -511,6 +944,7 @@ int apol_avrule_query_set_target_component(const apol_policy_t * p, apol_avrule_
 		errno = EINVAL;
 		return -1;
 	}
+	avrule_plan_destroy(&a->plan);
 	apol_query_set_flag(p, &a->flags, component & APOL_QUERY_SYMBOL_IS_TYPE, APOL_QUERY_TARGET_TYPE);
 	apol_query_set_flag(p, &a->flags, component & APOL_QUERY_SYMBOL_IS_ATTRIBUTE, APOL_QUERY_TARGET_ATTRIBUTE);
 	return 0;
@@ -519,6 +953,7 @@ int apol_avrule_query_set_target_component(const apol_policy_t * p, apol_avrule_
 int apol_avrule_query_append_class(const apol_policy_t * p, apol_avrule_query_t * a, const char *obj_class)
 {
 	char *s = NULL;
+	avrule_plan_destroy(&a->plan);
 	if (obj_class == NULL) {
 		apol_vector_destroy(&a->classes);
 	} else if ((s = strdup(obj_class)) == NULL || (a->classes == NULL && (a->classes = apol_vector_create(free)) == NULL)
@@ -533,6 +968,7 @@ int apol_avrule_query_append_class(const apol_policy_t * p, apol_avrule_query_t
 int apol_avrule_query_append_perm(const apol_policy_t * p, apol_avrule_query_t * a, const char *perm)
 {
 	char *s;
+	avrule_plan_destroy(&a->plan);
 	if (perm == NULL) {
 		apol_vector_destroy(&a->perms);
 	} else if ((s = strdup(perm)) == NULL ||
@@ -545,29 +981,41 @@ int apol_avrule_query_append_perm(const apol_policy_t * p, apol_avrule_query_t *
 
 int apol_avrule_query_set_bool(const apol_policy_t * p, apol_avrule_query_t * a, const char *bool_name)
 {
+	avrule_plan_destroy(&a->plan);
 	return apol_query_set(p, &a->bool_name, NULL, bool_name);
 }
 
 int apol_avrule_query_set_enabled(const apol_policy_t * p, apol_avrule_query_t * a, int is_enabled)
 {
+	avrule_plan_destroy(&a->plan);
 	return apol_query_set_flag(p, &a->flags, is_enabled, APOL_QUERY_ONLY_ENABLED);
 }
 
 int apol_avrule_query_set_all_perms(const apol_policy_t * p, apol_avrule_query_t * a, int match_all)
 {
+	avrule_plan_destroy(&a->plan);
 	return apol_query_set_flag(p, &a->flags, match_all, APOL_QUERY_MATCH_ALL_PERMS);
 }
 
 int apol_avrule_query_set_source_any(const apol_policy_t * p, apol_avrule_query_t * a, int is_any)
 {
+	avrule_plan_destroy(&a->plan);
 	return apol_query_set_flag(p, &a->flags, is_any, APOL_QUERY_SOURCE_AS_ANY);
 }
 
 int apol_avrule_query_set_regex(const apol_policy_t * p, apol_avrule_query_t * a, int is_regex)
 {
+	avrule_plan_destroy(&a->plan);
 	return apol_query_set_regex(p, &a->flags, is_regex);
 }
 
+int apol_avrule_query_set_threads(const apol_policy_t * p __attribute__ ((unused)), apol_avrule_query_t * a,
+				  size_t num_threads)
+{
+	a->num_threads = num_threads;
+	return 0;
+}
+
 /**
  * Comparison function for two syntactic avrules.  Will return -1 if
  * a's line number is before b's, 1 if b is greater.
@@ -475,3 +475,95 @@ int apol_context_convert(const apol_policy_t * p, apol_context_t * context)
 	}
 	return 0;
 }
+
+/**
+ * Look up the value of an MLS level's sensitivity and categories.
+ * @param cats Pointer in which to store an allocated array of category
+ * values, which the caller must free.
+ */
+static int context_get_level_values(const apol_policy_t * p, const apol_mls_level_t * level, qpol_constraint_level_t * values,
+				    uint32_t ** cats)
+{
+	const qpol_level_t *sens;
+	const qpol_cat_t *cat;
+	const apol_vector_t *cat_names;
+	const char *sens_name;
+	size_t i;
+
+	*cats = NULL;
+	if (level == NULL || apol_mls_level_is_literal(level) > 0 || (sens_name = apol_mls_level_get_sens(level)) == NULL ||
+	    qpol_policy_get_level_by_name(p->p, sens_name, &sens) < 0 || qpol_level_get_value(p->p, sens, &values->sens) < 0) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	cat_names = apol_mls_level_get_cats(level);
+	values->num_cats = apol_vector_get_size(cat_names);
+	if ((*cats = calloc(values->num_cats + 1, sizeof(uint32_t))) == NULL) {
+		ERR(p, "%s", strerror(ENOMEM));
+		return -1;
+	}
+	for (i = 0; i < values->num_cats; i++) {
+		if (qpol_policy_get_cat_by_name(p->p, apol_vector_get_element(cat_names, i), &cat) < 0 ||
+		    qpol_cat_get_value(p->p, cat, &(*cats)[i]) < 0) {
+			free(*cats);
+			*cats = NULL;
+			ERR(p, "%s", strerror(EINVAL));
+			errno = EINVAL;
+			return -1;
+		}
+	}
+	values->cats = *cats;
+	return 0;
+}
+
+int apol_context_create_constraint_ctx(const apol_policy_t * p, const qpol_constraint_engine_t * engine,
+				       const apol_context_t * context, qpol_constraint_ctx_t ** ctx)
+{
+	const qpol_user_t *user;
+	const qpol_role_t *role;
+	const qpol_type_t *type;
+	uint32_t user_value, role_value, type_value, *low_cats = NULL, *high_cats = NULL;
+	qpol_constraint_level_t low, high;
+	int retval = -1;
+
+	if (ctx != NULL)
+		*ctx = NULL;
+	if (p == NULL || engine == NULL || context == NULL || ctx == NULL ||
+	    context->user == NULL || context->role == NULL || context->type == NULL) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	if (qpol_policy_get_user_by_name(p->p, context->user, &user) < 0 ||
+	    qpol_user_get_value(p->p, user, &user_value) < 0 ||
+	    qpol_policy_get_role_by_name(p->p, context->role, &role) < 0 ||
+	    qpol_role_get_value(p->p, role, &role_value) < 0 ||
+	    qpol_policy_get_type_by_name(p->p, context->type, &type) < 0 || qpol_type_get_value(p->p, type, &type_value) < 0) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	if (!apol_policy_is_mls(p)) {
+		return qpol_constraint_ctx_create_from_values(engine, user_value, role_value, type_value, NULL, NULL, ctx);
+	}
+
+	if (context->range == NULL) {
+		ERR(p, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	if (context_get_level_values(p, apol_mls_range_get_low(context->range), &low, &low_cats) < 0) {
+		goto cleanup;
+	}
+	if (apol_mls_range_get_high(context->range) != NULL &&
+	    context_get_level_values(p, apol_mls_range_get_high(context->range), &high, &high_cats) < 0) {
+		goto cleanup;
+	}
+	retval = qpol_constraint_ctx_create_from_values(engine, user_value, role_value, type_value, &low,
+							(high_cats != NULL ? &high : NULL), ctx);
+      cleanup:
+	free(low_cats);
+	free(high_cats);
+	return retval;
+}
@@ -515,9 +515,11 @@ apol_domain_trans_result_t *domain_trans_result_create()
 	return NULL;
 }
 
-/* public functions */
-/* table */
-int apol_policy_build_domain_trans_table(apol_policy_t * policy)
+/**
+ * Build a policy's domain transition table; the caller must hold the
+ * policy's domain_trans_lock.
+ */
+static int domain_trans_table_build(apol_policy_t * policy)
 {
 	int error = 0;
 	apol_avrule_query_t *avq = NULL;
@@ -609,11 +611,14 @@ void domain_trans_table_destroy(apol_domain_trans_table_t ** table)
 
 void apol_policy_reset_domain_trans_table(apol_policy_t * policy)
 {
-	if (!policy || !policy->domain_trans_table)
+	if (!policy)
 		return;
-	apol_bst_inorder_map(policy->domain_trans_table->domain_table, dom_node_reset, NULL);
-	apol_bst_inorder_map(policy->domain_trans_table->entrypoint_table, ep_node_reset, NULL);
-	return;
+	pthread_mutex_lock(&policy->domain_trans_lock);
+	if (policy->domain_trans_table) {
+		apol_bst_inorder_map(policy->domain_trans_table->domain_table, dom_node_reset, NULL);
+		apol_bst_inorder_map(policy->domain_trans_table->entrypoint_table, ep_node_reset, NULL);
+	}
+	pthread_mutex_unlock(&policy->domain_trans_lock);
 }
 
 void apol_domain_trans_table_reset(apol_policy_t * policy)
@@ -1624,7 +1629,11 @@ static int domain_trans_table_get_all_reverse_trans(apol_policy_t * policy, apol
 	return -1;
 }
 
-int apol_domain_trans_analysis_do(apol_policy_t * policy, apol_domain_trans_analysis_t * dta, apol_vector_t ** results)
+/**
+ * Run a domain transition analysis; the caller must hold the policy's
+ * domain_trans_lock.
+ */
+static int domain_trans_analysis_run(apol_policy_t * policy, apol_domain_trans_analysis_t * dta, apol_vector_t ** results)
 {
 	apol_vector_t *local_results = NULL;
 	apol_avrule_query_t *accessq = NULL;
@@ -1639,7 +1648,7 @@ int apol_domain_trans_analysis_do(apol_policy_t * policy, apol_domain_trans_anal
 
 	/* build table if not already present */
 	if (!(policy->domain_trans_table)) {
-		if (apol_policy_build_domain_trans_table(policy))
+		if (domain_trans_table_build(policy))
 			return -1;     /* errors already reported by build function */
 	}
 
@@ -1904,8 +1913,12 @@ const apol_vector_t *apol_domain_trans_result_get_access_rules(const apol_domain
 	}
 }
 
-int apol_domain_trans_table_verify_trans(apol_policy_t * policy, const qpol_type_t * start_dom, const qpol_type_t * ep_type,
-					 const qpol_type_t * end_dom)
+/**
+ * Verify a transition against the domain transition table; the caller
+ * must hold the policy's domain_trans_lock.
+ */
+static int domain_trans_table_verify(apol_policy_t * policy, const qpol_type_t * start_dom, const qpol_type_t * ep_type,
+				     const qpol_type_t * end_dom)
 {
 	int missing_rules = 0;
 
@@ -2074,3 +2087,64 @@ void apol_domain_trans_result_destroy(apol_domain_trans_result_t ** res)
 	domain_trans_result_free((void *)*res);
 	*res = NULL;
 }
+
+/* the public entry points that use the domain transition table hold
+ * the policy's lock for their duration, so that threads sharing a
+ * (frozen) policy take turns with it */
+
+int apol_policy_build_domain_trans_table(apol_policy_t * policy)
+{
+	int retv, error;
+
+	if (!policy) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	pthread_mutex_lock(&policy->domain_trans_lock);
+	retv = domain_trans_table_build(policy);
+	error = errno;
+	pthread_mutex_unlock(&policy->domain_trans_lock);
+	errno = error;
+	return retv;
+}
+
+int apol_domain_trans_analysis_do(apol_policy_t * policy, apol_domain_trans_analysis_t * dta, apol_vector_t ** results)
+{
+	int retv, error;
+
+	if (!policy) {
+		if (results)
+			*results = NULL;
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	pthread_mutex_lock(&policy->domain_trans_lock);
+	/* on a shared policy, results must not depend upon which
+	 * analyses other threads ran before this one */
+	if (policy->frozen)
+		apol_policy_reset_domain_trans_table(policy);
+	retv = domain_trans_analysis_run(policy, dta, results);
+	error = errno;
+	pthread_mutex_unlock(&policy->domain_trans_lock);
+	errno = error;
+	return retv;
+}
+
+int apol_domain_trans_table_verify_trans(apol_policy_t * policy, const qpol_type_t * start_dom, const qpol_type_t * ep_type,
+					 const qpol_type_t * end_dom)
+{
+	int retv, error;
+
+	if (!policy) {
+		errno = EINVAL;
+		return -1;
+	}
+	pthread_mutex_lock(&policy->domain_trans_lock);
+	retv = domain_trans_table_verify(policy, start_dom, ep_type, end_dom);
+	error = errno;
+	pthread_mutex_unlock(&policy->domain_trans_lock);
+	errno = error;
+	return retv;
+}
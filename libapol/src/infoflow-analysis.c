@@ -532,6 +532,181 @@ static int apol_infoflow_graph_connect_nodes(const apol_policy_t * p,
 	return retval;
 }
 
+/**
+ * Permission map information for every permission bit of every class,
+ * filled in the first time a rule of that class is added to a graph
+ * so that each rule's permissions may be examined from its permission
+ * mask instead of by name.
+ */
+typedef struct apol_infoflow_perm_table
+{
+	size_t num_classes;
+	/** vector of apol_obj_perm_t restricting the permissions of
+	 *  interest, or NULL or empty to allow all */
+	const apol_vector_t *class_perms;
+	/** non-zero once a class's entries have been filled in */
+	unsigned char *filled;
+	/** for each class, the bits of permissions in the analysis's
+	 *  class_perms list, or all of its bits if there is no list */
+	uint32_t *allowed;
+	/** map and weight for each of 32 bits of each class */
+	int *map, *weight;
+} apol_infoflow_perm_table_t;
+
+static void apol_infoflow_perm_table_destroy(apol_infoflow_perm_table_t ** t)
+{
+	if (t != NULL && *t != NULL) {
+		free((*t)->filled);
+		free((*t)->allowed);
+		free((*t)->map);
+		free((*t)->weight);
+		free(*t);
+		*t = NULL;
+	}
+}
+
+static apol_infoflow_perm_table_t *apol_infoflow_perm_table_create(const apol_policy_t * p, const apol_vector_t * class_perms)
+{
+	apol_infoflow_perm_table_t *t = NULL;
+	qpol_iterator_t *iter = NULL;
+	int retval = -1;
+
+	if ((t = calloc(1, sizeof(*t))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	t->class_perms = class_perms;
+	if (qpol_policy_get_class_iter(p->p, &iter) < 0 || qpol_iterator_get_size(iter, &t->num_classes) < 0) {
+		goto cleanup;
+	}
+	if ((t->filled = calloc(t->num_classes + 1, sizeof(*t->filled))) == NULL ||
+	    (t->allowed = calloc(t->num_classes + 1, sizeof(*t->allowed))) == NULL ||
+	    (t->map = calloc((t->num_classes + 1) * 32, sizeof(*t->map))) == NULL ||
+	    (t->weight = calloc((t->num_classes + 1) * 32, sizeof(*t->weight))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	retval = 0;
+      cleanup:
+	qpol_iterator_destroy(&iter);
+	if (retval < 0) {
+		apol_infoflow_perm_table_destroy(&t);
+	}
+	return t;
+}
+
+/**
+ * Fill in a class's entries within a permission table.
+ *
+ * @param p Policy containing the class.
+ * @param t Table to fill.
+ * @param obj_class Class whose entries to fill.
+ * @param class_val Value of obj_class.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+static int apol_infoflow_perm_table_fill(const apol_policy_t * p, apol_infoflow_perm_table_t * t, const qpol_class_t * obj_class,
+					 uint32_t class_val)
+{
+	const apol_vector_t *class_perms = t->class_perms;
+	const qpol_common_t *common;
+	qpol_iterator_t *iter = NULL;
+	const char *class_name;
+	char *perm_name;
+	uint32_t perm_mask, bit;
+	apol_vector_t *obj_perm_v = NULL;
+	size_t i;
+	int pass, retval = -1;
+
+	if (qpol_class_get_name(p->p, obj_class, &class_name) < 0 || qpol_class_get_common(p->p, obj_class, &common) < 0) {
+		goto cleanup;
+	}
+	for (pass = 0; pass < 2; pass++) {
+		if (pass == 0 && qpol_class_get_perm_iter(p->p, obj_class, &iter) < 0) {
+			goto cleanup;
+		}
+		if (pass == 1) {
+			if (common == NULL)
+				break;
+			if (qpol_common_get_perm_iter(p->p, common, &iter) < 0) {
+				goto cleanup;
+			}
+		}
+		for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+			if (qpol_iterator_get_item(iter, (void **)&perm_name) < 0 ||
+			    qpol_class_get_perm_mask(p->p, obj_class, perm_name, &perm_mask) < 0) {
+				goto cleanup;
+			}
+			if (perm_mask == 0) {
+				continue;
+			}
+			for (bit = 0; !(perm_mask & ((uint32_t) 1 << bit)); bit++) ;
+			if (apol_policy_get_permmap(p, class_name, perm_name, &t->map[(class_val - 1) * 32 + bit],
+						    &t->weight[(class_val - 1) * 32 + bit]) < 0) {
+				goto cleanup;
+			}
+			t->allowed[class_val - 1] |= perm_mask;
+		}
+		qpol_iterator_destroy(&iter);
+	}
+
+	if (class_perms != NULL && apol_vector_get_size(class_perms) > 0) {
+		uint32_t allowed = 0;
+		for (i = 0; i < apol_vector_get_size(class_perms); i++) {
+			apol_obj_perm_t *obj_perm = (apol_obj_perm_t *) apol_vector_get_element(class_perms, i);
+			if (strcmp(apol_obj_perm_get_obj_name(obj_perm), class_name) == 0) {
+				obj_perm_v = apol_obj_perm_get_perm_vector(obj_perm);
+				break;
+			}
+		}
+		for (i = 0; obj_perm_v != NULL && i < apol_vector_get_size(obj_perm_v); i++) {
+			if (qpol_class_get_perm_mask(p->p, obj_class, apol_vector_get_element(obj_perm_v, i), &perm_mask) < 0) {
+				goto cleanup;
+			}
+			allowed |= perm_mask;
+		}
+		t->allowed[class_val - 1] = allowed;
+	}
+
+	t->filled[class_val - 1] = 1;
+	retval = 0;
+      cleanup:
+	qpol_iterator_destroy(&iter);
+	return retval;
+}
+
+/**
+ * Get the value of a rule's class and the mask of its permissions,
+ * filling in the class's entries within the permission table if
+ * needed.
+ *
+ * @param p Policy containing the rule.
+ * @param t Permission table.
+ * @param rule AV rule whose class and permissions to get.
+ * @param class_val Reference to the rule's class value.
+ * @param perm_mask Reference to the rule's permission mask.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+static int apol_infoflow_perm_table_get(const apol_policy_t * p, apol_infoflow_perm_table_t * t, const qpol_avrule_t * rule,
+					uint32_t * class_val, uint32_t * perm_mask)
+{
+	const qpol_class_t *obj_class;
+
+	if (qpol_avrule_get_object_class(p->p, rule, &obj_class) < 0 ||
+	    qpol_class_get_value(p->p, obj_class, class_val) < 0 || qpol_avrule_get_perm_mask(p->p, rule, perm_mask) < 0) {
+		return -1;
+	}
+	if (*class_val < 1 || *class_val > t->num_classes) {
+		ERR(p, "%s", strerror(ERANGE));
+		return -1;
+	}
+	if (!t->filled[*class_val - 1] && apol_infoflow_perm_table_fill(p, t, obj_class, *class_val) < 0) {
+		return -1;
+	}
+	return 0;
+}
+
 /**
  * Given a policy and a partially completed infoflow graph, create the
  * nodes and edges associated with a particular rule.
@@ -545,35 +720,30 @@ static int apol_infoflow_graph_connect_nodes(const apol_policy_t * p,
  * @param max_len Maximum permission length (i.e., inverse of
  * permission weight) to consider when deciding to add this rule or
  * not.
+ * @param t Permission table for the policy.
  *
  * @return 0 on success, < 0 on error.
  */
 static int apol_infoflow_graph_create_avrule(const apol_policy_t * p, apol_infoflow_graph_t * g, const qpol_avrule_t * rule,
-					     apol_bst_t * types, int max_len)
+					     apol_bst_t * types, int max_len, apol_infoflow_perm_table_t * t)
 {
-	const qpol_class_t *obj_class;
-	qpol_iterator_t *perm_iter = NULL;
-	const char *obj_class_name;
-	char *perm_name;
+	uint32_t class_val, perm_mask, bit;
 	int found_read = 0, found_write = 0, perm_error = 0;
 	int read_len = INT_MAX, write_len = INT_MAX;
 	int retval = -1;
-	if (qpol_avrule_get_object_class(p->p, rule, &obj_class) < 0 ||
-	    qpol_class_get_name(p->p, obj_class, &obj_class_name) < 0 || qpol_avrule_get_perm_iter(p->p, rule, &perm_iter) < 0) {
+	if (apol_infoflow_perm_table_get(p, t, rule, &class_val, &perm_mask) < 0) {
 		goto cleanup;
 	}
 
 	/* find read or write flows for each object class/perm pair */
-	for (; !qpol_iterator_end(perm_iter); qpol_iterator_next(perm_iter)) {
+	for (bit = 0; bit < 32; bit++) {
 		int perm_map, perm_weight, len;
 
-		if (qpol_iterator_get_item(perm_iter, (void **)&perm_name) < 0) {
-			goto cleanup;
-		}
-		if (apol_policy_get_permmap(p, obj_class_name, perm_name, &perm_map, &perm_weight) < 0) {
-			goto cleanup;
+		if (!(perm_mask & ((uint32_t) 1 << bit))) {
+			continue;
 		}
-		free(perm_name);
+		perm_map = t->map[(class_val - 1) * 32 + bit];
+		perm_weight = t->weight[(class_val - 1) * 32 + bit];
 		if (perm_map == APOL_PERMMAP_UNMAPPED) {
 			perm_error = 1;
 			continue;
@@ -609,7 +779,6 @@ static int apol_infoflow_graph_create_avrule(const apol_policy_t * p, apol_infof
 
 	retval = 0;
       cleanup:
-	qpol_iterator_destroy(&perm_iter);
 	return retval;
 }
 
@@ -699,60 +868,25 @@ static int apol_infoflow_graph_check_types(const apol_policy_t * p, const qpol_a
  *
  * @param p Policy to which look up classes and permissions.
  * @param rule AV rule to check.
- * @param class_perms Vector of apol_obj_perm_t, of which rule's class
- * and permissions must be a member.  If NULL or empty then allow all
- * classes and permissions.
+ * @param t Permission table for the policy, created with the vector
+ * of apol_obj_perm_t of which rule's class and permissions must be a
+ * member.  If that vector is NULL or empty then allow all classes and
+ * permissions.
  *
  * @return 1 if rule matches, 0 if not, < 0 on error.
  */
 static int apol_infoflow_graph_check_class_perms(const apol_policy_t * p, const qpol_avrule_t * rule,
-						 const apol_vector_t * class_perms)
+						 apol_infoflow_perm_table_t * t)
 {
-	const qpol_class_t *obj_class;
-	const char *obj_name;
-	char *perm;
-	qpol_iterator_t *iter = NULL;
-	apol_obj_perm_t *obj_perm = NULL;
-	apol_vector_t *obj_perm_v = NULL;
-	size_t i;
-	int retval = -1;
+	uint32_t class_val, perm_mask;
 
-	if (class_perms == NULL || apol_vector_get_size(class_perms) == 0) {
-		retval = 1;
-		goto cleanup;
-	}
-	if (qpol_avrule_get_object_class(p->p, rule, &obj_class) < 0 || qpol_class_get_name(p->p, obj_class, &obj_name) < 0) {
-		goto cleanup;
-	}
-	for (i = 0; i < apol_vector_get_size(class_perms); i++) {
-		obj_perm = (apol_obj_perm_t *) apol_vector_get_element(class_perms, i);
-		if (strcmp(apol_obj_perm_get_obj_name(obj_perm), obj_name) == 0) {
-			obj_perm_v = apol_obj_perm_get_perm_vector(obj_perm);
-			break;
-		}
-	}
-	if (i >= apol_vector_get_size(class_perms)) {
-		retval = 0;	       /* no matching class */
-		goto cleanup;
-	}
-	if (qpol_avrule_get_perm_iter(p->p, rule, &iter) < 0) {
-		goto cleanup;
+	if (t->class_perms == NULL || apol_vector_get_size(t->class_perms) == 0) {
+		return 1;
 	}
-	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
-		if (qpol_iterator_get_item(iter, (void **)&perm) < 0) {
-			goto cleanup;
-		}
-		if (apol_vector_get_index(obj_perm_v, perm, apol_str_strcmp, NULL, &i) == 0) {
-			free(perm);
-			retval = 1;
-			goto cleanup;
-		}
-		free(perm);
+	if (apol_infoflow_perm_table_get(p, t, rule, &class_val, &perm_mask) < 0) {
+		return -1;
 	}
-	retval = 0;		       /* no matching perm */
-      cleanup:
-	qpol_iterator_destroy(&iter);
-	return retval;
+	return (perm_mask & t->allowed[class_val - 1]) ? 1 : 0;
 }
 
 /**
@@ -772,6 +906,7 @@ static int apol_infoflow_graph_create(const apol_policy_t * p, const apol_infofl
 {
 	apol_bst_t *types = NULL;
 	qpol_iterator_t *iter = NULL;
+	apol_infoflow_perm_table_t *perm_table = NULL;
 	int max_len = APOL_PERMMAP_MAX_WEIGHT - ia->min_weight + 1;
 	int compval, retval = -1;
 
@@ -805,7 +940,8 @@ static int apol_infoflow_graph_create(const apol_policy_t * p, const apol_infofl
 		goto cleanup;
 	}
 
-	if (qpol_policy_get_avrule_iter(p->p, QPOL_RULE_ALLOW, &iter) < 0) {
+	if ((perm_table = apol_infoflow_perm_table_create(p, ia->class_perms)) == NULL ||
+	    qpol_policy_get_avrule_iter(p->p, QPOL_RULE_ALLOW, &iter) < 0) {
 		goto cleanup;
 	}
 
@@ -820,13 +956,13 @@ static int apol_infoflow_graph_create(const apol_policy_t * p, const apol_infofl
 		} else if (compval == 0) {
 			continue;
 		}
-		compval = apol_infoflow_graph_check_class_perms(p, rule, ia->class_perms);
+		compval = apol_infoflow_graph_check_class_perms(p, rule, perm_table);
 		if (compval < 0) {
 			goto cleanup;
 		} else if (compval == 0) {
 			continue;
 		}
-		if (apol_infoflow_graph_create_avrule(p, *g, rule, types, max_len) < 0) {
+		if (apol_infoflow_graph_create_avrule(p, *g, rule, types, max_len, perm_table) < 0) {
 			goto cleanup;
 		}
 	}
@@ -840,6 +976,7 @@ static int apol_infoflow_graph_create(const apol_policy_t * p, const apol_infofl
       cleanup:
 	apol_bst_destroy(&types);
 	qpol_iterator_destroy(&iter);
+	apol_infoflow_perm_table_destroy(&perm_table);
 	if (retval < 0) {
 		apol_infoflow_graph_destroy(g);
 	}
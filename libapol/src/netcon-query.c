@@ -64,7 +64,14 @@ int apol_portcon_get_by_query(const apol_policy_t * p, const apol_portcon_query_
 	qpol_iterator_t *iter;
 	int retval = -1, retval2;
 	*v = NULL;
-	if (qpol_policy_get_portcon_iter(p->p, &iter) < 0) {
+	/* a statement matching an exact low or high port must contain
+	 * that port, so let the port index narrow the candidates */
+	if (po != NULL && po->proto >= 0 && (po->low >= 0 || po->high >= 0)) {
+		if (qpol_policy_get_portcon_iter_by_port(p->p, (uint8_t) po->proto,
+							 (uint16_t) (po->low >= 0 ? po->low : po->high), &iter) < 0) {
+			return -1;
+		}
+	} else if (qpol_policy_get_portcon_iter(p->p, &iter) < 0) {
 		return -1;
 	}
 	if ((*v = apol_vector_create(NULL)) == NULL) {
@@ -385,7 +392,13 @@ int apol_nodecon_get_by_query(const apol_policy_t * p, const apol_nodecon_query_
 	int retval = -1, retval2;
 	qpol_nodecon_t *nodecon = NULL;
 	*v = NULL;
-	if (qpol_policy_get_nodecon_iter(p->p, &iter) < 0) {
+	/* a statement matching an exact address covers that address, so
+	 * let the address index narrow the candidates */
+	if (n != NULL && n->addr_proto >= 0) {
+		if (qpol_policy_get_nodecon_iter_by_addr(p->p, n->addr, (unsigned char)n->addr_proto, &iter) < 0) {
+			return -1;
+		}
+	} else if (qpol_policy_get_nodecon_iter(p->p, &iter) < 0) {
 		return -1;
 	}
 	if ((*v = apol_vector_create(free)) == NULL) {
@@ -532,6 +532,11 @@ int apol_policy_open_permmap(apol_policy_t * p, const char *filename)
 	if (p == NULL || filename == NULL) {
 		goto cleanup;
 	}
+	if (p->frozen) {
+		ERR(p, "%s", "The policy is frozen; its permission map may not be changed.");
+		errno = EPERM;
+		goto cleanup;
+	}
 	permmap_destroy(&p->pmap);
 	if ((p->pmap = apol_permmap_create_from_policy(p)) == NULL) {
 		goto cleanup;
@@ -677,6 +682,11 @@ int apol_policy_set_permmap(apol_policy_t * p, const char *class_name, const cha
 	if (p == NULL || p->pmap == NULL) {
 		return -1;
 	}
+	if (p->frozen) {
+		ERR(p, "%s", "The policy is frozen; its permission map may not be changed.");
+		errno = EPERM;
+		return -1;
+	}
 	if ((pc = find_permmap_class(p, class_name)) == NULL || (pp = find_permmap_perm(p, pc, perm_name)) == NULL) {
 		ERR(p, "Could not find permission %s in class %s.", perm_name, class_name);
 		return -1;
@@ -40,6 +40,7 @@ extern "C"
 #include <apol/util.h>
 #include <apol/vector.h>
 
+#include <pthread.h>
 #include <regex.h>
 #include <stdlib.h>
 #include <qpol/policy.h>
@@ -63,6 +64,14 @@ extern "C"
 		struct apol_permmap *pmap;
 	/** for domain trans analysis; table built as needed */
 		struct apol_domain_trans_table *domain_trans_table;
+	/** held (recursively) while the domain trans table is in use,
+	 *  because analyses record their progress within it */
+		pthread_mutex_t domain_trans_lock;
+	/** non-zero once apol_policy_freeze() has been called; the
+	 *  value is unique among the policies frozen by this process, so
+	 *  that a query plan compiled against one frozen policy is never
+	 *  mistaken for one of another allocated at the same address */
+		unsigned long frozen;
 	};
 
 /** Every query allows the treatment of strings as regular expressions
@@ -83,6 +92,38 @@ extern "C"
 
 #define APOL_QUERY_MATCH_ALL_PERMS 0x1000
 
+/** Number of rules fetched at a time with qpol_iterator_get_items()
+ *  while searching rule tables. */
+#define APOL_QUERY_BATCH_SIZE 256
+
+/** Number of parts into which a rule search is split for each thread
+ *  searching, so that threads finishing early can take more parts. */
+#define APOL_QUERY_PARTS_PER_THREAD 4
+
+/**
+ * A set of symbol values (of types or of classes), one bit per value,
+ * against which a rule's fields are matched with a single test rather
+ * than by searching a candidate list.
+ */
+	typedef struct apol_query_bitset
+	{
+	/** bit v of the set is bit (v % 32) of bits[v / 32]; NULL if
+	 *  every value is in the set */
+		uint32_t *bits;
+	/** number of words in bits */
+		size_t size;
+	} apol_query_bitset_t;
+
+/**
+ * Determine if a value is in a bitset.
+ * @param set Bitset to check.
+ * @param value Value of the symbol.
+ * @return Non-zero if the value is in the set, zero otherwise.
+ */
+#define apol_query_bitset_test(set, value) \
+	((set)->bits == NULL || \
+	 ((value) / 32 < (set)->size && ((set)->bits[(value) / 32] & (1U << ((value) % 32))) != 0))
+
 /**
  * Destroy a compiled regular expression, setting it to NULL
  * afterwards.	Does nothing if the reference is NULL.
@@ -414,6 +455,90 @@ extern "C"
  */
 	apol_vector_t *apol_query_create_candidate_class_list(const apol_policy_t * p, apol_vector_t * classes);
 
+/**
+ * Build the bitset, by type value, of a list of types as returned by
+ * apol_query_create_candidate_type_list().
+ *
+ * @param p Policy from which the types come.
+ * @param types Vector of qpol_type_t, or NULL to build a set that
+ * holds every type.
+ * @param set Bitset to initialize.  Call apol_query_bitset_destroy()
+ * afterwards.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+	int apol_query_create_type_bitset(const apol_policy_t * p, const apol_vector_t * types, apol_query_bitset_t * set);
+
+/**
+ * Build the bitset, by class value, of a list of classes as returned
+ * by apol_query_create_candidate_class_list().
+ *
+ * @param p Policy from which the classes come.
+ * @param classes Vector of qpol_class_t, or NULL to build a set that
+ * holds every class.
+ * @param set Bitset to initialize.  Call apol_query_bitset_destroy()
+ * afterwards.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+	int apol_query_create_class_bitset(const apol_policy_t * p, const apol_vector_t * classes, apol_query_bitset_t * set);
+
+/**
+ * Determine how many threads should run a query.
+ *
+ * @param p Policy to be searched.
+ * @param num_threads Number of threads requested, or 0 for one per
+ * online processor.
+ *
+ * @return Number of threads to use; always 1 unless the policy's qpol
+ * policy has been frozen, since only then may it be searched by
+ * several threads at once.
+ */
+	size_t apol_query_get_num_threads(const apol_policy_t * p, size_t num_threads);
+
+/**
+ * Append a result to a vector; used so that a get_by_query function
+ * may be written in terms of the corresponding foreach_by_query
+ * function.
+ *
+ * @param p Policy being searched, to report errors.
+ * @param result Result to append.
+ * @param arg Vector to which to append.
+ *
+ * @return 0 on success, < 0 on error.
+ */
+	int apol_query_append_result(const apol_policy_t * p, void *result, void *arg);
+
+/**
+ * Run a search split into parts on several threads, then pass the
+ * results of the parts to a function in order of part, so that the
+ * results do not depend on which thread searched which part.  The
+ * calling thread searches too, and only it calls fn.
+ *
+ * @param p Policy being searched, to report errors.
+ * @param fn Function to call for each result of every part.
+ * @param fn_arg Argument passed to fn.
+ * @param num_parts Number of parts.
+ * @param num_threads Maximum number of threads to search with.
+ * @param select Function that searches one part, appending its
+ * results to a vector, and returns 0 on success or < 0 on error with
+ * errno set.  It will be called from several threads at once.
+ * @param arg Argument passed to select.
+ *
+ * @return 0 on success, < 0 on error with errno set, or the non-zero
+ * value returned by fn to stop.
+ */
+	int apol_query_select_parallel(const apol_policy_t * p, apol_query_result_fn_t fn, void *fn_arg, size_t num_parts,
+				       size_t num_threads, int (*select) (size_t part, apol_vector_t * v, void *arg), void *arg);
+
+/**
+ * Free the memory used by a bitset, leaving it as a set of every
+ * value.  Does nothing if the set was never allocated.
+ *
+ * @param set Bitset to destroy.
+ */
+	void apol_query_bitset_destroy(apol_query_bitset_t * set);
+
 /**
  * Given a type, return a vector of qpol_type_t pointers to which the
  * type expands.  If the type is just a type or an alias, the vector
@@ -33,6 +33,7 @@
 #include <regex.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 /******************** misc helpers ********************/
 
@@ -725,6 +726,190 @@ apol_vector_t *apol_query_create_candidate_class_list(const apol_policy_t * p, a
 	return list;
 }
 
+/**
+ * Build a bitset from a list of symbols, given the function that
+ * returns a symbol's value.
+ */
+static int apol_query_create_bitset(const apol_policy_t * p, const apol_vector_t * v,
+				    int (*get_value) (const apol_policy_t *, const void *, uint32_t *), apol_query_bitset_t * set)
+{
+	uint32_t *bits = NULL, val, max = 0;
+	size_t i;
+
+	set->bits = NULL;
+	set->size = 0;
+	if (v == NULL) {
+		return 0;
+	}
+	for (i = 0; i < apol_vector_get_size(v); i++) {
+		if (get_value(p, apol_vector_get_element(v, i), &val) < 0) {
+			return -1;
+		}
+		if (val > max) {
+			max = val;
+		}
+	}
+	if ((bits = calloc(max / 32 + 1, sizeof(*bits))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		return -1;
+	}
+	for (i = 0; i < apol_vector_get_size(v); i++) {
+		get_value(p, apol_vector_get_element(v, i), &val);
+		bits[val / 32] |= 1U << (val % 32);
+	}
+	set->bits = bits;
+	set->size = max / 32 + 1;
+	return 0;
+}
+
+static int apol_query_get_type_value(const apol_policy_t * p, const void *type, uint32_t * value)
+{
+	return qpol_type_get_value(p->p, type, value);
+}
+
+static int apol_query_get_class_value(const apol_policy_t * p, const void *obj_class, uint32_t * value)
+{
+	return qpol_class_get_value(p->p, obj_class, value);
+}
+
+int apol_query_create_type_bitset(const apol_policy_t * p, const apol_vector_t * types, apol_query_bitset_t * set)
+{
+	return apol_query_create_bitset(p, types, apol_query_get_type_value, set);
+}
+
+int apol_query_create_class_bitset(const apol_policy_t * p, const apol_vector_t * classes, apol_query_bitset_t * set)
+{
+	return apol_query_create_bitset(p, classes, apol_query_get_class_value, set);
+}
+
+void apol_query_bitset_destroy(apol_query_bitset_t * set)
+{
+	free(set->bits);
+	set->bits = NULL;
+	set->size = 0;
+}
+
+size_t apol_query_get_num_threads(const apol_policy_t * p, size_t num_threads)
+{
+	long num_cpus;
+
+	if (!qpol_policy_is_frozen(p->p)) {
+		return 1;
+	}
+	if (num_threads == 0) {
+		num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		num_threads = (num_cpus > 0 ? (size_t) num_cpus : 1);
+	}
+	return num_threads;
+}
+
+struct apol_query_pool
+{
+	size_t num_parts;
+	apol_vector_t **results;
+	int (*select) (size_t part, apol_vector_t * v, void *arg);
+	void *arg;
+	/* next part to search and the errno of the first part to fail,
+	 * protected by lock */
+	size_t next;
+	int error;
+	pthread_mutex_t lock;
+};
+
+static void *apol_query_pool_worker(void *data)
+{
+	struct apol_query_pool *pool = data;
+	size_t part;
+	int error;
+
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		part = pool->next++;
+		error = pool->error;
+		pthread_mutex_unlock(&pool->lock);
+		if (part >= pool->num_parts || error != 0) {
+			break;
+		}
+		if ((pool->results[part] = apol_vector_create(NULL)) == NULL ||
+		    pool->select(part, pool->results[part], pool->arg) < 0) {
+			error = (errno != 0 ? errno : EIO);
+			pthread_mutex_lock(&pool->lock);
+			if (pool->error == 0) {
+				pool->error = error;
+			}
+			pthread_mutex_unlock(&pool->lock);
+			break;
+		}
+	}
+	return NULL;
+}
+
+int apol_query_append_result(const apol_policy_t * p, void *result, void *arg)
+{
+	if (apol_vector_append(arg, result) < 0) {
+		ERR(p, "%s", strerror(ENOMEM));
+		return -1;
+	}
+	return 0;
+}
+
+int apol_query_select_parallel(const apol_policy_t * p, apol_query_result_fn_t fn, void *fn_arg, size_t num_parts,
+			       size_t num_threads, int (*select) (size_t part, apol_vector_t * v, void *arg), void *arg)
+{
+	struct apol_query_pool pool;
+	pthread_t *threads = NULL;
+	size_t i, j, num_started = 0;
+	int error = 0, retv = 0;
+
+	if (num_threads > num_parts) {
+		num_threads = num_parts;
+	}
+	memset(&pool, 0, sizeof(pool));
+	pool.num_parts = num_parts;
+	pool.select = select;
+	pool.arg = arg;
+	if ((pool.results = calloc(num_parts + 1, sizeof(*pool.results))) == NULL ||
+	    (num_threads > 1 && (threads = calloc(num_threads, sizeof(*threads))) == NULL)) {
+		error = errno;
+		ERR(p, "%s", strerror(error));
+		free(pool.results);
+		errno = error;
+		return -1;
+	}
+	pthread_mutex_init(&pool.lock, NULL);
+
+	/* should no thread start, the calling thread simply searches
+	 * every part itself */
+	for (i = 1; i < num_threads; i++) {
+		if (pthread_create(&threads[num_started], NULL, apol_query_pool_worker, &pool) != 0) {
+			break;
+		}
+		num_started++;
+	}
+	apol_query_pool_worker(&pool);
+	for (i = 0; i < num_started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	pthread_mutex_destroy(&pool.lock);
+	free(threads);
+
+	error = pool.error;
+	for (i = 0; i < num_parts; i++) {
+		for (j = 0; error == 0 && retv == 0 && j < apol_vector_get_size(pool.results[i]); j++) {
+			if ((retv = fn(p, apol_vector_get_element(pool.results[i], j), fn_arg)) < 0) {
+				error = (errno != 0 ? errno : EIO);
+			}
+		}
+		apol_vector_destroy(&pool.results[i]);
+	}
+	free(pool.results);
+	if (error != 0) {
+		errno = error;
+		return (retv < 0 ? retv : -1);
+	}
+	return retv;
+}
+
 apol_vector_t *apol_query_expand_type(const apol_policy_t * p, const qpol_type_t * t)
 {
 	apol_vector_t *v = NULL;
@@ -31,10 +31,12 @@
 #include <qpol/policy.h>
 #include <qpol/policy_extend.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 
 static void apol_handle_default_callback(void *varg __attribute__ ((unused)), const apol_policy_t * p
 					 __attribute__ ((unused)), int level, const char *fmt, va_list va_args)
@@ -72,6 +74,31 @@ static void qpol_handle_route_to_callback(void *varg, const qpol_policy_t * poli
 	}
 }
 
+/**
+ * Initialize the lock that guards a policy's domain transition table.
+ * The lock is recursive, since analyses build and reset the table
+ * through its public functions.
+ * @return 0 on success, < 0 on error with errno set.
+ */
+static int apol_policy_init_domain_trans_lock(apol_policy_t * policy)
+{
+	pthread_mutexattr_t attr;
+	int error;
+
+	if ((error = pthread_mutexattr_init(&attr)) != 0) {
+		errno = error;
+		return -1;
+	}
+	if ((error = pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE)) != 0 ||
+	    (error = pthread_mutex_init(&policy->domain_trans_lock, &attr)) != 0) {
+		pthread_mutexattr_destroy(&attr);
+		errno = error;
+		return -1;
+	}
+	pthread_mutexattr_destroy(&attr);
+	return 0;
+}
+
 apol_policy_t *apol_policy_create_from_policy_path(const apol_policy_path_t * path, const int options,
 						   apol_callback_fn_t msg_callback, void *varg)
 {
@@ -93,6 +120,11 @@ apol_policy_t *apol_policy_create_from_policy_path(const apol_policy_path_t * pa
 		policy->msg_callback = apol_handle_default_callback;
 	}
 	policy->msg_callback_arg = varg;
+	if (apol_policy_init_domain_trans_lock(policy) < 0) {
+		ERR(NULL, "%s", strerror(errno));
+		free(policy);
+		return NULL;
+	}
 	primary_path = apol_policy_path_get_primary(path);
 	INFO(policy, "Loading policy %s.", primary_path);
 	policy_type = qpol_policy_open_from_file(primary_path, &policy->p, qpol_handle_route_to_callback, policy, options);
@@ -109,23 +141,51 @@ apol_policy_t *apol_policy_create_from_policy_path(const apol_policy_path_t * pa
 			return policy;
 		}
 		const apol_vector_t *modules = apol_policy_path_get_modules(path);
-		size_t i;
-		for (i = 0; i < apol_vector_get_size(modules); i++) {
-			const char *module_path = apol_vector_get_element(modules, i);
-			qpol_module_t *mod = NULL;
-			INFO(policy, "Loading module %s.", module_path);
-			if (qpol_module_create_from_file(module_path, &mod)) {
-				ERR(policy, "Error loading module %s.", module_path);
-				apol_policy_destroy(&policy);
-				return NULL;
-			}
-			if (qpol_policy_append_module(policy->p, mod)) {
-				ERR(policy, "Error loading module %s.", module_path);
+		size_t i, num_modules = apol_vector_get_size(modules), failed = 0;
+		const char **paths = NULL;
+		qpol_module_t **mods = NULL;
+		struct timeval start, end;
+		if ((paths = calloc(num_modules + 1, sizeof(*paths))) == NULL ||
+		    (mods = calloc(num_modules + 1, sizeof(*mods))) == NULL) {
+			ERR(policy, "%s", strerror(errno));
+			free(paths);
+			apol_policy_destroy(&policy);
+			return NULL;
+		}
+		for (i = 0; i < num_modules; i++) {
+			paths[i] = apol_vector_get_element(modules, i);
+		}
+		/* decode the packages in parallel, then append them in
+		 * their original order */
+		INFO(policy, "Loading %zu modules.", num_modules);
+		gettimeofday(&start, NULL);
+		if (qpol_module_create_from_files(paths, num_modules, 0, mods, &failed)) {
+			if (failed < num_modules)
+				ERR(policy, "Error loading module %s.", paths[failed]);
+			else
+				ERR(policy, "Error loading modules: %s", strerror(errno));
+			free(paths);
+			free(mods);
+			apol_policy_destroy(&policy);
+			return NULL;
+		}
+		gettimeofday(&end, NULL);
+		INFO(policy, "Loaded %zu modules in %.3f seconds.", num_modules,
+		     (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0);
+		for (i = 0; i < num_modules; i++) {
+			if (qpol_policy_append_module(policy->p, mods[i])) {
+				ERR(policy, "Error loading module %s.", paths[i]);
+				for (; i < num_modules; i++) {
+					qpol_module_destroy(&mods[i]);
+				}
+				free(paths);
+				free(mods);
 				apol_policy_destroy(&policy);
-				qpol_module_destroy(&mod);
 				return NULL;
 			}
 		}
+		free(paths);
+		free(mods);
 		INFO(policy, "%s", "Linking modules into base policy.");
 		if (qpol_policy_rebuild(policy->p, options)) {
 			apol_policy_destroy(&policy);
@@ -141,6 +201,7 @@ void apol_policy_destroy(apol_policy_t ** policy)
 		qpol_policy_destroy(&((*policy)->p));
 		permmap_destroy(&(*policy)->pmap);
 		domain_trans_table_destroy(&(*policy)->domain_trans_table);
+		pthread_mutex_destroy(&(*policy)->domain_trans_lock);
 		free(*policy);
 		*policy = NULL;
 	}
@@ -164,6 +225,64 @@ int apol_policy_get_policy_handle_unknown(const apol_policy_t * p)
 	return handle_unknown;
 }
 
+/** serial number of the policy most recently frozen by this process */
+static unsigned long freeze_serial = 0;
+static pthread_mutex_t freeze_serial_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int apol_policy_freeze(apol_policy_t * policy)
+{
+	unsigned long serial;
+
+	if (policy == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	if (policy->frozen) {
+		return 0;
+	}
+	if (qpol_policy_freeze(policy->p) < 0) {
+		return -1;
+	}
+	if (qpol_policy_has_capability(policy->p, QPOL_CAP_RULES_LOADED) && apol_policy_build_domain_trans_table(policy) < 0) {
+		return -1;
+	}
+	pthread_mutex_lock(&freeze_serial_lock);
+	serial = ++freeze_serial;
+	pthread_mutex_unlock(&freeze_serial_lock);
+	policy->frozen = serial;
+	return 0;
+}
+
+int apol_policy_is_frozen(const apol_policy_t * policy)
+{
+	return (policy != NULL && policy->frozen);
+}
+
+int apol_policy_get_fingerprint(const apol_policy_t * policy, uint64_t * fingerprint)
+{
+	if (policy == NULL || fingerprint == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	return qpol_policy_get_fingerprint(policy->p, fingerprint);
+}
+
+char *apol_policy_get_fingerprint_str(const apol_policy_t * policy)
+{
+	uint64_t fingerprint;
+	char *str = NULL;
+	if (apol_policy_get_fingerprint(policy, &fingerprint) < 0) {
+		return NULL;
+	}
+	if (asprintf(&str, "%016" PRIx64, fingerprint) < 0) {
+		ERR(policy, "%s", strerror(errno));
+		return NULL;
+	}
+	return str;
+}
+
 qpol_policy_t *apol_policy_get_qpol(const apol_policy_t * policy)
 {
 	if (policy == NULL) {
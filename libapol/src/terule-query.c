@@ -33,197 +33,257 @@
 #include <errno.h>
 #include <string.h>
 
+/**
+ * A query compiled against a policy.  The candidate types are kept
+ * as lists, which choose the parts of the rule index to walk, and as
+ * bitsets by type value, against which each rule's source, target and
+ * default are matched; the classes become a bitset by class value.  A
+ * query keeps its plan for later runs against the same frozen policy.
+ */
+typedef struct terule_plan
+{
+	/** serial number of the frozen policy against which the plan
+	 *  was compiled, or 0 if the policy was not frozen */
+	unsigned long policy_serial;
+	uint32_t rule_type;
+	unsigned int flags;
+	/** candidate source, target and default types, or NULL to
+	 *  accept all types; all the same list when treating the source
+	 *  as any field */
+	apol_vector_t *source_list, *target_list, *default_list;
+	apol_query_bitset_t sources, targets, defaults, classes;
+	char *bool_name;
+	/** compiled boolean regex, compiled upon first use by a
+	 *  search on one thread */
+	regex_t *bool_regex;
+} terule_plan_t;
+
 struct apol_terule_query
 {
 	char *source, *target, *default_type, *bool_name;
 	apol_vector_t *classes;
 	unsigned int rules;
 	unsigned int flags;
+	size_t num_threads;
+	/** plan from the last run, if against a frozen policy */
+	terule_plan_t *plan;
 };
 
 /**
- *  Common semantic rule selection routine used in get*rule_by_query.
+ *  Pass to a function those rules from an iterator that match a
+ *  compiled query.
  *  @param p Policy to search.
- *  @param v Vector of rules to populate (of type qpol_terule_t).
- *  @param rule_type Mask of rules to search.
- *  @param flags Query options as specified by the apol_terule_query.
- *  @param source_list If non-NULL, list of types to use as source.
- *  If NULL, accept all types.
- *  @param target_list If non-NULL, list of types to use as target.
- *  If NULL, accept all types.
- *  @param class_list If non-NULL, list of classes to use.
- *  If NULL, accept all classes.
- *  @param default_list If non-NULL, list of types to use as default.
- *  If NULL, accept all types.
- *  @param bool_name If non-NULL, find conditional rules affected by this boolean.
- *  If NULL, all rules will be considered (including unconditional rules).
- *  @return 0 on success and < 0 on failure.
+ *  @param iter Iterator over rules (of type qpol_terule_t) to consider.
+ *  @param fn Function to call for each matching rule.
+ *  @param arg Argument passed to fn.
+ *  @param plan Compiled query.
+ *  @param bool_regex Reference to the compiled boolean regex, compiled
+ *  upon first use.
+ *  @return 0 on success, < 0 on failure, or the non-zero value
+ *  returned by fn to stop.
  */
-static int rule_select(const apol_policy_t * p, apol_vector_t * v, uint32_t rule_type, unsigned int flags,
-		       const apol_vector_t * source_list, const apol_vector_t * target_list, const apol_vector_t * class_list,
-		       const apol_vector_t * default_list, const char *bool_name)
+static int rule_select_from_iter(const apol_policy_t * p, qpol_iterator_t * iter, apol_query_result_fn_t fn, void *arg,
+				 const terule_plan_t * plan, regex_t ** bool_regex)
 {
-	qpol_iterator_t *iter = NULL;
-	int only_enabled = flags & APOL_QUERY_ONLY_ENABLED;
-	int is_regex = flags & APOL_QUERY_REGEX;
-	int source_as_any = flags & APOL_QUERY_SOURCE_AS_ANY;
-	int retv = -1;
-	regex_t *bool_regex = NULL;
-
-	if (qpol_policy_get_terule_iter(p->p, rule_type, &iter) < 0) {
-		goto cleanup;
-	}
-
-	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
-		qpol_terule_t *rule;
-		uint32_t is_enabled;
-		const qpol_cond_t *cond = NULL;
-		int match_source = 0, match_target = 0, match_default = 0, match_bool = 0;
-		size_t i;
-		if (qpol_iterator_get_item(iter, (void **)&rule) < 0) {
-			goto cleanup;
-		}
-
-		if (qpol_terule_get_is_enabled(p->p, rule, &is_enabled) < 0) {
+	int only_enabled = plan->flags & APOL_QUERY_ONLY_ENABLED;
+	int is_regex = plan->flags & APOL_QUERY_REGEX;
+	int source_as_any = plan->flags & APOL_QUERY_SOURCE_AS_ANY;
+	int retv = -1, ret;
+	void *rules[APOL_QUERY_BATCH_SIZE];
+	size_t num_rules, r;
+
+	for (;;) {
+		if (qpol_iterator_get_items(iter, rules, APOL_QUERY_BATCH_SIZE, &num_rules) < 0) {
 			goto cleanup;
 		}
-		if (!is_enabled && only_enabled) {
-			continue;
+		if (num_rules == 0) {
+			break;
 		}
+		for (r = 0; r < num_rules; r++) {
+			qpol_terule_t *rule = rules[r];
+			uint32_t is_enabled;
+			const qpol_cond_t *cond = NULL;
+			int match_source = 1, match_target = 1, match_default = 1, match_bool = 0;
 
-		if (bool_name != NULL) {
-			if (qpol_terule_get_cond(p->p, rule, &cond) < 0) {
+			if (qpol_terule_get_is_enabled(p->p, rule, &is_enabled) < 0) {
 				goto cleanup;
 			}
-			if (cond == NULL) {
-				continue;	/* skip unconditional rule */
-			}
-			match_bool = apol_compare_cond_expr(p, cond, bool_name, is_regex, &bool_regex);
-			if (match_bool < 0) {
-				goto cleanup;
-			} else if (match_bool == 0) {
+			if (!is_enabled && only_enabled) {
 				continue;
 			}
-		}
 
-		if (source_list == NULL) {
-			match_source = 1;
-		} else {
-			const qpol_type_t *source_type;
-			if (qpol_terule_get_source_type(p->p, rule, &source_type) < 0) {
-				goto cleanup;
+			if (plan->bool_name != NULL) {
+				if (qpol_terule_get_cond(p->p, rule, &cond) < 0) {
+					goto cleanup;
+				}
+				if (cond == NULL) {
+					continue;	/* skip unconditional rule */
+				}
+				match_bool = apol_compare_cond_expr(p, cond, plan->bool_name, is_regex, bool_regex);
+				if (match_bool < 0) {
+					goto cleanup;
+				} else if (match_bool == 0) {
+					continue;
+				}
 			}
-			if (apol_vector_get_index(source_list, source_type, NULL, NULL, &i) == 0) {
-				match_source = 1;
+
+			if (plan->sources.bits != NULL) {
+				const qpol_type_t *source_type;
+				uint32_t source_val;
+				if (qpol_terule_get_source_type(p->p, rule, &source_type) < 0 ||
+				    qpol_type_get_value(p->p, source_type, &source_val) < 0) {
+					goto cleanup;
+				}
+				match_source = apol_query_bitset_test(&plan->sources, source_val);
 			}
-		}
 
-		/* if source did not match, but treating source symbol
-		 * as any field, then delay rejecting this rule until
-		 * the target and default have been checked */
-		if (!source_as_any && !match_source) {
-			continue;
-		}
+			/* if source did not match, but treating source symbol
+			 * as any field, then delay rejecting this rule until
+			 * the target and default have been checked */
+			if (!source_as_any && !match_source) {
+				continue;
+			}
 
-		if (target_list == NULL || (source_as_any && match_source)) {
-			match_target = 1;
-		} else {
-			const qpol_type_t *target_type;
-			if (qpol_terule_get_target_type(p->p, rule, &target_type) < 0) {
-				goto cleanup;
+			if (plan->targets.bits != NULL && !(source_as_any && match_source)) {
+				const qpol_type_t *target_type;
+				uint32_t target_val;
+				if (qpol_terule_get_target_type(p->p, rule, &target_type) < 0 ||
+				    qpol_type_get_value(p->p, target_type, &target_val) < 0) {
+					goto cleanup;
+				}
+				match_target = apol_query_bitset_test(&plan->targets, target_val);
 			}
-			if (apol_vector_get_index(target_list, target_type, NULL, NULL, &i) == 0) {
-				match_target = 1;
+
+			if (!source_as_any && !match_target) {
+				continue;
 			}
-		}
 
-		if (!source_as_any && !match_target) {
-			continue;
-		}
+			if (plan->defaults.bits != NULL && !(source_as_any && (match_source || match_target))) {
+				const qpol_type_t *default_type;
+				uint32_t default_val;
+				if (qpol_terule_get_default_type(p->p, rule, &default_type) < 0 ||
+				    qpol_type_get_value(p->p, default_type, &default_val) < 0) {
+					goto cleanup;
+				}
+				match_default = apol_query_bitset_test(&plan->defaults, default_val);
+			}
 
-		if (default_list == NULL || (source_as_any && match_source) || (source_as_any && match_target)) {
-			match_default = 1;
-		} else {
-			const qpol_type_t *default_type;
-			if (qpol_terule_get_default_type(p->p, rule, &default_type) < 0) {
-				goto cleanup;
+			if (!source_as_any && !match_default) {
+				continue;
 			}
-			if (apol_vector_get_index(default_list, default_type, NULL, NULL, &i) == 0) {
-				match_default = 1;
+			/* at least one thing must match if source_as_any was given */
+			if (source_as_any && (!match_source && !match_target && !match_default)) {
+				continue;
 			}
-		}
 
-		if (!source_as_any && !match_default) {
-			continue;
-		}
-		/* at least one thing must match if source_as_any was given */
-		if (source_as_any && (!match_source && !match_target && !match_default)) {
-			continue;
-		}
+			if (plan->classes.bits != NULL) {
+				const qpol_class_t *obj_class;
+				uint32_t class_val;
+				if (qpol_terule_get_object_class(p->p, rule, &obj_class) < 0 ||
+				    qpol_class_get_value(p->p, obj_class, &class_val) < 0) {
+					goto cleanup;
+				}
+				if (!apol_query_bitset_test(&plan->classes, class_val)) {
+					continue;
+				}
+			}
 
-		if (class_list != NULL) {
-			const qpol_class_t *obj_class;
-			if (qpol_terule_get_object_class(p->p, rule, &obj_class) < 0) {
+			if ((ret = fn(p, rule, arg)) != 0) {
+				retv = ret;
 				goto cleanup;
 			}
-			if (apol_vector_get_index(class_list, obj_class, NULL, NULL, &i) < 0) {
-				continue;
-			}
-		}
-
-		if (apol_vector_append(v, rule)) {
-			ERR(p, "%s", strerror(ENOMEM));
-			goto cleanup;
 		}
 	}
 
 	retv = 0;
 
       cleanup:
-	apol_regex_destroy(&bool_regex);
-	qpol_iterator_destroy(&iter);
 	return retv;
 }
 
-int apol_terule_get_by_query(const apol_policy_t * p, const apol_terule_query_t * t, apol_vector_t ** v)
+/**
+ *  Free all memory used by a compiled query and set it to NULL.  Does
+ *  nothing if the reference is already NULL.
+ *  @param plan Reference to the plan to destroy.
+ */
+static void terule_plan_destroy(terule_plan_t ** plan)
 {
-	apol_vector_t *source_list = NULL, *target_list = NULL, *class_list = NULL, *default_list = NULL;
-	int retval = -1, source_as_any = 0, is_regex = 0;
-	char *bool_name = NULL;
-	*v = NULL;
-	unsigned int flags = 0;
+	if (*plan != NULL) {
+		if ((*plan)->target_list == (*plan)->source_list) {
+			(*plan)->target_list = NULL;
+		}
+		if ((*plan)->default_list == (*plan)->source_list) {
+			(*plan)->default_list = NULL;
+		}
+		apol_vector_destroy(&(*plan)->source_list);
+		apol_vector_destroy(&(*plan)->target_list);
+		apol_vector_destroy(&(*plan)->default_list);
+		apol_query_bitset_destroy(&(*plan)->sources);
+		apol_query_bitset_destroy(&(*plan)->targets);
+		apol_query_bitset_destroy(&(*plan)->defaults);
+		apol_query_bitset_destroy(&(*plan)->classes);
+		free((*plan)->bool_name);
+		apol_regex_destroy(&(*plan)->bool_regex);
+		free(*plan);
+		*plan = NULL;
+	}
+}
 
-	uint32_t rule_type = QPOL_RULE_TYPE_TRANS | QPOL_RULE_TYPE_MEMBER | QPOL_RULE_TYPE_CHANGE;
+/**
+ *  Compile a query against a policy.
+ *  @param p Policy to be searched.
+ *  @param t Query to compile, or NULL to match all rules.
+ *  @param is_syn If non-zero, the candidate source and target types
+ *  will include those needed for syntactic rule searching.
+ *  @return The compiled query, to be destroyed by
+ *  terule_plan_destroy(), or NULL on error.
+ */
+static terule_plan_t *terule_plan_create(const apol_policy_t * p, const apol_terule_query_t * t, int is_syn)
+{
+	apol_vector_t *(*create_type_list) (const apol_policy_t *, const char *, int, int, unsigned int) =
+		(is_syn ? apol_query_create_candidate_syn_type_list : apol_query_create_candidate_type_list);
+	apol_vector_t *class_list = NULL;
+	terule_plan_t *plan = NULL;
+	int retval = -1, is_regex;
+
+	if ((plan = calloc(1, sizeof(*plan))) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		goto cleanup;
+	}
+	plan->policy_serial = p->frozen;
+	plan->rule_type = QPOL_RULE_TYPE_TRANS | QPOL_RULE_TYPE_MEMBER | QPOL_RULE_TYPE_CHANGE;
 	if (t != NULL) {
 		if (t->rules != 0) {
-			rule_type &= t->rules;
+			plan->rule_type &= t->rules;
 		}
-		flags = t->flags;
+		plan->flags = t->flags;
 		is_regex = t->flags & APOL_QUERY_REGEX;
-		bool_name = t->bool_name;
+		if (t->bool_name != NULL && (plan->bool_name = strdup(t->bool_name)) == NULL) {
+			ERR(p, "%s", strerror(errno));
+			goto cleanup;
+		}
 		if (t->source != NULL &&
-		    (source_list =
-		     apol_query_create_candidate_type_list(p, t->source, is_regex,
-							   t->flags & APOL_QUERY_SOURCE_INDIRECT,
-							   ((t->flags & (APOL_QUERY_SOURCE_TYPE | APOL_QUERY_SOURCE_ATTRIBUTE)) /
-							    APOL_QUERY_SOURCE_TYPE))) == NULL) {
+		    (plan->source_list =
+		     create_type_list(p, t->source, is_regex,
+				      t->flags & APOL_QUERY_SOURCE_INDIRECT,
+				      ((t->flags & (APOL_QUERY_SOURCE_TYPE | APOL_QUERY_SOURCE_ATTRIBUTE)) /
+				       APOL_QUERY_SOURCE_TYPE))) == NULL) {
 			goto cleanup;
 		}
 		if ((t->flags & APOL_QUERY_SOURCE_AS_ANY) && t->source != NULL) {
-			default_list = target_list = source_list;
-			source_as_any = 1;
+			plan->default_list = plan->target_list = plan->source_list;
 		} else {
+			plan->flags &= ~APOL_QUERY_SOURCE_AS_ANY;
 			if (t->target != NULL &&
-			    (target_list =
-			     apol_query_create_candidate_type_list(p, t->target, is_regex,
-								   t->flags & APOL_QUERY_TARGET_INDIRECT,
-								   ((t->
-								     flags & (APOL_QUERY_TARGET_TYPE | APOL_QUERY_TARGET_ATTRIBUTE))
-								    / APOL_QUERY_TARGET_TYPE))) == NULL) {
+			    (plan->target_list =
+			     create_type_list(p, t->target, is_regex,
+					      t->flags & APOL_QUERY_TARGET_INDIRECT,
+					      ((t->flags & (APOL_QUERY_TARGET_TYPE | APOL_QUERY_TARGET_ATTRIBUTE)) /
+					       APOL_QUERY_TARGET_TYPE))) == NULL) {
 				goto cleanup;
 			}
 			if (t->default_type != NULL &&
-			    (default_list =
+			    (plan->default_list =
 			     apol_query_create_candidate_type_list(p, t->default_type, is_regex, 0,
 								   APOL_QUERY_SYMBOL_IS_TYPE)) == NULL) {
 				goto cleanup;
@@ -235,86 +295,218 @@ int apol_terule_get_by_query(const apol_policy_t * p, const apol_terule_query_t
 			goto cleanup;
 		}
 	}
-
-	if ((*v = apol_vector_create(NULL)) == NULL) {
-		ERR(p, "%s", strerror(errno));
-		goto cleanup;
-	}
-
-	if (rule_select(p, *v, rule_type, flags, source_list, target_list, class_list, default_list, bool_name)) {
+	if (apol_query_create_type_bitset(p, plan->source_list, &plan->sources) < 0 ||
+	    apol_query_create_type_bitset(p, plan->target_list, &plan->targets) < 0 ||
+	    apol_query_create_type_bitset(p, plan->default_list, &plan->defaults) < 0 ||
+	    apol_query_create_class_bitset(p, class_list, &plan->classes) < 0) {
 		goto cleanup;
 	}
 
 	retval = 0;
       cleanup:
+	apol_vector_destroy(&class_list);
 	if (retval != 0) {
-		apol_vector_destroy(v);
+		terule_plan_destroy(&plan);
 	}
-	apol_vector_destroy(&source_list);
-	if (!source_as_any) {
-		apol_vector_destroy(&target_list);
-		apol_vector_destroy(&default_list);
+	return plan;
+}
+
+/** Walks over the rule tables that rule_select() may take. */
+#define RULE_WALK_ALL 0
+#define RULE_WALK_BY_SOURCE 1
+#define RULE_WALK_BY_TARGET 2
+
+/**
+ *  Select the rules matching a compiled query from one part of one
+ *  walk over the rule tables.
+ *  @param p Policy to search.
+ *  @param fn Function to call for each matching rule.
+ *  @param arg Argument passed to fn.
+ *  @param plan Compiled query.
+ *  @param bool_regex Reference to the compiled boolean regex, compiled
+ *  upon first use.
+ *  @param walk RULE_WALK_ALL to examine every rule, or
+ *  RULE_WALK_BY_SOURCE or RULE_WALK_BY_TARGET to examine the rules
+ *  indexed under each candidate source or target type.
+ *  @param part Part of the walk to take: a range of the buckets of the
+ *  rule tables, or of the candidate types.
+ *  @param num_parts Number of parts into which the walk is split.
+ *  @return 0 on success, < 0 on failure, or the non-zero value
+ *  returned by fn to stop.
+ */
+static int rule_select_part(const apol_policy_t * p, apol_query_result_fn_t fn, void *arg, terule_plan_t * plan,
+			    regex_t ** bool_regex, int walk, size_t part, size_t num_parts)
+{
+	qpol_iterator_t *iter = NULL;
+	const apol_vector_t *list = (walk == RULE_WALK_BY_SOURCE ? plan->source_list : plan->target_list);
+	int retv = -1, ret;
+	size_t i, num;
+
+	if (walk == RULE_WALK_ALL) {
+		if (qpol_policy_get_terule_iter_part(p->p, plan->rule_type, part, num_parts, &iter) < 0) {
+			goto cleanup;
+		}
+		if ((ret = rule_select_from_iter(p, iter, fn, arg, plan, bool_regex)) != 0) {
+			retv = ret;
+			goto cleanup;
+		}
+	} else {
+		num = apol_vector_get_size(list);
+		for (i = num * part / num_parts; i < num * (part + 1) / num_parts; i++) {
+			const qpol_type_t *type = apol_vector_get_element(list, i);
+			if ((walk == RULE_WALK_BY_SOURCE ?
+			     qpol_policy_get_terule_iter_by_source(p->p, plan->rule_type, type, &iter) :
+			     qpol_policy_get_terule_iter_by_target(p->p, plan->rule_type, type, &iter)) < 0) {
+				goto cleanup;
+			}
+			if ((ret = rule_select_from_iter(p, iter, fn, arg, plan, bool_regex)) != 0) {
+				retv = ret;
+				goto cleanup;
+			}
+			qpol_iterator_destroy(&iter);
+		}
+	}
+
+	retv = 0;
+      cleanup:
+	qpol_iterator_destroy(&iter);
+	return retv;
+}
+
+/** One walk over the rule tables, to be split among threads. */
+typedef struct rule_select_walk
+{
+	const apol_policy_t *p;
+	terule_plan_t *plan;
+	int walk;
+	size_t num_parts;
+} rule_select_walk_t;
+
+/**
+ *  Select the rules from one part of a walk, as called by
+ *  apol_query_select_parallel().  Each part compiles its own boolean
+ *  regex, so that parts running at once share nothing they modify.
+ */
+static int rule_select_walk_part(size_t part, apol_vector_t * v, void *arg)
+{
+	rule_select_walk_t *w = arg;
+	regex_t *bool_regex = NULL;
+	int retv;
+
+	retv = rule_select_part(w->p, apol_query_append_result, v, w->plan, &bool_regex, w->walk, part, w->num_parts);
+	apol_regex_destroy(&bool_regex);
+	return retv;
+}
+
+/**
+ *  Common semantic rule selection routine used in get*rule_by_query.
+ *  If the query names a source or target type, and is not treating
+ *  the source as any field, then only the rules indexed under those
+ *  types are examined; otherwise every rule in the policy is.  The
+ *  walk over the rules may be split among several threads, with the
+ *  results passed on in the same order as if one thread had taken the
+ *  whole walk.
+ *  @param p Policy to search.
+ *  @param fn Function to call for each matching rule.
+ *  @param arg Argument passed to fn.
+ *  @param plan Compiled query.
+ *  @param num_threads Number of threads requested, as given to
+ *  apol_query_get_num_threads().
+ *  @return 0 on success, < 0 on failure, or the non-zero value
+ *  returned by fn to stop.
+ */
+static int rule_select(const apol_policy_t * p, apol_query_result_fn_t fn, void *arg, terule_plan_t * plan,
+		       size_t num_threads)
+{
+	rule_select_walk_t w;
+	size_t num;
+
+	/* a rule matching only by its default type can not be found
+	 * through the index, so treating the source as any field
+	 * requires examining every rule */
+	w.walk = RULE_WALK_ALL;
+	if (!(plan->flags & APOL_QUERY_SOURCE_AS_ANY)) {
+		if (plan->source_list != NULL) {
+			w.walk = RULE_WALK_BY_SOURCE;
+		} else if (plan->target_list != NULL) {
+			w.walk = RULE_WALK_BY_TARGET;
+		}
+	}
+
+	num_threads = apol_query_get_num_threads(p, num_threads);
+	if (num_threads <= 1) {
+		return rule_select_part(p, fn, arg, plan, &plan->bool_regex, w.walk, 0, 1);
+	}
+	w.p = p;
+	w.plan = plan;
+	w.num_parts = num_threads * APOL_QUERY_PARTS_PER_THREAD;
+	if (w.walk != RULE_WALK_ALL) {
+		num = apol_vector_get_size(w.walk == RULE_WALK_BY_SOURCE ? plan->source_list : plan->target_list);
+		if (num < w.num_parts) {
+			w.num_parts = num;
+		}
+	}
+	if (w.num_parts == 0) {
+		return 0;
+	}
+	return apol_query_select_parallel(p, fn, arg, w.num_parts, num_threads, rule_select_walk_part, &w);
+}
+
+int apol_terule_foreach_by_query(const apol_policy_t * p, const apol_terule_query_t * t, apol_query_result_fn_t fn, void *arg)
+{
+	terule_plan_t *plan = NULL;
+	int retval = -1;
+
+	if (t != NULL && t->plan != NULL && apol_policy_is_frozen(p) && t->plan->policy_serial == p->frozen) {
+		plan = t->plan;
+	} else if ((plan = terule_plan_create(p, t, 0)) == NULL) {
+		goto cleanup;
+	} else if (t != NULL && plan->policy_serial != 0) {
+		/* the policy can no longer change, so keep the plan
+		 * for the query's next run */
+		terule_plan_destroy(&((apol_terule_query_t *) t)->plan);
+		((apol_terule_query_t *) t)->plan = plan;
+	}
+
+	retval = rule_select(p, fn, arg, plan, (t != NULL ? t->num_threads : 1));
+      cleanup:
+	if (t == NULL || plan != t->plan) {
+		terule_plan_destroy(&plan);
 	}
-	apol_vector_destroy(&class_list);
 	return retval;
 }
 
+int apol_terule_get_by_query(const apol_policy_t * p, const apol_terule_query_t * t, apol_vector_t ** v)
+{
+	if ((*v = apol_vector_create(NULL)) == NULL) {
+		ERR(p, "%s", strerror(errno));
+		return -1;
+	}
+	if (apol_terule_foreach_by_query(p, t, apol_query_append_result, *v)) {
+		apol_vector_destroy(v);
+		return -1;
+	}
+	return 0;
+}
+
 int apol_syn_terule_get_by_query(const apol_policy_t * p, const apol_terule_query_t * t, apol_vector_t ** v)
 {
-	apol_vector_t *source_list = NULL, *target_list = NULL, *class_list = NULL, *default_list = NULL, *syn_v = NULL;
+	apol_vector_t *source_list = NULL, *target_list = NULL, *default_list = NULL, *syn_v = NULL;
+	terule_plan_t *plan = NULL;
 	int retval = -1, source_as_any = 0, is_regex = 0;
-	char *bool_name = NULL;
 	*v = NULL;
 	size_t i;
-	unsigned int flags = 0;
 
 	if (!p || !qpol_policy_has_capability(apol_policy_get_qpol(p), QPOL_CAP_SYN_RULES)) {
 		ERR(p, "%s", strerror(EINVAL));
 		goto cleanup;
 	}
 
-	uint32_t rule_type = QPOL_RULE_TYPE_TRANS | QPOL_RULE_TYPE_MEMBER | QPOL_RULE_TYPE_CHANGE;
+	if ((plan = terule_plan_create(p, t, 1)) == NULL) {
+		goto cleanup;
+	}
 	if (t != NULL) {
-		if (t->rules != 0) {
-			rule_type &= t->rules;
-		}
-		flags = t->flags;
 		is_regex = t->flags & APOL_QUERY_REGEX;
-		bool_name = t->bool_name;
-		if (t->source != NULL &&
-		    (source_list =
-		     apol_query_create_candidate_syn_type_list(p, t->source, is_regex,
-							       t->flags & APOL_QUERY_SOURCE_INDIRECT,
-							       ((t->flags & (APOL_QUERY_SOURCE_TYPE |
-									     APOL_QUERY_SOURCE_ATTRIBUTE)) /
-								APOL_QUERY_SOURCE_TYPE))) == NULL) {
-			goto cleanup;
-		}
-		if ((t->flags & APOL_QUERY_SOURCE_AS_ANY) && t->source != NULL) {
-			default_list = target_list = source_list;
-			source_as_any = 1;
-		} else {
-			if (t->target != NULL &&
-			    (target_list =
-			     apol_query_create_candidate_syn_type_list(p, t->target, is_regex,
-								       t->flags & APOL_QUERY_TARGET_INDIRECT,
-								       ((t->flags & (APOL_QUERY_TARGET_TYPE |
-										     APOL_QUERY_TARGET_ATTRIBUTE))
-									/ APOL_QUERY_TARGET_TYPE))) == NULL) {
-				goto cleanup;
-			}
-			if (t->default_type != NULL &&
-			    (default_list =
-			     apol_query_create_candidate_type_list(p, t->default_type, is_regex, 0,
-								   APOL_QUERY_SYMBOL_IS_TYPE)) == NULL) {
-				goto cleanup;
-			}
-		}
-		if (t->classes != NULL &&
-		    apol_vector_get_size(t->classes) > 0 &&
-		    (class_list = apol_query_create_candidate_class_list(p, t->classes)) == NULL) {
-			goto cleanup;
-		}
 	}
 
 	if ((*v = apol_vector_create(NULL)) == NULL) {
@@ -322,10 +514,17 @@ int apol_syn_terule_get_by_query(const apol_policy_t * p, const apol_terule_quer
 		goto cleanup;
 	}
 
-	if (rule_select(p, *v, rule_type, flags, source_list, target_list, class_list, default_list, bool_name)) {
+	if (rule_select(p, apol_query_append_result, *v, plan, (t != NULL ? t->num_threads : 1))) {
 		goto cleanup;
 	}
 
+	/* keep the candidate types for post filtering */
+	source_list = plan->source_list;
+	target_list = plan->target_list;
+	default_list = plan->default_list;
+	source_as_any = (source_list != NULL && source_list == target_list);
+	plan->source_list = plan->target_list = plan->default_list = NULL;
+
 	syn_v = apol_terule_list_to_syn_terules(p, *v);
 	if (!syn_v) {
 		goto cleanup;
@@ -428,7 +627,7 @@ int apol_syn_terule_get_by_query(const apol_policy_t * p, const apol_terule_quer
 		apol_vector_destroy(&target_list);
 		apol_vector_destroy(&default_list);
 	}
-	apol_vector_destroy(&class_list);
+	terule_plan_destroy(&plan);
 	return retval;
 }
 
@@ -440,6 +639,7 @@ apol_terule_query_t *apol_terule_query_create(void)
 		t->flags =
 			(APOL_QUERY_SOURCE_TYPE | APOL_QUERY_SOURCE_ATTRIBUTE | APOL_QUERY_TARGET_TYPE |
 			 APOL_QUERY_TARGET_ATTRIBUTE);
+		t->num_threads = 1;
 	}
 	return t;
 }
@@ -452,6 +652,7 @@ void apol_terule_query_destroy(apol_terule_query_t ** t)
 		free((*t)->default_type);
 		free((*t)->bool_name);
 		apol_vector_destroy(&(*t)->classes);
+		terule_plan_destroy(&(*t)->plan);
 		free(*t);
 		*t = NULL;
 	}
@@ -459,6 +660,7 @@ void apol_terule_query_destroy(apol_terule_query_t ** t)
 
 int apol_terule_query_set_rules(const apol_policy_t * p __attribute__ ((unused)), apol_terule_query_t * t, unsigned int rules)
 {
+	terule_plan_destroy(&t->plan);
 	if (rules != 0) {
 		t->rules = rules;
 	} else {
@@ -469,6 +671,7 @@ int apol_terule_query_set_rules(const apol_policy_t * p __attribute__ ((unused))
 
 int apol_terule_query_set_source(const apol_policy_t * p, apol_terule_query_t * t, const char *symbol, int is_indirect)
 {
+	terule_plan_destroy(&t->plan);
 	apol_query_set_flag(p, &t->flags, is_indirect, APOL_QUERY_SOURCE_INDIRECT);
 	return apol_query_set(p, &t->source, NULL, symbol);
 }
@@ -480,6 +683,7 @@ int apol_terule_query_set_source_component(const apol_policy_t * p, apol_terule_
 		errno = EINVAL;
 		return -1;
 	}
+	terule_plan_destroy(&t->plan);
 	apol_query_set_flag(p, &t->flags, component & APOL_QUERY_SYMBOL_IS_TYPE, APOL_QUERY_SOURCE_TYPE);
 	apol_query_set_flag(p, &t->flags, component & APOL_QUERY_SYMBOL_IS_ATTRIBUTE, APOL_QUERY_SOURCE_ATTRIBUTE);
 	return 0;
@@ -487,6 +691,7 @@ int apol_terule_query_set_source_component(const apol_policy_t * p, apol_terule_
 
 int apol_terule_query_set_target(const apol_policy_t * p, apol_terule_query_t * t, const char *symbol, int is_indirect)
 {
+	terule_plan_destroy(&t->plan);
 	apol_query_set_flag(p, &t->flags, is_indirect, APOL_QUERY_TARGET_INDIRECT);
 	return apol_query_set(p, &t->target, NULL, symbol);
 }
@@ -498,6 +703,7 @@ int apol_terule_query_set_target_component(const apol_policy_t * p, apol_terule_
 		errno = EINVAL;
 		return -1;
 	}
+	terule_plan_destroy(&t->plan);
 	apol_query_set_flag(p, &t->flags, component & APOL_QUERY_SYMBOL_IS_TYPE, APOL_QUERY_TARGET_TYPE);
 	apol_query_set_flag(p, &t->flags, component & APOL_QUERY_SYMBOL_IS_ATTRIBUTE, APOL_QUERY_TARGET_ATTRIBUTE);
 	return 0;
@@ -505,12 +711,14 @@ int apol_terule_query_set_target_component(const apol_policy_t * p, apol_terule_
 
 int apol_terule_query_set_default(const apol_policy_t * p, apol_terule_query_t * t, const char *symbol)
 {
+	terule_plan_destroy(&t->plan);
 	return apol_query_set(p, &t->default_type, NULL, symbol);
 }
 
 int apol_terule_query_append_class(const apol_policy_t * p, apol_terule_query_t * t, const char *obj_class)
 {
 	char *s = NULL;
+	terule_plan_destroy(&t->plan);
 	if (obj_class == NULL) {
 		apol_vector_destroy(&t->classes);
 	} else if ((s = strdup(obj_class)) == NULL || (t->classes == NULL && (t->classes = apol_vector_create(free)) == NULL)
@@ -524,24 +732,35 @@ int apol_terule_query_append_class(const apol_policy_t * p, apol_terule_query_t
 
 int apol_terule_query_set_bool(const apol_policy_t * p, apol_terule_query_t * t, const char *bool_name)
 {
+	terule_plan_destroy(&t->plan);
 	return apol_query_set(p, &t->bool_name, NULL, bool_name);
 }
 
 int apol_terule_query_set_enabled(const apol_policy_t * p, apol_terule_query_t * t, int is_enabled)
 {
+	terule_plan_destroy(&t->plan);
 	return apol_query_set_flag(p, &t->flags, is_enabled, APOL_QUERY_ONLY_ENABLED);
 }
 
 int apol_terule_query_set_source_any(const apol_policy_t * p, apol_terule_query_t * t, int is_any)
 {
+	terule_plan_destroy(&t->plan);
 	return apol_query_set_flag(p, &t->flags, is_any, APOL_QUERY_SOURCE_AS_ANY);
 }
 
 int apol_terule_query_set_regex(const apol_policy_t * p, apol_terule_query_t * t, int is_regex)
 {
+	terule_plan_destroy(&t->plan);
 	return apol_query_set_regex(p, &t->flags, is_regex);
 }
 
+int apol_terule_query_set_threads(const apol_policy_t * p __attribute__ ((unused)), apol_terule_query_t * t,
+				  size_t num_threads)
+{
+	t->num_threads = num_threads;
+	return 0;
+}
+
 /**
  * Comparison function for two syntactic terules.  Will return -1 if
  * a's line number is before b's, 1 if b is greater.
@@ -27,6 +27,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
 
 /** The default initial capacity of a vector; must be a positive integer */
 #define APOL_VECTOR_DFLT_INIT_CAP 10
@@ -292,37 +294,244 @@ int apol_vector_compare(const apol_vector_t * a, const apol_vector_t * b, apol_v
 	}
 }
 
-static size_t vector_qsort_partition(void **data, size_t first, size_t last, apol_vector_comp_func * cmp, void *arg)
+/** Ranges of at most this many elements are sorted by insertion. */
+#define VECTOR_SORT_INSERTION_MAX 16
+
+/** Vectors with fewer elements than this are not worth the threads
+ *  of apol_vector_sort_parallel(). */
+#define VECTOR_SORT_PARALLEL_MIN 16384
+
+/** Stable insertion sort of the n elements starting at data. */
+static void vector_insertion_sort(void **data, size_t n, apol_vector_comp_func * cmp, void *arg)
+{
+	size_t i, j;
+	void *x;
+
+	for (i = 1; i < n; i++) {
+		x = data[i];
+		for (j = i; j > 0 && cmp(data[j - 1], x, arg) > 0; j--) {
+			data[j] = data[j - 1];
+		}
+		data[j] = x;
+	}
+}
+
+static void vector_sift_down(void **data, size_t root, size_t n, apol_vector_comp_func * cmp, void *arg)
+{
+	void *x = data[root];
+	size_t child;
+
+	while ((child = 2 * root + 1) < n) {
+		if (child + 1 < n && cmp(data[child], data[child + 1], arg) < 0) {
+			child++;
+		}
+		if (cmp(x, data[child], arg) >= 0) {
+			break;
+		}
+		data[root] = data[child];
+		root = child;
+	}
+	data[root] = x;
+}
+
+static void vector_heapsort(void **data, size_t n, apol_vector_comp_func * cmp, void *arg)
 {
-	void *pivot = data[last];
-	size_t i = first, j = last;
-	while (i < j) {
-		if (cmp(data[i], pivot, arg) <= 0) {
-			i++;
+	size_t i;
+	void *x;
+
+	for (i = n / 2; i > 0; i--) {
+		vector_sift_down(data, i - 1, n, cmp, arg);
+	}
+	for (i = n - 1; i > 0; i--) {
+		x = data[0];
+		data[0] = data[i];
+		data[i] = x;
+		vector_sift_down(data, 0, i, cmp, arg);
+	}
+}
+
+#define VECTOR_SWAP(data, a, b) do { void *_x = (data)[a]; (data)[a] = (data)[b]; (data)[b] = _x; } while (0)
+
+/**
+ * Introsort of the n elements starting at data: quicksort with a
+ * median of three pivot, switching to heapsort for any range that is
+ * partitioned more than depth times, so that the worst case stays
+ * O(n log n), and finishing small ranges by insertion sort.  Only the
+ * smaller side of each partition is recursed upon, bounding the stack
+ * by log n frames.
+ */
+static void vector_introsort(void **data, size_t n, size_t depth, apol_vector_comp_func * cmp, void *arg)
+{
+	size_t i, j, mid;
+	void *pivot;
+
+	while (n > VECTOR_SORT_INSERTION_MAX) {
+		if (depth == 0) {
+			vector_heapsort(data, n, cmp, arg);
+			return;
+		}
+		depth--;
+
+		/* order the first, middle and last elements; the
+		 * outer two then bound the scans below */
+		mid = n / 2;
+		if (cmp(data[mid], data[0], arg) < 0) {
+			VECTOR_SWAP(data, 0, mid);
+		}
+		if (cmp(data[n - 1], data[mid], arg) < 0) {
+			VECTOR_SWAP(data, mid, n - 1);
+			if (cmp(data[mid], data[0], arg) < 0) {
+				VECTOR_SWAP(data, 0, mid);
+			}
+		}
+		pivot = data[mid];
+
+		/* elements equal to the pivot stop both scans, so
+		 * that runs of equal elements split evenly */
+		i = 0;
+		j = n - 1;
+		for (;;) {
+			do {
+				i++;
+			} while (cmp(data[i], pivot, arg) < 0);
+			do {
+				j--;
+			} while (cmp(pivot, data[j], arg) < 0);
+			if (i >= j) {
+				break;
+			}
+			VECTOR_SWAP(data, i, j);
+		}
+
+		/* now [0, j] <= pivot <= [j + 1, n) */
+		if (j + 1 < n - j - 1) {
+			vector_introsort(data, j + 1, depth, cmp, arg);
+			data += j + 1;
+			n -= j + 1;
 		} else {
-			data[j] = data[i];
-			data[i] = data[j - 1];
-			j--;
+			vector_introsort(data + j + 1, n - j - 1, depth, cmp, arg);
+			n = j + 1;
 		}
 	}
-	data[j] = pivot;
-	return j;
+	vector_insertion_sort(data, n, cmp, arg);
+}
+
+static void vector_sort(void **data, size_t n, apol_vector_comp_func * cmp, void *arg)
+{
+	size_t depth = 0, i;
+
+	for (i = n; i > 1; i >>= 1) {
+		depth += 2;
+	}
+	vector_introsort(data, n, depth, cmp, arg);
 }
 
-static void vector_qsort(void **data, size_t first, size_t last, apol_vector_comp_func * cmp, void *arg)
+/**
+ * Stably merge the sorted ranges [lo, mid) and [mid, hi) of src into
+ * the same positions of dst.
+ */
+static void vector_merge(void **src, size_t lo, size_t mid, size_t hi, void **dst, apol_vector_comp_func * cmp, void *arg)
 {
-	if (first < last) {
-		size_t i = vector_qsort_partition(data, first, last, cmp, arg);
-		/* need this explicit check here, because i is an
-		 * unsigned integer, and subtracting 1 from 0 is
-		 * bad */
-		if (i > 0) {
-			vector_qsort(data, first, i - 1, cmp, arg);
+	size_t i = lo, j = mid, k = lo;
+
+	if (mid > lo && mid < hi && cmp(src[mid - 1], src[mid], arg) <= 0) {
+		/* already in order, as when re-sorting a sorted vector */
+		memcpy(dst + lo, src + lo, (hi - lo) * sizeof(*dst));
+		return;
+	}
+	while (i < mid && j < hi) {
+		if (cmp(src[j], src[i], arg) < 0) {
+			dst[k++] = src[j++];
+		} else {
+			dst[k++] = src[i++];
 		}
-		vector_qsort(data, i + 1, last, cmp, arg);
+	}
+	while (i < mid) {
+		dst[k++] = src[i++];
+	}
+	while (j < hi) {
+		dst[k++] = src[j++];
 	}
 }
 
+/**
+ * Bottom up merge sort of the n elements of data, using tmp (of at
+ * least n elements) as scratch space.  Equal elements keep their
+ * relative order.
+ */
+static void vector_mergesort(void **data, void **tmp, size_t n, apol_vector_comp_func * cmp, void *arg)
+{
+	void **src = data, **dst = tmp, **t;
+	size_t width, lo;
+
+	for (lo = 0; lo < n; lo += VECTOR_SORT_INSERTION_MAX) {
+		vector_insertion_sort(data + lo, (n - lo < VECTOR_SORT_INSERTION_MAX ? n - lo : VECTOR_SORT_INSERTION_MAX), cmp, arg);
+	}
+	for (width = VECTOR_SORT_INSERTION_MAX; width < n; width *= 2) {
+		for (lo = 0; lo < n; lo += 2 * width) {
+			size_t mid = (n - lo < width ? n : lo + width);
+			size_t hi = (n - lo < 2 * width ? n : lo + 2 * width);
+			vector_merge(src, lo, mid, hi, dst, cmp, arg);
+		}
+		t = src;
+		src = dst;
+		dst = t;
+	}
+	if (src != data) {
+		memcpy(data, src, n * sizeof(*data));
+	}
+}
+
+/** One piece of the work of apol_vector_sort_parallel(). */
+struct vector_sort_task
+{
+	void **src, **dst;
+	size_t lo, mid, hi;
+	apol_vector_comp_func *cmp;
+	void *arg;
+};
+
+static void *vector_sort_task_sort(void *data)
+{
+	struct vector_sort_task *task = data;
+	vector_sort(task->src + task->lo, task->hi - task->lo, task->cmp, task->arg);
+	return NULL;
+}
+
+static void *vector_sort_task_merge(void *data)
+{
+	struct vector_sort_task *task = data;
+	vector_merge(task->src, task->lo, task->mid, task->hi, task->dst, task->cmp, task->arg);
+	return NULL;
+}
+
+/**
+ * Run tasks on as many threads, the calling thread taking the first.
+ * Should a thread fail to start, the calling thread runs the tasks
+ * left over.
+ */
+static void vector_sort_run_tasks(struct vector_sort_task *tasks, size_t num, void *(*fn) (void *))
+{
+	pthread_t *threads = NULL;
+	size_t i, num_started = 1;
+
+	if (num > 1 && (threads = calloc(num, sizeof(*threads))) != NULL) {
+		for (; num_started < num; num_started++) {
+			if (pthread_create(&threads[num_started], NULL, fn, &tasks[num_started]) != 0) {
+				break;
+			}
+		}
+	}
+	for (i = num_started; i < num; i++) {
+		fn(&tasks[i]);
+	}
+	fn(&tasks[0]);
+	for (i = 1; i < num_started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	free(threads);
+}
+
 /**
  * Generic comparison function, which treats elements of the vector as
  * unsigned integers.
@@ -339,7 +548,6 @@ static int vector_int_comp(const void *a, const void *b, void *data __attribute_
 	return 0;
 }
 
-/* implemented as an in-place quicksort */
 void apol_vector_sort(apol_vector_t * v, apol_vector_comp_func * cmp, void *data)
 {
 	if (!v) {
@@ -350,10 +558,110 @@ void apol_vector_sort(apol_vector_t * v, apol_vector_comp_func * cmp, void *data
 		cmp = vector_int_comp;
 	}
 	if (v->size > 1) {
-		vector_qsort(v->array, 0, v->size - 1, cmp, data);
+		vector_sort(v->array, v->size, cmp, data);
 	}
 }
 
+int apol_vector_sort_stable(apol_vector_t * v, apol_vector_comp_func * cmp, void *data)
+{
+	void **tmp;
+
+	if (!v) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (cmp == NULL) {
+		cmp = vector_int_comp;
+	}
+	if (v->size > 1) {
+		if ((tmp = malloc(v->size * sizeof(*tmp))) == NULL) {
+			return -1;
+		}
+		vector_mergesort(v->array, tmp, v->size, cmp, data);
+		free(tmp);
+	}
+	return 0;
+}
+
+int apol_vector_sort_parallel(apol_vector_t * v, apol_vector_comp_func * cmp, void *data, size_t num_threads)
+{
+	struct vector_sort_task *tasks = NULL;
+	size_t *bounds = NULL, num_runs, i, k;
+	void **tmp = NULL, **src, **dst, **t;
+	long num_cpus;
+	int error;
+
+	if (!v) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (cmp == NULL) {
+		cmp = vector_int_comp;
+	}
+	if (num_threads == 0) {
+		num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		num_threads = (num_cpus > 0 ? (size_t) num_cpus : 1);
+	}
+	if (num_threads > v->size / (VECTOR_SORT_PARALLEL_MIN / 2)) {
+		num_threads = v->size / (VECTOR_SORT_PARALLEL_MIN / 2);
+	}
+	if (num_threads <= 1) {
+		apol_vector_sort(v, cmp, data);
+		return 0;
+	}
+
+	if ((tmp = malloc(v->size * sizeof(*tmp))) == NULL ||
+	    (tasks = calloc(num_threads, sizeof(*tasks))) == NULL || (bounds = calloc(num_threads + 1, sizeof(*bounds))) == NULL) {
+		error = errno;
+		free(tmp);
+		free(tasks);
+		errno = error;
+		return -1;
+	}
+
+	/* sort one run per thread, then merge pairs of runs, a
+	 * thread for each pair, until one run is left */
+	num_runs = num_threads;
+	for (i = 0; i <= num_runs; i++) {
+		bounds[i] = v->size / num_runs * i + (v->size % num_runs) * i / num_runs;
+	}
+	for (i = 0; i < num_runs; i++) {
+		tasks[i].src = v->array;
+		tasks[i].lo = bounds[i];
+		tasks[i].hi = bounds[i + 1];
+		tasks[i].cmp = cmp;
+		tasks[i].arg = data;
+	}
+	vector_sort_run_tasks(tasks, num_runs, vector_sort_task_sort);
+
+	src = v->array;
+	dst = tmp;
+	while (num_runs > 1) {
+		for (i = 0, k = 0; i < num_runs; i += 2, k++) {
+			tasks[k].src = src;
+			tasks[k].dst = dst;
+			tasks[k].lo = bounds[i];
+			tasks[k].mid = bounds[i + 1];
+			tasks[k].hi = (i + 2 <= num_runs ? bounds[i + 2] : bounds[i + 1]);
+			bounds[k] = bounds[i];
+		}
+		bounds[k] = v->size;
+		vector_sort_run_tasks(tasks, k, vector_sort_task_merge);
+		num_runs = k;
+		t = src;
+		src = dst;
+		dst = t;
+	}
+	if (src != v->array) {
+		memcpy(v->array, src, v->size * sizeof(*src));
+	}
+
+	free(tmp);
+	free(tasks);
+	free(bounds);
+	return 0;
+}
+
 void apol_vector_sort_uniquify(apol_vector_t * v, apol_vector_comp_func * cmp, void *data)
 {
 	if (!v) {
@@ -382,7 +690,10 @@ void apol_vector_sort_uniquify(apol_vector_t * v, apol_vector_comp_func * cmp, v
 		}
 		v->size = j + 1;
 
-		apol_vector_sort(v, cmp, data);
+		/* a stable sort keeps the first of equal elements */
+		if (apol_vector_sort_stable(v, cmp, data) < 0) {
+			apol_vector_sort(v, cmp, data);
+		}
 		j = 0;
 		for (i = 1; i < v->size; i++) {
 			if (cmp(v->array[i], v->array[j], data) != 0) {
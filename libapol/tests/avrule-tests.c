@@ -114,11 +114,156 @@ static void avrule_default(void)
 	apol_avrule_query_destroy(&aq);
 }
 
+struct avrule_foreach_state
+{
+	apol_vector_t *v;
+	size_t num_seen, stop_after;
+};
+
+static int avrule_foreach_check(const apol_policy_t * p __attribute__ ((unused)), void *result, void *arg)
+{
+	struct avrule_foreach_state *s = arg;
+	CU_ASSERT(s->num_seen < apol_vector_get_size(s->v) && apol_vector_get_element(s->v, s->num_seen) == result);
+	s->num_seen++;
+	return (s->num_seen == s->stop_after ? 42 : 0);
+}
+
+static void avrule_foreach(void)
+{
+	apol_avrule_query_t *aq = apol_avrule_query_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(aq);
+
+	int retval;
+	struct avrule_foreach_state s;
+
+	retval = apol_avrule_get_by_query(bp, aq, &s.v);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	CU_ASSERT_FATAL(apol_vector_get_size(s.v) > 1);
+
+	/* every rule is passed, in the same order as the vector */
+	s.num_seen = 0;
+	s.stop_after = 0;
+	retval = apol_avrule_foreach_by_query(bp, aq, avrule_foreach_check, &s);
+	CU_ASSERT_EQUAL(retval, 0);
+	CU_ASSERT(s.num_seen == apol_vector_get_size(s.v));
+
+	/* the search stops as soon as the callback asks it to */
+	s.num_seen = 0;
+	s.stop_after = 1;
+	retval = apol_avrule_foreach_by_query(bp, aq, avrule_foreach_check, &s);
+	CU_ASSERT_EQUAL(retval, 42);
+	CU_ASSERT(s.num_seen == 1);
+
+	apol_vector_destroy(&s.v);
+	apol_avrule_query_destroy(&aq);
+}
+
+static void avrule_check_same_order(const apol_vector_t * a, const apol_vector_t * b)
+{
+	size_t i;
+
+	CU_ASSERT_FATAL(apol_vector_get_size(a) == apol_vector_get_size(b));
+	for (i = 0; i < apol_vector_get_size(a); i++) {
+		CU_ASSERT(apol_vector_get_element(a, i) == apol_vector_get_element(b, i));
+	}
+}
+
+/**
+ * Check that two vectors hold the same rules, regardless of order.
+ * Both vectors are sorted in place.
+ */
+static void avrule_check_same_set(apol_vector_t * a, apol_vector_t * b)
+{
+	size_t i;
+
+	CU_ASSERT_FATAL(apol_vector_get_size(a) == apol_vector_get_size(b));
+	apol_vector_sort(a, NULL, NULL);
+	apol_vector_sort(b, NULL, NULL);
+	CU_ASSERT(apol_vector_compare(a, b, NULL, NULL, &i) == 0);
+}
+
+static void avrule_multi_query(void)
+{
+	apol_avrule_query_t *queries[5];
+	apol_vector_t *single[5], *multi[5];
+	qpol_policy_t *q = apol_policy_get_qpol(bp);
+	const qpol_avrule_t *rule;
+	const qpol_type_t *type;
+	const char *type_name;
+	int retval;
+	size_t i;
+
+	queries[0] = apol_avrule_query_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(queries[0]);
+	retval = apol_avrule_query_set_rules(bp, queries[0], QPOL_RULE_ALLOW);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	queries[1] = apol_avrule_query_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(queries[1]);
+	retval = apol_avrule_query_set_rules(bp, queries[1], QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+
+	/* name the source type of some allow rule, once as the source
+	 * only and once as either the source or the target */
+	retval = apol_avrule_get_by_query(bp, queries[0], &single[0]);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	CU_ASSERT_FATAL(apol_vector_get_size(single[0]) > 0);
+	rule = apol_vector_get_element(single[0], 0);
+	CU_ASSERT_FATAL(qpol_avrule_get_source_type(q, rule, &type) == 0);
+	CU_ASSERT_FATAL(qpol_type_get_name(q, type, &type_name) == 0);
+	apol_vector_destroy(&single[0]);
+
+	queries[2] = apol_avrule_query_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(queries[2]);
+	retval = apol_avrule_query_set_source(bp, queries[2], type_name, 1);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	queries[3] = apol_avrule_query_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(queries[3]);
+	retval = apol_avrule_query_set_source(bp, queries[3], type_name, 1);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	retval = apol_avrule_query_set_source_any(bp, queries[3], 1);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	queries[4] = NULL;
+
+	for (i = 0; i < 5; i++) {
+		retval = apol_avrule_get_by_query(bp, queries[i], &single[i]);
+		CU_ASSERT_EQUAL_FATAL(retval, 0);
+	}
+	CU_ASSERT(apol_vector_get_size(single[4]) == apol_vector_get_size(single[0]) + apol_vector_get_size(single[1]));
+	CU_ASSERT(apol_vector_get_size(single[2]) > 0);
+	CU_ASSERT(apol_vector_get_size(single[3]) >= apol_vector_get_size(single[2]));
+
+	retval = apol_avrule_get_by_queries(bp, queries, 5, multi);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	/* the queries that name no type find their rules in the same
+	 * order as separate passes would */
+	avrule_check_same_order(multi[0], single[0]);
+	avrule_check_same_order(multi[1], single[1]);
+	avrule_check_same_order(multi[4], single[4]);
+	/* those that name a type may find them in another order */
+	avrule_check_same_set(multi[2], single[2]);
+	avrule_check_same_set(multi[3], single[3]);
+	for (i = 0; i < 5; i++) {
+		apol_vector_destroy(&multi[i]);
+		apol_vector_destroy(&single[i]);
+	}
+
+	retval = apol_avrule_get_by_queries(bp, queries, 0, multi);
+	CU_ASSERT_EQUAL(retval, 0);
+
+	for (i = 0; i < 4; i++) {
+		apol_avrule_query_destroy(&queries[i]);
+	}
+}
+
 CU_TestInfo avrule_tests[] = {
 	{"basic syntactic search", avrule_basic_syn}
 	,
 	{"default query", avrule_default}
 	,
+	{"streaming search", avrule_foreach}
+	,
+	{"multiple queries in one pass", avrule_multi_query}
+	,
 	CU_TEST_INFO_NULL
 };
 
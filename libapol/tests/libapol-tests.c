@@ -36,6 +36,7 @@
 #include "terule-tests.h"
 #include "constrain-tests.h"
 #include "user-tests.h"
+#include "vector-tests.h"
 
 int main(void)
 {
@@ -52,6 +53,7 @@ int main(void)
 		{"TE Rule Query", terule_init, terule_cleanup, terule_tests},
 		{"User Query", user_init, user_cleanup, user_tests},
 		{"Constrain query", constrain_init, constrain_cleanup, constrain_tests},
+		{"Vector", vector_init, vector_cleanup, vector_tests},
 		CU_SUITE_INFO_NULL
 	};
 
@@ -85,9 +85,120 @@ static void terule_basic_syn(void)
 	apol_terule_query_destroy(&tq);
 }
 
+static void terule_frozen_plan(void)
+{
+	apol_terule_query_t *tq = apol_terule_query_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(tq);
+
+	int retval;
+	apol_vector_t *v = NULL;
+	size_t num_all, num_first;
+
+	retval = apol_terule_get_by_query(bp, tq, &v);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	num_all = apol_vector_get_size(v);
+	apol_vector_destroy(&v);
+
+	retval = apol_policy_freeze(bp);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+
+	/* the first run against the frozen policy compiles the plan,
+	 * later runs reuse it, and changing the query discards it */
+	retval = apol_terule_get_by_query(bp, tq, &v);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	CU_ASSERT(apol_vector_get_size(v) == num_all);
+	apol_vector_destroy(&v);
+
+	retval = apol_terule_query_append_class(bp, tq, "cursor");
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	retval = apol_terule_get_by_query(bp, tq, &v);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	num_first = apol_vector_get_size(v);
+	CU_ASSERT(num_first < num_all);
+	apol_vector_destroy(&v);
+
+	retval = apol_terule_get_by_query(bp, tq, &v);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	CU_ASSERT(apol_vector_get_size(v) == num_first);
+	apol_vector_destroy(&v);
+
+	retval = apol_terule_query_append_class(bp, tq, NULL);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	retval = apol_terule_get_by_query(bp, tq, &v);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	CU_ASSERT(apol_vector_get_size(v) == num_all);
+	apol_vector_destroy(&v);
+	apol_terule_query_destroy(&tq);
+}
+
+static void terule_parallel(void)
+{
+	apol_terule_query_t *tq = apol_terule_query_create();
+	CU_ASSERT_PTR_NOT_NULL_FATAL(tq);
+
+	int retval;
+	apol_vector_t *serial = NULL, *v = NULL;
+	size_t i, num_threads[] = { 2, 3, 0 }, j;
+
+	/* searches are only threaded on a frozen policy; freezing again
+	 * is harmless if an earlier test already did */
+	retval = apol_policy_freeze(bp);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	CU_ASSERT_FATAL(apol_policy_is_frozen(bp));
+	CU_ASSERT_FATAL(qpol_policy_is_frozen(apol_policy_get_qpol(bp)));
+	retval = apol_terule_get_by_query(bp, tq, &serial);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+
+	for (j = 0; j < sizeof(num_threads) / sizeof(num_threads[0]); j++) {
+		retval = apol_terule_query_set_threads(bp, tq, num_threads[j]);
+		CU_ASSERT_EQUAL_FATAL(retval, 0);
+		retval = apol_terule_get_by_query(bp, tq, &v);
+		CU_ASSERT_EQUAL_FATAL(retval, 0);
+		CU_ASSERT_FATAL(apol_vector_get_size(v) == apol_vector_get_size(serial));
+		for (i = 0; i < apol_vector_get_size(v); i++) {
+			CU_ASSERT(apol_vector_get_element(v, i) == apol_vector_get_element(serial, i));
+		}
+		apol_vector_destroy(&v);
+	}
+
+	/* an indexed walk is split by candidate type instead */
+	CU_ASSERT_FATAL(apol_vector_get_size(serial) > 0);
+	const qpol_terule_t *rule = apol_vector_get_element(serial, 0);
+	const qpol_type_t *target;
+	const char *target_name;
+	retval = qpol_terule_get_target_type(apol_policy_get_qpol(bp), rule, &target);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	retval = qpol_type_get_name(apol_policy_get_qpol(bp), target, &target_name);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	apol_vector_destroy(&serial);
+
+	retval = apol_terule_query_set_threads(bp, tq, 1);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	retval = apol_terule_query_set_target(bp, tq, target_name, 1);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	retval = apol_terule_get_by_query(bp, tq, &serial);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	retval = apol_terule_query_set_threads(bp, tq, 4);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	retval = apol_terule_get_by_query(bp, tq, &v);
+	CU_ASSERT_EQUAL_FATAL(retval, 0);
+	CU_ASSERT_FATAL(apol_vector_get_size(serial) > 0);
+	CU_ASSERT_FATAL(apol_vector_get_size(v) == apol_vector_get_size(serial));
+	for (i = 0; i < apol_vector_get_size(v); i++) {
+		CU_ASSERT(apol_vector_get_element(v, i) == apol_vector_get_element(serial, i));
+	}
+	apol_vector_destroy(&v);
+	apol_vector_destroy(&serial);
+	apol_terule_query_destroy(&tq);
+}
+
 CU_TestInfo terule_tests[] = {
 	{"basic syntactic search", terule_basic_syn}
 	,
+	{"frozen query plan", terule_frozen_plan}
+	,
+	{"parallel search", terule_parallel}
+	,
 	CU_TEST_INFO_NULL
 };
 
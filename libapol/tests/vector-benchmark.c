@@ -0,0 +1,136 @@
+/**
+ *  @file
+ *
+ *  Time the vector sorting routines on sorted, reversed and random
+ *  input.  This is built by "make check" but not run as one of its
+ *  tests; run it by hand as ./vector-benchmark [number of elements].
+ *
+ *  Copyright (C) 2007 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <apol/vector.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define BENCHMARK_SIZE 200000
+
+typedef enum
+{
+	INPUT_SORTED, INPUT_REVERSED, INPUT_RANDOM, INPUT_FEW_DISTINCT, INPUT_NUM
+} input_kind_e;
+
+static const char *input_names[INPUT_NUM] = { "sorted", "reversed", "random", "few distinct" };
+
+typedef enum
+{
+	SORT_INTRO, SORT_STABLE, SORT_PARALLEL, SORT_NUM
+} sort_kind_e;
+
+static const char *sort_names[SORT_NUM] = { "introsort", "stable", "parallel" };
+
+static int size_comp(const void *a, const void *b, void *data __attribute__ ((unused)))
+{
+	const size_t *x = a, *y = b;
+	if (*x < *y)
+		return -1;
+	return (*x > *y);
+}
+
+static size_t input_key(input_kind_e kind, size_t i, size_t n)
+{
+	switch (kind) {
+	case INPUT_SORTED:
+		return i;
+	case INPUT_REVERSED:
+		return n - i;
+	case INPUT_RANDOM:
+		return (size_t) random();
+	default:
+		return (size_t) random() % 8;
+	}
+}
+
+static int run_sort(apol_vector_t * v, sort_kind_e sort)
+{
+	switch (sort) {
+	case SORT_INTRO:
+		apol_vector_sort(v, size_comp, NULL);
+		return 0;
+	case SORT_STABLE:
+		return apol_vector_sort_stable(v, size_comp, NULL);
+	default:
+		return apol_vector_sort_parallel(v, size_comp, NULL, 4);
+	}
+}
+
+static double elapsed(const struct timeval *start)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = BENCHMARK_SIZE, i;
+	size_t *keys;
+	int kind, sort;
+
+	if (argc > 1 && (n = strtoul(argv[1], NULL, 10)) == 0) {
+		fprintf(stderr, "usage: %s [number of elements]\n", argv[0]);
+		return 1;
+	}
+	if ((keys = malloc(n * sizeof(*keys))) == NULL) {
+		perror("malloc");
+		return 1;
+	}
+	for (kind = 0; kind < INPUT_NUM; kind++) {
+		for (sort = 0; sort < SORT_NUM; sort++) {
+			apol_vector_t *v;
+			struct timeval start;
+			if ((v = apol_vector_create_with_capacity(n, NULL)) == NULL) {
+				perror("apol_vector_create_with_capacity");
+				free(keys);
+				return 1;
+			}
+			srandom(1);
+			for (i = 0; i < n; i++) {
+				keys[i] = input_key(kind, i, n);
+				if (apol_vector_append(v, keys + i) < 0) {
+					perror("apol_vector_append");
+					apol_vector_destroy(&v);
+					free(keys);
+					return 1;
+				}
+			}
+			gettimeofday(&start, NULL);
+			if (run_sort(v, sort) < 0) {
+				perror("sort");
+				apol_vector_destroy(&v);
+				free(keys);
+				return 1;
+			}
+			printf("%-12s %-9s %zd elements: %.4fs\n", input_names[kind], sort_names[sort], n, elapsed(&start));
+			apol_vector_destroy(&v);
+		}
+	}
+	free(keys);
+	return 0;
+}
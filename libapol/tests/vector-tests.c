@@ -0,0 +1,202 @@
+/**
+ *  @file
+ *
+ *  Test the vector sorting routines on sorted, reversed and random
+ *  input.
+ *
+ *  Copyright (C) 2007 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <CUnit/CUnit.h>
+#include <apol/vector.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef enum
+{
+	INPUT_SORTED, INPUT_REVERSED, INPUT_RANDOM, INPUT_FEW_DISTINCT, INPUT_NUM
+} input_kind_e;
+
+typedef enum
+{
+	SORT_INTRO, SORT_STABLE, SORT_PARALLEL, SORT_NUM
+} sort_kind_e;
+
+/** An element whose key need not be unique, remembering where it started. */
+typedef struct keyed
+{
+	size_t key, pos;
+} keyed_t;
+
+static int keyed_comp(const void *a, const void *b, void *data __attribute__ ((unused)))
+{
+	const keyed_t *x = a, *y = b;
+	if (x->key < y->key)
+		return -1;
+	return (x->key > y->key);
+}
+
+static size_t input_key(input_kind_e kind, size_t i, size_t n)
+{
+	switch (kind) {
+	case INPUT_SORTED:
+		return i;
+	case INPUT_REVERSED:
+		return n - i;
+	case INPUT_RANDOM:
+		return (size_t) random();
+	default:
+		return (size_t) random() % 8;
+	}
+}
+
+/**
+ * Build a vector of n keyed elements, backed by elems, in the given
+ * order.
+ */
+static apol_vector_t *build_vector(keyed_t * elems, input_kind_e kind, size_t n)
+{
+	apol_vector_t *v = apol_vector_create_with_capacity(n, NULL);
+	size_t i;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(v);
+	for (i = 0; i < n; i++) {
+		elems[i].key = input_key(kind, i, n);
+		elems[i].pos = i;
+		CU_ASSERT_FATAL(apol_vector_append(v, elems + i) == 0);
+	}
+	return v;
+}
+
+static int run_sort(apol_vector_t * v, sort_kind_e sort)
+{
+	switch (sort) {
+	case SORT_INTRO:
+		apol_vector_sort(v, keyed_comp, NULL);
+		return 0;
+	case SORT_STABLE:
+		return apol_vector_sort_stable(v, keyed_comp, NULL);
+	default:
+		return apol_vector_sort_parallel(v, keyed_comp, NULL, 4);
+	}
+}
+
+/**
+ * Check that a vector of n elements is in order, holds every element
+ * exactly once and, if stable is set, keeps equal keys in their
+ * original order.
+ */
+static void check_sorted(apol_vector_t * v, size_t n, int stable)
+{
+	unsigned char *seen = calloc(n ? n : 1, 1);
+	size_t i;
+	int in_order = 1, all_seen = 1;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(seen);
+	CU_ASSERT(apol_vector_get_size(v) == n);
+	for (i = 0; i < apol_vector_get_size(v); i++) {
+		const keyed_t *k = apol_vector_get_element(v, i);
+		if (i > 0) {
+			const keyed_t *prev = apol_vector_get_element(v, i - 1);
+			if (prev->key > k->key || (stable && prev->key == k->key && prev->pos > k->pos))
+				in_order = 0;
+		}
+		if (k->pos >= n || seen[k->pos])
+			all_seen = 0;
+		else
+			seen[k->pos] = 1;
+	}
+	CU_ASSERT(in_order);
+	CU_ASSERT(all_seen);
+	free(seen);
+}
+
+static void vector_sort_inputs(void)
+{
+	static const size_t sizes[] = { 0, 1, 2, 15, 17, 1000, 40000 };
+	keyed_t *elems = malloc(40000 * sizeof(*elems));
+	size_t i;
+	int kind, sort;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(elems);
+	srandom(1);
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		for (kind = 0; kind < INPUT_NUM; kind++) {
+			for (sort = 0; sort < SORT_NUM; sort++) {
+				apol_vector_t *v = build_vector(elems, kind, sizes[i]);
+				CU_ASSERT(run_sort(v, sort) == 0);
+				check_sorted(v, sizes[i], sort == SORT_STABLE);
+				apol_vector_destroy(&v);
+			}
+		}
+	}
+	free(elems);
+}
+
+static void vector_sort_default_comp(void)
+{
+	apol_vector_t *v = apol_vector_create(NULL);
+	size_t i;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(v);
+	for (i = 0; i < 1000; i++)
+		CU_ASSERT(apol_vector_append(v, (void *)(uintptr_t) ((i * 7919) % 1000)) == 0);
+	CU_ASSERT(apol_vector_sort_parallel(v, NULL, NULL, 0) == 0);
+	for (i = 0; i < apol_vector_get_size(v); i++)
+		CU_ASSERT((uintptr_t) apol_vector_get_element(v, i) == i);
+	apol_vector_destroy(&v);
+}
+
+static void vector_uniquify(void)
+{
+	keyed_t elems[300];
+	apol_vector_t *v = build_vector(elems, INPUT_REVERSED, 300);
+	size_t i;
+
+	for (i = 0; i < 300; i++)
+		elems[i].key = (300 - i) % 10;
+	apol_vector_sort_uniquify(v, keyed_comp, NULL);
+	CU_ASSERT_FATAL(apol_vector_get_size(v) == 10);
+	for (i = 0; i < 10; i++) {
+		const keyed_t *k = apol_vector_get_element(v, i);
+		/* of equal elements, the first one appended must remain */
+		CU_ASSERT(k->key == i && k->pos == (300 - i) % 10);
+	}
+	apol_vector_destroy(&v);
+}
+
+CU_TestInfo vector_tests[] = {
+	{"sort inputs", vector_sort_inputs}
+	,
+	{"sort without comparator", vector_sort_default_comp}
+	,
+	{"sort uniquify", vector_uniquify}
+	,
+	CU_TEST_INFO_NULL
+};
+
+int vector_init()
+{
+	return 0;
+}
+
+int vector_cleanup()
+{
+	return 0;
+}
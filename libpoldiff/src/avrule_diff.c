@@ -828,6 +828,89 @@ static void sort_and_uniquify_perms(pseudo_avrule_t * key)
 	}
 }
 
+/**
+ * Build a table mapping each permission bit of each class in a policy
+ * to the permission's pseudo name, so that rules' permission masks
+ * can be converted without looking up permissions by name.
+ *
+ * @param diff Policy diff error handler.
+ * @param p Policy whose classes to map.
+ * @param num_classes Reference to the number of classes in the policy.
+ *
+ * @return A newly allocated table of 32 entries per class, indexed
+ * by (class value - 1) * 32 + bit; entries for unused bits are NULL.
+ * The caller must free() the table.  On error, return NULL and set
+ * errno.
+ */
+static char **avrule_build_perm_table(poldiff_t * diff, const apol_policy_t * p, size_t * num_classes)
+{
+	qpol_iterator_t *class_iter = NULL, *perm_iter = NULL;
+	const qpol_class_t *obj_class;
+	const qpol_common_t *common;
+	char **table = NULL, *perm_name, *pseudo_perm;
+	uint32_t class_val, perm_mask, bit;
+	qpol_policy_t *q = apol_policy_get_qpol(p);
+	int retval = -1, error = 0, pass;
+
+	if (qpol_policy_get_class_iter(q, &class_iter) < 0 || qpol_iterator_get_size(class_iter, num_classes) < 0) {
+		error = errno;
+		goto cleanup;
+	}
+	if ((table = calloc((*num_classes + 1) * 32, sizeof(*table))) == NULL) {
+		error = errno;
+		ERR(diff, "%s", strerror(error));
+		goto cleanup;
+	}
+	for (; !qpol_iterator_end(class_iter); qpol_iterator_next(class_iter)) {
+		if (qpol_iterator_get_item(class_iter, (void **)&obj_class) < 0 ||
+		    qpol_class_get_value(q, obj_class, &class_val) < 0 || qpol_class_get_common(q, obj_class, &common) < 0) {
+			error = errno;
+			goto cleanup;
+		}
+		if (class_val < 1 || class_val > *num_classes) {
+			continue;
+		}
+		/* first the class's own permissions, then its common's */
+		for (pass = 0; pass < 2; pass++) {
+			if (pass == 0 && qpol_class_get_perm_iter(q, obj_class, &perm_iter) < 0) {
+				error = errno;
+				goto cleanup;
+			}
+			if (pass == 1) {
+				if (common == NULL)
+					break;
+				if (qpol_common_get_perm_iter(q, common, &perm_iter) < 0) {
+					error = errno;
+					goto cleanup;
+				}
+			}
+			for (; !qpol_iterator_end(perm_iter); qpol_iterator_next(perm_iter)) {
+				if (qpol_iterator_get_item(perm_iter, (void **)&perm_name) < 0 ||
+				    qpol_class_get_perm_mask(q, obj_class, perm_name, &perm_mask) < 0) {
+					error = errno;
+					goto cleanup;
+				}
+				if (perm_mask == 0 || apol_bst_get_element(diff->perm_bst, perm_name, NULL, (void **)&pseudo_perm) < 0) {
+					continue;	/* reported if a rule uses it */
+				}
+				for (bit = 0; !(perm_mask & ((uint32_t) 1 << bit)); bit++) ;
+				table[(class_val - 1) * 32 + bit] = pseudo_perm;
+			}
+			qpol_iterator_destroy(&perm_iter);
+		}
+	}
+	retval = 0;
+      cleanup:
+	qpol_iterator_destroy(&class_iter);
+	qpol_iterator_destroy(&perm_iter);
+	if (retval < 0) {
+		free(table);
+		errno = error;
+		return NULL;
+	}
+	return table;
+}
+
 /**
  * Given a rule, construct a new pseudo-avrule and insert it into the
  * BST if not already there.
@@ -838,17 +921,21 @@ static void sort_and_uniquify_perms(pseudo_avrule_t * key)
  * @param source Source pseudo-type value.
  * @param target Target pseudo-type value.
  * @param b BST containing pseudo-avrules.
+ * @param perm_table Table from permission bits to pseudo names, as
+ * returned by avrule_build_perm_table().
+ * @param num_classes Number of classes in perm_table.
  *
  * @return 0 on success, < 0 on error.
  */
 static int avrule_add_to_bst(poldiff_t * diff, const apol_policy_t * p,
-			     const qpol_avrule_t * rule, uint32_t source, uint32_t target, apol_bst_t * b)
+			     const qpol_avrule_t * rule, uint32_t source, uint32_t target, apol_bst_t * b,
+			     char **perm_table, size_t num_classes)
 {
 	pseudo_avrule_t *key, *inserted_key;
 	const qpol_class_t *obj_class;
-	qpol_iterator_t *perm_iter = NULL;
 	const char *class_name;
-	char *perm_name, *pseudo_perm, **t;
+	char *pseudo_perm, **t;
+	uint32_t perm_mask, class_val, bit;
 	size_t num_perms;
 	const qpol_cond_t *cond;
 	qpol_policy_t *q = apol_policy_get_qpol(p);
@@ -860,7 +947,8 @@ static int avrule_add_to_bst(poldiff_t * diff, const apol_policy_t * p,
 	}
 	if (qpol_avrule_get_rule_type(q, rule, &(key->spec)) < 0 ||
 	    qpol_avrule_get_object_class(q, rule, &obj_class) < 0 ||
-	    qpol_avrule_get_perm_iter(q, rule, &perm_iter) < 0 || qpol_avrule_get_cond(q, rule, &cond) < 0) {
+	    qpol_avrule_get_perm_mask(q, rule, &perm_mask) < 0 || qpol_avrule_get_cond(q, rule, &cond) < 0 ||
+	    qpol_class_get_value(q, obj_class, &class_val) < 0) {
 		error = errno;
 		goto cleanup;
 	}
@@ -891,9 +979,9 @@ static int avrule_add_to_bst(poldiff_t * diff, const apol_policy_t * p,
 	key = NULL;
 
 	/* append and uniquify this rule's permissions */
-	if (qpol_iterator_get_size(perm_iter, &num_perms) < 0) {
-		error = errno;
-		goto cleanup;
+	for (num_perms = 0, bit = 0; bit < 32; bit++) {
+		if (perm_mask & ((uint32_t) 1 << bit))
+			num_perms++;
 	}
 	if ((t = realloc(inserted_key->perms, (inserted_key->num_perms + num_perms) * sizeof(*t))) == NULL) {
 		error = errno;
@@ -901,19 +989,15 @@ static int avrule_add_to_bst(poldiff_t * diff, const apol_policy_t * p,
 		goto cleanup;
 	}
 	inserted_key->perms = t;
-	for (; !qpol_iterator_end(perm_iter); qpol_iterator_next(perm_iter)) {
-		if (qpol_iterator_get_item(perm_iter, (void *)&perm_name) < 0) {
-			error = errno;
-			goto cleanup;
-		}
-		if (apol_bst_get_element(diff->perm_bst, perm_name, NULL, (void **)&pseudo_perm) < 0) {
+	for (bit = 0; bit < 32; bit++) {
+		if (!(perm_mask & ((uint32_t) 1 << bit)))
+			continue;
+		if (class_val < 1 || class_val > num_classes || (pseudo_perm = perm_table[(class_val - 1) * 32 + bit]) == NULL) {
 			error = EBADRQC;	/* should never get here */
 			ERR(diff, "%s", strerror(error));
 			assert(0);
-			free(perm_name);
 			goto cleanup;
 		}
-		free(perm_name);
 		inserted_key->perms[(inserted_key->num_perms)++] = pseudo_perm;
 	}
 	sort_and_uniquify_perms(inserted_key);
@@ -933,7 +1017,6 @@ static int avrule_add_to_bst(poldiff_t * diff, const apol_policy_t * p,
 
 	retval = 0;
       cleanup:
-	qpol_iterator_destroy(&perm_iter);
 	if (retval < 0) {
 		avrule_free_item(key);
 	}
@@ -950,10 +1033,13 @@ static int avrule_add_to_bst(poldiff_t * diff, const apol_policy_t * p,
  * @param p Policy from which the rule came.
  * @param rule AV rule to insert.
  * @param b BST containing pseudo-avrules.
+ * @param perm_table Table from permission bits to pseudo names.
+ * @param num_classes Number of classes in perm_table.
  *
  * @return 0 on success, < 0 on error.
  */
-static int avrule_expand(poldiff_t * diff, const apol_policy_t * p, const qpol_avrule_t * rule, apol_bst_t * b)
+static int avrule_expand(poldiff_t * diff, const apol_policy_t * p, const qpol_avrule_t * rule, apol_bst_t * b,
+			 char **perm_table, size_t num_classes)
 {
 	const qpol_type_t *source, *orig_target, *target;
 	unsigned char source_attr, target_attr;
@@ -1023,7 +1109,7 @@ static int avrule_expand(poldiff_t * diff, const apol_policy_t * p, const qpol_a
 #endif
 			if ((source_val = type_map_lookup(diff, source, which)) == 0 ||
 			    (target_val = type_map_lookup(diff, target, which)) == 0 ||
-			    avrule_add_to_bst(diff, p, rule, source_val, target_val, b) < 0) {
+			    avrule_add_to_bst(diff, p, rule, source_val, target_val, b, perm_table, num_classes) < 0) {
 				error = errno;
 				goto cleanup;
 			}
@@ -1055,11 +1141,13 @@ static int avrule_expand(poldiff_t * diff, const apol_policy_t * p, const qpol_a
 static apol_vector_t *avrule_get_items(poldiff_t * diff, const apol_policy_t * policy, const unsigned int which)
 {
 	apol_vector_t *bools = NULL, *bool_states = NULL;
-	size_t i, num_rules, j;
+	size_t i, num_rules, j, num_classes = 0;
+	char **perm_table = NULL;
 	apol_bst_t *b = NULL;
 	apol_vector_t *v = NULL;
 	qpol_iterator_t *iter = NULL;
-	const qpol_avrule_t *rule;
+	void *rules[POLDIFF_RULE_BATCH_SIZE];
+	size_t num_batch, k;
 	qpol_policy_t *q = apol_policy_get_qpol(policy);
 	int retval = -1, error = 0;
 
@@ -1106,21 +1194,32 @@ static apol_vector_t *avrule_get_items(poldiff_t * diff, const apol_policy_t * p
 		ERR(diff, "%s", strerror(error));
 		goto cleanup;
 	}
+	if ((perm_table = avrule_build_perm_table(diff, policy, &num_classes)) == NULL) {
+		error = errno;
+		goto cleanup;
+	}
 	if (qpol_policy_get_avrule_iter(q, which, &iter) < 0) {
 
 		error = errno;
 		goto cleanup;
 	}
 	qpol_iterator_get_size(iter, &num_rules);
-	for (j = 0; !qpol_iterator_end(iter); qpol_iterator_next(iter), j++) {
-		if (qpol_iterator_get_item(iter, (void **)&rule) < 0 || avrule_expand(diff, policy, rule, b) < 0) {
+	for (j = 0;; j += num_batch) {
+		if (qpol_iterator_get_items(iter, rules, POLDIFF_RULE_BATCH_SIZE, &num_batch) < 0) {
 			error = errno;
 			goto cleanup;
 		}
-		if (!(j % 1024)) {
-			int percent = 50 * j / num_rules + (policy == diff->mod_pol ? 50 : 0);
-			INFO(diff, "Computing AV rule difference: %02d%% complete", percent);
+		if (num_batch == 0) {
+			break;
+		}
+		for (k = 0; k < num_batch; k++) {
+			if (avrule_expand(diff, policy, rules[k], b, perm_table, num_classes) < 0) {
+				error = errno;
+				goto cleanup;
+			}
 		}
+		INFO(diff, "Computing AV rule difference: %02d%% complete",
+		     (int)(50 * j / num_rules + (policy == diff->mod_pol ? 50 : 0)));
 	}
 	if ((v = apol_bst_get_vector(b, 1)) == NULL) {
 		error = errno;
@@ -1140,6 +1239,7 @@ static apol_vector_t *avrule_get_items(poldiff_t * diff, const apol_policy_t * p
 	apol_vector_destroy(&bool_states);
 	apol_bst_destroy(&b);
 	qpol_iterator_destroy(&iter);
+	free(perm_table);
 	if (retval < 0) {
 		apol_vector_destroy(&v);
 		errno = error;
@@ -624,9 +624,9 @@ int poldiff_enable_line_numbers(poldiff_t * diff)
 		return -1;
 	}
 	if (!diff->line_numbers_enabled) {
-		if (qpol_policy_build_syn_rule_table(diff->orig_qpol))
+		if (qpol_policy_build_syn_rule_table_lazy(diff->orig_qpol))
 			return -1;
-		if (qpol_policy_build_syn_rule_table(diff->mod_qpol))
+		if (qpol_policy_build_syn_rule_table_lazy(diff->mod_qpol))
 			return -1;
 		if ((retval = avrule_enable_line_numbers(diff, AVRULE_OFFSET_ALLOW)) < 0) {
 			return retval;
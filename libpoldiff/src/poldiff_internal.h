@@ -194,6 +194,13 @@ extern "C"
  */
 	typedef int (*poldiff_reset_fn_t) (poldiff_t * diff);
 
+/**
+ * Number of rules fetched at a time with qpol_iterator_get_items()
+ * while expanding a policy's rules; progress is reported once per
+ * batch.
+ */
+#define POLDIFF_RULE_BATCH_SIZE 1024
+
 /******************** error handling code below ********************/
 
 #define POLDIFF_MSG_ERR  1
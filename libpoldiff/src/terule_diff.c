@@ -874,7 +874,8 @@ static apol_vector_t *terule_get_items(poldiff_t * diff, const apol_policy_t * p
 	apol_bst_t *b = NULL;
 	apol_vector_t *v = NULL;
 	qpol_iterator_t *iter = NULL;
-	qpol_terule_t *rule;
+	void *rules[POLDIFF_RULE_BATCH_SIZE];
+	size_t num_batch, k;
 	qpol_policy_t *q = apol_policy_get_qpol(policy);
 	int retval = -1, error = 0;
 	if (poldiff_build_bsts(diff) < 0) {
@@ -916,15 +917,22 @@ static apol_vector_t *terule_get_items(poldiff_t * diff, const apol_policy_t * p
 		goto cleanup;
 	}
 	qpol_iterator_get_size(iter, &num_rules);
-	for (j = 0; !qpol_iterator_end(iter); qpol_iterator_next(iter), j++) {
-		if (qpol_iterator_get_item(iter, (void **)&rule) < 0 || terule_expand(diff, policy, rule, b) < 0) {
+	for (j = 0;; j += num_batch) {
+		if (qpol_iterator_get_items(iter, rules, POLDIFF_RULE_BATCH_SIZE, &num_batch) < 0) {
 			error = errno;
 			goto cleanup;
 		}
-		if (!(j % 1024)) {
-			int percent = 50 * j / num_rules + (policy == diff->mod_pol ? 50 : 0);
-			INFO(diff, "Computing TE rule difference: %02d%% complete", percent);
+		if (num_batch == 0) {
+			break;
 		}
+		for (k = 0; k < num_batch; k++) {
+			if (terule_expand(diff, policy, rules[k], b) < 0) {
+				error = errno;
+				goto cleanup;
+			}
+		}
+		INFO(diff, "Computing TE rule difference: %02d%% complete",
+		     (int)(50 * j / num_rules + (policy == diff->mod_pol ? 50 : 0)));
 	}
 	if ((v = apol_bst_get_vector(b, 1)) == NULL) {
 		error = errno;
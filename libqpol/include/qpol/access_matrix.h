@@ -0,0 +1,122 @@
+/**
+ * @file
+ * Defines the public interface for the type-pair access matrix.  The
+ * matrix is an optional, precomputed summary of a policy's av rules:
+ * for every pair of (non-attribute) source and target types it lists
+ * the object classes and permissions granted, audited, or dontaudited
+ * between them, after expanding attributes.  Once built, the accesses
+ * of any pair are found in constant time, without scanning the rule
+ * tables.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QPOL_ACCESS_MATRIX_H
+#define QPOL_ACCESS_MATRIX_H
+
+#ifdef	__cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <qpol/policy.h>
+#include <qpol/avrule_query.h>
+#include <qpol/class_perm_query.h>
+#include <qpol/cond_query.h>
+#include <qpol/type_query.h>
+
+/** Memory budget used when none is given to
+ *  qpol_policy_build_access_matrix(). */
+#define QPOL_ACCESS_MATRIX_DEFAULT_BUDGET (256 * 1024 * 1024)
+
+/**
+ * One access of a source type upon a target type.  All rules of the
+ * same type, object class, and conditional (and conditional list)
+ * that apply to the pair are merged into a single entry.
+ */
+	typedef struct qpol_access_entry
+	{
+		/** object class of the access */
+		const qpol_class_t *obj_class;
+		/** one of QPOL_RULE_ALLOW, QPOL_RULE_AUDITALLOW,
+		 *  QPOL_RULE_DONTAUDIT, or QPOL_RULE_NEVERALLOW */
+		uint32_t rule_type;
+		/** permissions, as returned by qpol_avrule_get_perm_mask() */
+		uint32_t perm_mask;
+		/** conditional of the rules, or NULL if unconditional */
+		const qpol_cond_t *cond;
+		/** QPOL_COND_RULE_LIST if the rules are in the conditional's
+		 *  true list, 0 otherwise */
+		uint32_t which_list;
+	} qpol_access_entry_t;
+
+/**
+ *  Build the access matrix of a policy, replacing any matrix already
+ *  built.  The matrix reflects the rules as loaded; whether a
+ *  conditional entry is in effect depends on the current boolean
+ *  states (see qpol_cond_eval()), and is not recorded in the matrix.
+ *  The matrix is discarded whenever the policy is rebuilt.
+ *  @param policy The policy whose matrix to build.
+ *  @param budget Maximum number of bytes the build may use.  If the
+ *  policy's rules would need more than this, no matrix is built.  If
+ *  0, use QPOL_ACCESS_MATRIX_DEFAULT_BUDGET.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set (ENOMEM if the budget would be exceeded) and the
+ *  policy will have no matrix.
+ */
+	extern int qpol_policy_build_access_matrix(qpol_policy_t * policy, size_t budget);
+
+/**
+ *  Free the access matrix of a policy, if it has one and the policy
+ *  is not frozen.
+ *  @param policy The policy whose matrix to free.
+ */
+	extern void qpol_policy_drop_access_matrix(qpol_policy_t * policy);
+
+/**
+ *  Determine whether a policy's access matrix has been built.
+ *  @param policy The policy to check.
+ *  @return Returns 1 if the policy has a matrix and 0 otherwise.
+ */
+	extern int qpol_policy_has_access_matrix(const qpol_policy_t * policy);
+
+/**
+ *  Get all accesses of a source type upon a target type, whether the
+ *  rules granting them name the types or attributes of them.  Entries
+ *  are sorted by object class value, then by rule type.
+ *  @param policy The policy whose matrix to search.
+ *  @param source The source type; must not be an attribute.
+ *  @param target The target type; must not be an attribute.
+ *  @param entries Pointer in which to store a newly allocated array
+ *  of the pair's entries, or NULL if there are none.  The caller is
+ *  responsible for calling free() upon this array.
+ *  @param num_entries Pointer in which to store the number of entries
+ *  for the pair; 0 if the source has no access upon the target.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set (ENOENT if the policy has no matrix), *entries
+ *  will be NULL and *num_entries will be 0.
+ */
+	extern int qpol_policy_lookup_access(const qpol_policy_t * policy, const qpol_type_t * source, const qpol_type_t * target,
+					     qpol_access_entry_t ** entries, size_t * num_entries);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif				       /* QPOL_ACCESS_MATRIX_H */
@@ -63,6 +63,107 @@ extern "C"
  */
 	extern int qpol_policy_get_avrule_iter(const qpol_policy_t * policy, uint32_t rule_type_mask, qpol_iterator_t ** iter);
 
+/**
+ *  Get an iterator over all av rules in a policy of a rule type in
+ *  rule_type_mask, in a canonical order: by source, then target, then
+ *  object class, then rule type, with unconditional rules before
+ *  conditional ones that share the same key.  Rules from both the
+ *  unconditional and the conditional rule tables are merged into
+ *  this one order, so two sorted iterators may be walked side by
+ *  side to diff or join policies.  The order comes from an index that
+ *  is built the first time it is needed for a policy.  The same
+ *  restrictions as qpol_policy_get_avrule_iter() apply.
+ *  @param policy Policy from which to get the av rules.
+ *  @param rule_type_mask Bitwise or'ed set of QPOL_RULE_* values.
+ *  It is an error to specify any of QPOL_RULE_TYPE_* in the mask.
+ *  @param iter Iterator over items of type qpol_avrule_t returned.
+ *  The caller is responsible for calling qpol_iterator_destroy()
+ *  to free memory used by this iterator.
+ *  It is important to note that this iterator is only valid as long as
+ *  the policy is unmodifed.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	extern int qpol_policy_get_avrule_iter_sorted(const qpol_policy_t * policy, uint32_t rule_type_mask,
+						      qpol_iterator_t ** iter);
+
+/**
+ *  Get an iterator over one part of the av rules in a policy of a rule
+ *  type in rule_type_mask.  The buckets of the unconditional and
+ *  conditional rule tables are split into num_parts nearly equal
+ *  ranges; iterating over parts 0 through num_parts - 1 in turn gives
+ *  the same rules in the same order as qpol_policy_get_avrule_iter().
+ *  Once the policy is frozen, distinct threads may iterate over
+ *  distinct parts at once.  The same restrictions as
+ *  qpol_policy_get_avrule_iter() apply.
+ *  @param policy Policy from which to get the av rules.
+ *  @param rule_type_mask Bitwise or'ed set of QPOL_RULE_* values.
+ *  It is an error to specify any of QPOL_RULE_TYPE_* in the mask.
+ *  @param part Part to iterate, from 0 to num_parts - 1.
+ *  @param num_parts Number of parts into which to split the rules.
+ *  @param iter Iterator over items of type qpol_avrule_t returned.
+ *  The caller is responsible for calling qpol_iterator_destroy()
+ *  to free memory used by this iterator.
+ *  It is important to note that this iterator is only valid as long as
+ *  the policy is unmodifed.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	extern int qpol_policy_get_avrule_iter_part(const qpol_policy_t * policy, uint32_t rule_type_mask, size_t part,
+						    size_t num_parts, qpol_iterator_t ** iter);
+
+/**
+ *  Get an iterator over the av rules in a policy of a rule type in
+ *  rule_type_mask whose source is the given type or attribute.  Only
+ *  rules whose source field names this exact type are returned;
+ *  rules written against an attribute containing the type must be
+ *  requested using the attribute.  The rules are found through an
+ *  index that is built the first time any of these functions is
+ *  called for a policy, so the cost of each call is proportional to
+ *  the number of rules using the type rather than to the size of the
+ *  policy.  The same restrictions as qpol_policy_get_avrule_iter()
+ *  apply.
+ *  @param policy Policy from which to get the rules.
+ *  @param rule_type_mask Bitwise or'ed set of QPOL_RULE_* values.
+ *  It is an error to specify any of QPOL_RULE_TYPE_* in the mask.
+ *  @param source Type or attribute whose rules to get.
+ *  @param iter Iterator over items of type qpol_avrule_t returned.
+ *  The caller is responsible for calling qpol_iterator_destroy()
+ *  to free memory used by this iterator.
+ *  It is important to note that this iterator is only valid as long as
+ *  the policy is unmodifed.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	extern int qpol_policy_get_avrule_iter_by_source(const qpol_policy_t * policy, uint32_t rule_type_mask,
+							   const qpol_type_t * source, qpol_iterator_t ** iter);
+
+/**
+ *  Get an iterator over the av rules in a policy of a rule type in
+ *  rule_type_mask whose target is the given type or attribute.  Only
+ *  rules whose target field names this exact type are returned;
+ *  rules written against an attribute containing the type must be
+ *  requested using the attribute.  The rules are found through an
+ *  index that is built the first time any of these functions is
+ *  called for a policy, so the cost of each call is proportional to
+ *  the number of rules using the type rather than to the size of the
+ *  policy.  The same restrictions as qpol_policy_get_avrule_iter()
+ *  apply.
+ *  @param policy Policy from which to get the rules.
+ *  @param rule_type_mask Bitwise or'ed set of QPOL_RULE_* values.
+ *  It is an error to specify any of QPOL_RULE_TYPE_* in the mask.
+ *  @param target Type or attribute whose rules to get.
+ *  @param iter Iterator over items of type qpol_avrule_t returned.
+ *  The caller is responsible for calling qpol_iterator_destroy()
+ *  to free memory used by this iterator.
+ *  It is important to note that this iterator is only valid as long as
+ *  the policy is unmodifed.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	extern int qpol_policy_get_avrule_iter_by_target(const qpol_policy_t * policy, uint32_t rule_type_mask,
+							   const qpol_type_t * target, qpol_iterator_t ** iter);
+
 /**
  *  Get the source type from an av rule.
  *  @param policy Policy from which the rule comes.
@@ -114,6 +215,22 @@ extern "C"
  */
 	extern int qpol_avrule_get_perm_iter(const qpol_policy_t * policy, const qpol_avrule_t * rule, qpol_iterator_t ** perms);
 
+/**
+ *  Get the permissions in an av rule as a bit mask.  Bit n (counting
+ *  from 0) is set if the rule grants (or, for dontaudit rules,
+ *  silences) the permission with value n + 1 in the rule's object
+ *  class; use qpol_class_get_perm_mask() to find the bit for a
+ *  permission name.  Unlike qpol_avrule_get_perm_iter() this
+ *  allocates no memory.
+ *  @param policy Policy from which the rule comes.
+ *  @param rule The rule from which to get the permissions.
+ *  @param mask Integer in which to store the permission mask.  Only
+ *  bits for permissions that exist in the rule's class are set.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *mask will be 0.
+ */
+	extern int qpol_avrule_get_perm_mask(const qpol_policy_t * policy, const qpol_avrule_t * rule, uint32_t * mask);
+
 /**
  *  Get the rule type value for an av rule.
  *  @param policy Policy from which the rule comes.
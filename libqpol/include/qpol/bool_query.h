@@ -85,7 +85,10 @@ extern "C"
 
 /**
  *  Set the state of a boolean and update the state of all conditionals
- *  using the boolean.
+ *  using the boolean.  Only those conditionals are re-evaluated, unless
+ *  qpol_bool_set_state_no_eval() has been called since the last full
+ *  re-evaluation.  To consider other boolean states without changing
+ *  the policy, see qpol_bool_scenario_create().
  *  @param policy The policy with which the boolean is associated.
  *  The state of the policy is changed by this function.
  *  @param datum Boolean datum for which to set the state. Must be non-NULL.
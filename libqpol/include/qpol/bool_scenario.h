@@ -0,0 +1,138 @@
+/**
+ * @file
+ * Defines the public interface for boolean scenarios.  A scenario
+ * holds a hypothetical assignment of states to a policy's booleans
+ * and answers which conditionals are true, and which rules enabled,
+ * under that assignment.  Unlike qpol_bool_set_state(), scenarios
+ * never modify the policy, so any number of them may be evaluated
+ * against the same policy, even from several threads at once.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QPOL_BOOL_SCENARIO_H
+#define QPOL_BOOL_SCENARIO_H
+
+#ifdef	__cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <qpol/policy.h>
+#include <qpol/avrule_query.h>
+#include <qpol/bool_query.h>
+#include <qpol/cond_query.h>
+#include <qpol/terule_query.h>
+
+	typedef struct qpol_bool_scenario qpol_bool_scenario_t;
+
+/**
+ *  Create a scenario whose booleans start in the states they currently
+ *  have within the policy.  Create all scenarios for a policy before
+ *  sharing them among threads; later calls on a scenario only read the
+ *  policy.
+ *  @param policy The policy whose booleans to model.  The policy must
+ *  outlive the scenario.
+ *  @param scenario Pointer in which to store the newly allocated
+ *  scenario.  The caller must call qpol_bool_scenario_destroy()
+ *  afterwards.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *scenario will be NULL.
+ */
+	extern int qpol_bool_scenario_create(const qpol_policy_t * policy, qpol_bool_scenario_t ** scenario);
+
+/**
+ *  Free all memory used by a scenario and set it to NULL.  Does
+ *  nothing if the pointer is already NULL.
+ *  @param scenario Reference to the scenario to destroy.
+ */
+	extern void qpol_bool_scenario_destroy(qpol_bool_scenario_t ** scenario);
+
+/**
+ *  Return all booleans of a scenario to the states they currently have
+ *  within the policy.
+ *  @param scenario The scenario to reset.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set.
+ */
+	extern int qpol_bool_scenario_reset(qpol_bool_scenario_t * scenario);
+
+/**
+ *  Set the state of a boolean within a scenario.  Only the
+ *  conditionals using the boolean are re-evaluated.
+ *  @param scenario The scenario to modify.
+ *  @param datum Boolean whose state to set.
+ *  @param state Value to which to set the state of the boolean.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set.
+ */
+	extern int qpol_bool_scenario_set_state(qpol_bool_scenario_t * scenario, const qpol_bool_t * datum, int state);
+
+/**
+ *  Get the state of a boolean within a scenario.
+ *  @param scenario The scenario to query.
+ *  @param datum Boolean whose state to get.
+ *  @param state Pointer in which to store the state.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *state will be 0 (false).
+ */
+	extern int qpol_bool_scenario_get_state(const qpol_bool_scenario_t * scenario, const qpol_bool_t * datum, int *state);
+
+/**
+ *  Determine whether a conditional is true within a scenario.
+ *  @param scenario The scenario to query.
+ *  @param cond The conditional to evaluate.
+ *  @param is_true Pointer in which to store 1 if the conditional is
+ *  true and 0 otherwise.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *is_true will be 0.
+ */
+	extern int qpol_bool_scenario_cond_eval(const qpol_bool_scenario_t * scenario, const qpol_cond_t * cond,
+						uint32_t * is_true);
+
+/**
+ *  Determine whether an av rule is enabled within a scenario.
+ *  Unconditional rules are always enabled.
+ *  @param scenario The scenario to query.
+ *  @param rule The rule to check.
+ *  @param is_enabled Pointer in which to store 1 if the rule is
+ *  enabled and 0 otherwise.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *is_enabled will be 0.
+ */
+	extern int qpol_bool_scenario_avrule_get_is_enabled(const qpol_bool_scenario_t * scenario, const qpol_avrule_t * rule,
+							    uint32_t * is_enabled);
+
+/**
+ *  Determine whether a type rule is enabled within a scenario.
+ *  Unconditional rules are always enabled.
+ *  @param scenario The scenario to query.
+ *  @param rule The rule to check.
+ *  @param is_enabled Pointer in which to store 1 if the rule is
+ *  enabled and 0 otherwise.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *is_enabled will be 0.
+ */
+	extern int qpol_bool_scenario_terule_get_is_enabled(const qpol_bool_scenario_t * scenario, const qpol_terule_t * rule,
+							    uint32_t * is_enabled);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif				       /* QPOL_BOOL_SCENARIO_H */
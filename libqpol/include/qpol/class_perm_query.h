@@ -132,6 +132,23 @@ extern "C"
  */
 	extern int qpol_class_get_perm_iter(const qpol_policy_t * policy, const qpol_class_t * obj_class, qpol_iterator_t ** perms);
 
+/**
+ *  Get the bit that represents a permission within the access vectors
+ *  of a class, suitable for testing against the mask returned by
+ *  qpol_avrule_get_perm_mask().  The permission may be declared by
+ *  the class itself or inherited from its common.
+ *  @param policy The policy with which the class is associated.
+ *  @param obj_class The class in which to look up the permission.
+ *  @param perm Name of the permission; searching is case sensitive.
+ *  @param mask Pointer to the integer to be set to the permission's
+ *  bit.  If the class has no permission with that name then *mask
+ *  will be set to 0 and the call is still considered successful.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *mask will be 0.
+ */
+	extern int qpol_class_get_perm_mask(const qpol_policy_t * policy, const qpol_class_t * obj_class, const char *perm,
+					    uint32_t * mask);
+
 /**
  *  Get the name which identifies a class.
  *  @param policy The policy with which the class is associated.
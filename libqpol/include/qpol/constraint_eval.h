@@ -0,0 +1,192 @@
+/**
+ * @file
+ * Defines the public interface for evaluating constraints.  An engine
+ * compiles every constraint and validatetrans expression of a policy
+ * into a flat program; it then decides, for whole batches of security
+ * contexts at a time, whether an access or a transition satisfies
+ * them, and if not which statement forbids it.  Contexts must first be
+ * compiled by the engine too, which turns their names into values and
+ * their categories into bitmaps.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QPOL_CONSTRAINT_EVAL_H
+#define QPOL_CONSTRAINT_EVAL_H
+
+#ifdef	__cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <qpol/policy.h>
+#include <qpol/class_perm_query.h>
+#include <qpol/constraint_query.h>
+#include <qpol/context_query.h>
+
+	typedef struct qpol_constraint_engine qpol_constraint_engine_t;
+	typedef struct qpol_constraint_ctx qpol_constraint_ctx_t;
+
+/**
+ * An MLS level given by value, as an argument to
+ * qpol_constraint_ctx_create_from_values().
+ */
+	typedef struct qpol_constraint_level
+	{
+		/** value of the sensitivity, as from qpol_level_get_value() */
+		uint32_t sens;
+		/** values of the categories, as from qpol_cat_get_value() */
+		const uint32_t *cats;
+		/** number of elements in cats */
+		size_t num_cats;
+	} qpol_constraint_level_t;
+
+/**
+ * One access to check against the constraints.
+ */
+	typedef struct qpol_constraint_tuple
+	{
+		/** context of the subject */
+		const qpol_constraint_ctx_t *scontext;
+		/** context of the object */
+		const qpol_constraint_ctx_t *tcontext;
+		/** class of the object */
+		const qpol_class_t *obj_class;
+		/** permissions requested, as from qpol_class_get_perm_mask() */
+		uint32_t perms;
+	} qpol_constraint_tuple_t;
+
+/**
+ * One transition to check against the validatetrans statements.
+ */
+	typedef struct qpol_validatetrans_tuple
+	{
+		/** context of the object before the transition */
+		const qpol_constraint_ctx_t *oldcontext;
+		/** context of the object after the transition */
+		const qpol_constraint_ctx_t *newcontext;
+		/** context of the process performing the transition */
+		const qpol_constraint_ctx_t *taskcontext;
+		/** class of the object */
+		const qpol_class_t *obj_class;
+	} qpol_validatetrans_tuple_t;
+
+/**
+ *  Compile the constraints and validatetrans statements of a policy.
+ *  Once created, an engine is only read, so it may be shared among
+ *  threads.
+ *  @param policy The policy whose statements to compile.  The policy
+ *  must outlive the engine.
+ *  @param engine Pointer in which to store the newly allocated engine.
+ *  The caller must call qpol_constraint_engine_destroy() afterwards.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set (EILSEQ if an expression is malformed) and
+ *  *engine will be NULL.
+ */
+	extern int qpol_constraint_engine_create(const qpol_policy_t * policy, qpol_constraint_engine_t ** engine);
+
+/**
+ *  Free all memory used by an engine and set it to NULL.  Contexts
+ *  compiled by the engine must be destroyed first.
+ *  @param engine Reference pointer to the engine to destroy.
+ */
+	extern void qpol_constraint_engine_destroy(qpol_constraint_engine_t ** engine);
+
+/**
+ *  Compile a context of the policy for evaluation.
+ *  @param engine Engine that will evaluate the context.
+ *  @param context Context to compile.
+ *  @param ctx Pointer in which to store the newly allocated context.
+ *  The caller must call qpol_constraint_ctx_destroy() afterwards.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *ctx will be NULL.
+ */
+	extern int qpol_constraint_ctx_create(const qpol_constraint_engine_t * engine, const qpol_context_t * context,
+					      qpol_constraint_ctx_t ** ctx);
+
+/**
+ *  Compile a context given by the values of its components, such as
+ *  one read from an audit message.
+ *  @param engine Engine that will evaluate the context.
+ *  @param user Value of the user, as from qpol_user_get_value().
+ *  @param role Value of the role, as from qpol_role_get_value().
+ *  @param type Value of the type, as from qpol_type_get_value().
+ *  @param low Low level of the range; ignored, and may be NULL, if the
+ *  policy is not MLS.
+ *  @param high High level of the range, or NULL if the same as low.
+ *  @param ctx Pointer in which to store the newly allocated context.
+ *  The caller must call qpol_constraint_ctx_destroy() afterwards.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set (EINVAL if a value is not in the policy) and
+ *  *ctx will be NULL.
+ */
+	extern int qpol_constraint_ctx_create_from_values(const qpol_constraint_engine_t * engine, uint32_t user, uint32_t role,
+							  uint32_t type, const qpol_constraint_level_t * low,
+							  const qpol_constraint_level_t * high, qpol_constraint_ctx_t ** ctx);
+
+/**
+ *  Free all memory used by a compiled context and set it to NULL.
+ *  @param ctx Reference pointer to the context to destroy.
+ */
+	extern void qpol_constraint_ctx_destroy(qpol_constraint_ctx_t ** ctx);
+
+/**
+ *  Check a batch of accesses against the constraints of their classes.
+ *  An access is denied by every constraint that names one of its
+ *  permissions and whose expression is false for its contexts.
+ *  @param engine Engine with which to evaluate.
+ *  @param tuples Array of accesses to check.
+ *  @param num_tuples Number of elements in tuples.
+ *  @param denied Array of num_tuples elements in which to store, for
+ *  each access, the first constraint (in policy order) that denies
+ *  it, or NULL if it is allowed.  The caller should not free these
+ *  pointers, which remain valid as long as the engine.
+ *  @param denied_perms If not NULL, array of num_tuples elements in
+ *  which to store, for each access, the requested permissions that
+ *  some constraint denies.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and the contents of denied and denied_perms are
+ *  undefined.
+ */
+	extern int qpol_constraint_engine_check(const qpol_constraint_engine_t * engine, const qpol_constraint_tuple_t * tuples,
+						size_t num_tuples, const qpol_constraint_t ** denied, uint32_t * denied_perms);
+
+/**
+ *  Check a batch of transitions against the validatetrans statements
+ *  of their classes.
+ *  @param engine Engine with which to evaluate.
+ *  @param tuples Array of transitions to check.
+ *  @param num_tuples Number of elements in tuples.
+ *  @param denied Array of num_tuples elements in which to store, for
+ *  each transition, the first validatetrans statement (in policy
+ *  order) whose expression is false, or NULL if it is allowed.  The
+ *  caller should not free these pointers, which remain valid as long
+ *  as the engine.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and the contents of denied are undefined.
+ */
+	extern int qpol_constraint_engine_validatetrans(const qpol_constraint_engine_t * engine,
+							const qpol_validatetrans_tuple_t * tuples, size_t num_tuples,
+							const qpol_validatetrans_t ** denied);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif				       /* QPOL_CONSTRAINT_EVAL_H */
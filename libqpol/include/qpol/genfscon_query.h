@@ -121,6 +121,48 @@ extern "C"
 	extern int qpol_genfscon_get_context(const qpol_policy_t * policy, const qpol_genfscon_t * genfscon,
 					     const qpol_context_t ** context);
 
+/**
+ *  Get the genfscon statement that labels a file, as the kernel would
+ *  choose it: of the statements for the file system that apply to the
+ *  file's object class and whose path is a prefix of the file's path,
+ *  the one with the longest path.  The statements are found through a
+ *  path trie built the first time it is needed.
+ *  @param policy The policy from which to get the genfscon statement.
+ *  @param name The name of the file system.
+ *  @param path The path of the file relative to the filesystem mount
+ *  point.
+ *  @param obj_class The object class of the file; see QPOL_CLASS_*
+ *  defines above for values.  Statements for QPOL_CLASS_ALL always
+ *  apply, so if QPOL_CLASS_ALL is given only they are considered.
+ *  @param genfscon Pointer in which to store the genfscon statement.
+ *  The caller should call free() on this pointer.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set (ENOENT if no statement labels the file) and
+ *  *genfscon will be NULL.
+ */
+	extern int qpol_policy_lookup_genfscon(const qpol_policy_t * policy, const char *name, const char *path,
+					       uint32_t obj_class, qpol_genfscon_t ** genfscon);
+
+/**
+ *  Get the contexts with which genfscon statements label many files of
+ *  one file system, choosing statements as qpol_policy_lookup_genfscon()
+ *  does.
+ *  @param policy The policy from which to get the contexts.
+ *  @param name The name of the file system.
+ *  @param paths Array of paths of the files relative to the
+ *  filesystem mount point.
+ *  @param num_paths Number of paths in the array.
+ *  @param obj_class The object class of the files; see QPOL_CLASS_*
+ *  defines above for values.
+ *  @param contexts Array of num_paths elements in which to store the
+ *  context of each file, or NULL for a file no statement labels.  The
+ *  caller should not free the contexts.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set.
+ */
+	extern int qpol_policy_lookup_genfscon_contexts(const qpol_policy_t * policy, const char *name, const char *const *paths,
+							size_t num_paths, uint32_t obj_class, const qpol_context_t ** contexts);
+
 #ifdef	__cplusplus
 }
 #endif
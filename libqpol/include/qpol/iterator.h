@@ -88,6 +88,27 @@ extern "C"
  */
 	extern int qpol_iterator_get_size(const qpol_iterator_t * iter, size_t * size);
 
+/**
+ *  Get several items at once, starting at the current position of the
+ *  iterator, and advance the iterator past them.  This is equivalent
+ *  to calling qpol_iterator_get_item() and qpol_iterator_next() until
+ *  either max items have been fetched or the iterator reaches its end,
+ *  but is considerably cheaper for the iterators over rules, symbols,
+ *  bitmaps and contexts.  The items are the same as those returned by
+ *  qpol_iterator_get_item() and must be freed (or not) likewise.
+ *  @param iter The iterator from which to get items.
+ *  @param items Array of at least max pointers into which to store
+ *  the items.
+ *  @param max Maximum number of items to get.
+ *  @param num Pointer in which to store the number of items stored
+ *  into items.  This is less than max only if the iterator has
+ *  reached its end; it is 0 if the iterator was already at its end.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set, the iterator will have advanced past the *num
+ *  items stored, and the state of the iterator is otherwise undefined.
+ */
+	extern int qpol_iterator_get_items(qpol_iterator_t * iter, void **items, size_t max, size_t * num);
+
 #ifdef	__cplusplus
 }
 #endif
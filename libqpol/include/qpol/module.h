@@ -30,6 +30,7 @@ extern "C"
 {
 #endif
 
+#include <stddef.h>
 #include <stdint.h>
 
 	typedef struct qpol_module qpol_module_t;
@@ -51,6 +52,28 @@ extern "C"
  */
 	extern int qpol_module_create_from_file(const char *path, qpol_module_t ** module);
 
+/**
+ *  Create qpol modules from several policy package files at once,
+ *  decoding the packages on a pool of threads.  This is equivalent to
+ *  calling qpol_module_create_from_file() for each path in turn.
+ *  @param paths Array of files from which to read the modules.
+ *  @param num_paths Number of elements in paths.
+ *  @param num_threads Maximum number of threads to use, or 0 to use
+ *  one per online processor.
+ *  @param modules Array of at least num_paths elements in which to
+ *  store the newly allocated modules, in the same order as paths.
+ *  The caller is responsible for calling qpol_module_destroy() upon
+ *  each module.
+ *  @param failed If non-NULL and the call fails, the index within
+ *  paths of the first module that could not be read is stored here,
+ *  or num_paths if the failure was not due to any one module.
+ *  @return 0 on success and < 0 on failure; if the call fails, errno
+ *  will be set to the error for that module and every element of
+ *  modules will be NULL.
+ */
+	extern int qpol_module_create_from_files(const char *const *paths, size_t num_paths, size_t num_threads,
+						 qpol_module_t ** modules, size_t * failed);
+
 /**
  *  Free all memory used by a qpol module and set it to NULL.  Does
  *  nothing if the pointer is already NULL.
@@ -0,0 +1,93 @@
+/**
+ * @file
+ * Defines the public interface for checking the allow rules of a
+ * policy against its neverallow rules.  Rather than expanding every
+ * rule into all of the type pairs it covers, the check indexes the
+ * allow rules by class and source key, then walks only the keys that
+ * can match each neverallow's type sets.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QPOL_NEVERALLOW_H
+#define QPOL_NEVERALLOW_H
+
+#ifdef	__cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <qpol/policy.h>
+#include <qpol/avrule_query.h>
+#include <qpol/syn_rule_query.h>
+
+/**
+ * One allow rule that grants some of the permissions a neverallow
+ * rule forbids.
+ */
+	typedef struct qpol_neverallow_violation
+	{
+		/** the neverallow rule that is violated */
+		const qpol_syn_avrule_t *neverallow;
+		/** the allow rule, in the expanded policy, that violates it;
+		 * qpol_avrule_get_syn_avrule_iter() gives the syntactic
+		 * rules from which it came */
+		const qpol_avrule_t *allow;
+		/** permissions both granted and forbidden, as from
+		 * qpol_class_get_perm_mask() */
+		uint32_t perms;
+	} qpol_neverallow_violation_t;
+
+/**
+ *  Check every allow rule of a policy, conditional or not and whatever
+ *  the state of its conditional, against all of its neverallow rules.
+ *  The policy must have syntactic rules and have its rules loaded,
+ *  though neverallows need not have been expanded; the syntactic rules
+ *  table is built lazily if needed.
+ *  @param policy The policy to check.
+ *  @param violations Pointer in which to store a newly allocated array
+ *  of violations, grouped by neverallow rule in policy order.  The
+ *  caller must free() the array but not the rules it references.
+ *  @param num Pointer in which to store the number of violations.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set (ENOTSUP if the policy lacks the rules needed)
+ *  and *violations will be NULL.
+ */
+	extern int qpol_policy_check_neverallows(qpol_policy_t * policy, qpol_neverallow_violation_t ** violations, size_t * num);
+
+/**
+ *  Check every allow rule of a policy against one neverallow rule.
+ *  @param policy The policy to check.
+ *  @param rule The neverallow rule, from the policy's syntactic rules.
+ *  @param violations Pointer in which to store a newly allocated array
+ *  of violations.  The caller must free() the array but not the rules
+ *  it references.
+ *  @param num Pointer in which to store the number of violations.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set (EINVAL if the rule is not a neverallow) and
+ *  *violations will be NULL.
+ */
+	extern int qpol_policy_check_neverallow(qpol_policy_t * policy, const qpol_syn_avrule_t * rule,
+						qpol_neverallow_violation_t ** violations, size_t * num);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif				       /* QPOL_NEVERALLOW_H */
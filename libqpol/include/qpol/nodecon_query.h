@@ -70,6 +70,46 @@ extern "C"
  */
 	extern int qpol_policy_get_nodecon_iter(const qpol_policy_t * policy, qpol_iterator_t ** iter);
 
+/**
+ *  Get an iterator for the nodecon statements whose address and mask
+ *  cover an IP address.  The statements are found through an index
+ *  built the first time it is needed, rather than by scanning every
+ *  nodecon statement.
+ *  @param policy The policy from which to create the iterator.
+ *  @param addr The IP address to look up, if IPv4 only addr[0] is used.
+ *  @param protocol The protocol of the address;
+ *  set to QPOL_IPV4 for IPv4 and QPOL_IPV6 for IPv6.
+ *  @param iter Iterator over items of type qpol_nodecon_t returned, in
+ *  the order in which they appear in the policy.  The caller is
+ *  responsible for calling qpol_iterator_destroy to free memory used
+ *  by this iterator. The caller must also call free() on items
+ *  returned by qpol_iterator_get_item() when using this iterator.
+ *  It is important to note that this iterator is only valid as long
+ *  as the policy is unmodified.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	extern int qpol_policy_get_nodecon_iter_by_addr(const qpol_policy_t * policy, const uint32_t addr[4],
+							unsigned char protocol, qpol_iterator_t ** iter);
+
+/**
+ *  Get the nodecon statement that labels an IP address; this is the
+ *  first statement in the policy whose address and mask cover it.
+ *  (The policy compiler orders nodecon statements from most to least
+ *  specific mask, so this is also the most specific statement.)
+ *  @param policy The policy from which to get the nodecon statement.
+ *  @param addr The IP address to look up, if IPv4 only addr[0] is used.
+ *  @param protocol The protocol of the address;
+ *  set to QPOL_IPV4 for IPv4 and QPOL_IPV6 for IPv6.
+ *  @param ocon Pointer in which to store the statement returned.
+ *  The caller should call free() to free memory used by this pointer.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set (ENOENT if no statement labels the address) and
+ *  *ocon will be NULL.
+ */
+	extern int qpol_policy_lookup_nodecon(const qpol_policy_t * policy, const uint32_t addr[4], unsigned char protocol,
+					      qpol_nodecon_t ** ocon);
+
 /**
  *  Get the IP address from a nodecon statement. Sets protocol to indicate
  *  the number of integers used by the array.
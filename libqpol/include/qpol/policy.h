@@ -36,10 +36,13 @@ extern "C"
 
 	typedef struct qpol_policy qpol_policy_t;
 
+#include <qpol/access_matrix.h>
 #include <qpol/avrule_query.h>
 #include <qpol/bool_query.h>
+#include <qpol/bool_scenario.h>
 #include <qpol/class_perm_query.h>
 #include <qpol/cond_query.h>
+#include <qpol/constraint_eval.h>
 #include <qpol/constraint_query.h>
 #include <qpol/context_query.h>
 #include <qpol/fs_use_query.h>
@@ -49,6 +52,7 @@ extern "C"
 #include <qpol/mls_query.h>
 #include <qpol/mlsrule_query.h>
 #include <qpol/module.h>
+#include <qpol/neverallow.h>
 #include <qpol/netifcon_query.h>
 #include <qpol/nodecon_query.h>
 #include <qpol/permissive_query.h>
@@ -134,6 +138,12 @@ extern "C"
  *  QPOL_POLICY_KERNEL_BINARY, or QPOL_POLICY_MODULE_BINARY on success
  *  and < 0 on failure; if the call fails, errno will be set and
  *  *policy will be NULL.
+ *  @note Distinct threads may open distinct policies concurrently;
+ *  the source policy parser keeps all of its state per thread.
+ *  @note If the environment variable SETOOLS_SNAPSHOT_DIR is set,
+ *  source policies are snapshotted into that directory after being
+ *  parsed and linked, and later opens of identical source read the
+ *  snapshot instead of parsing it again.
  */
 	extern int qpol_policy_open_from_file(const char *filename, qpol_policy_t ** policy, qpol_callback_fn_t fn, void *varg,
 					      const int options);
@@ -265,6 +275,142 @@ extern "C"
  */
 	extern int qpol_policy_get_policy_handle_unknown(const qpol_policy_t * policy, unsigned int *handle_unknown);
 
+/**
+ *  Make a policy read only, so that one loaded policy may serve any
+ *  number of query threads.  Every structure that a query would
+ *  otherwise build the first time it is needed, such as the
+ *  syntactic rule table and the rule and statement indexes, is built
+ *  now; pending boolean changes are applied to the conditionals.
+ *  Afterwards, functions that would modify the policy (setting
+ *  booleans, re-evaluating conditionals, appending, enabling, or
+ *  disabling modules, rebuilding, and building or dropping the
+ *  access matrix) fail with EPERM.  A policy cannot be thawed.
+ *
+ *  Once frozen, all functions that take a const qpol_policy_t, and
+ *  the iterators they return, may be called from several threads at
+ *  once, provided that each iterator is used by only one thread at a
+ *  time and that the policy's message callback is itself thread safe.
+ *  An access matrix, if wanted, must be built before freezing.
+ *  @param policy The policy to freeze.
+ *  @return Returns 0 on success (including if already frozen) and < 0
+ *  on failure; if the call fails, errno will be set and the policy
+ *  will remain modifiable.
+ */
+	extern int qpol_policy_freeze(qpol_policy_t * policy);
+
+/**
+ *  Determine if a policy has been frozen by qpol_policy_freeze().
+ *  @param policy The policy to check.
+ *  @return Non-zero if the policy is frozen, and zero otherwise.
+ */
+	extern int qpol_policy_is_frozen(const qpol_policy_t * policy);
+
+/**
+ *  Get the fingerprint of a policy: a 64-bit hash of the libqpol
+ *  version, the images from which it was loaded (the binary policy,
+ *  the source text, or the decompressed base and enabled modules in
+ *  order), its type, and the options that change its contents.  Two
+ *  policies with the same fingerprint hold the same rules, so results
+ *  computed from one, even by another process, may be reused for the
+ *  other.  The fingerprint does not reflect the current values of
+ *  booleans.
+ *  @param policy The policy whose fingerprint to get.
+ *  @param fingerprint Pointer in which to store the fingerprint.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *fingerprint will be 0.
+ */
+	extern int qpol_policy_get_fingerprint(const qpol_policy_t * policy, uint64_t * fingerprint);
+
+/**
+ *  Phases of loading or rebuilding a policy, as reported by
+ *  qpol_policy_get_load_stats().
+ */
+	typedef enum qpol_load_phase
+	{
+		/** Reading a binary policy or base module, or parsing (or
+		 *  reading the snapshot of) a source policy. */
+		QPOL_LOAD_PHASE_PARSE,
+		/** Linking the enabled modules into the base. */
+		QPOL_LOAD_PHASE_LINK,
+		/** Removing the symbols of disabled declarations. */
+		QPOL_LOAD_PHASE_PRUNE_DISABLED_SYMBOLS,
+		/** Merging symbols declared by more than one module. */
+		QPOL_LOAD_PHASE_UNION_MULTIPLY_DECLARED_SYMBOLS,
+		/** Expanding the linked policy. */
+		QPOL_LOAD_PHASE_EXPAND,
+		/** Inferring the version of a source or modular policy. */
+		QPOL_LOAD_PHASE_INFER_POLICY_VERSION,
+		/** Building the extended policy image. */
+		QPOL_LOAD_PHASE_POLICY_EXTEND,
+		/** Building, or if lazy indexing, the syntactic rule table. */
+		QPOL_LOAD_PHASE_SYN_RULE_TABLE,
+		/** Number of phases; not itself a phase. */
+		QPOL_LOAD_PHASE_NUM
+	} qpol_load_phase_e;
+
+/**
+ *  Time and memory spent in one phase of loading a policy.
+ */
+	typedef struct qpol_load_phase_stats
+	{
+		/** number of times the phase ran; 0 if it did not apply */
+		unsigned int count;
+		/** elapsed wall clock time, in seconds */
+		double wall_time;
+		/** CPU time used by the whole process, user plus system,
+		 *  in seconds */
+		double cpu_time;
+		/** change in bytes of heap in use (or, if the C library
+		 *  cannot report that, of resident memory); negative if
+		 *  the phase released more than it allocated */
+		int64_t mem_delta;
+	} qpol_load_phase_stats_t;
+
+/**
+ *  Statistics about the most recent load or rebuild of a policy.
+ *  Memory is attributed to a phase by sampling the process before and
+ *  after it, so other threads allocating at the same time will skew
+ *  the figures.
+ */
+	typedef struct qpol_load_stats
+	{
+		/** statistics for each phase, indexed by qpol_load_phase_e */
+		qpol_load_phase_stats_t phases[QPOL_LOAD_PHASE_NUM];
+		/** memory added by the phases from parse through
+		 *  infer_policy_version, which build the policydb */
+		size_t policydb_bytes;
+		/** bytes held by the nodes and slots of the policydb's
+		 *  unconditional and conditional avtabs (a part of
+		 *  policydb_bytes) */
+		size_t avtab_bytes;
+		/** memory added by the policy_extend and syntactic rule
+		 *  table phases */
+		size_t ext_bytes;
+		/** bytes of the process currently resident */
+		size_t resident_bytes;
+		/** peak bytes of the process ever resident */
+		size_t peak_resident_bytes;
+	} qpol_load_stats_t;
+
+/**
+ *  Get timing and memory statistics for the most recent load or
+ *  rebuild of a policy.  This replaces parsing the informational
+ *  messages sent to the policy's callback.
+ *  @param policy The policy whose statistics to get.
+ *  @param stats Structure to fill in.
+ *  @return Returns 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set.
+ */
+	extern int qpol_policy_get_load_stats(const qpol_policy_t * policy, qpol_load_stats_t * stats);
+
+/**
+ *  Get the name of a load phase, such as "expand".
+ *  @param phase The phase whose name to get.
+ *  @return Name of the phase, or NULL if phase is not valid.  The
+ *  caller should not free this string.
+ */
+	extern const char *qpol_load_phase_get_name(qpol_load_phase_e phase);
+
 #ifdef	__cplusplus
 }
 #endif
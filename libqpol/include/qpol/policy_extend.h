@@ -45,6 +45,24 @@ extern "C"
  */
 	extern int qpol_policy_build_syn_rule_table(qpol_policy_t * policy);
 
+/**
+ *  Prepare the table of syntactic rules for a policy without filling
+ *  it.  Only the list of syntactic rules is built now, along with an
+ *  index by source type; the table entries for a source type are
+ *  added the first time qpol_avrule_get_syn_avrule_iter() or
+ *  qpol_terule_get_syn_terule_iter() asks about a rule with that
+ *  source.  This is much cheaper when only a few rules will be looked
+ *  up.  Because lookups then modify the table, do not look up
+ *  syntactic rules from several threads at once.  Subsequent calls
+ *  to this function or to qpol_policy_build_syn_rule_table() have no
+ *  effect.
+ *  @param policy The policy for which to build the table.
+ *  This policy will be modified by this call.
+ *  @return 0 on success and < 0 on error; if the call fails,
+ *  errno will be set.
+ */
+	extern int qpol_policy_build_syn_rule_table_lazy(qpol_policy_t * policy);
+
 /* forward declarations: see avrule_query.h and terule_query.h */
 	struct qpol_avrule;
 	struct qpol_terule;
@@ -68,6 +68,43 @@ extern "C"
  */
 	extern int qpol_policy_get_portcon_iter(const qpol_policy_t * policy, qpol_iterator_t ** iter);
 
+/**
+ *  Get an iterator for the portcon statements whose port range
+ *  contains a port.  The statements are found through an index built
+ *  the first time it is needed, rather than by scanning every portcon
+ *  statement.
+ *  @param policy The policy from which to create the iterator.
+ *  @param protocol The protocol of the port; one of IPPROTO_TCP or
+ *  IPPROTO_UDP from netinet/in.h
+ *  @param port The port to look up.
+ *  @param iter Iterator over items of type qpol_portcon_t returned, in
+ *  the order in which they appear in the policy.  The caller is
+ *  responsible for calling qpol_iterator_destroy to free memory used
+ *  by this iterator.
+ *  It is important to note that this iterator is only valid as long
+ *  as the policy is unmodified.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	extern int qpol_policy_get_portcon_iter_by_port(const qpol_policy_t * policy, uint8_t protocol, uint16_t port,
+							qpol_iterator_t ** iter);
+
+/**
+ *  Get the portcon statement that labels a port; this is the first
+ *  statement in the policy whose port range contains the port.
+ *  @param policy The policy from which to get the portcon statement.
+ *  @param protocol The protocol of the port; one of IPPROTO_TCP or
+ *  IPPROTO_UDP from netinet/in.h
+ *  @param port The port to look up.
+ *  @param ocon Pointer in which to store the statement returned.
+ *  The caller should not free this pointer.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set (ENOENT if no statement labels the port) and
+ *  *ocon will be NULL.
+ */
+	extern int qpol_policy_lookup_portcon(const qpol_policy_t * policy, uint8_t protocol, uint16_t port,
+					      const qpol_portcon_t ** ocon);
+
 /**
  *  Get the protocol from a portcon statement.
  *  @param policy The policy associated with the portcon statement.
@@ -58,6 +58,101 @@ extern "C"
  */
 	extern int qpol_policy_get_terule_iter(const qpol_policy_t * policy, uint32_t rule_type_mask, qpol_iterator_t ** iter);
 
+/**
+ *  Get an iterator over all type rules in a policy of a rule type in
+ *  rule_type_mask, in a canonical order: by source, then target, then
+ *  object class, then rule type, with unconditional rules before
+ *  conditional ones that share the same key.  This is the same order
+ *  as that of qpol_policy_get_avrule_iter_sorted(), and the same
+ *  restrictions as qpol_policy_get_terule_iter() apply.
+ *  @param policy Policy from which to get the rules.
+ *  @param rule_type_mask Bitwise or'ed set of QPOL_RULE_TYPE_* values.
+ *  It is an error to specify any other values of QPOL_RULE_* in the mask.
+ *  @param iter Iterator over items of type qpol_terule_t returned.
+ *  The caller is responsible for calling qpol_iterator_destroy()
+ *  to free memory used by this iterator.
+ *  It is important to note that this iterator is only valid as long as
+ *  the policy is unmodifed.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	extern int qpol_policy_get_terule_iter_sorted(const qpol_policy_t * policy, uint32_t rule_type_mask,
+						      qpol_iterator_t ** iter);
+
+/**
+ *  Get an iterator over one part of the type rules in a policy of a
+ *  rule type in rule_type_mask.  Iterating over parts 0 through
+ *  num_parts - 1 in turn gives the same rules in the same order as
+ *  qpol_policy_get_terule_iter(); see
+ *  qpol_policy_get_avrule_iter_part().
+ *  @param policy Policy from which to get the rules.
+ *  @param rule_type_mask Bitwise or'ed set of QPOL_RULE_TYPE_* values.
+ *  It is an error to specify any other values of QPOL_RULE_* in the mask.
+ *  @param part Part to iterate, from 0 to num_parts - 1.
+ *  @param num_parts Number of parts into which to split the rules.
+ *  @param iter Iterator over items of type qpol_terule_t returned.
+ *  The caller is responsible for calling qpol_iterator_destroy()
+ *  to free memory used by this iterator.
+ *  It is important to note that this iterator is only valid as long as
+ *  the policy is unmodifed.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	extern int qpol_policy_get_terule_iter_part(const qpol_policy_t * policy, uint32_t rule_type_mask, size_t part,
+						    size_t num_parts, qpol_iterator_t ** iter);
+
+/**
+ *  Get an iterator over the type rules in a policy of a rule type in
+ *  rule_type_mask whose source is the given type or attribute.  Only
+ *  rules whose source field names this exact type are returned;
+ *  rules written against an attribute containing the type must be
+ *  requested using the attribute.  The rules are found through an
+ *  index that is built the first time any of these functions is
+ *  called for a policy, so the cost of each call is proportional to
+ *  the number of rules using the type rather than to the size of the
+ *  policy.  The same restrictions as qpol_policy_get_terule_iter()
+ *  apply.
+ *  @param policy Policy from which to get the rules.
+ *  @param rule_type_mask Bitwise or'ed set of QPOL_RULE_TYPE_* values.
+ *  It is an error to specify any other values of QPOL_RULE_* in the mask.
+ *  @param source Type or attribute whose rules to get.
+ *  @param iter Iterator over items of type qpol_terule_t returned.
+ *  The caller is responsible for calling qpol_iterator_destroy()
+ *  to free memory used by this iterator.
+ *  It is important to note that this iterator is only valid as long as
+ *  the policy is unmodifed.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	extern int qpol_policy_get_terule_iter_by_source(const qpol_policy_t * policy, uint32_t rule_type_mask,
+							   const qpol_type_t * source, qpol_iterator_t ** iter);
+
+/**
+ *  Get an iterator over the type rules in a policy of a rule type in
+ *  rule_type_mask whose target is the given type or attribute.  Only
+ *  rules whose target field names this exact type are returned;
+ *  rules written against an attribute containing the type must be
+ *  requested using the attribute.  The rules are found through an
+ *  index that is built the first time any of these functions is
+ *  called for a policy, so the cost of each call is proportional to
+ *  the number of rules using the type rather than to the size of the
+ *  policy.  The same restrictions as qpol_policy_get_terule_iter()
+ *  apply.
+ *  @param policy Policy from which to get the rules.
+ *  @param rule_type_mask Bitwise or'ed set of QPOL_RULE_TYPE_* values.
+ *  It is an error to specify any other values of QPOL_RULE_* in the mask.
+ *  @param target Type or attribute whose rules to get.
+ *  @param iter Iterator over items of type qpol_terule_t returned.
+ *  The caller is responsible for calling qpol_iterator_destroy()
+ *  to free memory used by this iterator.
+ *  It is important to note that this iterator is only valid as long as
+ *  the policy is unmodifed.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and *iter will be NULL.
+ */
+	extern int qpol_policy_get_terule_iter_by_target(const qpol_policy_t * policy, uint32_t rule_type_mask,
+							   const qpol_type_t * target, qpol_iterator_t ** iter);
+
 /**
  *  Get the source type from a type rule.
  *  @param policy Policy from which the rule comes.
@@ -0,0 +1,502 @@
+/**
+ * @file
+ *
+ * Implementation of the type-pair access matrix.  The matrix is kept
+ * at the granularity of the avtab: the merged entries of each
+ * (source, target) key as written, attributes included, are stored
+ * in one array sorted by key, and an open addressing hash table maps
+ * each key to its slice of that array.  A lookup gathers the slices
+ * of every key that a pair of types falls under, through a list per
+ * type of itself and the attributes it belongs to, and merges them.
+ * Expanding attribute rules into every member pair instead needs
+ * memory far beyond any reasonable budget for a reference policy.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include "access_matrix_internal.h"
+#include "iterator_internal.h"
+#include "qpol_internal.h"
+#include <sepol/policydb/policydb.h>
+#include <sepol/policydb/avtab.h>
+#include <sepol/policydb/ebitmap.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ACCESS_MATRIX_RULE_TYPES (QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT | QPOL_RULE_NEVERALLOW)
+
+typedef struct access_pair
+{
+	uint32_t source;
+	uint32_t target;
+	size_t start;
+	size_t count;
+} access_pair_t;
+
+struct qpol_access_matrix
+{
+	qpol_access_entry_t *entries;
+	size_t num_entries;
+	access_pair_t *pairs;
+	size_t num_pairs;
+	/** index + 1 into pairs of the pair hashed to each bucket, or
+	 *  0 if the bucket is empty; num_buckets is a power of 2 */
+	size_t *buckets;
+	size_t num_buckets;
+	/** keys under which a type's rules are found: the keys of
+	 *  type value v are keys[key_start[v - 1]] through
+	 *  keys[key_start[v] - 1]; attributes have none */
+	size_t *key_start;
+	uint32_t *keys;
+	uint32_t num_types;
+};
+
+/** One avtab rule, before merging. */
+typedef struct access_tuple
+{
+	uint32_t source;
+	uint32_t target;
+	uint32_t class_val;
+	qpol_access_entry_t entry;
+} access_tuple_t;
+
+/** Upper bound on the bytes used per avtab rule while building. */
+#define ACCESS_MATRIX_TUPLE_COST (sizeof(access_tuple_t) + sizeof(qpol_access_entry_t) + sizeof(access_pair_t) + 4 * sizeof(size_t))
+
+static size_t access_matrix_hash(uint32_t source, uint32_t target, size_t mask)
+{
+	uint64_t key = (((uint64_t) source) << 32) | target;
+	key *= UINT64_C(0x9E3779B97F4A7C15);
+	return (size_t) (key >> 32) & mask;
+}
+
+static int access_tuple_comp(const void *a, const void *b)
+{
+	const access_tuple_t *x = a, *y = b;
+
+	if (x->source != y->source)
+		return (x->source < y->source ? -1 : 1);
+	if (x->target != y->target)
+		return (x->target < y->target ? -1 : 1);
+	if (x->class_val != y->class_val)
+		return (x->class_val < y->class_val ? -1 : 1);
+	if (x->entry.rule_type != y->entry.rule_type)
+		return (x->entry.rule_type < y->entry.rule_type ? -1 : 1);
+	if (x->entry.cond != y->entry.cond)
+		return ((uintptr_t) x->entry.cond < (uintptr_t) y->entry.cond ? -1 : 1);
+	if (x->entry.which_list != y->entry.which_list)
+		return (x->entry.which_list < y->entry.which_list ? -1 : 1);
+	return 0;
+}
+
+static int access_entry_comp(const void *a, const void *b)
+{
+	const qpol_access_entry_t *x = a, *y = b;
+	uint32_t x_class = ((const class_datum_t *)x->obj_class)->s.value;
+	uint32_t y_class = ((const class_datum_t *)y->obj_class)->s.value;
+
+	if (x_class != y_class)
+		return (x_class < y_class ? -1 : 1);
+	if (x->rule_type != y->rule_type)
+		return (x->rule_type < y->rule_type ? -1 : 1);
+	if (x->cond != y->cond)
+		return ((uintptr_t) x->cond < (uintptr_t) y->cond ? -1 : 1);
+	if (x->which_list != y->which_list)
+		return (x->which_list < y->which_list ? -1 : 1);
+	return 0;
+}
+
+/**
+ * Count the keys under which the rules of each type are found: the
+ * type itself and every attribute to which it belongs.
+ * @return The total number of keys; key_start[v] is set to the
+ * number for type value v.
+ */
+static size_t access_key_count(const policydb_t * db, size_t * key_start)
+{
+	uint32_t v, num_types = db->p_types.nprim;
+	type_datum_t *type;
+	ebitmap_node_t *node;
+	uint32_t bit;
+	size_t total = 0;
+
+	for (v = 1; v <= num_types; v++) {
+		type = db->type_val_to_struct[v - 1];
+		if (!type)
+			continue;
+		if (type->flavor != TYPE_ATTRIB) {
+			key_start[v]++;
+			total++;
+			continue;
+		}
+		ebitmap_for_each_bit(&type->types, node, bit) {
+			if (ebitmap_node_get_bit(node, bit) && bit < num_types) {
+				key_start[bit + 1]++;
+				total++;
+			}
+		}
+	}
+	return total;
+}
+
+/**
+ * Fill in the keys of every type, once key_start holds the number of
+ * keys of each.
+ */
+static void access_key_fill(const policydb_t * db, size_t * key_start, uint32_t * keys)
+{
+	uint32_t v, num_types = db->p_types.nprim;
+	type_datum_t *type;
+	ebitmap_node_t *node;
+	uint32_t bit;
+	size_t *next;
+
+	/* turn the counts into offsets, so that v's keys start at
+	 * key_start[v - 1]; that serves as the next free slot while
+	 * filling, ending at key_start[v], so shift back afterwards */
+	for (v = 1; v <= num_types; v++)
+		key_start[v] += key_start[v - 1];
+	for (v = 1; v <= num_types; v++) {
+		type = db->type_val_to_struct[v - 1];
+		if (!type)
+			continue;
+		if (type->flavor != TYPE_ATTRIB) {
+			next = &key_start[v - 1];
+			keys[(*next)++] = v;
+			continue;
+		}
+		ebitmap_for_each_bit(&type->types, node, bit) {
+			if (ebitmap_node_get_bit(node, bit) && bit < num_types) {
+				next = &key_start[bit];
+				keys[(*next)++] = v;
+			}
+		}
+	}
+	for (v = num_types; v > 0; v--)
+		key_start[v] = key_start[v - 1];
+	key_start[0] = 0;
+}
+
+static int access_key_valid(uint32_t num_types, uint32_t v)
+{
+	return (v >= 1 && v <= num_types);
+}
+
+/**
+ * Count the av rules of an avtab that the matrix holds.
+ */
+static size_t access_matrix_count(const policydb_t * db, const avtab_t * tab)
+{
+	uint32_t bucket, num_types = db->p_types.nprim;
+	avtab_ptr_t node;
+	size_t count = 0;
+
+	for (bucket = 0; tab->htable && bucket < iterator_get_avtab_size(tab); bucket++) {
+		for (node = tab->htable[bucket]; node; node = node->next) {
+			if ((node->key.specified & ACCESS_MATRIX_RULE_TYPES) &&
+			    access_key_valid(num_types, node->key.source_type) && access_key_valid(num_types, node->key.target_type))
+				count++;
+		}
+	}
+	return count;
+}
+
+/**
+ * Copy the av rules of an avtab into tuples, keyed by their source
+ * and target as written, starting at tuples[*num].
+ */
+static void access_matrix_fill(const policydb_t * db, const avtab_t * tab, access_tuple_t * tuples, size_t * num)
+{
+	uint32_t bucket, num_types = db->p_types.nprim, nperms;
+	avtab_ptr_t node;
+	access_tuple_t *tuple;
+
+	for (bucket = 0; tab->htable && bucket < iterator_get_avtab_size(tab); bucket++) {
+		for (node = tab->htable[bucket]; node; node = node->next) {
+			if (!(node->key.specified & ACCESS_MATRIX_RULE_TYPES) ||
+			    !access_key_valid(num_types, node->key.source_type) || !access_key_valid(num_types, node->key.target_type))
+				continue;
+
+			tuple = &tuples[(*num)++];
+			memset(tuple, 0, sizeof(*tuple));
+			tuple->source = node->key.source_type;
+			tuple->target = node->key.target_type;
+			tuple->class_val = node->key.target_class;
+			tuple->entry.obj_class = (const qpol_class_t *)db->class_val_to_struct[node->key.target_class - 1];
+			tuple->entry.rule_type = node->key.specified & ACCESS_MATRIX_RULE_TYPES;
+			/* same as qpol_avrule_get_perm_mask() */
+			if (node->key.specified & QPOL_RULE_DONTAUDIT)
+				tuple->entry.perm_mask = ~(node->datum.data);
+			else
+				tuple->entry.perm_mask = node->datum.data;
+			nperms = db->class_val_to_struct[node->key.target_class - 1]->permissions.nprim;
+			if (nperms < 32)
+				tuple->entry.perm_mask &= ((uint32_t) 1 << nperms) - 1;
+			tuple->entry.cond = (const qpol_cond_t *)node->parse_context;
+			if (node->parse_context)
+				tuple->entry.which_list = node->merged & QPOL_COND_RULE_LIST;
+		}
+	}
+}
+
+/**
+ * Find the entries of a key as written.
+ * @return The key's pair, or NULL if it has no entries.
+ */
+static const access_pair_t *access_matrix_find(const qpol_access_matrix_t * matrix, uint32_t source, uint32_t target)
+{
+	const access_pair_t *pair;
+	size_t h;
+
+	for (h = access_matrix_hash(source, target, matrix->num_buckets - 1); matrix->buckets[h];
+	     h = (h + 1) & (matrix->num_buckets - 1)) {
+		pair = &matrix->pairs[matrix->buckets[h] - 1];
+		if (pair->source == source && pair->target == target)
+			return pair;
+	}
+	return NULL;
+}
+
+int qpol_policy_build_access_matrix(qpol_policy_t * policy, size_t budget)
+{
+	const policydb_t *db;
+	qpol_access_matrix_t **slot, *matrix = NULL;
+	access_tuple_t *tuples = NULL;
+	size_t num_tuples = 0, num_keys, key_cost, i, j, h;
+	int error = 0;
+
+	if (!policy) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	QPOL_FAIL_IF_FROZEN(policy, STATUS_ERR);
+	if (!(slot = qpol_access_matrix_slot(policy, 1))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		errno = error;
+		return STATUS_ERR;
+	}
+	qpol_access_matrix_destroy(slot);
+
+	if (budget == 0)
+		budget = QPOL_ACCESS_MATRIX_DEFAULT_BUDGET;
+	db = &policy->p->p;
+	if (!(matrix = calloc(1, sizeof(*matrix))) ||
+	    !(matrix->key_start = calloc((size_t) db->p_types.nprim + 1, sizeof(size_t)))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		goto err;
+	}
+	matrix->num_types = db->p_types.nprim;
+	num_keys = access_key_count(db, matrix->key_start);
+
+	/* size everything from the number of rules and type keys,
+	 * refusing to build if that could exceed the budget */
+	key_cost = (matrix->num_types + 1) * sizeof(size_t) + num_keys * sizeof(uint32_t);
+	num_tuples = access_matrix_count(db, &db->te_avtab) + access_matrix_count(db, &db->te_cond_avtab);
+	if (key_cost > budget || num_tuples > (budget - key_cost) / ACCESS_MATRIX_TUPLE_COST) {
+		error = ENOMEM;
+		ERR(policy, "Access matrix exceeds memory budget of %zu bytes.", budget);
+		goto err;
+	}
+
+	INFO(policy, "%s", "Building access matrix.");
+	if (!(matrix->keys = malloc((num_keys + 1) * sizeof(uint32_t)))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		goto err;
+	}
+	access_key_fill(db, matrix->key_start, matrix->keys);
+
+	if (!(tuples = malloc((num_tuples + 1) * sizeof(access_tuple_t)))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		goto err;
+	}
+	num_tuples = 0;
+	access_matrix_fill(db, &db->te_avtab, tuples, &num_tuples);
+	access_matrix_fill(db, &db->te_cond_avtab, tuples, &num_tuples);
+	qsort(tuples, num_tuples, sizeof(access_tuple_t), access_tuple_comp);
+
+	/* merge rules that differ only in their permissions */
+	for (i = 0, j = 0; i < num_tuples; i++) {
+		if (j > 0 && !access_tuple_comp(&tuples[j - 1], &tuples[i]))
+			tuples[j - 1].entry.perm_mask |= tuples[i].entry.perm_mask;
+		else
+			tuples[j++] = tuples[i];
+	}
+	num_tuples = j;
+
+	if (!(matrix->entries = malloc((num_tuples + 1) * sizeof(qpol_access_entry_t))) ||
+	    !(matrix->pairs = malloc((num_tuples + 1) * sizeof(access_pair_t)))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		goto err;
+	}
+	for (i = 0; i < num_tuples; i++) {
+		matrix->entries[i] = tuples[i].entry;
+		if (i == 0 || tuples[i].source != tuples[i - 1].source || tuples[i].target != tuples[i - 1].target) {
+			matrix->pairs[matrix->num_pairs].source = tuples[i].source;
+			matrix->pairs[matrix->num_pairs].target = tuples[i].target;
+			matrix->pairs[matrix->num_pairs].start = i;
+			matrix->pairs[matrix->num_pairs].count = 0;
+			matrix->num_pairs++;
+		}
+		matrix->pairs[matrix->num_pairs - 1].count++;
+	}
+	matrix->num_entries = num_tuples;
+	free(tuples);
+	tuples = NULL;
+
+	/* keep the table at most half full */
+	matrix->num_buckets = 16;
+	while (matrix->num_buckets < 2 * matrix->num_pairs)
+		matrix->num_buckets <<= 1;
+	if (!(matrix->buckets = calloc(matrix->num_buckets, sizeof(size_t)))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		goto err;
+	}
+	for (i = 0; i < matrix->num_pairs; i++) {
+		h = access_matrix_hash(matrix->pairs[i].source, matrix->pairs[i].target, matrix->num_buckets - 1);
+		while (matrix->buckets[h])
+			h = (h + 1) & (matrix->num_buckets - 1);
+		matrix->buckets[h] = i + 1;
+	}
+
+	*slot = matrix;
+	return STATUS_SUCCESS;
+
+      err:
+	free(tuples);
+	qpol_access_matrix_destroy(&matrix);
+	errno = error;
+	return STATUS_ERR;
+}
+
+void qpol_access_matrix_destroy(qpol_access_matrix_t ** matrix)
+{
+	if (!matrix || !(*matrix))
+		return;
+	free((*matrix)->entries);
+	free((*matrix)->pairs);
+	free((*matrix)->buckets);
+	free((*matrix)->key_start);
+	free((*matrix)->keys);
+	free(*matrix);
+	*matrix = NULL;
+}
+
+void qpol_policy_drop_access_matrix(qpol_policy_t * policy)
+{
+	qpol_access_matrix_t **slot;
+
+	if (!policy || policy->frozen || !(slot = qpol_access_matrix_slot(policy, 0)))
+		return;
+	qpol_access_matrix_destroy(slot);
+}
+
+int qpol_policy_has_access_matrix(const qpol_policy_t * policy)
+{
+	qpol_access_matrix_t **slot;
+
+	if (!policy || !(slot = qpol_access_matrix_slot(policy, 0)))
+		return 0;
+	return (*slot != NULL);
+}
+
+int qpol_policy_lookup_access(const qpol_policy_t * policy, const qpol_type_t * source, const qpol_type_t * target,
+			      qpol_access_entry_t ** entries, size_t * num_entries)
+{
+	qpol_access_matrix_t **slot;
+	const qpol_access_matrix_t *matrix;
+	const access_pair_t *pair;
+	qpol_access_entry_t *found;
+	uint32_t sv, tv;
+	unsigned char s_attr, t_attr;
+	size_t s, t, num_found = 0, i, j;
+	int error;
+
+	if (entries)
+		*entries = NULL;
+	if (num_entries)
+		*num_entries = 0;
+	if (!policy || !source || !target || !entries || !num_entries) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (!(slot = qpol_access_matrix_slot(policy, 0)) || !(*slot)) {
+		ERR(policy, "%s", "Access matrix has not been built.");
+		errno = ENOENT;
+		return STATUS_ERR;
+	}
+	matrix = *slot;
+
+	if (qpol_type_get_value(policy, source, &sv) || qpol_type_get_value(policy, target, &tv) ||
+	    qpol_type_get_isattr(policy, source, &s_attr) || qpol_type_get_isattr(policy, target, &t_attr))
+		return STATUS_ERR;
+	if (s_attr || t_attr || !access_key_valid(matrix->num_types, sv) || !access_key_valid(matrix->num_types, tv)) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	/* count, then gather, the entries of every key covering the pair */
+	for (s = matrix->key_start[sv - 1]; s < matrix->key_start[sv]; s++) {
+		for (t = matrix->key_start[tv - 1]; t < matrix->key_start[tv]; t++) {
+			if ((pair = access_matrix_find(matrix, matrix->keys[s], matrix->keys[t])))
+				num_found += pair->count;
+		}
+	}
+	if (num_found == 0)
+		return STATUS_SUCCESS;
+	if (!(found = malloc(num_found * sizeof(*found)))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		errno = error;
+		return STATUS_ERR;
+	}
+	num_found = 0;
+	for (s = matrix->key_start[sv - 1]; s < matrix->key_start[sv]; s++) {
+		for (t = matrix->key_start[tv - 1]; t < matrix->key_start[tv]; t++) {
+			if ((pair = access_matrix_find(matrix, matrix->keys[s], matrix->keys[t]))) {
+				memcpy(found + num_found, matrix->entries + pair->start, pair->count * sizeof(*found));
+				num_found += pair->count;
+			}
+		}
+	}
+
+	/* merge entries from different keys that differ only in their
+	 * permissions */
+	qsort(found, num_found, sizeof(*found), access_entry_comp);
+	for (i = 0, j = 0; i < num_found; i++) {
+		if (j > 0 && !access_entry_comp(&found[j - 1], &found[i]))
+			found[j - 1].perm_mask |= found[i].perm_mask;
+		else
+			found[j++] = found[i];
+	}
+
+	*entries = found;
+	*num_entries = j;
+	return STATUS_SUCCESS;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file
+ *
+ * Private interface to the type-pair access matrix.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QPOL_ACCESS_MATRIX_INTERNAL_H
+#define QPOL_ACCESS_MATRIX_INTERNAL_H
+
+#ifdef	__cplusplus
+extern "C"
+{
+#endif
+
+#include <qpol/access_matrix.h>
+
+	typedef struct qpol_access_matrix qpol_access_matrix_t;
+
+/**
+ * Free all memory used by a matrix and set it to NULL.
+ * @param matrix Reference pointer to the matrix to destroy.
+ */
+	void qpol_access_matrix_destroy(qpol_access_matrix_t ** matrix);
+
+/**
+ * Get the location in which the policy's matrix is stored.  The
+ * matrix is kept with the policy's extended image and is destroyed
+ * whenever that image is.  (Implemented in policy_extend.c.)
+ * @param policy Policy whose matrix location to get.
+ * @param create If non-zero, create the extended image if the policy
+ * does not yet have one.
+ * @return Location of the matrix, or NULL if the policy has no
+ * extended image (and create was 0 or creating it failed; in the
+ * latter case errno will be set).
+ */
+	qpol_access_matrix_t **qpol_access_matrix_slot(const qpol_policy_t * policy, int create);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif				       /* QPOL_ACCESS_MATRIX_INTERNAL_H */
@@ -32,6 +32,7 @@
 #include <sepol/policydb/util.h>
 #include <stdlib.h>
 #include "qpol_internal.h"
+#include "avtab_index.h"
 
 int qpol_policy_get_avrule_iter(const qpol_policy_t * policy, uint32_t rule_type_mask, qpol_iterator_t ** iter)
 {
@@ -85,6 +86,98 @@ int qpol_policy_get_avrule_iter(const qpol_policy_t * policy, uint32_t rule_type
 	return STATUS_SUCCESS;
 }
 
+int qpol_policy_get_avrule_iter_sorted(const qpol_policy_t * policy, uint32_t rule_type_mask, qpol_iterator_t ** iter)
+{
+	if (iter) {
+		*iter = NULL;
+	}
+	if (policy == NULL || iter == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	if (!qpol_policy_has_capability(policy, QPOL_CAP_RULES_LOADED)) {
+		ERR(policy, "%s", "Cannot get avrules: Rules not loaded");
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+	if ((rule_type_mask & QPOL_RULE_NEVERALLOW) && !qpol_policy_has_capability(policy, QPOL_CAP_NEVERALLOW)) {
+		ERR(policy, "%s", "Cannot get avrules: Neverallow rules requested but not available");
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+	return qpol_avtab_index_get_sorted_iter(policy, rule_type_mask, iter);
+}
+
+int qpol_policy_get_avrule_iter_part(const qpol_policy_t * policy, uint32_t rule_type_mask, size_t part, size_t num_parts,
+				     qpol_iterator_t ** iter)
+{
+	if (iter) {
+		*iter = NULL;
+	}
+	if (policy == NULL || iter == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	if (!qpol_policy_has_capability(policy, QPOL_CAP_RULES_LOADED)) {
+		ERR(policy, "%s", "Cannot get avrules: Rules not loaded");
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+	if ((rule_type_mask & QPOL_RULE_NEVERALLOW) && !qpol_policy_has_capability(policy, QPOL_CAP_NEVERALLOW)) {
+		ERR(policy, "%s", "Cannot get avrules: Neverallow rules requested but not available");
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+	return avtab_state_create_part(policy, rule_type_mask, part, num_parts, iter);
+}
+
+/**
+ *  Check that the rules needed for an indexed av rule iterator are
+ *  available.
+ *  @return 0 if they are, < 0 (with errno set) if not.
+ */
+static int avrule_check_iter_args(const qpol_policy_t * policy, uint32_t rule_type_mask, const qpol_type_t * type,
+				  qpol_iterator_t ** iter)
+{
+	if (iter) {
+		*iter = NULL;
+	}
+	if (policy == NULL || type == NULL || iter == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	if (!qpol_policy_has_capability(policy, QPOL_CAP_RULES_LOADED)) {
+		ERR(policy, "%s", "Cannot get avrules: Rules not loaded");
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+	if ((rule_type_mask & QPOL_RULE_NEVERALLOW) && !qpol_policy_has_capability(policy, QPOL_CAP_NEVERALLOW)) {
+		ERR(policy, "%s", "Cannot get avrules: Neverallow rules requested but not available");
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+	return STATUS_SUCCESS;
+}
+
+int qpol_policy_get_avrule_iter_by_source(const qpol_policy_t * policy, uint32_t rule_type_mask, const qpol_type_t * source,
+					  qpol_iterator_t ** iter)
+{
+	if (avrule_check_iter_args(policy, rule_type_mask, source, iter))
+		return STATUS_ERR;
+	return qpol_avtab_index_get_iter(policy, rule_type_mask, source, QPOL_AVTAB_INDEX_SOURCE, iter);
+}
+
+int qpol_policy_get_avrule_iter_by_target(const qpol_policy_t * policy, uint32_t rule_type_mask, const qpol_type_t * target,
+					  qpol_iterator_t ** iter)
+{
+	if (avrule_check_iter_args(policy, rule_type_mask, target, iter))
+		return STATUS_ERR;
+	return qpol_avtab_index_get_iter(policy, rule_type_mask, target, QPOL_AVTAB_INDEX_TARGET, iter);
+}
+
 int qpol_avrule_get_source_type(const qpol_policy_t * policy, const qpol_avrule_t * rule, const qpol_type_t ** source)
 {
 	policydb_t *db = NULL;
@@ -194,6 +287,39 @@ int qpol_avrule_get_perm_iter(const qpol_policy_t * policy, const qpol_avrule_t
 	return STATUS_SUCCESS;
 }
 
+int qpol_avrule_get_perm_mask(const qpol_policy_t * policy, const qpol_avrule_t * rule, uint32_t * mask)
+{
+	policydb_t *db = NULL;
+	avtab_ptr_t avrule = NULL;
+	uint32_t nperms;
+
+	if (mask) {
+		*mask = 0;
+	}
+
+	if (!policy || !rule || !mask) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	db = &policy->p->p;
+	avrule = (avtab_ptr_t) rule;
+	if (avrule->key.specified & QPOL_RULE_DONTAUDIT) {
+		*mask = ~(avrule->datum.data);	/* stored as auditdeny flip the bits */
+	} else {
+		*mask = avrule->datum.data;
+	}
+
+	/* flipping the bits of a dontaudit sets those past the class's
+	 * last permission; clear them */
+	nperms = db->class_val_to_struct[avrule->key.target_class - 1]->permissions.nprim;
+	if (nperms < 32)
+		*mask &= ((uint32_t) 1 << nperms) - 1;
+
+	return STATUS_SUCCESS;
+}
+
 int qpol_avrule_get_rule_type(const qpol_policy_t * policy, const qpol_avrule_t * rule, uint32_t * rule_type)
 {
 	policydb_t *db = NULL;
@@ -0,0 +1,362 @@
+/**
+ * @file
+ *
+ * Implementation of the per-type index over a policy's access vector
+ * tables.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include "avtab_index.h"
+#include "iterator_internal.h"
+#include "qpol_internal.h"
+#include <sepol/policydb/policydb.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct avtab_index_state
+{
+	uint32_t rule_type_mask;
+	avtab_ptr_t *nodes;
+	size_t num_nodes;
+	size_t cur;
+} avtab_index_state_t;
+
+/** A node and its position within its source type's list. */
+typedef struct avtab_sort_entry
+{
+	avtab_ptr_t node;
+	size_t pos;
+} avtab_sort_entry_t;
+
+/**
+ * Count the nodes of an avtab for each source and target type.
+ * Counts for the type with value v are accumulated into
+ * src_start[v] and tgt_start[v].
+ */
+static void avtab_index_count(const avtab_t * tab, uint32_t num_types, size_t * src_start, size_t * tgt_start)
+{
+	uint32_t bucket;
+	avtab_ptr_t node;
+
+	for (bucket = 0; tab->htable && bucket < iterator_get_avtab_size(tab); bucket++) {
+		for (node = tab->htable[bucket]; node; node = node->next) {
+			if (node->key.source_type > 0 && node->key.source_type <= num_types)
+				src_start[node->key.source_type]++;
+			if (node->key.target_type > 0 && node->key.target_type <= num_types)
+				tgt_start[node->key.target_type]++;
+		}
+	}
+}
+
+/**
+ * Place the nodes of an avtab into their slots.  On entry src_fill[v
+ * - 1] holds the next free slot for source type v; likewise for
+ * tgt_fill.
+ */
+static void avtab_index_fill(const avtab_t * tab, qpol_avtab_index_t * index, size_t * src_fill, size_t * tgt_fill)
+{
+	uint32_t bucket;
+	avtab_ptr_t node;
+
+	for (bucket = 0; tab->htable && bucket < iterator_get_avtab_size(tab); bucket++) {
+		for (node = tab->htable[bucket]; node; node = node->next) {
+			if (node->key.source_type > 0 && node->key.source_type <= index->num_types)
+				index->src_nodes[src_fill[node->key.source_type - 1]++] = node;
+			if (node->key.target_type > 0 && node->key.target_type <= index->num_types)
+				index->tgt_nodes[tgt_fill[node->key.target_type - 1]++] = node;
+		}
+	}
+}
+
+static int avtab_sort_entry_comp(const void *a, const void *b)
+{
+	const avtab_sort_entry_t *x = a, *y = b;
+	const avtab_key_t *xk = &x->node->key, *yk = &y->node->key;
+
+	if (xk->target_type != yk->target_type)
+		return (xk->target_type < yk->target_type ? -1 : 1);
+	if (xk->target_class != yk->target_class)
+		return (xk->target_class < yk->target_class ? -1 : 1);
+	if (xk->specified != yk->specified)
+		return (xk->specified < yk->specified ? -1 : 1);
+	/* keep the source list's order, unconditional rules first */
+	return (x->pos < y->pos ? -1 : (x->pos > y->pos));
+}
+
+/**
+ * Fill the index's sorted_nodes.  The source lists already group the
+ * nodes by source, so only each list needs to be sorted.
+ * @return 0 on success, < 0 on out of memory.
+ */
+static int avtab_index_sort(qpol_avtab_index_t * index)
+{
+	avtab_sort_entry_t *entries = NULL;
+	size_t max = 0, num, i, j;
+	uint32_t v;
+
+	index->num_nodes = index->src_start[index->num_types];
+	for (v = 1; v <= index->num_types; v++) {
+		if (index->src_start[v] - index->src_start[v - 1] > max)
+			max = index->src_start[v] - index->src_start[v - 1];
+	}
+	if (!(index->sorted_nodes = malloc((index->num_nodes + 1) * sizeof(avtab_ptr_t))) ||
+	    !(entries = malloc((max + 1) * sizeof(avtab_sort_entry_t))))
+		return -1;
+
+	for (v = 1; v <= index->num_types; v++) {
+		num = index->src_start[v] - index->src_start[v - 1];
+		for (i = 0, j = index->src_start[v - 1]; i < num; i++, j++) {
+			entries[i].node = index->src_nodes[j];
+			entries[i].pos = i;
+		}
+		qsort(entries, num, sizeof(avtab_sort_entry_t), avtab_sort_entry_comp);
+		for (i = 0, j = index->src_start[v - 1]; i < num; i++, j++)
+			index->sorted_nodes[j] = entries[i].node;
+	}
+
+	free(entries);
+	return 0;
+}
+
+int qpol_avtab_index_create(const qpol_policy_t * policy, qpol_avtab_index_t ** index)
+{
+	const policydb_t *db;
+	qpol_avtab_index_t *idx = NULL;
+	size_t *src_fill = NULL, *tgt_fill = NULL;
+	uint32_t i;
+	int error = 0;
+
+	if (index)
+		*index = NULL;
+	if (!policy || !index) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	db = &policy->p->p;
+	if (!(idx = calloc(1, sizeof(*idx)))) {
+		error = errno;
+		goto err;
+	}
+	idx->num_types = db->p_types.nprim;
+	if (!(idx->src_start = calloc(idx->num_types + 1, sizeof(size_t))) ||
+	    !(idx->tgt_start = calloc(idx->num_types + 1, sizeof(size_t)))) {
+		error = errno;
+		goto err;
+	}
+
+	/* count, then turn the counts into starting offsets */
+	avtab_index_count(&db->te_avtab, idx->num_types, idx->src_start, idx->tgt_start);
+	avtab_index_count(&db->te_cond_avtab, idx->num_types, idx->src_start, idx->tgt_start);
+	for (i = 1; i <= idx->num_types; i++) {
+		idx->src_start[i] += idx->src_start[i - 1];
+		idx->tgt_start[i] += idx->tgt_start[i - 1];
+	}
+
+	/* allocate at least one slot so that an empty policy is not
+	 * mistaken for a failed allocation */
+	if (!(idx->src_nodes = malloc((idx->src_start[idx->num_types] + 1) * sizeof(avtab_ptr_t))) ||
+	    !(idx->tgt_nodes = malloc((idx->tgt_start[idx->num_types] + 1) * sizeof(avtab_ptr_t))) ||
+	    !(src_fill = malloc((idx->num_types + 1) * sizeof(size_t))) || !(tgt_fill = malloc((idx->num_types + 1) * sizeof(size_t)))) {
+		error = errno;
+		goto err;
+	}
+	memcpy(src_fill, idx->src_start, (idx->num_types + 1) * sizeof(size_t));
+	memcpy(tgt_fill, idx->tgt_start, (idx->num_types + 1) * sizeof(size_t));
+
+	avtab_index_fill(&db->te_avtab, idx, src_fill, tgt_fill);
+	avtab_index_fill(&db->te_cond_avtab, idx, src_fill, tgt_fill);
+	if (avtab_index_sort(idx)) {
+		error = errno;
+		goto err;
+	}
+
+	free(src_fill);
+	free(tgt_fill);
+	*index = idx;
+	return STATUS_SUCCESS;
+
+      err:
+	ERR(policy, "%s", strerror(error));
+	free(src_fill);
+	free(tgt_fill);
+	qpol_avtab_index_destroy(&idx);
+	errno = error;
+	return STATUS_ERR;
+}
+
+void qpol_avtab_index_destroy(qpol_avtab_index_t ** index)
+{
+	if (!index || !(*index))
+		return;
+	free((*index)->src_start);
+	free((*index)->src_nodes);
+	free((*index)->tgt_start);
+	free((*index)->tgt_nodes);
+	free((*index)->sorted_nodes);
+	free(*index);
+	*index = NULL;
+}
+
+static void *avtab_index_state_get_cur(const qpol_iterator_t * iter)
+{
+	avtab_index_state_t *state;
+
+	if (iter == NULL || (state = qpol_iterator_state(iter)) == NULL || state->cur >= state->num_nodes) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return state->nodes[state->cur];
+}
+
+static int avtab_index_state_next(qpol_iterator_t * iter)
+{
+	avtab_index_state_t *state;
+
+	if (iter == NULL || (state = qpol_iterator_state(iter)) == NULL) {
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	if (state->cur >= state->num_nodes) {
+		errno = ERANGE;
+		return STATUS_ERR;
+	}
+	do {
+		state->cur++;
+	} while (state->cur < state->num_nodes && !(state->nodes[state->cur]->key.specified & state->rule_type_mask));
+
+	return STATUS_SUCCESS;
+}
+
+static int avtab_index_state_end(const qpol_iterator_t * iter)
+{
+	avtab_index_state_t *state;
+
+	if (iter == NULL || (state = qpol_iterator_state(iter)) == NULL) {
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	return (state->cur >= state->num_nodes);
+}
+
+static size_t avtab_index_state_size(const qpol_iterator_t * iter)
+{
+	avtab_index_state_t *state;
+	size_t i, count = 0;
+
+	if (iter == NULL || (state = qpol_iterator_state(iter)) == NULL) {
+		errno = EINVAL;
+		return 0;
+	}
+	for (i = 0; i < state->num_nodes; i++) {
+		if (state->nodes[i]->key.specified & state->rule_type_mask)
+			count++;
+	}
+	return count;
+}
+
+static int avtab_index_state_get_items(qpol_iterator_t * iter, void **items, size_t max, size_t * num)
+{
+	avtab_index_state_t *state = qpol_iterator_state(iter);
+
+	for (; *num < max && state->cur < state->num_nodes; state->cur++) {
+		if (state->nodes[state->cur]->key.specified & state->rule_type_mask)
+			items[(*num)++] = state->nodes[state->cur];
+	}
+	/* leave the iterator on a matching node, as next() does */
+	while (state->cur < state->num_nodes && !(state->nodes[state->cur]->key.specified & state->rule_type_mask))
+		state->cur++;
+
+	return STATUS_SUCCESS;
+}
+
+/**
+ * Create an iterator over an array of nodes of the index.
+ */
+static int avtab_index_iter_create(const qpol_policy_t * policy, uint32_t rule_type_mask, avtab_ptr_t * nodes, size_t num_nodes,
+				   qpol_iterator_t ** iter)
+{
+	avtab_index_state_t *state = NULL;
+
+	if (!(state = calloc(1, sizeof(*state)))) {
+		ERR(policy, "%s", strerror(ENOMEM));
+		errno = ENOMEM;
+		return STATUS_ERR;
+	}
+	state->rule_type_mask = rule_type_mask;
+	state->nodes = nodes;
+	state->num_nodes = num_nodes;
+
+	if (qpol_iterator_create(policy, state, avtab_index_state_get_cur, avtab_index_state_next,
+				 avtab_index_state_end, avtab_index_state_size, free, iter)) {
+		free(state);
+		return STATUS_ERR;
+	}
+	qpol_iterator_set_get_items(*iter, avtab_index_state_get_items);
+	if (state->num_nodes > 0 && !(state->nodes[0]->key.specified & rule_type_mask))
+		avtab_index_state_next(*iter);
+
+	return STATUS_SUCCESS;
+}
+
+int qpol_avtab_index_get_iter(const qpol_policy_t * policy, uint32_t rule_type_mask, const qpol_type_t * type,
+			      int which, qpol_iterator_t ** iter)
+{
+	const qpol_avtab_index_t *index = NULL;
+	uint32_t value;
+
+	if (iter)
+		*iter = NULL;
+	if (!policy || !type || !iter || (which != QPOL_AVTAB_INDEX_SOURCE && which != QPOL_AVTAB_INDEX_TARGET)) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (qpol_type_get_value(policy, type, &value) || qpol_avtab_index_get(policy, &index))
+		return STATUS_ERR;
+
+	if (value < 1 || value > index->num_types)
+		return avtab_index_iter_create(policy, rule_type_mask, NULL, 0, iter);
+	if (which == QPOL_AVTAB_INDEX_SOURCE)
+		return avtab_index_iter_create(policy, rule_type_mask, index->src_nodes + index->src_start[value - 1],
+					       index->src_start[value] - index->src_start[value - 1], iter);
+	return avtab_index_iter_create(policy, rule_type_mask, index->tgt_nodes + index->tgt_start[value - 1],
+				       index->tgt_start[value] - index->tgt_start[value - 1], iter);
+}
+
+int qpol_avtab_index_get_sorted_iter(const qpol_policy_t * policy, uint32_t rule_type_mask, qpol_iterator_t ** iter)
+{
+	const qpol_avtab_index_t *index = NULL;
+
+	if (iter)
+		*iter = NULL;
+	if (!policy || !iter) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (qpol_avtab_index_get(policy, &index))
+		return STATUS_ERR;
+	return avtab_index_iter_create(policy, rule_type_mask, index->sorted_nodes, index->num_nodes, iter);
+}
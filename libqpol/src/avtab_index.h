@@ -0,0 +1,120 @@
+/**
+ * @file
+ *
+ * Private interface to the per-type index over a policy's access
+ * vector tables.  The index maps each type (or attribute) value to the
+ * avtab nodes that use it as a source and as a target, so that
+ * searches restricted to a handful of types need not walk every rule
+ * in the policy.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QPOL_AVTAB_INDEX_H
+#define QPOL_AVTAB_INDEX_H
+
+#ifdef	__cplusplus
+extern "C"
+{
+#endif
+
+#include <qpol/policy.h>
+#include <qpol/iterator.h>
+#include <qpol/type_query.h>
+#include <sepol/policydb/avtab.h>
+
+#define QPOL_AVTAB_INDEX_SOURCE 0
+#define QPOL_AVTAB_INDEX_TARGET 1
+
+/**
+ * Index from type value to avtab nodes.  Nodes for the type with
+ * value v as source are src_nodes[src_start[v - 1]] through
+ * src_nodes[src_start[v] - 1]; likewise for targets.  Within each
+ * list unconditional rules precede conditional ones, which is the
+ * same order in which qpol_policy_get_avrule_iter() returns them.
+ * sorted_nodes holds all num_nodes nodes in key order: by source,
+ * target, class and then rule type, with unconditional rules before
+ * conditional ones for the same key.
+ */
+	typedef struct qpol_avtab_index
+	{
+		uint32_t num_types;
+		size_t *src_start;
+		avtab_ptr_t *src_nodes;
+		size_t *tgt_start;
+		avtab_ptr_t *tgt_nodes;
+		avtab_ptr_t *sorted_nodes;
+		size_t num_nodes;
+	} qpol_avtab_index_t;
+
+/**
+ * Build the index over a policy's te_avtab and te_cond_avtab.
+ * @param policy Policy whose rules to index.
+ * @param index Reference pointer to the created index.
+ * @return 0 on success and < 0 on failure; if the call fails,
+ * errno will be set and *index will be NULL.
+ */
+	int qpol_avtab_index_create(const qpol_policy_t * policy, qpol_avtab_index_t ** index);
+
+/**
+ * Free all memory used by an index and set it to NULL.
+ * @param index Reference pointer to the index to destroy.
+ */
+	void qpol_avtab_index_destroy(qpol_avtab_index_t ** index);
+
+/**
+ * Get the policy's index, building it the first time it is needed.
+ * The index is stored with the policy's extended image and is
+ * discarded whenever that image is.  (Implemented in policy_extend.c.)
+ * @param policy Policy whose index to get.
+ * @param index Pointer in which to store the index.  The caller
+ * should not free this pointer.
+ * @return 0 on success and < 0 on failure; if the call fails,
+ * errno will be set and *index will be NULL.
+ */
+	int qpol_avtab_index_get(const qpol_policy_t * policy, const qpol_avtab_index_t ** index);
+
+/**
+ * Get an iterator over the avtab nodes of a rule type in
+ * rule_type_mask that use a given type as their source or target.
+ * @param policy Policy from which to get the rules.
+ * @param rule_type_mask Bitwise or'ed set of rule types to return.
+ * @param type Type or attribute by which to select the rules.
+ * @param which One of QPOL_AVTAB_INDEX_SOURCE or QPOL_AVTAB_INDEX_TARGET.
+ * @param iter Iterator over items of type avtab_ptr_t returned.
+ * @return 0 on success and < 0 on failure; if the call fails,
+ * errno will be set and *iter will be NULL.
+ */
+	int qpol_avtab_index_get_iter(const qpol_policy_t * policy, uint32_t rule_type_mask, const qpol_type_t * type,
+				      int which, qpol_iterator_t ** iter);
+
+/**
+ * Get an iterator over the avtab nodes of a rule type in
+ * rule_type_mask, in the key order of the index's sorted_nodes.
+ * @param policy Policy from which to get the rules.
+ * @param rule_type_mask Bitwise or'ed set of rule types to return.
+ * @param iter Iterator over items of type avtab_ptr_t returned.
+ * @return 0 on success and < 0 on failure; if the call fails,
+ * errno will be set and *iter will be NULL.
+ */
+	int qpol_avtab_index_get_sorted_iter(const qpol_policy_t * policy, uint32_t rule_type_mask, qpol_iterator_t ** iter);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif				       /* QPOL_AVTAB_INDEX_H */
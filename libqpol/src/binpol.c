@@ -0,0 +1,76 @@
+/**
+ * @file
+ *
+ * Probes of the header of a binary policy held in memory.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include "qpol_internal.h"
+#include <byteswap.h>
+#include <endian.h>
+#include <string.h>
+#include <asm/types.h>
+
+#include <sepol/policydb/policydb.h>
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+#define le32_to_cpu(x) (x)
+#else
+#define le32_to_cpu(x) bswap_32(x)
+#endif
+
+int qpol_binpol_version(const char *data, size_t size)
+{
+	__u32 buf[2];
+	size_t len;
+
+	if (data == NULL)
+		return -1;
+
+	/* magic #, sz of policy string and, after the string, the version */
+	if (size < sizeof(__u32) * 3)
+		return -3;
+	memcpy(buf, data, sizeof(__u32) * 2);
+	if (le32_to_cpu(buf[0]) != SELINUX_MAGIC)
+		return -2;
+
+	/* skip over the policy string, then read the version */
+	len = le32_to_cpu(buf[1]);
+	if (len > size - sizeof(__u32) * 3)
+		return -3;
+	memcpy(buf, data + sizeof(__u32) * 2 + len, sizeof(__u32));
+
+	return le32_to_cpu(buf[0]);
+}
+
+int qpol_is_data_binpol(const char *data, size_t size)
+{
+	__u32 ubuf;
+
+	if (data == NULL || size < sizeof(__u32))
+		return 0;
+
+	memcpy(&ubuf, data, sizeof(__u32));
+	ubuf = le32_to_cpu(ubuf);
+	if (ubuf == SELINUX_MAGIC)
+		return 1;
+
+	return 0;
+}
@@ -33,11 +33,12 @@
 #include "iterator_internal.h"
 #include <qpol/bool_query.h>
 #include "qpol_internal.h"
+#include "symbol_index.h"
+#include "cond_index.h"
 
 int qpol_policy_get_bool_by_name(const qpol_policy_t * policy, const char *name, qpol_bool_t ** datum)
 {
 	hashtab_datum_t internal_datum;
-	policydb_t *db;
 
 	if (policy == NULL || name == NULL || datum == NULL) {
 		if (datum != NULL)
@@ -47,8 +48,7 @@ int qpol_policy_get_bool_by_name(const qpol_policy_t * policy, const char *name,
 		return STATUS_ERR;
 	}
 
-	db = &policy->p->p;
-	internal_datum = hashtab_search(db->p_bools.table, (const hashtab_key_t)name);
+	internal_datum = qpol_symbol_find(policy, SYM_BOOLS, name);
 	if (internal_datum == NULL) {
 		ERR(policy, "could not find datum for bool %s", name);
 		*datum = NULL;
@@ -137,6 +137,7 @@ int qpol_bool_get_state(const qpol_policy_t * policy, const qpol_bool_t * datum,
 int qpol_bool_set_state(qpol_policy_t * policy, qpol_bool_t * datum, int state)
 {
 	cond_bool_datum_t *internal_datum;
+	int old_state;
 
 	if (policy == NULL || datum == NULL) {
 		ERR(policy, "%s", strerror(EINVAL));
@@ -144,12 +145,23 @@ int qpol_bool_set_state(qpol_policy_t * policy, qpol_bool_t * datum, int state)
 		return STATUS_ERR;
 	}
 
+	QPOL_FAIL_IF_FROZEN(policy, STATUS_ERR);
+
 	internal_datum = (cond_bool_datum_t *) datum;
+	old_state = internal_datum->state;
 	internal_datum->state = state;
 
-	/* re-evaluate conditionals to update the state of their rules */
-	if (qpol_policy_reevaluate_conds(policy)) {
-		return STATUS_ERR;     /* errno already set */
+	/* re-evaluate conditionals to update the state of their rules;
+	 * unless some other boolean was changed without doing so, only
+	 * the conditionals using this boolean need be considered */
+	if (policy->conds_outdated) {
+		if (qpol_policy_reevaluate_conds(policy)) {
+			return STATUS_ERR;     /* errno already set */
+		}
+	} else if (old_state != state) {
+		if (qpol_cond_index_reevaluate_bool(policy, internal_datum->s.value)) {
+			return STATUS_ERR;     /* errno already set */
+		}
 	}
 
 	return STATUS_SUCCESS;
@@ -165,7 +177,11 @@ int qpol_bool_set_state_no_eval(qpol_policy_t * policy, qpol_bool_t * datum, int
 		return STATUS_ERR;
 	}
 
+	QPOL_FAIL_IF_FROZEN(policy, STATUS_ERR);
+
 	internal_datum = (cond_bool_datum_t *) datum;
+	if (internal_datum->state != state)
+		policy->conds_outdated = 1;
 	internal_datum->state = state;
 
 	return STATUS_SUCCESS;
@@ -0,0 +1,258 @@
+/**
+ * @file
+ *
+ * Implementation of boolean scenarios, which evaluate conditionals
+ * under a hypothetical assignment of boolean states without modifying
+ * the policy.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <qpol/bool_scenario.h>
+#include "cond_index.h"
+#include "qpol_internal.h"
+#include <sepol/policydb/policydb.h>
+#include <sepol/policydb/avtab.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct qpol_bool_scenario
+{
+	const qpol_policy_t *policy;
+	const qpol_cond_index_t *index;
+	/** state of each boolean, indexed by value - 1 */
+	int *bool_states;
+	/** state of each conditional, in the order of index->conds */
+	unsigned char *cond_states;
+};
+
+/**
+ * Evaluate the conditional at position pos within the index and
+ * record its state.
+ */
+static int bool_scenario_eval_cond(qpol_bool_scenario_t * scenario, size_t pos)
+{
+	int state = qpol_cond_index_eval(scenario->index->conds[pos]->expr, scenario->bool_states, scenario->index->num_bools);
+	if (state < 0) {
+		ERR(scenario->policy, "Error evaluating conditional: %s", strerror(EILSEQ));
+		errno = EILSEQ;
+		return STATUS_ERR;
+	}
+	scenario->cond_states[pos] = (state ? 1 : 0);
+	return STATUS_SUCCESS;
+}
+
+int qpol_bool_scenario_create(const qpol_policy_t * policy, qpol_bool_scenario_t ** scenario)
+{
+	qpol_bool_scenario_t *s = NULL;
+	int error = 0;
+
+	if (scenario)
+		*scenario = NULL;
+	if (!policy || !scenario) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (!(s = calloc(1, sizeof(*s)))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		errno = error;
+		return STATUS_ERR;
+	}
+	s->policy = policy;
+	if (qpol_cond_index_get(policy, &s->index)) {
+		error = errno;
+		goto err;
+	}
+	if (!(s->bool_states = calloc(s->index->num_bools + 1, sizeof(int))) ||
+	    !(s->cond_states = calloc(s->index->num_conds + 1, sizeof(unsigned char)))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		goto err;
+	}
+	if (qpol_bool_scenario_reset(s)) {
+		error = errno;
+		goto err;
+	}
+
+	*scenario = s;
+	return STATUS_SUCCESS;
+
+      err:
+	qpol_bool_scenario_destroy(&s);
+	errno = error;
+	return STATUS_ERR;
+}
+
+void qpol_bool_scenario_destroy(qpol_bool_scenario_t ** scenario)
+{
+	if (!scenario || !(*scenario))
+		return;
+	free((*scenario)->bool_states);
+	free((*scenario)->cond_states);
+	free(*scenario);
+	*scenario = NULL;
+}
+
+int qpol_bool_scenario_reset(qpol_bool_scenario_t * scenario)
+{
+	const policydb_t *db;
+	uint32_t i;
+	size_t j;
+
+	if (!scenario) {
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	db = &scenario->policy->p->p;
+	for (i = 0; i < scenario->index->num_bools; i++)
+		scenario->bool_states[i] = (db->bool_val_to_struct[i]->state ? 1 : 0);
+	for (j = 0; j < scenario->index->num_conds; j++) {
+		if (bool_scenario_eval_cond(scenario, j))
+			return STATUS_ERR;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+int qpol_bool_scenario_set_state(qpol_bool_scenario_t * scenario, const qpol_bool_t * datum, int state)
+{
+	const cond_bool_datum_t *internal_datum;
+	const qpol_cond_index_t *index;
+	uint32_t value;
+	size_t i;
+
+	if (!scenario || !datum) {
+		ERR(scenario ? scenario->policy : NULL, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	index = scenario->index;
+	internal_datum = (const cond_bool_datum_t *)datum;
+	value = internal_datum->s.value;
+	if (value < 1 || value > index->num_bools) {
+		ERR(scenario->policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	state = (state ? 1 : 0);
+	if (scenario->bool_states[value - 1] == state)
+		return STATUS_SUCCESS;
+	scenario->bool_states[value - 1] = state;
+
+	for (i = index->bool_start[value - 1]; i < index->bool_start[value]; i++) {
+		if (bool_scenario_eval_cond(scenario, index->bool_conds[i]))
+			return STATUS_ERR;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+int qpol_bool_scenario_get_state(const qpol_bool_scenario_t * scenario, const qpol_bool_t * datum, int *state)
+{
+	const cond_bool_datum_t *internal_datum;
+
+	if (state)
+		*state = 0;
+	if (!scenario || !datum || !state) {
+		ERR(scenario ? scenario->policy : NULL, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	internal_datum = (const cond_bool_datum_t *)datum;
+	if (internal_datum->s.value < 1 || internal_datum->s.value > scenario->index->num_bools) {
+		ERR(scenario->policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	*state = scenario->bool_states[internal_datum->s.value - 1];
+
+	return STATUS_SUCCESS;
+}
+
+int qpol_bool_scenario_cond_eval(const qpol_bool_scenario_t * scenario, const qpol_cond_t * cond, uint32_t * is_true)
+{
+	size_t pos;
+
+	if (is_true)
+		*is_true = 0;
+	if (!scenario || !cond || !is_true) {
+		ERR(scenario ? scenario->policy : NULL, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	pos = qpol_cond_index_find(scenario->index, (const cond_node_t *)cond);
+	if (pos >= scenario->index->num_conds) {
+		ERR(scenario->policy, "%s", strerror(ENOENT));
+		errno = ENOENT;
+		return STATUS_ERR;
+	}
+	*is_true = scenario->cond_states[pos];
+
+	return STATUS_SUCCESS;
+}
+
+/**
+ * Determine whether an avtab node is enabled within a scenario.  A
+ * conditional rule is enabled if it is in its conditional's true list
+ * and the conditional is true, or in the false list and the
+ * conditional is false.
+ */
+static int bool_scenario_rule_get_is_enabled(const qpol_bool_scenario_t * scenario, avtab_ptr_t rule, uint32_t * is_enabled)
+{
+	uint32_t is_true;
+
+	if (is_enabled)
+		*is_enabled = 0;
+	if (!scenario || !rule || !is_enabled) {
+		ERR(scenario ? scenario->policy : NULL, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (!rule->parse_context) {
+		*is_enabled = 1;
+		return STATUS_SUCCESS;
+	}
+	if (qpol_bool_scenario_cond_eval(scenario, (const qpol_cond_t *)rule->parse_context, &is_true))
+		return STATUS_ERR;
+	*is_enabled = (is_true == ((rule->merged & QPOL_COND_RULE_LIST) ? 1 : 0));
+
+	return STATUS_SUCCESS;
+}
+
+int qpol_bool_scenario_avrule_get_is_enabled(const qpol_bool_scenario_t * scenario, const qpol_avrule_t * rule,
+					     uint32_t * is_enabled)
+{
+	return bool_scenario_rule_get_is_enabled(scenario, (avtab_ptr_t) rule, is_enabled);
+}
+
+int qpol_bool_scenario_terule_get_is_enabled(const qpol_bool_scenario_t * scenario, const qpol_terule_t * rule,
+					     uint32_t * is_enabled)
+{
+	return bool_scenario_rule_get_is_enabled(scenario, (avtab_ptr_t) rule, is_enabled);
+}
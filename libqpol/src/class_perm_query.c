@@ -35,6 +35,7 @@
 #include "iterator_internal.h"
 #include <qpol/class_perm_query.h>
 #include "qpol_internal.h"
+#include "symbol_index.h"
 
 /* perms */
 typedef struct perm_hash_state
@@ -345,7 +346,6 @@ int qpol_perm_get_common_iter(const qpol_policy_t * policy, const char *perm, qp
 int qpol_policy_get_class_by_name(const qpol_policy_t * policy, const char *name, const qpol_class_t ** obj_class)
 {
 	hashtab_datum_t internal_datum;
-	policydb_t *db;
 
 	if (policy == NULL || name == NULL || obj_class == NULL) {
 		if (obj_class != NULL)
@@ -355,8 +355,7 @@ int qpol_policy_get_class_by_name(const qpol_policy_t * policy, const char *name
 		return STATUS_ERR;
 	}
 
-	db = &policy->p->p;
-	internal_datum = hashtab_search(db->p_classes.table, (const hashtab_key_t)name);
+	internal_datum = qpol_symbol_find(policy, SYM_CLASSES, name);
 	if (internal_datum == NULL) {
 		*obj_class = NULL;
 		ERR(policy, "could not find class %s", name);
@@ -443,6 +442,37 @@ int qpol_class_get_common(const qpol_policy_t * policy, const qpol_class_t * obj
 	return STATUS_SUCCESS;
 }
 
+int qpol_class_get_perm_mask(const qpol_policy_t * policy, const qpol_class_t * obj_class, const char *perm, uint32_t * mask)
+{
+	class_datum_t *internal_datum = NULL;
+	perm_datum_t *perm_datum = NULL;
+
+	if (mask != NULL)
+		*mask = 0;
+	if (policy == NULL || obj_class == NULL || perm == NULL || mask == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	internal_datum = (class_datum_t *) obj_class;
+	perm_datum = hashtab_search(internal_datum->permissions.table, (const hashtab_key_t)perm);
+	if (perm_datum == NULL && internal_datum->comdatum != NULL)
+		perm_datum = hashtab_search(internal_datum->comdatum->permissions.table, (const hashtab_key_t)perm);
+	if (perm_datum == NULL)
+		return STATUS_SUCCESS;
+
+	/* access vectors are a uint32_t; see perm_state_get_cur() */
+	if (perm_datum->s.value < 1 || perm_datum->s.value > 32) {
+		ERR(policy, "%s", strerror(EDOM));
+		errno = EDOM;
+		return STATUS_ERR;
+	}
+	*mask = (uint32_t) 1 << (perm_datum->s.value - 1);
+
+	return STATUS_SUCCESS;
+}
+
 int qpol_class_get_perm_iter(const qpol_policy_t * policy, const qpol_class_t * obj_class, qpol_iterator_t ** perms)
 {
 	class_datum_t *internal_datum = NULL;
@@ -512,7 +542,6 @@ int qpol_class_get_name(const qpol_policy_t * policy, const qpol_class_t * obj_c
 int qpol_policy_get_common_by_name(const qpol_policy_t * policy, const char *name, const qpol_common_t ** common)
 {
 	hashtab_datum_t internal_datum;
-	policydb_t *db;
 
 	if (policy == NULL || name == NULL || common == NULL) {
 		if (common != NULL)
@@ -522,8 +551,7 @@ int qpol_policy_get_common_by_name(const qpol_policy_t * policy, const char *nam
 		return STATUS_ERR;
 	}
 
-	db = &policy->p->p;
-	internal_datum = hashtab_search(db->p_commons.table, (const hashtab_key_t)name);
+	internal_datum = qpol_symbol_find(policy, SYM_COMMONS, name);
 	if (internal_datum == NULL) {
 		*common = NULL;
 		ERR(policy, "could not find common %s", name);
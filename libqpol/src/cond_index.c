@@ -0,0 +1,271 @@
+/**
+ * @file
+ *
+ * Implementation of the index from booleans to the conditionals that
+ * use them.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include "cond_index.h"
+#include "qpol_internal.h"
+#include <sepol/policydb/policydb.h>
+#include <sepol/policydb/avtab.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Determine if a boolean already appears in an expression before the
+ * given node.
+ */
+static int cond_expr_uses_bool_before(const cond_expr_t * expr, const cond_expr_t * stop, uint32_t bool_val)
+{
+	for (; expr != NULL && expr != stop; expr = expr->next) {
+		if (expr->expr_type == COND_BOOL && expr->bool == bool_val)
+			return 1;
+	}
+	return 0;
+}
+
+static int cond_index_pos_comp(const void *a, const void *b)
+{
+	const qpol_cond_index_pos_t *x = a, *y = b;
+	if (x->cond < y->cond)
+		return -1;
+	return (x->cond > y->cond);
+}
+
+int qpol_cond_index_create(const qpol_policy_t * policy, qpol_cond_index_t ** index)
+{
+	const policydb_t *db;
+	qpol_cond_index_t *idx = NULL;
+	cond_node_t *cond;
+	cond_expr_t *expr;
+	size_t *fill = NULL, i;
+	int error = 0;
+
+	if (index)
+		*index = NULL;
+	if (!policy || !index) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	db = &policy->p->p;
+	if (!(idx = calloc(1, sizeof(*idx)))) {
+		error = errno;
+		goto err;
+	}
+	idx->num_bools = db->p_bools.nprim;
+	for (cond = db->cond_list; cond; cond = cond->next)
+		idx->num_conds++;
+
+	if (!(idx->bool_start = calloc(idx->num_bools + 1, sizeof(size_t))) ||
+	    !(idx->conds = calloc(idx->num_conds + 1, sizeof(cond_node_t *))) ||
+	    !(idx->by_addr = calloc(idx->num_conds + 1, sizeof(qpol_cond_index_pos_t)))) {
+		error = errno;
+		goto err;
+	}
+
+	/* count the distinct conditionals using each boolean, then turn
+	 * the counts into starting offsets */
+	for (cond = db->cond_list, i = 0; cond; cond = cond->next, i++) {
+		idx->conds[i] = cond;
+		idx->by_addr[i].cond = cond;
+		idx->by_addr[i].pos = i;
+		for (expr = cond->expr; expr; expr = expr->next) {
+			if (expr->expr_type != COND_BOOL || expr->bool < 1 || expr->bool > idx->num_bools)
+				continue;
+			if (!cond_expr_uses_bool_before(cond->expr, expr, expr->bool))
+				idx->bool_start[expr->bool]++;
+		}
+	}
+	for (i = 1; i <= idx->num_bools; i++)
+		idx->bool_start[i] += idx->bool_start[i - 1];
+	qsort(idx->by_addr, idx->num_conds, sizeof(qpol_cond_index_pos_t), cond_index_pos_comp);
+
+	if (!(idx->bool_conds = malloc((idx->bool_start[idx->num_bools] + 1) * sizeof(size_t))) ||
+	    !(fill = malloc((idx->num_bools + 1) * sizeof(size_t)))) {
+		error = errno;
+		goto err;
+	}
+	memcpy(fill, idx->bool_start, (idx->num_bools + 1) * sizeof(size_t));
+	for (i = 0; i < idx->num_conds; i++) {
+		for (expr = idx->conds[i]->expr; expr; expr = expr->next) {
+			if (expr->expr_type != COND_BOOL || expr->bool < 1 || expr->bool > idx->num_bools)
+				continue;
+			if (!cond_expr_uses_bool_before(idx->conds[i]->expr, expr, expr->bool))
+				idx->bool_conds[fill[expr->bool - 1]++] = i;
+		}
+	}
+
+	free(fill);
+	*index = idx;
+	return STATUS_SUCCESS;
+
+      err:
+	ERR(policy, "%s", strerror(error));
+	free(fill);
+	qpol_cond_index_destroy(&idx);
+	errno = error;
+	return STATUS_ERR;
+}
+
+void qpol_cond_index_destroy(qpol_cond_index_t ** index)
+{
+	if (!index || !(*index))
+		return;
+	free((*index)->conds);
+	free((*index)->bool_start);
+	free((*index)->bool_conds);
+	free((*index)->by_addr);
+	free(*index);
+	*index = NULL;
+}
+
+size_t qpol_cond_index_find(const qpol_cond_index_t * index, const cond_node_t * cond)
+{
+	qpol_cond_index_pos_t key, *found;
+
+	key.cond = cond;
+	key.pos = 0;
+	found = bsearch(&key, index->by_addr, index->num_conds, sizeof(qpol_cond_index_pos_t), cond_index_pos_comp);
+	return (found ? found->pos : index->num_conds);
+}
+
+int qpol_cond_index_eval(const cond_expr_t * expr, const int *bool_states, uint32_t num_bools)
+{
+	int s[COND_EXPR_MAXDEPTH];
+	int sp = -1;
+
+	s[0] = -1;
+	for (; expr != NULL; expr = expr->next) {
+		switch (expr->expr_type) {
+		case COND_BOOL:
+			if (sp == (COND_EXPR_MAXDEPTH - 1) || expr->bool < 1 || expr->bool > num_bools)
+				return -1;
+			sp++;
+			s[sp] = bool_states[expr->bool - 1];
+			break;
+		case COND_NOT:
+			if (sp < 0)
+				return -1;
+			s[sp] = !s[sp];
+			break;
+		case COND_OR:
+			if (sp < 1)
+				return -1;
+			sp--;
+			s[sp] |= s[sp + 1];
+			break;
+		case COND_AND:
+			if (sp < 1)
+				return -1;
+			sp--;
+			s[sp] &= s[sp + 1];
+			break;
+		case COND_XOR:
+			if (sp < 1)
+				return -1;
+			sp--;
+			s[sp] ^= s[sp + 1];
+			break;
+		case COND_EQ:
+			if (sp < 1)
+				return -1;
+			sp--;
+			s[sp] = (s[sp] == s[sp + 1]);
+			break;
+		case COND_NEQ:
+			if (sp < 1)
+				return -1;
+			sp--;
+			s[sp] = (s[sp] != s[sp + 1]);
+			break;
+		default:
+			return -1;
+		}
+	}
+	return s[0];
+}
+
+void qpol_cond_update_rules(cond_node_t * cond)
+{
+	cond_av_list_t *list_ptr = NULL;
+
+	/* walk true list */
+	for (list_ptr = cond->true_list; list_ptr; list_ptr = list_ptr->next) {
+		/* field not used (except by write),
+		 * now storing list and enabled flags */
+		if (cond->cur_state)
+			list_ptr->node->merged |= QPOL_COND_RULE_ENABLED;
+		else
+			list_ptr->node->merged &= ~(QPOL_COND_RULE_ENABLED);
+	}
+
+	/* walk false list */
+	for (list_ptr = cond->false_list; list_ptr; list_ptr = list_ptr->next) {
+		/* field not used (except by write),
+		 * now storing list and enabled flags */
+		if (!cond->cur_state)
+			list_ptr->node->merged |= QPOL_COND_RULE_ENABLED;
+		else
+			list_ptr->node->merged &= ~(QPOL_COND_RULE_ENABLED);
+	}
+}
+
+int qpol_cond_index_reevaluate_bool(qpol_policy_t * policy, uint32_t bool_val)
+{
+	const qpol_cond_index_t *index = NULL;
+	policydb_t *db;
+	cond_node_t *cond;
+	size_t i;
+	int state;
+
+	if (!policy) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	if (qpol_cond_index_get(policy, &index))
+		return STATUS_ERR;
+	if (bool_val < 1 || bool_val > index->num_bools)
+		return STATUS_SUCCESS;
+
+	db = &policy->p->p;
+	for (i = index->bool_start[bool_val - 1]; i < index->bool_start[bool_val]; i++) {
+		cond = index->conds[index->bool_conds[i]];
+		state = cond_evaluate_expr(db, cond->expr);
+		if (state < 0) {
+			ERR(policy, "Error evaluating conditional: %s", strerror(EILSEQ));
+			errno = EILSEQ;
+			return STATUS_ERR;
+		}
+		/* rules of a conditional whose state did not change are
+		 * already correct */
+		if (state == cond->cur_state)
+			continue;
+		cond->cur_state = state;
+		qpol_cond_update_rules(cond);
+	}
+
+	return STATUS_SUCCESS;
+}
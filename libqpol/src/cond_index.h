@@ -0,0 +1,134 @@
+/**
+ * @file
+ *
+ * Private interface to the index from booleans to the conditionals
+ * whose expressions use them.  With it, changing the state of one
+ * boolean need only re-evaluate the conditionals that depend upon
+ * that boolean, rather than every conditional in the policy.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QPOL_COND_INDEX_H
+#define QPOL_COND_INDEX_H
+
+#ifdef	__cplusplus
+extern "C"
+{
+#endif
+
+#include <qpol/policy.h>
+#include <sepol/policydb/conditional.h>
+
+/**
+ * Position of a conditional within the policy's cond_list, used to
+ * find the position of the conditional owning a rule.
+ */
+	typedef struct qpol_cond_index_pos
+	{
+		const cond_node_t *cond;
+		size_t pos;
+	} qpol_cond_index_pos_t;
+
+/**
+ * Index from boolean value to conditionals.  The conditionals using
+ * the boolean with value v are conds[bool_conds[bool_start[v - 1]]]
+ * through conds[bool_conds[bool_start[v] - 1]], each listed once no
+ * matter how often the boolean appears within its expression.
+ */
+	typedef struct qpol_cond_index
+	{
+		uint32_t num_bools;
+		size_t num_conds;
+		/** conditionals in cond_list order */
+		cond_node_t **conds;
+		size_t *bool_start;
+		size_t *bool_conds;
+		/** conditionals sorted by address */
+		qpol_cond_index_pos_t *by_addr;
+	} qpol_cond_index_t;
+
+/**
+ * Build the index over a policy's conditionals.
+ * @param policy Policy whose conditionals to index.
+ * @param index Reference pointer to the created index.
+ * @return 0 on success and < 0 on failure; if the call fails,
+ * errno will be set and *index will be NULL.
+ */
+	int qpol_cond_index_create(const qpol_policy_t * policy, qpol_cond_index_t ** index);
+
+/**
+ * Free all memory used by an index and set it to NULL.
+ * @param index Reference pointer to the index to destroy.
+ */
+	void qpol_cond_index_destroy(qpol_cond_index_t ** index);
+
+/**
+ * Get the policy's index, building it the first time it is needed.
+ * The index is stored with the policy's extended image and is
+ * discarded whenever that image is.  (Implemented in policy_extend.c.)
+ * @param policy Policy whose index to get.
+ * @param index Pointer in which to store the index.  The caller
+ * should not free this pointer.
+ * @return 0 on success and < 0 on failure; if the call fails,
+ * errno will be set and *index will be NULL.
+ */
+	int qpol_cond_index_get(const qpol_policy_t * policy, const qpol_cond_index_t ** index);
+
+/**
+ * Find the position of a conditional within the index.
+ * @param index Index to search.
+ * @param cond Conditional to find.
+ * @return Position of the conditional within index->conds, or
+ * index->num_conds if the conditional is not in the index.
+ */
+	size_t qpol_cond_index_find(const qpol_cond_index_t * index, const cond_node_t * cond);
+
+/**
+ * Evaluate a conditional expression against a set of boolean states,
+ * in the same manner as sepol's cond_evaluate_expr().
+ * @param expr Expression to evaluate.
+ * @param bool_states Array of states indexed by boolean value - 1.
+ * @param num_bools Number of elements in bool_states.
+ * @return 1 if the expression is true, 0 if false, or < 0 if the
+ * expression is malformed.
+ */
+	int qpol_cond_index_eval(const cond_expr_t * expr, const int *bool_states, uint32_t num_bools);
+
+/**
+ * Set the enabled flag of each rule in a conditional's true and false
+ * lists according to the conditional's cur_state.
+ * @param cond Conditional whose rules to update.
+ */
+	void qpol_cond_update_rules(cond_node_t * cond);
+
+/**
+ * Re-evaluate only those conditionals that use the given boolean,
+ * updating the enabled flags of the rules of each conditional whose
+ * state changed.  This modifies the policy.
+ * @param policy Policy containing the boolean.
+ * @param bool_val Value of the boolean whose state has changed.
+ * @return 0 on success and < 0 on failure; if the call fails,
+ * errno will be set.
+ */
+	int qpol_cond_index_reevaluate_bool(qpol_policy_t * policy, uint32_t bool_val);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif				       /* QPOL_COND_INDEX_H */
@@ -0,0 +1,778 @@
+/**
+ * @file
+ *
+ * Implementation of the constraint evaluation engine.  Each constraint
+ * and validatetrans expression, stored by libsepol as a linked list in
+ * postfix order, is compiled into an array of instructions for a small
+ * stack machine; sets of names become flat bitmaps.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <qpol/constraint_eval.h>
+#include "qpol_internal.h"
+#include "constraint_internal.h"
+#include <sepol/policydb/policydb.h>
+#include <sepol/policydb/constraint.h>
+#include <sepol/policydb/context.h>
+#include <sepol/policydb/ebitmap.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CE_WORD_BITS 64
+#define CE_WORDS(bits) (((bits) + CE_WORD_BITS - 1) / CE_WORD_BITS)
+#define CE_BIT_GET(words, bit) (((words)[(bit) / CE_WORD_BITS] >> ((bit) % CE_WORD_BITS)) & 1)
+#define CE_BIT_SET(words, bit) ((words)[(bit) / CE_WORD_BITS] |= (uint64_t) 1 << ((bit) % CE_WORD_BITS))
+
+/* instructions; each leaf pushes one truth value */
+#define CE_OP_NOT        0
+#define CE_OP_AND        1
+#define CE_OP_OR         2
+#define CE_OP_FALSE      3	       /* an operator the kernel treats as false */
+#define CE_OP_ATTR_EQ    4	       /* field of scontext == field of tcontext */
+#define CE_OP_ROLE_DOM   5
+#define CE_OP_ROLE_DOMBY 6
+#define CE_OP_ROLE_INCOMP 7
+#define CE_OP_LEVEL      8	       /* compare two levels */
+#define CE_OP_NAMES      9	       /* field of a context is in a set */
+
+/* fields of a context */
+#define CE_FIELD_USER 0
+#define CE_FIELD_ROLE 1
+#define CE_FIELD_TYPE 2
+
+/* which context an instruction reads */
+#define CE_CTX_SOURCE 0
+#define CE_CTX_TARGET 1
+#define CE_CTX_XTARGET 2
+
+typedef struct ce_insn
+{
+	unsigned char op;
+	/** result is complemented (for NEQ operators) */
+	unsigned char negate;
+	/** CE_FIELD_* for ATTR_EQ and NAMES; index into ce_level_pairs
+	 *  for LEVEL */
+	unsigned char field;
+	/** CE_CTX_* for NAMES; QPOL_CEXPR_OP_* for LEVEL */
+	unsigned char arg;
+	/** offset of the set within the engine's sets, for NAMES */
+	size_t set;
+	/** number of bits in the set, for NAMES */
+	uint32_t set_bits;
+} ce_insn_t;
+
+typedef struct ce_statement
+{
+	struct qpol_constraint handle;
+	uint32_t perms;
+	size_t start;
+	size_t len;
+} ce_statement_t;
+
+struct qpol_constraint_engine
+{
+	const qpol_policy_t *policy;
+	uint32_t num_users;
+	uint32_t num_roles;
+	uint32_t num_types;
+	uint32_t num_sens;
+	uint32_t num_cats;
+	size_t cat_words;
+	int mls;
+	ce_insn_t *insns;
+	size_t num_insns;
+	uint64_t *sets;
+	size_t num_set_words;
+	/** role dominance: bit r2 - 1 of row r1 - 1 is set if r1
+	 *  dominates r2 */
+	uint64_t *role_dom;
+	size_t role_words;
+	/** statements of class value c are constrs[constr_start[c - 1]]
+	 *  through constrs[constr_start[c] - 1] */
+	ce_statement_t *constrs;
+	size_t *constr_start;
+	ce_statement_t *vtrans;
+	size_t *vtrans_start;
+	uint32_t num_classes;
+	/** deepest stack any program needs */
+	size_t max_depth;
+};
+
+struct qpol_constraint_ctx
+{
+	uint32_t user;
+	uint32_t role;
+	uint32_t type;
+	uint32_t sens[2];
+	/** category bitmaps of the low and high levels, each
+	 *  engine->cat_words long */
+	uint64_t *cats[2];
+};
+
+/** For each QPOL_CEXPR_SYM_L*: which context (0 source, 1 target) and
+ *  which level (0 low, 1 high) of it are compared, for the left and
+ *  right operands. */
+static const unsigned char ce_level_pairs[6][4] = {
+	{0, 0, 1, 0},		       /* l1 l2 */
+	{0, 0, 1, 1},		       /* l1 h2 */
+	{0, 1, 1, 0},		       /* h1 l2 */
+	{0, 1, 1, 1},		       /* h1 h2 */
+	{0, 0, 0, 1},		       /* l1 h1 */
+	{1, 0, 1, 1}		       /* l2 h2 */
+};
+
+/**
+ * @return Index into ce_level_pairs of a QPOL_CEXPR_SYM_L* attribute.
+ */
+static unsigned char ce_level_pair(uint32_t attr)
+{
+	switch (attr) {
+	case CEXPR_L1L2:
+		return 0;
+	case CEXPR_L1H2:
+		return 1;
+	case CEXPR_H1L2:
+		return 2;
+	case CEXPR_H1H2:
+		return 3;
+	case CEXPR_L1H1:
+		return 4;
+	default:		       /* CEXPR_L2H2 */
+		return 5;
+	}
+}
+
+static int ce_append_insn(qpol_constraint_engine_t * engine, size_t * cap, const ce_insn_t * insn)
+{
+	ce_insn_t *tmp;
+
+	if (engine->num_insns >= *cap) {
+		size_t new_cap = *cap ? *cap * 2 : 256;
+		if (!(tmp = realloc(engine->insns, new_cap * sizeof(ce_insn_t))))
+			return -1;
+		engine->insns = tmp;
+		*cap = new_cap;
+	}
+	engine->insns[engine->num_insns++] = *insn;
+	return 0;
+}
+
+/**
+ * Copy an ebitmap of values into a new set of the engine.
+ * @return Offset of the set, or (size_t)-1 on error.
+ */
+static size_t ce_add_set(qpol_constraint_engine_t * engine, const ebitmap_t * names, uint32_t bits)
+{
+	size_t words = CE_WORDS(bits), offset = engine->num_set_words;
+	uint64_t *tmp;
+	ebitmap_node_t *node;
+	unsigned int bit;
+
+	if (!(tmp = realloc(engine->sets, (offset + words + 1) * sizeof(uint64_t))))
+		return (size_t) - 1;
+	engine->sets = tmp;
+	memset(engine->sets + offset, 0, words * sizeof(uint64_t));
+	ebitmap_for_each_bit(names, node, bit) {
+		if (ebitmap_node_get_bit(node, bit) && bit < bits)
+			CE_BIT_SET(engine->sets + offset, bit);
+	}
+	engine->num_set_words += words;
+	return offset;
+}
+
+/**
+ * Compile one postfix expression, appending its instructions to the
+ * engine's.
+ */
+static int ce_compile_expr(qpol_constraint_engine_t * engine, size_t * cap, const constraint_expr_t * expr, size_t * len)
+{
+	const constraint_expr_t *e;
+	ce_insn_t insn;
+	size_t depth = 0, start = engine->num_insns;
+	uint32_t field;
+
+	for (e = expr; e; e = e->next) {
+		memset(&insn, 0, sizeof(insn));
+		switch (e->expr_type) {
+		case CEXPR_NOT:
+			if (depth < 1)
+				goto malformed;
+			insn.op = CE_OP_NOT;
+			break;
+		case CEXPR_AND:
+		case CEXPR_OR:
+			if (depth < 2)
+				goto malformed;
+			insn.op = (e->expr_type == CEXPR_AND ? CE_OP_AND : CE_OP_OR);
+			depth--;
+			break;
+		case CEXPR_ATTR:
+			depth++;
+			switch (e->attr) {
+			case CEXPR_USER:
+			case CEXPR_TYPE:
+				insn.field = (e->attr == CEXPR_USER ? CE_FIELD_USER : CE_FIELD_TYPE);
+				insn.op = (e->op == CEXPR_EQ || e->op == CEXPR_NEQ ? CE_OP_ATTR_EQ : CE_OP_FALSE);
+				insn.negate = (e->op == CEXPR_NEQ);
+				break;
+			case CEXPR_ROLE:
+				insn.field = CE_FIELD_ROLE;
+				if (e->op == CEXPR_EQ || e->op == CEXPR_NEQ) {
+					insn.op = CE_OP_ATTR_EQ;
+					insn.negate = (e->op == CEXPR_NEQ);
+				} else if (e->op == CEXPR_DOM) {
+					insn.op = CE_OP_ROLE_DOM;
+				} else if (e->op == CEXPR_DOMBY) {
+					insn.op = CE_OP_ROLE_DOMBY;
+				} else if (e->op == CEXPR_INCOMP) {
+					insn.op = CE_OP_ROLE_INCOMP;
+				} else {
+					insn.op = CE_OP_FALSE;
+				}
+				break;
+			case CEXPR_L1L2:
+			case CEXPR_L1H2:
+			case CEXPR_H1L2:
+			case CEXPR_H1H2:
+			case CEXPR_L1H1:
+			case CEXPR_L2H2:
+				insn.op = (e->op >= CEXPR_EQ && e->op <= CEXPR_INCOMP ? CE_OP_LEVEL : CE_OP_FALSE);
+				insn.field = ce_level_pair(e->attr);
+				insn.arg = (unsigned char)e->op;
+				break;
+			default:
+				insn.op = CE_OP_FALSE;
+			}
+			break;
+		case CEXPR_NAMES:
+			depth++;
+			if (e->op != CEXPR_EQ && e->op != CEXPR_NEQ) {
+				insn.op = CE_OP_FALSE;
+				break;
+			}
+			insn.op = CE_OP_NAMES;
+			insn.negate = (e->op == CEXPR_NEQ);
+			insn.arg = (e->attr & CEXPR_TARGET ? CE_CTX_TARGET : (e->attr & CEXPR_XTARGET ? CE_CTX_XTARGET : CE_CTX_SOURCE));
+			field = e->attr & ~(CEXPR_TARGET | CEXPR_XTARGET);
+			if (field & CEXPR_USER) {
+				insn.field = CE_FIELD_USER;
+				insn.set_bits = engine->num_users;
+			} else if (field & CEXPR_ROLE) {
+				insn.field = CE_FIELD_ROLE;
+				insn.set_bits = engine->num_roles;
+			} else if (field & CEXPR_TYPE) {
+				insn.field = CE_FIELD_TYPE;
+				insn.set_bits = engine->num_types;
+			} else {
+				insn.op = CE_OP_FALSE;
+				break;
+			}
+			if ((insn.set = ce_add_set(engine, &e->names, insn.set_bits)) == (size_t) - 1)
+				return -1;
+			break;
+		default:
+			goto malformed;
+		}
+		if (ce_append_insn(engine, cap, &insn))
+			return -1;
+		if (depth > engine->max_depth)
+			engine->max_depth = depth;
+	}
+	if (depth != 1)
+		goto malformed;
+
+	*len = engine->num_insns - start;
+	return 0;
+
+      malformed:
+	errno = EILSEQ;
+	return -1;
+}
+
+/**
+ * Compile a list of statements of one class.
+ */
+static int ce_compile_statements(qpol_constraint_engine_t * engine, size_t * cap, const class_datum_t * cls,
+				 constraint_node_t * head, ce_statement_t * stmts, size_t * num)
+{
+	constraint_node_t *node;
+
+	for (node = head; node; node = node->next) {
+		ce_statement_t *stmt = &stmts[(*num)++];
+		stmt->handle.obj_class = (const qpol_class_t *)cls;
+		stmt->handle.constr = node;
+		stmt->perms = node->permissions;
+		stmt->start = engine->num_insns;
+		if (ce_compile_expr(engine, cap, node->expr, &stmt->len))
+			return -1;
+	}
+	return 0;
+}
+
+static int ce_build_role_dom(qpol_constraint_engine_t * engine, const policydb_t * db)
+{
+	uint32_t r;
+	ebitmap_node_t *node;
+	unsigned int bit;
+
+	engine->role_words = CE_WORDS(engine->num_roles);
+	if (!(engine->role_dom = calloc((size_t)engine->num_roles * engine->role_words + 1, sizeof(uint64_t))))
+		return -1;
+	for (r = 0; r < engine->num_roles; r++) {
+		if (!db->role_val_to_struct[r])
+			continue;
+		ebitmap_for_each_bit(&db->role_val_to_struct[r]->dominates, node, bit) {
+			if (ebitmap_node_get_bit(node, bit) && bit < engine->num_roles)
+				CE_BIT_SET(engine->role_dom + (size_t)r * engine->role_words, bit);
+		}
+	}
+	return 0;
+}
+
+int qpol_constraint_engine_create(const qpol_policy_t * policy, qpol_constraint_engine_t ** engine)
+{
+	qpol_constraint_engine_t *eng = NULL;
+	const policydb_t *db;
+	constraint_node_t *node;
+	size_t num_constrs = 0, num_vtrans = 0, cap = 0;
+	uint32_t c;
+	int error = 0;
+
+	if (engine)
+		*engine = NULL;
+	if (!policy || !engine) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	db = &policy->p->p;
+	if (!(eng = calloc(1, sizeof(*eng)))) {
+		error = errno;
+		goto err;
+	}
+	eng->policy = policy;
+	eng->num_users = db->p_users.nprim;
+	eng->num_roles = db->p_roles.nprim;
+	eng->num_types = db->p_types.nprim;
+	eng->mls = db->mls;
+	if (eng->mls) {
+		eng->num_sens = db->p_levels.nprim;
+		eng->num_cats = db->p_cats.nprim;
+	}
+	eng->cat_words = CE_WORDS(eng->num_cats);
+	eng->num_classes = db->p_classes.nprim;
+
+	for (c = 0; c < eng->num_classes; c++) {
+		if (!db->class_val_to_struct[c])
+			continue;
+		for (node = db->class_val_to_struct[c]->constraints; node; node = node->next)
+			num_constrs++;
+		for (node = db->class_val_to_struct[c]->validatetrans; node; node = node->next)
+			num_vtrans++;
+	}
+	if (!(eng->constrs = calloc(num_constrs + 1, sizeof(ce_statement_t))) ||
+	    !(eng->vtrans = calloc(num_vtrans + 1, sizeof(ce_statement_t))) ||
+	    !(eng->constr_start = calloc(eng->num_classes + 1, sizeof(size_t))) ||
+	    !(eng->vtrans_start = calloc(eng->num_classes + 1, sizeof(size_t)))) {
+		error = errno;
+		goto err;
+	}
+
+	num_constrs = num_vtrans = 0;
+	for (c = 0; c < eng->num_classes; c++) {
+		const class_datum_t *cls = db->class_val_to_struct[c];
+		if (cls &&
+		    (ce_compile_statements(eng, &cap, cls, cls->constraints, eng->constrs, &num_constrs) ||
+		     ce_compile_statements(eng, &cap, cls, cls->validatetrans, eng->vtrans, &num_vtrans))) {
+			error = errno;
+			goto err;
+		}
+		eng->constr_start[c + 1] = num_constrs;
+		eng->vtrans_start[c + 1] = num_vtrans;
+	}
+
+	if (ce_build_role_dom(eng, db)) {
+		error = errno;
+		goto err;
+	}
+
+	*engine = eng;
+	return STATUS_SUCCESS;
+
+      err:
+	if (error == EILSEQ)
+		ERR(policy, "Error compiling constraint: %s", strerror(error));
+	else
+		ERR(policy, "%s", strerror(error));
+	qpol_constraint_engine_destroy(&eng);
+	errno = error;
+	return STATUS_ERR;
+}
+
+void qpol_constraint_engine_destroy(qpol_constraint_engine_t ** engine)
+{
+	if (!engine || !(*engine))
+		return;
+	free((*engine)->insns);
+	free((*engine)->sets);
+	free((*engine)->role_dom);
+	free((*engine)->constrs);
+	free((*engine)->constr_start);
+	free((*engine)->vtrans);
+	free((*engine)->vtrans_start);
+	free(*engine);
+	*engine = NULL;
+}
+
+/**
+ * Allocate a context with room for its category bitmaps and fill in
+ * its user, role, and type.
+ */
+static qpol_constraint_ctx_t *ce_ctx_alloc(const qpol_constraint_engine_t * engine, uint32_t user, uint32_t role, uint32_t type)
+{
+	qpol_constraint_ctx_t *ctx;
+
+	if (user < 1 || user > engine->num_users || role < 1 || role > engine->num_roles || type < 1 || type > engine->num_types) {
+		errno = EINVAL;
+		return NULL;
+	}
+	if (!(ctx = calloc(1, sizeof(*ctx) + (2 * engine->cat_words + 1) * sizeof(uint64_t))))
+		return NULL;
+	ctx->user = user;
+	ctx->role = role;
+	ctx->type = type;
+	ctx->cats[0] = (uint64_t *) (ctx + 1);
+	ctx->cats[1] = ctx->cats[0] + engine->cat_words;
+	return ctx;
+}
+
+int qpol_constraint_ctx_create(const qpol_constraint_engine_t * engine, const qpol_context_t * context, qpol_constraint_ctx_t ** ctx)
+{
+	const context_struct_t *internal_context = (const context_struct_t *)context;
+	ebitmap_node_t *node;
+	unsigned int bit;
+	int i, error = 0;
+
+	if (ctx)
+		*ctx = NULL;
+	if (!engine || !context || !ctx) {
+		ERR(engine ? engine->policy : NULL, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (!(*ctx = ce_ctx_alloc(engine, internal_context->user, internal_context->role, internal_context->type))) {
+		error = errno;
+		ERR(engine->policy, "%s", strerror(error));
+		errno = error;
+		return STATUS_ERR;
+	}
+	if (engine->mls) {
+		for (i = 0; i < 2; i++) {
+			(*ctx)->sens[i] = internal_context->range.level[i].sens;
+			ebitmap_for_each_bit(&internal_context->range.level[i].cat, node, bit) {
+				if (ebitmap_node_get_bit(node, bit) && bit < engine->num_cats)
+					CE_BIT_SET((*ctx)->cats[i], bit);
+			}
+		}
+	}
+	return STATUS_SUCCESS;
+}
+
+int qpol_constraint_ctx_create_from_values(const qpol_constraint_engine_t * engine, uint32_t user, uint32_t role, uint32_t type,
+					   const qpol_constraint_level_t * low, const qpol_constraint_level_t * high,
+					   qpol_constraint_ctx_t ** ctx)
+{
+	const qpol_constraint_level_t *levels[2];
+	size_t i, j;
+	int error = 0;
+
+	if (ctx)
+		*ctx = NULL;
+	if (!engine || !ctx || (engine->mls && !low)) {
+		ERR(engine ? engine->policy : NULL, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (!(*ctx = ce_ctx_alloc(engine, user, role, type))) {
+		error = errno;
+		goto err;
+	}
+	if (engine->mls) {
+		levels[0] = low;
+		levels[1] = (high ? high : low);
+		for (i = 0; i < 2; i++) {
+			if (levels[i]->sens < 1 || levels[i]->sens > engine->num_sens || (levels[i]->num_cats > 0 && !levels[i]->cats)) {
+				error = EINVAL;
+				goto err;
+			}
+			(*ctx)->sens[i] = levels[i]->sens;
+			for (j = 0; j < levels[i]->num_cats; j++) {
+				if (levels[i]->cats[j] < 1 || levels[i]->cats[j] > engine->num_cats) {
+					error = EINVAL;
+					goto err;
+				}
+				CE_BIT_SET((*ctx)->cats[i], levels[i]->cats[j] - 1);
+			}
+		}
+	}
+	return STATUS_SUCCESS;
+
+      err:
+	ERR(engine->policy, "%s", strerror(error));
+	qpol_constraint_ctx_destroy(ctx);
+	errno = error;
+	return STATUS_ERR;
+}
+
+void qpol_constraint_ctx_destroy(qpol_constraint_ctx_t ** ctx)
+{
+	if (!ctx || !(*ctx))
+		return;
+	free(*ctx);
+	*ctx = NULL;
+}
+
+static uint32_t ce_ctx_field(const qpol_constraint_ctx_t * ctx, unsigned char field)
+{
+	return (field == CE_FIELD_USER ? ctx->user : (field == CE_FIELD_ROLE ? ctx->role : ctx->type));
+}
+
+/**
+ * @return Non-zero if level a of context ca dominates level b of
+ * context cb.
+ */
+static int ce_level_dom(const qpol_constraint_engine_t * engine, const qpol_constraint_ctx_t * ca, int a,
+			const qpol_constraint_ctx_t * cb, int b)
+{
+	size_t i;
+
+	if (ca->sens[a] < cb->sens[b])
+		return 0;
+	for (i = 0; i < engine->cat_words; i++) {
+		if (cb->cats[b][i] & ~ca->cats[a][i])
+			return 0;
+	}
+	return 1;
+}
+
+static int ce_level_eq(const qpol_constraint_engine_t * engine, const qpol_constraint_ctx_t * ca, int a,
+		       const qpol_constraint_ctx_t * cb, int b)
+{
+	return ca->sens[a] == cb->sens[b] && !memcmp(ca->cats[a], cb->cats[b], engine->cat_words * sizeof(uint64_t));
+}
+
+static int ce_role_dom(const qpol_constraint_engine_t * engine, uint32_t r1, uint32_t r2)
+{
+	return CE_BIT_GET(engine->role_dom + (size_t)(r1 - 1) * engine->role_words, r2 - 1);
+}
+
+/**
+ * Run a program against up to three contexts.
+ * @param stack Scratch space of at least engine->max_depth elements.
+ * @return The value of the expression.
+ */
+static int ce_eval(const qpol_constraint_engine_t * engine, const ce_statement_t * stmt, const qpol_constraint_ctx_t * s,
+		   const qpol_constraint_ctx_t * t, const qpol_constraint_ctx_t * x, unsigned char *stack)
+{
+	const ce_insn_t *insn = engine->insns + stmt->start, *end = insn + stmt->len;
+	const qpol_constraint_ctx_t *ctxs[3] = { s, t, x }, *c;
+	const unsigned char *pair;
+	size_t sp = 0;
+	uint32_t val;
+	int v = 0;
+
+	for (; insn < end; insn++) {
+		switch (insn->op) {
+		case CE_OP_NOT:
+			stack[sp - 1] = !stack[sp - 1];
+			continue;
+		case CE_OP_AND:
+			sp--;
+			stack[sp - 1] = stack[sp - 1] && stack[sp];
+			continue;
+		case CE_OP_OR:
+			sp--;
+			stack[sp - 1] = stack[sp - 1] || stack[sp];
+			continue;
+		case CE_OP_FALSE:
+			v = 0;
+			break;
+		case CE_OP_ATTR_EQ:
+			v = (ce_ctx_field(s, insn->field) == ce_ctx_field(t, insn->field));
+			break;
+		case CE_OP_ROLE_DOM:
+			v = ce_role_dom(engine, s->role, t->role);
+			break;
+		case CE_OP_ROLE_DOMBY:
+			v = ce_role_dom(engine, t->role, s->role);
+			break;
+		case CE_OP_ROLE_INCOMP:
+			v = !ce_role_dom(engine, s->role, t->role) && !ce_role_dom(engine, t->role, s->role);
+			break;
+		case CE_OP_LEVEL:
+			pair = ce_level_pairs[insn->field];
+			switch (insn->arg) {
+			case CEXPR_EQ:
+			case CEXPR_NEQ:
+				v = ce_level_eq(engine, ctxs[pair[0]], pair[1], ctxs[pair[2]], pair[3]);
+				break;
+			case CEXPR_DOM:
+				v = ce_level_dom(engine, ctxs[pair[0]], pair[1], ctxs[pair[2]], pair[3]);
+				break;
+			case CEXPR_DOMBY:
+				v = ce_level_dom(engine, ctxs[pair[2]], pair[3], ctxs[pair[0]], pair[1]);
+				break;
+			default:	       /* CEXPR_INCOMP */
+				v = !ce_level_dom(engine, ctxs[pair[0]], pair[1], ctxs[pair[2]], pair[3]) &&
+					!ce_level_dom(engine, ctxs[pair[2]], pair[3], ctxs[pair[0]], pair[1]);
+			}
+			if (insn->arg == CEXPR_NEQ)
+				v = !v;
+			break;
+		default:		       /* CE_OP_NAMES */
+			/* as in the kernel, naming a context that is not
+			 * given fails the whole expression, negated or not */
+			if (!(c = ctxs[insn->arg]))
+				return 0;
+			val = ce_ctx_field(c, insn->field);
+			v = (val >= 1 && val <= insn->set_bits && CE_BIT_GET(engine->sets + insn->set, val - 1));
+			break;
+		}
+		stack[sp++] = (unsigned char)(insn->negate ? !v : v);
+	}
+	return stack[0];
+}
+
+/**
+ * Get the range of an engine's statements for a class.
+ * @return 0 on success, -1 if the class is not of the policy.
+ */
+static int ce_class_range(const qpol_constraint_engine_t * engine, const qpol_class_t * obj_class, const size_t * starts,
+			  size_t * first, size_t * last)
+{
+	uint32_t value = ((const class_datum_t *)obj_class)->s.value;
+
+	if (value < 1 || value > engine->num_classes)
+		return -1;
+	*first = starts[value - 1];
+	*last = starts[value];
+	return 0;
+}
+
+int qpol_constraint_engine_check(const qpol_constraint_engine_t * engine, const qpol_constraint_tuple_t * tuples, size_t num_tuples,
+				 const qpol_constraint_t ** denied, uint32_t * denied_perms)
+{
+	unsigned char *stack = NULL;
+	size_t i, j, first, last;
+	uint32_t perms;
+	int error = 0;
+
+	if (!engine || (num_tuples > 0 && (!tuples || !denied))) {
+		ERR(engine ? engine->policy : NULL, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	if (!(stack = malloc(engine->max_depth + 1))) {
+		error = errno;
+		ERR(engine->policy, "%s", strerror(error));
+		errno = error;
+		return STATUS_ERR;
+	}
+
+	for (i = 0; i < num_tuples; i++) {
+		const qpol_constraint_tuple_t *tuple = &tuples[i];
+		if (!tuple->scontext || !tuple->tcontext || !tuple->obj_class ||
+		    ce_class_range(engine, tuple->obj_class, engine->constr_start, &first, &last)) {
+			error = EINVAL;
+			ERR(engine->policy, "%s", strerror(error));
+			free(stack);
+			errno = error;
+			return STATUS_ERR;
+		}
+		denied[i] = NULL;
+		perms = 0;
+		for (j = first; j < last; j++) {
+			const ce_statement_t *stmt = &engine->constrs[j];
+			if (!(stmt->perms & tuple->perms) || (stmt->perms & tuple->perms & ~perms) == 0)
+				continue;
+			if (!ce_eval(engine, stmt, tuple->scontext, tuple->tcontext, NULL, stack)) {
+				if (!denied[i])
+					denied[i] = &stmt->handle;
+				perms |= stmt->perms & tuple->perms;
+				if (!denied_perms)
+					break;
+			}
+		}
+		if (denied_perms)
+			denied_perms[i] = perms;
+	}
+
+	free(stack);
+	return STATUS_SUCCESS;
+}
+
+int qpol_constraint_engine_validatetrans(const qpol_constraint_engine_t * engine, const qpol_validatetrans_tuple_t * tuples,
+					 size_t num_tuples, const qpol_validatetrans_t ** denied)
+{
+	unsigned char *stack = NULL;
+	size_t i, j, first, last;
+	int error = 0;
+
+	if (!engine || (num_tuples > 0 && (!tuples || !denied))) {
+		ERR(engine ? engine->policy : NULL, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	if (!(stack = malloc(engine->max_depth + 1))) {
+		error = errno;
+		ERR(engine->policy, "%s", strerror(error));
+		errno = error;
+		return STATUS_ERR;
+	}
+
+	for (i = 0; i < num_tuples; i++) {
+		const qpol_validatetrans_tuple_t *tuple = &tuples[i];
+		if (!tuple->oldcontext || !tuple->newcontext || !tuple->taskcontext || !tuple->obj_class ||
+		    ce_class_range(engine, tuple->obj_class, engine->vtrans_start, &first, &last)) {
+			error = EINVAL;
+			ERR(engine->policy, "%s", strerror(error));
+			free(stack);
+			errno = error;
+			return STATUS_ERR;
+		}
+		denied[i] = NULL;
+		for (j = first; j < last; j++) {
+			const ce_statement_t *stmt = &engine->vtrans[j];
+			/* as in the kernel, the old context is the source and
+			 * the new context the target */
+			if (!ce_eval(engine, stmt, tuple->oldcontext, tuple->newcontext, tuple->taskcontext, stack)) {
+				denied[i] = (const qpol_validatetrans_t *)&stmt->handle;
+				break;
+			}
+		}
+	}
+
+	free(stack);
+	return STATUS_SUCCESS;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file
+ *
+ * Private definition of constraint and validatetrans statements, shared
+ * by the query and evaluation code.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QPOL_CONSTRAINT_INTERNAL_H
+#define QPOL_CONSTRAINT_INTERNAL_H
+
+#ifdef	__cplusplus
+extern "C"
+{
+#endif
+
+#include <qpol/class_perm_query.h>
+#include <sepol/policydb/constraint.h>
+
+/** Both constraint and validatetrans statements are represented by
+ *  this struct. */
+	struct qpol_constraint
+	{
+		const qpol_class_t *obj_class;
+		constraint_node_t *constr;
+	};
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif				       /* QPOL_CONSTRAINT_INTERNAL_H */
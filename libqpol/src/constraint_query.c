@@ -32,6 +32,7 @@
 #include <qpol/class_perm_query.h>
 #include "qpol_internal.h"
 #include "iterator_internal.h"
+#include "constraint_internal.h"
 
 #include <sepol/policydb/policydb.h>
 #include <sepol/policydb/constraint.h>
@@ -40,12 +41,6 @@
 #include <string.h>
 #include <errno.h>
 
-struct qpol_constraint
-{
-	const qpol_class_t *obj_class;
-	constraint_node_t *constr;
-};
-
 typedef struct policy_constr_state
 {
 	qpol_iterator_t *class_iter;
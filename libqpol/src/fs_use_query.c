@@ -34,11 +34,11 @@
 #include <sepol/policydb/context.h>
 #include "qpol_internal.h"
 #include "iterator_internal.h"
+#include "ocon_index.h"
 
 int qpol_policy_get_fs_use_by_name(const qpol_policy_t * policy, const char *name, const qpol_fs_use_t ** ocon)
 {
-	ocontext_t *tmp = NULL;
-	policydb_t *db = NULL;
+	const qpol_ocon_index_t *index = NULL;
 
 	if (ocon != NULL)
 		*ocon = NULL;
@@ -49,13 +49,9 @@ int qpol_policy_get_fs_use_by_name(const qpol_policy_t * policy, const char *nam
 		return STATUS_ERR;
 	}
 
-	db = &policy->p->p;
-	for (tmp = db->ocontexts[OCON_FSUSE]; tmp; tmp = tmp->next) {
-		if (!strcmp(name, tmp->u.name))
-			break;
-	}
-
-	*ocon = (qpol_fs_use_t *) tmp;
+	if (qpol_ocon_index_get(policy, &index))
+		return STATUS_ERR;
+	*ocon = (qpol_fs_use_t *) qpol_ocon_index_find_fs_use(index, name);
 
 	if (*ocon == NULL) {
 		ERR(policy, "could not find fs_use statement for %s", name);
@@ -33,6 +33,7 @@
 #include <sepol/policydb/policydb.h>
 #include "qpol_internal.h"
 #include "iterator_internal.h"
+#include "ocon_index.h"
 
 struct qpol_genfscon
 {
@@ -229,6 +230,69 @@ int qpol_policy_get_genfscon_iter(const qpol_policy_t * policy, qpol_iterator_t
 	return STATUS_SUCCESS;
 }
 
+int qpol_policy_lookup_genfscon(const qpol_policy_t * policy, const char *name, const char *path, uint32_t obj_class,
+				qpol_genfscon_t ** genfscon)
+{
+	const qpol_ocon_index_t *index = NULL;
+	ocontext_t *ocon = NULL;
+	genfs_t *genfs = NULL;
+	int error = 0;
+
+	if (genfscon != NULL)
+		*genfscon = NULL;
+
+	if (policy == NULL || name == NULL || path == NULL || genfscon == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (qpol_ocon_index_get(policy, &index))
+		return STATUS_ERR;
+	if ((ocon = qpol_ocon_index_find_genfs(index, name, path, obj_class, &genfs)) == NULL) {
+		errno = ENOENT;
+		return STATUS_ERR;
+	}
+
+	*genfscon = calloc(1, sizeof(qpol_genfscon_t));
+	if (!(*genfscon)) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		errno = error;
+		return STATUS_ERR;
+	}
+	/* shallow copy only the struct pointer (genfscon) should be free()'ed */
+	(*genfscon)->fs_name = genfs->fstype;
+	(*genfscon)->path = ocon->u.name;
+	(*genfscon)->context = &(ocon->context[0]);
+	(*genfscon)->sclass = ocon->v.sclass;
+
+	return STATUS_SUCCESS;
+}
+
+int qpol_policy_lookup_genfscon_contexts(const qpol_policy_t * policy, const char *name, const char *const *paths, size_t num_paths,
+					 uint32_t obj_class, const qpol_context_t ** contexts)
+{
+	const qpol_ocon_index_t *index = NULL;
+	ocontext_t *ocon = NULL;
+	size_t i;
+
+	if (policy == NULL || name == NULL || (num_paths > 0 && (paths == NULL || contexts == NULL))) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (qpol_ocon_index_get(policy, &index))
+		return STATUS_ERR;
+	for (i = 0; i < num_paths; i++) {
+		ocon = qpol_ocon_index_find_genfs(index, name, paths[i], obj_class, NULL);
+		contexts[i] = ocon ? (qpol_context_t *) & (ocon->context[0]) : NULL;
+	}
+
+	return STATUS_SUCCESS;
+}
+
 int qpol_genfscon_get_name(const qpol_policy_t * policy, const qpol_genfscon_t * genfs, const char **name)
 {
 	if (name != NULL)
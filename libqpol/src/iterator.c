@@ -57,14 +57,21 @@ struct qpol_iterator
 	int (*end) (const qpol_iterator_t * iter);
 	 size_t(*size) (const qpol_iterator_t * iter);
 	void (*free_fn) (void *x);
+	/* optional; if NULL qpol_iterator_get_items() uses the above */
+	int (*get_items) (qpol_iterator_t * iter, void **items, size_t max, size_t * num);
 };
 
+static int hash_state_get_items(qpol_iterator_t * iter, void **items, size_t max, size_t * num);
+static int ebitmap_state_get_items(qpol_iterator_t * iter, void **items, size_t max, size_t * num);
+static int ocon_state_get_items(qpol_iterator_t * iter, void **items, size_t max, size_t * num);
+static int avtab_state_get_items(qpol_iterator_t * iter, void **items, size_t max, size_t * num);
+
 /**
  * The number of buckets in sepol's av tables was statically set in
  * libsepol < 2.0.20.  With libsepol 2.0.20, this size was dynamically
  * calculated based upon the number of rules.
  */
-static uint32_t iterator_get_avtab_size(const avtab_t * avtab)
+uint32_t iterator_get_avtab_size(const avtab_t * avtab)
 {
 #ifdef SEPOL_DYNAMIC_AVTAB
 	return avtab->nslot;
@@ -73,6 +80,15 @@ static uint32_t iterator_get_avtab_size(const avtab_t * avtab)
 #endif
 }
 
+/* position of an avtab state's bucket in the sequence of the buckets
+ * of both avtabs */
+static size_t avtab_state_pos(const avtab_state_t * state)
+{
+	if (state->which == QPOL_AVTAB_STATE_AV)
+		return state->bucket;
+	return (size_t) iterator_get_avtab_size(state->ucond_tab) + state->bucket;
+}
+
 int qpol_iterator_create(const qpol_policy_t * policy, void *state,
 			 void *(*get_cur) (const qpol_iterator_t * iter),
 			 int (*next) (qpol_iterator_t * iter),
@@ -106,9 +122,26 @@ int qpol_iterator_create(const qpol_policy_t * policy, void *state,
 	(*iter)->size = size;
 	(*iter)->free_fn = free_fn;
 
+	/* the common states know how to fetch many items at once */
+	if (next == hash_state_next)
+		(*iter)->get_items = hash_state_get_items;
+	else if (next == ebitmap_state_next)
+		(*iter)->get_items = ebitmap_state_get_items;
+	else if (next == ocon_state_next)
+		(*iter)->get_items = ocon_state_get_items;
+	else if (next == avtab_state_next)
+		(*iter)->get_items = avtab_state_get_items;
+
 	return STATUS_SUCCESS;
 }
 
+void qpol_iterator_set_get_items(qpol_iterator_t * iter,
+				 int (*get_items) (qpol_iterator_t * iter, void **items, size_t max, size_t * num))
+{
+	if (iter != NULL)
+		iter->get_items = get_items;
+}
+
 void *qpol_iterator_state(const qpol_iterator_t * iter)
 {
 	if (iter == NULL || iter->state == NULL) {
@@ -272,7 +305,8 @@ int avtab_state_next(qpol_iterator_t * iter)
 	state = iter->state;
 	avtab = (state->which == QPOL_AVTAB_STATE_AV ? state->ucond_tab : state->cond_tab);
 
-	if ((!avtab->htable || state->bucket >= iterator_get_avtab_size(avtab)) && state->which == QPOL_AVTAB_STATE_COND) {
+	if (((!avtab->htable || state->bucket >= iterator_get_avtab_size(avtab)) && state->which == QPOL_AVTAB_STATE_COND) ||
+	    (state->is_part && avtab_state_pos(state) >= state->limit)) {
 		errno = ERANGE;
 		return STATUS_ERR;
 	}
@@ -294,6 +328,10 @@ int avtab_state_next(qpol_iterator_t * iter)
 						break;
 					}
 				}
+				if (state->is_part && avtab_state_pos(state) >= state->limit) {
+					state->node = NULL;
+					break;
+				}
 				if (avtab->htable && avtab->htable[state->bucket] != NULL) {
 					state->node = avtab->htable[state->bucket];
 					break;
@@ -370,6 +408,8 @@ int avtab_state_end(const qpol_iterator_t * iter)
 	avtab = (state->which == QPOL_AVTAB_STATE_AV ? state->ucond_tab : state->cond_tab);
 	if ((!avtab->htable || state->bucket >= iterator_get_avtab_size(avtab)) && state->which == QPOL_AVTAB_STATE_COND)
 		return 1;
+	if (state->is_part && avtab_state_pos(state) >= state->limit)
+		return 1;
 	return 0;
 }
 
@@ -426,13 +466,29 @@ size_t ocon_state_size(const qpol_iterator_t * iter)
 	return count;
 }
 
+/* count the rules of a state's mask in buckets lo up to hi of an avtab */
+static size_t avtab_count_rules(const avtab_t * avtab, uint32_t rule_type_mask, size_t lo, size_t hi)
+{
+	size_t count = 0, bucket;
+	avtab_ptr_t node = NULL;
+
+	if (!avtab->htable)
+		return 0;
+	if (hi > iterator_get_avtab_size(avtab))
+		hi = iterator_get_avtab_size(avtab);
+	for (bucket = lo; bucket < hi; bucket++) {
+		for (node = avtab->htable[bucket]; node; node = node->next) {
+			if (node->key.specified & rule_type_mask)
+				count++;
+		}
+	}
+	return count;
+}
+
 size_t avtab_state_size(const qpol_iterator_t * iter)
 {
 	avtab_state_t *state;
-	avtab_t *avtab;
-	size_t count = 0;
-	avtab_ptr_t node = NULL;
-	uint32_t bucket = 0;
+	size_t first = 0, limit = (size_t) - 1, num_ucond;
 
 	if (iter == NULL || iter->state == NULL || iter->policy == NULL) {
 		errno = EINVAL;
@@ -440,25 +496,71 @@ size_t avtab_state_size(const qpol_iterator_t * iter)
 	}
 
 	state = iter->state;
-	avtab = state->ucond_tab;
-
-	for (bucket = 0; avtab->htable && bucket < iterator_get_avtab_size(avtab); bucket++) {
-		for (node = avtab->htable[bucket]; node; node = node->next) {
-			if (node->key.specified & state->rule_type_mask)
-				count++;
-		}
+	if (state->is_part) {
+		first = state->first;
+		limit = state->limit;
 	}
+	num_ucond = iterator_get_avtab_size(state->ucond_tab);
 
-	avtab = state->cond_tab;
+	return avtab_count_rules(state->ucond_tab, state->rule_type_mask, first, limit) +
+		avtab_count_rules(state->cond_tab, state->rule_type_mask, (first > num_ucond ? first - num_ucond : 0),
+				  (limit > num_ucond ? limit - num_ucond : 0));
+}
 
-	for (bucket = 0; avtab->htable && bucket < iterator_get_avtab_size(avtab); bucket++) {
-		for (node = avtab->htable[bucket]; node; node = node->next) {
-			if (node->key.specified & state->rule_type_mask)
-				count++;
-		}
+int avtab_state_create_part(const qpol_policy_t * policy, uint32_t rule_type_mask, size_t part, size_t num_parts,
+			    qpol_iterator_t ** iter)
+{
+	policydb_t *db;
+	avtab_state_t *state;
+	avtab_t *avtab;
+	size_t num_ucond, num_buckets;
+
+	if (iter)
+		*iter = NULL;
+	if (policy == NULL || iter == NULL || num_parts == 0 || part >= num_parts) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
 	}
 
-	return count;
+	db = &policy->p->p;
+	if (!(state = calloc(1, sizeof(avtab_state_t)))) {
+		ERR(policy, "%s", strerror(ENOMEM));
+		errno = ENOMEM;
+		return STATUS_ERR;
+	}
+	state->ucond_tab = &db->te_avtab;
+	state->cond_tab = &db->te_cond_avtab;
+	state->rule_type_mask = rule_type_mask;
+
+	num_ucond = iterator_get_avtab_size(state->ucond_tab);
+	num_buckets = num_ucond + iterator_get_avtab_size(state->cond_tab);
+	state->is_part = 1;
+	state->first = num_buckets / num_parts * part + num_buckets % num_parts * part / num_parts;
+	state->limit = num_buckets / num_parts * (part + 1) + num_buckets % num_parts * (part + 1) / num_parts;
+
+	if (state->first >= state->limit) {
+		/* an empty part starts at the end */
+		state->which = QPOL_AVTAB_STATE_COND;
+		state->bucket = iterator_get_avtab_size(state->cond_tab);
+	} else if (state->first < num_ucond) {
+		state->which = QPOL_AVTAB_STATE_AV;
+		state->bucket = state->first;
+	} else {
+		state->which = QPOL_AVTAB_STATE_COND;
+		state->bucket = state->first - num_ucond;
+	}
+	avtab = (state->which == QPOL_AVTAB_STATE_AV ? state->ucond_tab : state->cond_tab);
+	if (avtab->htable && state->bucket < iterator_get_avtab_size(avtab))
+		state->node = avtab->htable[state->bucket];
+
+	if (qpol_iterator_create(policy, state, avtab_state_get_cur, avtab_state_next, avtab_state_end, avtab_state_size, free, iter)) {
+		free(state);
+		return STATUS_ERR;
+	}
+	if (!avtab_state_end(*iter) && (state->node == NULL || !(state->node->key.specified & state->rule_type_mask)))
+		avtab_state_next(*iter);
+	return STATUS_SUCCESS;
 }
 
 void qpol_iterator_destroy(qpol_iterator_t ** iter)
@@ -510,6 +612,114 @@ int qpol_iterator_end(const qpol_iterator_t * iter)
 	return iter->end(iter);
 }
 
+int qpol_iterator_get_items(qpol_iterator_t * iter, void **items, size_t max, size_t * num)
+{
+	if (num != NULL)
+		*num = 0;
+
+	if (iter == NULL || items == NULL || num == NULL || iter->get_cur == NULL || iter->next == NULL || iter->end == NULL) {
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (iter->get_items != NULL)
+		return iter->get_items(iter, items, max, num);
+
+	while (*num < max && !iter->end(iter)) {
+		if ((items[*num] = iter->get_cur(iter)) == NULL)
+			return STATUS_ERR;
+		(*num)++;
+		if (iter->next(iter))
+			return STATUS_ERR;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+static int hash_state_get_items(qpol_iterator_t * iter, void **items, size_t max, size_t * num)
+{
+	hash_state_t *hs = (hash_state_t *) iter->state;
+
+	while (*num < max && !hash_state_end(iter)) {
+		if (iter->get_cur == hash_state_get_cur)
+			items[*num] = hs->node->datum;
+		else if (iter->get_cur == hash_state_get_cur_key)
+			items[*num] = hs->node->key;
+		else if ((items[*num] = iter->get_cur(iter)) == NULL)
+			return STATUS_ERR;
+		(*num)++;
+		/* stay within the current bucket while possible */
+		if (hs->node->next != NULL)
+			hs->node = hs->node->next;
+		else if (hash_state_next(iter))
+			return STATUS_ERR;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+static int ebitmap_state_get_items(qpol_iterator_t * iter, void **items, size_t max, size_t * num)
+{
+	ebitmap_state_t *es = (ebitmap_state_t *) iter->state;
+	ebitmap_node_t *node;
+	size_t bit;
+
+	if (ebitmap_state_end(iter))
+		return STATUS_SUCCESS;
+
+	/* scan the map's nodes directly rather than testing one bit at
+	 * a time from the start of the map */
+	for (node = es->bmap->node; node != NULL && *num < max; node = node->next) {
+		if (node->startbit + MAPSIZE <= es->cur)
+			continue;
+		bit = (es->cur > node->startbit ? es->cur : node->startbit);
+		for (; bit < node->startbit + MAPSIZE && *num < max; bit++) {
+			if (!ebitmap_node_get_bit(node, bit))
+				continue;
+			es->cur = bit;
+			if ((items[*num] = iter->get_cur(iter)) == NULL)
+				return STATUS_ERR;
+			(*num)++;
+		}
+	}
+
+	/* move past the last item returned */
+	if (*num > 0 && ebitmap_state_next(iter))
+		return STATUS_ERR;
+
+	return STATUS_SUCCESS;
+}
+
+static int ocon_state_get_items(qpol_iterator_t * iter, void **items, size_t max, size_t * num)
+{
+	ocon_state_t *os = (ocon_state_t *) iter->state;
+
+	while (*num < max && os->cur != NULL) {
+		items[(*num)++] = os->cur;
+		os->cur = os->cur->next;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+static int avtab_state_get_items(qpol_iterator_t * iter, void **items, size_t max, size_t * num)
+{
+	avtab_state_t *state = (avtab_state_t *) iter->state;
+
+	while (*num < max && !avtab_state_end(iter)) {
+		items[(*num)++] = state->node;
+		/* stay within the current bucket while possible */
+		while (*num < max && state->node->next != NULL && (state->node->next->key.specified & state->rule_type_mask)) {
+			state->node = state->node->next;
+			items[(*num)++] = state->node;
+		}
+		if (avtab_state_next(iter))
+			return STATUS_ERR;
+	}
+
+	return STATUS_SUCCESS;
+}
+
 int qpol_iterator_get_size(const qpol_iterator_t * iter, size_t * size)
 {
 	if (size != NULL)
@@ -75,6 +75,11 @@ extern "C"
 #define QPOL_AVTAB_STATE_AV   0
 #define QPOL_AVTAB_STATE_COND 1
 		unsigned which;
+		/* if is_part is non-zero, only the buckets from first up to
+		 * but excluding limit are visited, counting those of
+		 * ucond_tab and then those of cond_tab as one sequence */
+		int is_part;
+		size_t first, limit;
 	} avtab_state_t;
 
 	int qpol_iterator_create(const qpol_policy_t * policy, void *state,
@@ -83,6 +88,17 @@ extern "C"
 				 int (*end) (const qpol_iterator_t * iter),
 				 size_t(*size) (const qpol_iterator_t * iter), void (*free_fn) (void *x), qpol_iterator_t ** iter);
 
+/**
+ * Give an iterator a function that fetches many items at once, to be
+ * used by qpol_iterator_get_items().  qpol_iterator_create() already
+ * does so for iterators using the hash, ebitmap, ocon and avtab states.
+ * The function must append up to max - *num items to items, starting
+ * at items[*num] and incrementing *num for each, advancing the
+ * iterator past each item appended.
+ */
+	void qpol_iterator_set_get_items(qpol_iterator_t * iter,
+					 int (*get_items) (qpol_iterator_t * iter, void **items, size_t max, size_t * num));
+
 	void *qpol_iterator_state(const qpol_iterator_t * iter);
 	const policydb_t *qpol_iterator_policy(const qpol_iterator_t * iter);
 
@@ -116,6 +132,32 @@ extern "C"
 	size_t avtab_state_size(const qpol_iterator_t * iter);
 
 	void ebitmap_state_destroy(void *es);
+
+/**
+ * Create an iterator over one part of the buckets of a policy's
+ * unconditional and conditional avtabs, taken as one sequence.  Going
+ * through parts 0 to num_parts - 1 in turn visits the same rules, in
+ * the same order, as one iterator over both avtabs; distinct parts may
+ * be iterated by distinct threads.
+ * @param policy Policy whose avtabs to iterate.
+ * @param rule_type_mask Bitwise or'ed set of QPOL_RULE_* values.
+ * @param part Which part, from 0 to num_parts - 1.
+ * @param num_parts Number of parts into which the buckets are split.
+ * @param iter Iterator over items of type avtab_ptr_t.
+ * @return 0 on success and < 0 on failure; if the call fails, errno
+ * will be set and *iter will be NULL.
+ */
+	int avtab_state_create_part(const qpol_policy_t * policy, uint32_t rule_type_mask, size_t part, size_t num_parts,
+				    qpol_iterator_t ** iter);
+
+/**
+ * Get the number of hash slots in an avtab.  If the avtab was
+ * dynamically allocated this is calculated based upon the number of
+ * rules.
+ * @param avtab The avtab whose size to get.
+ * @return Number of slots in the avtab's hash table.
+ */
+	uint32_t iterator_get_avtab_size(const avtab_t * avtab);
 #ifdef	__cplusplus
 }
 #endif
@@ -0,0 +1,177 @@
+/**
+ * @file
+ *
+ * Implementation of the timing and memory statistics recorded while
+ * loading or rebuilding a policy.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include "qpol_internal.h"
+#include <sepol/policydb/policydb.h>
+#include <sepol/policydb/avtab.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+#ifdef HAVE_MALLINFO2
+#include <malloc.h>
+#endif
+
+static const char *const load_phase_names[QPOL_LOAD_PHASE_NUM] = {
+	"parse",
+	"link",
+	"prune_disabled_symbols",
+	"union_multiply_declared_symbols",
+	"expand",
+	"infer_policy_version",
+	"policy_extend",
+	"syn_rule_table"
+};
+
+/**
+ * Get the number of bytes of the process currently resident.
+ * @return Resident bytes, or 0 if they cannot be determined.
+ */
+static size_t load_stats_resident_bytes(void)
+{
+	FILE *f;
+	unsigned long size, resident;
+	long page_size = sysconf(_SC_PAGESIZE);
+
+	if (page_size <= 0 || (f = fopen("/proc/self/statm", "r")) == NULL)
+		return 0;
+	if (fscanf(f, "%lu %lu", &size, &resident) != 2)
+		resident = 0;
+	fclose(f);
+	return (size_t) resident * (size_t) page_size;
+}
+
+/**
+ * Get the amount of memory against which phases are measured: bytes
+ * of heap in use if the C library reports it, otherwise resident
+ * bytes.
+ */
+static size_t load_stats_mem_bytes(void)
+{
+#ifdef HAVE_MALLINFO2
+	struct mallinfo2 mi = mallinfo2();
+	return mi.uordblks + mi.hblkhd;
+#else
+	return load_stats_resident_bytes();
+#endif
+}
+
+/**
+ * Get the CPU time, user plus system, used so far by the process.
+ */
+static void load_stats_cpu_time(struct timeval *tv)
+{
+	struct rusage ru;
+
+	if (getrusage(RUSAGE_SELF, &ru) < 0) {
+		timerclear(tv);
+		return;
+	}
+	timeradd(&ru.ru_utime, &ru.ru_stime, tv);
+}
+
+/**
+ * Get the number of bytes held by the nodes and slots of an avtab.
+ */
+static size_t load_stats_avtab_bytes(const avtab_t * avtab)
+{
+	return (size_t) avtab->nel * sizeof(struct avtab_node) + (size_t) avtab->nslot * sizeof(avtab_ptr_t);
+}
+
+void qpol_load_stats_reset(qpol_policy_t * policy)
+{
+	memset(&policy->load_stats, 0, sizeof(policy->load_stats));
+}
+
+void qpol_load_clock_start(qpol_load_clock_t * clock)
+{
+	gettimeofday(&clock->wall, NULL);
+	load_stats_cpu_time(&clock->cpu);
+	clock->mem = load_stats_mem_bytes();
+}
+
+double qpol_load_clock_stop(qpol_policy_t * policy, qpol_load_phase_e phase, qpol_load_clock_t * clock)
+{
+	qpol_load_clock_t now;
+	qpol_load_phase_stats_t *stats;
+	double wall;
+
+	qpol_load_clock_start(&now);
+	wall = (now.wall.tv_sec - clock->wall.tv_sec) + (now.wall.tv_usec - clock->wall.tv_usec) / 1000000.0;
+	if (policy != NULL && phase < QPOL_LOAD_PHASE_NUM) {
+		stats = &policy->load_stats.phases[phase];
+		stats->count++;
+		stats->wall_time += wall;
+		stats->cpu_time += (now.cpu.tv_sec - clock->cpu.tv_sec) + (now.cpu.tv_usec - clock->cpu.tv_usec) / 1000000.0;
+		stats->mem_delta += (int64_t) now.mem - (int64_t) clock->mem;
+	}
+	*clock = now;
+	return wall;
+}
+
+int qpol_policy_get_load_stats(const qpol_policy_t * policy, qpol_load_stats_t * stats)
+{
+	struct rusage ru;
+	int64_t policydb = 0, ext = 0;
+	size_t i;
+
+	if (policy == NULL || stats == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	*stats = policy->load_stats;
+	for (i = QPOL_LOAD_PHASE_PARSE; i <= QPOL_LOAD_PHASE_INFER_POLICY_VERSION; i++)
+		policydb += stats->phases[i].mem_delta;
+	ext = stats->phases[QPOL_LOAD_PHASE_POLICY_EXTEND].mem_delta + stats->phases[QPOL_LOAD_PHASE_SYN_RULE_TABLE].mem_delta;
+	stats->policydb_bytes = (policydb > 0 ? (size_t) policydb : 0);
+	stats->ext_bytes = (ext > 0 ? (size_t) ext : 0);
+
+	stats->avtab_bytes = 0;
+	if (policy->p != NULL) {
+		stats->avtab_bytes = load_stats_avtab_bytes(&policy->p->p.te_avtab) +
+			load_stats_avtab_bytes(&policy->p->p.te_cond_avtab);
+	}
+
+	stats->resident_bytes = load_stats_resident_bytes();
+	stats->peak_resident_bytes = 0;
+	/* Linux reports ru_maxrss in kilobytes */
+	if (getrusage(RUSAGE_SELF, &ru) == 0)
+		stats->peak_resident_bytes = (size_t) ru.ru_maxrss * 1024;
+
+	return STATUS_SUCCESS;
+}
+
+const char *qpol_load_phase_get_name(qpol_load_phase_e phase)
+{
+	if ((unsigned int)phase >= QPOL_LOAD_PHASE_NUM) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return load_phase_names[phase];
+}
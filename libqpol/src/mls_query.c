@@ -32,11 +32,11 @@
 #include "iterator_internal.h"
 #include <qpol/mls_query.h>
 #include "qpol_internal.h"
+#include "symbol_index.h"
 
 /* level */
 int qpol_policy_get_level_by_name(const qpol_policy_t * policy, const char *name, const qpol_level_t ** datum)
 {
-	policydb_t *db = NULL;
 	hashtab_datum_t internal_datum = NULL;
 
 	if (policy == NULL || name == NULL || datum == NULL) {
@@ -46,8 +46,7 @@ int qpol_policy_get_level_by_name(const qpol_policy_t * policy, const char *name
 		errno = EINVAL;
 		return STATUS_ERR;
 	}
-	db = &policy->p->p;
-	internal_datum = hashtab_search(db->p_levels.table, (const hashtab_key_t)name);
+	internal_datum = qpol_symbol_find(policy, SYM_LEVELS, name);
 	if (internal_datum == NULL) {
 		ERR(policy, "could not find datum for level %s", name);
 		errno = ENOENT;
@@ -324,7 +323,6 @@ int qpol_level_get_alias_iter(const qpol_policy_t * policy, const qpol_level_t *
 int qpol_policy_get_cat_by_name(const qpol_policy_t * policy, const char *name, const qpol_cat_t ** datum)
 {
 	hashtab_datum_t internal_datum;
-	policydb_t *db;
 
 	if (policy == NULL || name == NULL || datum == NULL) {
 		if (datum != NULL)
@@ -334,8 +332,7 @@ int qpol_policy_get_cat_by_name(const qpol_policy_t * policy, const char *name,
 		return STATUS_ERR;
 	}
 
-	db = &policy->p->p;
-	internal_datum = hashtab_search(db->p_cats.table, (const hashtab_key_t)name);
+	internal_datum = qpol_symbol_find(policy, SYM_CATS, name);
 	if (internal_datum == NULL) {
 		*datum = NULL;
 		ERR(policy, "could not find datum for cat %s", name);
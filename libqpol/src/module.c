@@ -26,9 +26,11 @@
 #include <config.h>
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <qpol/module.h>
 #include <qpol/util.h>
@@ -37,24 +39,26 @@
 #include <sepol/policydb.h>
 #include <sepol/policydb/module.h>
 
-int qpol_module_create_from_file(const char *path, qpol_module_t ** module)
+int qpol_module_create_from_data(const char *path, char *data, size_t size, int data_type, qpol_module_t ** module)
 {
 	sepol_module_package_t *smp = NULL;
 	sepol_policy_file_t *spf = NULL;
-	FILE *infile = NULL;
 	int error = 0;
 	char *tmp = NULL;
-	char *data = NULL;
-	ssize_t size;
 
 	if (module)
 		*module = NULL;
 
-	if (!path || !module) {
+	if (!path || !data || !module) {
 		errno = EINVAL;
 		return STATUS_ERR;
 	}
 
+	if (size < sizeof(uint32_t) || !qpol_is_data_mod_pkg(data)) {
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+
 	if (!(*module = calloc(1, sizeof(qpol_module_t)))) {
 		return STATUS_ERR;
 	}
@@ -68,28 +72,7 @@ int qpol_module_create_from_file(const char *path, qpol_module_t ** module)
 		error = errno;
 		goto err;
 	}
-
-	infile = fopen(path, "rb");
-	if (!infile) {
-		error = errno;
-		goto err;
-	}
-	size = qpol_bunzip(infile, &data);
-
-	if (size > 0) {
-		if (!qpol_is_data_mod_pkg(data)) {
-			error = ENOTSUP;
-			goto err;
-		}
-		sepol_policy_file_set_mem(spf, data, size);
-	} else {
-		if (!qpol_is_file_mod_pkg(infile)) {
-			error = ENOTSUP;
-			goto err;
-		}
-		rewind(infile);
-		sepol_policy_file_set_fp(spf, infile);
-	}
+	sepol_policy_file_set_mem(spf, data, size);
 
 	if (sepol_module_package_create(&smp)) {
 		error = EIO;
@@ -102,14 +85,10 @@ int qpol_module_create_from_file(const char *path, qpol_module_t ** module)
 	}
 	free(tmp);
 	tmp = NULL;
-	if (size > 0) {
-		// Re setting the memory location has the effect of rewind
-		// API is not accessible from here to explicitly "rewind" the
-		// in-memory file.
-		sepol_policy_file_set_mem(spf, data, size);
-	} else {
-		rewind(infile);
-	}
+	// Re setting the memory location has the effect of rewind
+	// API is not accessible from here to explicitly "rewind" the
+	// in-memory file.
+	sepol_policy_file_set_mem(spf, data, size);
 
 	if (sepol_module_package_read(smp, spf, 0)) {
 		error = EIO;
@@ -125,11 +104,13 @@ int qpol_module_create_from_file(const char *path, qpol_module_t ** module)
 
 	(*module)->version = (*module)->p->p.version;
 	(*module)->enabled = 1;
+	(*module)->file_data = data;
+	(*module)->file_data_sz = size;
+	(*module)->file_data_type = data_type;
+	(*module)->image_sz = size;
+	(*module)->image_hash = qpol_hash_bytes(QPOL_HASH_BASIS, data, size);
 
 	sepol_module_package_free(smp);
-	fclose(infile);
-	if (data != NULL)
-		free (data);
 	sepol_policy_file_free(spf);
 
 	return STATUS_SUCCESS;
@@ -138,16 +119,185 @@ int qpol_module_create_from_file(const char *path, qpol_module_t ** module)
 	qpol_module_destroy(module);
 	sepol_policy_file_free(spf);
 	sepol_module_package_free(smp);
-	if (infile)
-		fclose(infile);
-	if (data != NULL)
-		free (data);
 	if (tmp != NULL)
 		free(tmp);
 	errno = error;
 	return STATUS_ERR;
 }
 
+int qpol_module_create_from_file(const char *path, qpol_module_t ** module)
+{
+	FILE *infile = NULL;
+	int error = 0, data_type;
+	char *data = NULL;
+	ssize_t bz_size;
+	size_t size;
+
+	if (module)
+		*module = NULL;
+
+	if (!path || !module) {
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	infile = fopen(path, "rb");
+	if (!infile) {
+		return STATUS_ERR;
+	}
+	bz_size = qpol_bunzip(infile, &data);
+
+	if (bz_size > 0) {
+		size = bz_size;
+		data_type = QPOL_POLICY_FILE_DATA_TYPE_MEM;
+	} else {
+		/* map the file rather than reading it, so that the
+		 * module may be read again cheaply when relinking */
+		if (qpol_mmap_file(fileno(infile), &data, &size, &data_type)) {
+			error = errno;
+			fclose(infile);
+			errno = error;
+			return STATUS_ERR;
+		}
+	}
+	fclose(infile);
+
+	if (qpol_module_create_from_data(path, data, size, data_type, module)) {
+		error = errno;
+		qpol_unmap_file(data, size, data_type);
+		errno = error;
+		return STATUS_ERR;
+	}
+
+	/* keep only the mapping; a decompressed copy is not worth
+	 * holding onto for the life of the module */
+	if (bz_size > 0) {
+		free((*module)->file_data);
+		(*module)->file_data = NULL;
+		(*module)->file_data_sz = 0;
+		(*module)->file_data_type = QPOL_POLICY_FILE_DATA_TYPE_BIN;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+struct module_pool
+{
+	const char *const *paths;
+	size_t num_paths;
+	qpol_module_t **modules;
+	int *errors;
+	/* next path to read, protected by lock */
+	size_t next;
+	pthread_mutex_t lock;
+};
+
+static void *module_pool_worker(void *arg)
+{
+	struct module_pool *pool = arg;
+	size_t i;
+
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+		if (i >= pool->num_paths)
+			break;
+		if (qpol_module_create_from_file(pool->paths[i], &pool->modules[i]))
+			pool->errors[i] = (errno ? errno : EIO);
+	}
+	return NULL;
+}
+
+int qpol_module_create_from_files(const char *const *paths, size_t num_paths, size_t num_threads,
+				  qpol_module_t ** modules, size_t * failed)
+{
+	struct module_pool pool;
+	pthread_t *threads = NULL;
+	size_t i, num_started = 0;
+	long num_cpus;
+	int error = 0;
+
+	/* until some module is found to be at fault */
+	if (failed)
+		*failed = num_paths;
+	if (!paths || !modules) {
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	for (i = 0; i < num_paths; i++)
+		modules[i] = NULL;
+
+	if (num_threads == 0) {
+		num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		num_threads = (num_cpus > 0 ? (size_t) num_cpus : 1);
+	}
+	if (num_threads > num_paths)
+		num_threads = num_paths;
+
+	memset(&pool, 0, sizeof(pool));
+	pool.paths = paths;
+	pool.num_paths = num_paths;
+	pool.modules = modules;
+	if (!(pool.errors = calloc(num_paths + 1, sizeof(int))) ||
+	    (num_threads > 1 && !(threads = calloc(num_threads, sizeof(pthread_t))))) {
+		error = errno;
+		free(pool.errors);
+		errno = error;
+		return STATUS_ERR;
+	}
+	pthread_mutex_init(&pool.lock, NULL);
+
+	/* the calling thread works too; should no thread start, it
+	 * simply reads every module itself */
+	for (i = 1; i < num_threads; i++) {
+		if (pthread_create(&threads[num_started], NULL, module_pool_worker, &pool))
+			break;
+		num_started++;
+	}
+	module_pool_worker(&pool);
+	for (i = 0; i < num_started; i++)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&pool.lock);
+	free(threads);
+
+	for (i = 0; i < num_paths; i++) {
+		if (pool.errors[i]) {
+			error = pool.errors[i];
+			if (failed)
+				*failed = i;
+			break;
+		}
+	}
+	free(pool.errors);
+	if (error) {
+		for (i = 0; i < num_paths; i++)
+			qpol_module_destroy(&modules[i]);
+		errno = error;
+		return STATUS_ERR;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+int qpol_module_reread(const qpol_module_t * module, qpol_module_t ** copy)
+{
+	if (copy)
+		*copy = NULL;
+
+	if (!module || !copy) {
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (module->file_data == NULL)
+		return qpol_module_create_from_file(module->path, copy);
+
+	/* the copy borrows the data, which the original still owns */
+	return qpol_module_create_from_data(module->path, module->file_data, module->file_data_sz,
+					    QPOL_POLICY_FILE_DATA_TYPE_BIN, copy);
+}
+
 void qpol_module_destroy(qpol_module_t ** module)
 {
 	if (!module || !(*module))
@@ -156,6 +306,7 @@ void qpol_module_destroy(qpol_module_t ** module)
 	free((*module)->path);
 	free((*module)->name);
 	sepol_policydb_free((*module)->p);
+	qpol_unmap_file((*module)->file_data, (*module)->file_data_sz, (*module)->file_data_type);
 	free(*module);
 	*module = NULL;
 }
@@ -227,6 +378,8 @@ int qpol_module_set_enabled(qpol_module_t * module, int enabled)
 		return STATUS_ERR;
 	}
 
+	QPOL_FAIL_IF_FROZEN(module->parent, STATUS_ERR);
+
 	if (enabled != module->enabled && module->parent) {
 		module->parent->modified = 1;
 	}
@@ -46,18 +46,19 @@ typedef struct scope_stack
 	struct scope_stack *parent, *child;
 } scope_stack_t;
 
-extern policydb_t *policydbp;
-extern queue_t id_queue;
+extern __thread policydb_t *policydbp;
+extern __thread queue_t id_queue;
 extern int yyerror(char *msg);
 extern void yyerror2(char *fmt, ...);
 
 static int push_stack(int stack_type, ...);
 static void pop_stack(void);
 
-/* keep track of the last item added to the stack */
-static scope_stack_t *stack_top = NULL;
-static avrule_block_t *last_block;
-static uint32_t next_decl_id = 1;
+/* keep track of the last item added to the stack; per thread, like the
+ * rest of the parser state */
+static __thread scope_stack_t *stack_top = NULL;
+static __thread avrule_block_t *last_block;
+static __thread uint32_t next_decl_id = 1;
 
 int define_policy(int pass, int module_header_given)
 {
@@ -33,11 +33,11 @@
 #include <sepol/policydb/policydb.h>
 #include "qpol_internal.h"
 #include "iterator_internal.h"
+#include "ocon_index.h"
 
 int qpol_policy_get_netifcon_by_name(const qpol_policy_t * policy, const char *name, const qpol_netifcon_t ** ocon)
 {
-	ocontext_t *tmp = NULL;
-	policydb_t *db = NULL;
+	const qpol_ocon_index_t *index = NULL;
 
 	if (ocon != NULL)
 		*ocon = NULL;
@@ -48,13 +48,9 @@ int qpol_policy_get_netifcon_by_name(const qpol_policy_t * policy, const char *n
 		return STATUS_ERR;
 	}
 
-	db = &policy->p->p;
-	for (tmp = db->ocontexts[OCON_NETIF]; tmp; tmp = tmp->next) {
-		if (!strcmp(name, tmp->u.name))
-			break;
-	}
-
-	*ocon = (qpol_netifcon_t *) tmp;
+	if (qpol_ocon_index_get(policy, &index))
+		return STATUS_ERR;
+	*ocon = (qpol_netifcon_t *) qpol_ocon_index_find_netif(index, name);
 
 	if (*ocon == NULL) {
 		ERR(policy, "could not find netifcon statement for %s", name);
@@ -0,0 +1,408 @@
+/**
+ * @file
+ *
+ * Implementation of the check of a policy's allow rules against its
+ * neverallow rules.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <qpol/neverallow.h>
+#include <qpol/policy_extend.h>
+#include "iterator_internal.h"
+#include "qpol_internal.h"
+#include "syn_rule_internal.h"
+#include <sepol/policydb/policydb.h>
+#include <sepol/policydb/avtab.h>
+#include <sepol/policydb/ebitmap.h>
+#include <sepol/policydb/expand.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct neverallow_entry
+{
+	uint32_t target;
+	uint32_t perms;
+	avtab_ptr_t node;
+} neverallow_entry_t;
+
+/**
+ * The allow rules of a policy grouped by class and source key, where
+ * a key is a type or an attribute.  The rules of class c and source
+ * key s are entries[start[i]] through entries[start[i + 1] - 1],
+ * where i is (c - 1) * num_types + (s - 1).
+ */
+typedef struct neverallow_index
+{
+	uint32_t num_types;
+	uint32_t num_classes;
+	size_t *start;
+	neverallow_entry_t *entries;
+} neverallow_index_t;
+
+/**
+ * The keys that can match one side of a neverallow rule: the types
+ * it names and every attribute containing one of them.  types and
+ * keys have an element per type value, set if the value is in the
+ * set.
+ */
+typedef struct neverallow_keys
+{
+	unsigned char *types;
+	unsigned char *keys;
+	int empty;
+} neverallow_keys_t;
+
+typedef struct neverallow_results
+{
+	qpol_neverallow_violation_t *list;
+	size_t num;
+	size_t size;
+} neverallow_results_t;
+
+static void neverallow_index_destroy(neverallow_index_t * index)
+{
+	free(index->start);
+	free(index->entries);
+	index->start = NULL;
+	index->entries = NULL;
+}
+
+static size_t neverallow_index_slot(const neverallow_index_t * index, uint32_t class_val, uint32_t key)
+{
+	return (size_t) (class_val - 1) * index->num_types + (key - 1);
+}
+
+/**
+ * Add the allow rules of one rule table to the index.  With fill 0,
+ * count them in start[slot + 1]; with fill 1, store them, advancing
+ * start[slot] past each.
+ */
+static void neverallow_index_add(const policydb_t * db, const avtab_t * tab, neverallow_index_t * index, int fill)
+{
+	uint32_t bucket, nperms;
+	avtab_ptr_t node;
+	size_t slot;
+	neverallow_entry_t *entry;
+
+	for (bucket = 0; tab->htable && bucket < iterator_get_avtab_size(tab); bucket++) {
+		for (node = tab->htable[bucket]; node; node = node->next) {
+			if (!(node->key.specified & AVTAB_ALLOWED) || node->datum.data == 0)
+				continue;
+			if (node->key.target_class < 1 || node->key.target_class > index->num_classes ||
+			    node->key.source_type < 1 || node->key.source_type > index->num_types ||
+			    node->key.target_type < 1 || node->key.target_type > index->num_types)
+				continue;
+			slot = neverallow_index_slot(index, node->key.target_class, node->key.source_type);
+			if (!fill) {
+				index->start[slot + 1]++;
+				continue;
+			}
+			entry = &index->entries[index->start[slot]++];
+			entry->target = node->key.target_type;
+			entry->perms = node->datum.data;
+			nperms = db->class_val_to_struct[node->key.target_class - 1]->permissions.nprim;
+			if (nperms < 32)
+				entry->perms &= ((uint32_t) 1 << nperms) - 1;
+			entry->node = node;
+		}
+	}
+}
+
+/**
+ * Index the allow rules of a policy, conditional or not.
+ * @return 0 on success, < 0 on out of memory.
+ */
+static int neverallow_index_create(const policydb_t * db, neverallow_index_t * index)
+{
+	size_t num_slots, i;
+
+	memset(index, 0, sizeof(*index));
+	index->num_types = db->p_types.nprim;
+	index->num_classes = db->p_classes.nprim;
+	num_slots = (size_t) index->num_types * index->num_classes;
+	if (!(index->start = calloc(num_slots + 1, sizeof(size_t))))
+		return -1;
+
+	neverallow_index_add(db, &db->te_avtab, index, 0);
+	neverallow_index_add(db, &db->te_cond_avtab, index, 0);
+	for (i = 0; i < num_slots; i++)
+		index->start[i + 1] += index->start[i];
+
+	if (!(index->entries = malloc((index->start[num_slots] + 1) * sizeof(neverallow_entry_t)))) {
+		neverallow_index_destroy(index);
+		return -1;
+	}
+	neverallow_index_add(db, &db->te_avtab, index, 1);
+	neverallow_index_add(db, &db->te_cond_avtab, index, 1);
+	/* filling advanced each start to the next slot's; shift back */
+	for (i = num_slots; i > 0; i--)
+		index->start[i] = index->start[i - 1];
+	index->start[0] = 0;
+
+	return 0;
+}
+
+static void neverallow_keys_destroy(neverallow_keys_t * keys)
+{
+	free(keys->types);
+	free(keys->keys);
+	keys->types = NULL;
+	keys->keys = NULL;
+}
+
+/**
+ * Find the keys that can match a type set.
+ * @return 0 on success, < 0 on out of memory.
+ */
+static int neverallow_keys_create(policydb_t * db, type_set_t * set, neverallow_keys_t * keys)
+{
+	ebitmap_t types;
+	ebitmap_node_t *node, *anode;
+	uint32_t bit, abit, num_types = db->p_types.nprim;
+	type_datum_t *type;
+
+	memset(keys, 0, sizeof(*keys));
+	keys->empty = 1;
+	if (!(keys->types = calloc(num_types + 1, 1)) || !(keys->keys = calloc(num_types + 1, 1))) {
+		neverallow_keys_destroy(keys);
+		return -1;
+	}
+
+	ebitmap_init(&types);
+	if (type_set_expand(set, &types, db, 1)) {
+		ebitmap_destroy(&types);
+		neverallow_keys_destroy(keys);
+		errno = ENOMEM;
+		return -1;
+	}
+	ebitmap_for_each_bit(&types, node, bit) {
+		if (!ebitmap_node_get_bit(node, bit) || bit >= num_types)
+			continue;
+		type = db->type_val_to_struct[bit];
+		if (!type || type->flavor == TYPE_ATTRIB)
+			continue;
+		keys->types[bit] = keys->keys[bit] = 1;
+		keys->empty = 0;
+		/* for a type, its bitmap holds the attributes containing it */
+		ebitmap_for_each_bit(&type->types, anode, abit) {
+			if (ebitmap_node_get_bit(anode, abit) && abit < num_types)
+				keys->keys[abit] = 1;
+		}
+	}
+	ebitmap_destroy(&types);
+	return 0;
+}
+
+/**
+ * Determine if a key, type or attribute, covers a type (both given by
+ * value).
+ */
+static int neverallow_key_has_type(const policydb_t * db, uint32_t key, uint32_t type_val)
+{
+	const type_datum_t *type = db->type_val_to_struct[key - 1];
+
+	if (type && type->flavor == TYPE_ATTRIB)
+		return ebitmap_get_bit(&type->types, type_val - 1);
+	return key == type_val;
+}
+
+/**
+ * Determine if an allow rule from source key to target key lets some
+ * type of a neverallow's source set access itself.
+ */
+static int neverallow_self_match(const policydb_t * db, const neverallow_keys_t * src, uint32_t source, uint32_t target)
+{
+	const type_datum_t *type = db->type_val_to_struct[source - 1];
+	ebitmap_node_t *node;
+	uint32_t bit;
+
+	if (!type || type->flavor != TYPE_ATTRIB)
+		return src->types[source - 1] && neverallow_key_has_type(db, target, source);
+	ebitmap_for_each_bit(&type->types, node, bit) {
+		if (ebitmap_node_get_bit(node, bit) && bit < db->p_types.nprim && src->types[bit] &&
+		    neverallow_key_has_type(db, target, bit + 1))
+			return 1;
+	}
+	return 0;
+}
+
+static int neverallow_results_append(neverallow_results_t * results, const struct qpol_syn_rule *rule, avtab_ptr_t node,
+				     uint32_t perms)
+{
+	qpol_neverallow_violation_t *tmp;
+	size_t size;
+
+	if (results->num >= results->size) {
+		size = (results->size ? results->size * 2 : 16);
+		if (!(tmp = realloc(results->list, size * sizeof(*tmp))))
+			return -1;
+		results->list = tmp;
+		results->size = size;
+	}
+	results->list[results->num].neverallow = (const qpol_syn_avrule_t *)rule;
+	results->list[results->num].allow = (const qpol_avrule_t *)node;
+	results->list[results->num].perms = perms;
+	results->num++;
+	return 0;
+}
+
+/**
+ * Find the allow rules that violate one neverallow rule.
+ * @return 0 on success, < 0 on out of memory.
+ */
+static int neverallow_check_rule(policydb_t * db, const neverallow_index_t * index, const struct qpol_syn_rule *rule,
+				 neverallow_results_t * results)
+{
+	avrule_t *avrule = rule->rule;
+	neverallow_keys_t src, tgt;
+	class_perm_node_t *cur;
+	const neverallow_entry_t *entry;
+	uint32_t s, num_types = index->num_types;
+	size_t slot, i;
+	int self = (avrule->flags & RULE_SELF) ? 1 : 0, retv = -1;
+
+	memset(&tgt, 0, sizeof(tgt));
+	if (neverallow_keys_create(db, &avrule->stypes, &src) || neverallow_keys_create(db, &avrule->ttypes, &tgt))
+		goto cleanup;
+	if (src.empty || (tgt.empty && !self)) {
+		retv = 0;
+		goto cleanup;
+	}
+
+	for (cur = avrule->perms; cur; cur = cur->next) {
+		if (cur->class < 1 || cur->class > index->num_classes || cur->data == 0)
+			continue;
+		for (s = 1; s <= num_types; s++) {
+			if (!src.keys[s - 1])
+				continue;
+			slot = neverallow_index_slot(index, cur->class, s);
+			for (i = index->start[slot]; i < index->start[slot + 1]; i++) {
+				entry = &index->entries[i];
+				if (!(entry->perms & cur->data))
+					continue;
+				if (!tgt.keys[entry->target - 1] && !(self && neverallow_self_match(db, &src, s, entry->target)))
+					continue;
+				if (neverallow_results_append(results, rule, entry->node, entry->perms & cur->data))
+					goto cleanup;
+			}
+		}
+	}
+	retv = 0;
+
+      cleanup:
+	neverallow_keys_destroy(&src);
+	neverallow_keys_destroy(&tgt);
+	return retv;
+}
+
+/**
+ * Check the policy's allow rules against a list of neverallow rules.
+ * If rule is NULL check all of the policy's neverallows, otherwise
+ * check only that one.
+ */
+static int neverallow_check(qpol_policy_t * policy, const struct qpol_syn_rule *rule, qpol_neverallow_violation_t ** violations,
+			    size_t * num)
+{
+	struct qpol_syn_rule *const *list = NULL;
+	size_t list_sz = 0, i;
+	neverallow_index_t index;
+	neverallow_results_t results;
+	int error = 0;
+
+	memset(&index, 0, sizeof(index));
+	memset(&results, 0, sizeof(results));
+
+	if (!qpol_policy_has_capability(policy, QPOL_CAP_SYN_RULES) || !qpol_policy_has_capability(policy, QPOL_CAP_RULES_LOADED)) {
+		ERR(policy, "%s", "Cannot check neverallow rules: Syntactic rules or allow rules not available");
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+	if (qpol_policy_build_syn_rule_table_lazy(policy) || qpol_syn_rule_get_master_list(policy, &list, &list_sz))
+		return STATUS_ERR;
+
+	if (neverallow_index_create(&policy->p->p, &index)) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		goto err;
+	}
+
+	if (rule != NULL) {
+		if (neverallow_check_rule(&policy->p->p, &index, rule, &results)) {
+			error = errno;
+			ERR(policy, "%s", strerror(error));
+			goto err;
+		}
+	} else {
+		for (i = 0; i < list_sz; i++) {
+			if (!(list[i]->rule->specified & AVRULE_NEVERALLOW))
+				continue;
+			if (neverallow_check_rule(&policy->p->p, &index, list[i], &results)) {
+				error = errno;
+				ERR(policy, "%s", strerror(error));
+				goto err;
+			}
+		}
+	}
+
+	neverallow_index_destroy(&index);
+	*violations = results.list;
+	*num = results.num;
+	return STATUS_SUCCESS;
+
+      err:
+	neverallow_index_destroy(&index);
+	free(results.list);
+	errno = error;
+	return STATUS_ERR;
+}
+
+int qpol_policy_check_neverallows(qpol_policy_t * policy, qpol_neverallow_violation_t ** violations, size_t * num)
+{
+	if (violations)
+		*violations = NULL;
+	if (num)
+		*num = 0;
+	if (!policy || !violations || !num) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	return neverallow_check(policy, NULL, violations, num);
+}
+
+int qpol_policy_check_neverallow(qpol_policy_t * policy, const qpol_syn_avrule_t * rule, qpol_neverallow_violation_t ** violations,
+				 size_t * num)
+{
+	const struct qpol_syn_rule *internal_rule = (const struct qpol_syn_rule *)rule;
+
+	if (violations)
+		*violations = NULL;
+	if (num)
+		*num = 0;
+	if (!policy || !rule || !violations || !num || !(internal_rule->rule->specified & AVRULE_NEVERALLOW)) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	return neverallow_check(policy, internal_rule, violations, num);
+}
@@ -33,6 +33,7 @@
 #include <sepol/policydb/policydb.h>
 #include "qpol_internal.h"
 #include "iterator_internal.h"
+#include "ocon_index.h"
 
 struct qpol_nodecon
 {
@@ -248,6 +249,117 @@ int qpol_policy_get_nodecon_iter(const qpol_policy_t * policy, qpol_iterator_t *
 	return STATUS_SUCCESS;
 }
 
+static void *ocon_array_state_get_cur_node(const qpol_iterator_t * iter)
+{
+	ocon_array_state_t *state;
+	qpol_nodecon_t *node = NULL;
+
+	if (iter == NULL || (state = qpol_iterator_state(iter)) == NULL || state->cur >= state->num) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	node = calloc(1, sizeof(qpol_nodecon_t));
+	if (!node) {
+		return NULL;
+	}
+
+	node->ocon = state->ocons[state->cur];
+	node->protocol = state->protocol;
+
+	return node;
+}
+
+int qpol_policy_get_nodecon_iter_by_addr(const qpol_policy_t * policy, const uint32_t addr[4], unsigned char protocol,
+					 qpol_iterator_t ** iter)
+{
+	const qpol_ocon_index_t *index = NULL;
+	ocon_array_state_t *os = NULL;
+	int error = 0;
+
+	if (iter != NULL)
+		*iter = NULL;
+
+	if (policy == NULL || addr == NULL || iter == NULL || (protocol != QPOL_IPV4 && protocol != QPOL_IPV6)) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (qpol_ocon_index_get(policy, &index))
+		return STATUS_ERR;
+
+	os = calloc(1, sizeof(ocon_array_state_t));
+	if (os == NULL) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		errno = error;
+		return STATUS_ERR;
+	}
+	os->protocol = protocol;
+	if (qpol_ocon_index_find_nodes(index, addr, protocol, &os->ocons, &os->num)) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		free(os);
+		errno = error;
+		return STATUS_ERR;
+	}
+
+	if (qpol_iterator_create(policy, (void *)os, ocon_array_state_get_cur_node,
+				 ocon_array_state_next, ocon_array_state_end, ocon_array_state_size, ocon_array_state_free, iter)) {
+		ocon_array_state_free(os);
+		return STATUS_ERR;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+int qpol_policy_lookup_nodecon(const qpol_policy_t * policy, const uint32_t addr[4], unsigned char protocol,
+			       qpol_nodecon_t ** ocon)
+{
+	const qpol_ocon_index_t *index = NULL;
+	ocontext_t **found = NULL;
+	size_t num = 0;
+	int error = 0;
+
+	if (ocon != NULL)
+		*ocon = NULL;
+
+	if (policy == NULL || addr == NULL || ocon == NULL || (protocol != QPOL_IPV4 && protocol != QPOL_IPV6)) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (qpol_ocon_index_get(policy, &index))
+		return STATUS_ERR;
+	if (qpol_ocon_index_find_nodes(index, addr, protocol, &found, &num)) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		errno = error;
+		return STATUS_ERR;
+	}
+	if (num == 0) {
+		free(found);
+		errno = ENOENT;
+		return STATUS_ERR;
+	}
+
+	*ocon = calloc(1, sizeof(qpol_nodecon_t));
+	if (*ocon == NULL) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		free(found);
+		errno = error;
+		return STATUS_ERR;
+	}
+	(*ocon)->ocon = found[0];
+	(*ocon)->protocol = protocol;
+	free(found);
+
+	return STATUS_SUCCESS;
+}
+
 int qpol_nodecon_get_addr(const qpol_policy_t * policy, const qpol_nodecon_t * ocon, uint32_t ** addr, unsigned char *protocol)
 {
 	if (addr != NULL)
@@ -0,0 +1,717 @@
+/**
+ * @file
+ *
+ * Implementation of the indexes over a policy's network and file
+ * system labeling statements.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include "ocon_index.h"
+#include "iterator_internal.h"
+#include "qpol_internal.h"
+#include <qpol/nodecon_query.h>
+#include <netinet/in.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** A statement and its position within its ocontext list. */
+typedef struct ocon_entry
+{
+	ocontext_t *ocon;
+	size_t pos;
+} ocon_entry_t;
+
+/**
+ * Port ranges sorted by protocol, then by low port.  The ranges of
+ * protocol p are ports[proto_start[p]] through
+ * ports[proto_start[p + 1] - 1].  Each protocol's ranges form an
+ * implicit balanced tree, rooted at the middle element of the slice,
+ * in which max_high[i] is the highest port of the subtree rooted at
+ * element i.
+ */
+typedef struct port_index
+{
+	ocon_entry_t *ports;
+	uint16_t *max_high;
+	size_t proto_start[257];
+} port_index_t;
+
+/**
+ * Binary trie over the leading bits of nodecon addresses.  Node 0 is
+ * the root; child[2 * n + b] is the child of node n for next bit b,
+ * or 0 if there is none.  Statements whose prefix ends at node n are
+ * entries[head[n] - 1], entries[next[head[n] - 1] - 1], etc.
+ * Statements whose masks are not a single prefix are kept in odd.
+ */
+typedef struct node_trie
+{
+	size_t *child;
+	size_t *head;
+	size_t num_nodes;
+	ocon_entry_t *entries;
+	size_t *next;
+	size_t num_entries;
+	ocon_entry_t *odd;
+	size_t num_odd;
+} node_trie_t;
+
+/**
+ * Open addressing hash of names; buckets hold index + 1 into names,
+ * or 0 if empty.  num_buckets is a power of 2.  Each user of the hash
+ * keeps the items named in an array parallel to names.
+ */
+typedef struct name_hash
+{
+	const char **names;
+	size_t num;
+	size_t *buckets;
+	size_t num_buckets;
+} name_hash_t;
+
+/**
+ * Character trie over the paths of each file system's genfscon
+ * statements.  Node roots[i] is the root of the trie for genfs[i];
+ * child[n] is the first child of node n and sibling[n] the next child
+ * of n's parent (both 0 if none), and label[n] is the character that
+ * leads to n.  Statements whose path ends at node n are
+ * entries[head[n] - 1], entries[next[head[n] - 1] - 1], etc., in
+ * policy order.
+ */
+typedef struct genfs_trie
+{
+	name_hash_t fstypes;
+	genfs_t **genfs;
+	size_t *roots;
+	unsigned char *label;
+	size_t *child;
+	size_t *sibling;
+	size_t *head;
+	size_t num_nodes;
+	ocontext_t **entries;
+	size_t *next;
+	size_t num_entries;
+} genfs_trie_t;
+
+struct qpol_ocon_index
+{
+	port_index_t port;
+	node_trie_t node[2];
+	name_hash_t netif;
+	ocontext_t **netifs;
+	name_hash_t fs_use;
+	ocontext_t **fs_uses;
+	genfs_trie_t genfs;
+};
+
+static int ocon_entry_port_comp(const void *a, const void *b)
+{
+	const ocon_entry_t *x = a, *y = b;
+
+	if (x->ocon->u.port.protocol != y->ocon->u.port.protocol)
+		return (x->ocon->u.port.protocol < y->ocon->u.port.protocol ? -1 : 1);
+	if (x->ocon->u.port.low_port != y->ocon->u.port.low_port)
+		return (x->ocon->u.port.low_port < y->ocon->u.port.low_port ? -1 : 1);
+	if (x->pos != y->pos)
+		return (x->pos < y->pos ? -1 : 1);
+	return 0;
+}
+
+static int ocon_entry_pos_comp(const void *a, const void *b)
+{
+	const ocon_entry_t *x = a, *y = b;
+
+	if (x->pos != y->pos)
+		return (x->pos < y->pos ? -1 : 1);
+	return 0;
+}
+
+/**
+ * Fill in max_high for the subtree over ports[lo] through
+ * ports[hi - 1], returning its highest port.
+ */
+static uint16_t port_index_fill_max(port_index_t * port, size_t lo, size_t hi)
+{
+	size_t mid;
+	uint16_t max, sub;
+
+	if (lo >= hi)
+		return 0;
+	mid = lo + (hi - lo) / 2;
+	max = port->ports[mid].ocon->u.port.high_port;
+	if ((sub = port_index_fill_max(port, lo, mid)) > max)
+		max = sub;
+	if ((sub = port_index_fill_max(port, mid + 1, hi)) > max)
+		max = sub;
+	port->max_high[mid] = max;
+	return max;
+}
+
+/**
+ * Append to found every range within ports[lo] through ports[hi - 1]
+ * that contains a port.
+ */
+static void port_index_stab(const port_index_t * port, size_t lo, size_t hi, uint16_t value, ocon_entry_t * found, size_t * num)
+{
+	size_t mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (port->max_high[mid] < value)
+			return;
+		port_index_stab(port, lo, mid, value, found, num);
+		if (port->ports[mid].ocon->u.port.low_port > value)
+			return;
+		if (port->ports[mid].ocon->u.port.high_port >= value)
+			found[(*num)++] = port->ports[mid];
+		lo = mid + 1;
+	}
+}
+
+static int port_index_create(const policydb_t * db, port_index_t * port)
+{
+	ocontext_t *ocon;
+	size_t num = 0, i;
+	unsigned int p;
+
+	for (ocon = db->ocontexts[OCON_PORT]; ocon; ocon = ocon->next)
+		num++;
+	if (!(port->ports = malloc((num + 1) * sizeof(ocon_entry_t))) || !(port->max_high = calloc(num + 1, sizeof(uint16_t))))
+		return -1;
+	for (ocon = db->ocontexts[OCON_PORT], i = 0; ocon; ocon = ocon->next, i++) {
+		port->ports[i].ocon = ocon;
+		port->ports[i].pos = i;
+	}
+	qsort(port->ports, num, sizeof(ocon_entry_t), ocon_entry_port_comp);
+
+	memset(port->proto_start, 0, sizeof(port->proto_start));
+	for (i = 0; i < num; i++)
+		port->proto_start[port->ports[i].ocon->u.port.protocol + 1]++;
+	for (p = 1; p <= 256; p++)
+		port->proto_start[p] += port->proto_start[p - 1];
+	for (p = 0; p < 256; p++)
+		port_index_fill_max(port, port->proto_start[p], port->proto_start[p + 1]);
+
+	return 0;
+}
+
+/**
+ * Get the length of the prefix described by a mask in network byte
+ * order, or -1 if the mask is not a single run of leading ones.
+ */
+static int node_prefix_len(const uint32_t * mask, size_t words)
+{
+	size_t i;
+	int len = 0;
+	uint32_t m;
+
+	for (i = 0; i < words; i++) {
+		m = ntohl(mask[i]);
+		if (len != (int)(i * 32)) {
+			if (m != 0)
+				return -1;
+			continue;
+		}
+		while (m & 0x80000000) {
+			len++;
+			m <<= 1;
+		}
+		if (m != 0)
+			return -1;
+	}
+	return len;
+}
+
+static unsigned int node_addr_bit(const uint32_t * addr, int bit)
+{
+	return (ntohl(addr[bit / 32]) >> (31 - bit % 32)) & 1;
+}
+
+static int node_covers(const uint32_t * ocon_addr, const uint32_t * ocon_mask, const uint32_t * addr, size_t words)
+{
+	size_t i;
+
+	for (i = 0; i < words; i++) {
+		if ((ocon_addr[i] & ocon_mask[i]) != (addr[i] & ocon_mask[i]))
+			return 0;
+	}
+	return 1;
+}
+
+static void node_get_addr_mask(ocontext_t * ocon, int v6, uint32_t ** addr, uint32_t ** mask)
+{
+	if (v6) {
+		*addr = ocon->u.node6.addr;
+		*mask = ocon->u.node6.mask;
+	} else {
+		*addr = &ocon->u.node.addr;
+		*mask = &ocon->u.node.mask;
+	}
+}
+
+static int node_trie_create(const policydb_t * db, int v6, node_trie_t * trie)
+{
+	ocontext_t *ocon;
+	uint32_t *addr, *mask;
+	size_t words = (v6 ? 4 : 1), num = 0, max_nodes = 1, pos, n, e;
+	int len, bit;
+
+	for (ocon = db->ocontexts[v6 ? OCON_NODE6 : OCON_NODE]; ocon; ocon = ocon->next) {
+		node_get_addr_mask(ocon, v6, &addr, &mask);
+		if ((len = node_prefix_len(mask, words)) >= 0)
+			max_nodes += len;
+		num++;
+	}
+	if (!(trie->child = calloc(2 * max_nodes, sizeof(size_t))) || !(trie->head = calloc(max_nodes, sizeof(size_t))) ||
+	    !(trie->entries = malloc((num + 1) * sizeof(ocon_entry_t))) || !(trie->next = calloc(num + 1, sizeof(size_t))) ||
+	    !(trie->odd = malloc((num + 1) * sizeof(ocon_entry_t))))
+		return -1;
+	trie->num_nodes = 1;
+
+	for (ocon = db->ocontexts[v6 ? OCON_NODE6 : OCON_NODE], pos = 0; ocon; ocon = ocon->next, pos++) {
+		node_get_addr_mask(ocon, v6, &addr, &mask);
+		if ((len = node_prefix_len(mask, words)) < 0) {
+			trie->odd[trie->num_odd].ocon = ocon;
+			trie->odd[trie->num_odd].pos = pos;
+			trie->num_odd++;
+			continue;
+		}
+		for (n = 0, bit = 0; bit < len; bit++) {
+			size_t *c = &trie->child[2 * n + node_addr_bit(addr, bit)];
+			if (!*c)
+				*c = trie->num_nodes++;
+			n = *c;
+		}
+		e = trie->num_entries++;
+		trie->entries[e].ocon = ocon;
+		trie->entries[e].pos = pos;
+		trie->next[e] = trie->head[n];
+		trie->head[n] = e + 1;
+	}
+
+	return 0;
+}
+
+static void node_trie_destroy(node_trie_t * trie)
+{
+	free(trie->child);
+	free(trie->head);
+	free(trie->entries);
+	free(trie->next);
+	free(trie->odd);
+}
+
+static size_t name_hash_name(const char *name)
+{
+	size_t h = 5381;
+
+	for (; *name; name++)
+		h = h * 33 + (unsigned char)*name;
+	return h;
+}
+
+static int name_hash_create(name_hash_t * hash, size_t num)
+{
+	for (hash->num_buckets = 16; hash->num_buckets < 2 * num;)
+		hash->num_buckets <<= 1;
+	if (!(hash->names = malloc((num + 1) * sizeof(char *))) || !(hash->buckets = calloc(hash->num_buckets, sizeof(size_t))))
+		return -1;
+	return 0;
+}
+
+static void name_hash_destroy(name_hash_t * hash)
+{
+	free(hash->names);
+	free(hash->buckets);
+}
+
+/**
+ * Find a name's bucket: the one holding it, or else the empty one in
+ * which it belongs.
+ */
+static size_t name_hash_bucket(const name_hash_t * hash, const char *name)
+{
+	size_t h, mask = hash->num_buckets - 1;
+
+	for (h = name_hash_name(name) & mask; hash->buckets[h]; h = (h + 1) & mask) {
+		if (!strcmp(hash->names[hash->buckets[h] - 1], name))
+			break;
+	}
+	return h;
+}
+
+/**
+ * Add a name to a hash unless it is already there.
+ * @return Index of the name within the hash, and in *added 1 if the
+ * name is new or 0 if it was already there.
+ */
+static size_t name_hash_insert(name_hash_t * hash, const char *name, int *added)
+{
+	size_t h = name_hash_bucket(hash, name);
+
+	*added = !hash->buckets[h];
+	if (*added) {
+		hash->names[hash->num] = name;
+		hash->buckets[h] = ++hash->num;
+	}
+	return hash->buckets[h] - 1;
+}
+
+/**
+ * @return Index of a name within a hash plus 1, or 0 if it is not
+ * there.
+ */
+static size_t name_hash_find(const name_hash_t * hash, const char *name)
+{
+	return hash->buckets[name_hash_bucket(hash, name)];
+}
+
+/**
+ * Hash the names of the statements in an ocontext list; the first
+ * statement for a name is the one used.
+ */
+static int ocon_hash_create(ocontext_t * head, name_hash_t * hash, ocontext_t *** ocons)
+{
+	ocontext_t *ocon;
+	size_t num = 0, i;
+	int added;
+
+	for (ocon = head; ocon; ocon = ocon->next)
+		num++;
+	if (name_hash_create(hash, num) || !(*ocons = malloc((num + 1) * sizeof(ocontext_t *))))
+		return -1;
+	for (ocon = head; ocon; ocon = ocon->next) {
+		i = name_hash_insert(hash, ocon->u.name, &added);
+		if (added)
+			(*ocons)[i] = ocon;
+	}
+	return 0;
+}
+
+/**
+ * Get the child of a trie node for a character.
+ * @return The child, or 0 if there is none.
+ */
+static size_t genfs_trie_find_child(const genfs_trie_t * trie, size_t n, unsigned char c)
+{
+	size_t child;
+
+	for (child = trie->child[n]; child; child = trie->sibling[child]) {
+		if (trie->label[child] == c)
+			return child;
+	}
+	return 0;
+}
+
+/**
+ * Get the child of a trie node for a character, adding it if there is
+ * none.  The trie was sized for every character of every path, so
+ * there is always room for a new node.
+ */
+static size_t genfs_trie_add_child(genfs_trie_t * trie, size_t n, unsigned char c)
+{
+	size_t child = genfs_trie_find_child(trie, n, c);
+
+	if (child)
+		return child;
+	child = trie->num_nodes++;
+	trie->label[child] = c;
+	trie->child[child] = 0;
+	trie->head[child] = 0;
+	trie->sibling[child] = trie->child[n];
+	trie->child[n] = child;
+	return child;
+}
+
+static int genfs_trie_create(const policydb_t * db, genfs_trie_t * trie)
+{
+	genfs_t *genfs;
+	ocontext_t *ocon;
+	size_t num_genfs = 0, num_chars = 0, num_ocons = 0, i, n, *tail;
+	const char *c;
+	int added;
+
+	for (genfs = db->genfs; genfs; genfs = genfs->next) {
+		num_genfs++;
+		for (ocon = genfs->head; ocon; ocon = ocon->next) {
+			num_ocons++;
+			num_chars += strlen(ocon->u.name);
+		}
+	}
+	n = num_genfs + num_chars + 1;
+	if (name_hash_create(&trie->fstypes, num_genfs) ||
+	    !(trie->genfs = malloc((num_genfs + 1) * sizeof(genfs_t *))) ||
+	    !(trie->roots = malloc((num_genfs + 1) * sizeof(size_t))) ||
+	    !(trie->label = malloc(n)) ||
+	    !(trie->child = malloc(n * sizeof(size_t))) ||
+	    !(trie->sibling = malloc(n * sizeof(size_t))) ||
+	    !(trie->head = malloc(n * sizeof(size_t))) ||
+	    !(trie->entries = malloc((num_ocons + 1) * sizeof(ocontext_t *))) ||
+	    !(trie->next = calloc(num_ocons + 1, sizeof(size_t))))
+		return -1;
+
+	/* node 0 is unused, so that 0 can mean no node */
+	trie->num_nodes = 1;
+	for (genfs = db->genfs; genfs; genfs = genfs->next) {
+		i = name_hash_insert(&trie->fstypes, genfs->fstype, &added);
+		if (!added)
+			continue;
+		trie->genfs[i] = genfs;
+		n = trie->roots[i] = trie->num_nodes++;
+		trie->child[n] = trie->sibling[n] = trie->head[n] = 0;
+		for (ocon = genfs->head; ocon; ocon = ocon->next) {
+			for (n = trie->roots[i], c = ocon->u.name; *c; c++)
+				n = genfs_trie_add_child(trie, n, (unsigned char)*c);
+			/* append, to keep each node's statements in policy order */
+			trie->entries[trie->num_entries] = ocon;
+			tail = &trie->head[n];
+			while (*tail)
+				tail = &trie->next[*tail - 1];
+			*tail = ++trie->num_entries;
+		}
+	}
+
+	return 0;
+}
+
+static void genfs_trie_destroy(genfs_trie_t * trie)
+{
+	name_hash_destroy(&trie->fstypes);
+	free(trie->genfs);
+	free(trie->roots);
+	free(trie->label);
+	free(trie->child);
+	free(trie->sibling);
+	free(trie->head);
+	free(trie->entries);
+	free(trie->next);
+}
+
+int qpol_ocon_index_create(const qpol_policy_t * policy, qpol_ocon_index_t ** index)
+{
+	const policydb_t *db;
+	qpol_ocon_index_t *idx = NULL;
+	int error = 0;
+
+	if (index)
+		*index = NULL;
+	if (!policy || !index) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	db = &policy->p->p;
+	if (!(idx = calloc(1, sizeof(*idx))) || port_index_create(db, &idx->port) || node_trie_create(db, 0, &idx->node[QPOL_IPV4])
+	    || node_trie_create(db, 1, &idx->node[QPOL_IPV6]) || ocon_hash_create(db->ocontexts[OCON_NETIF], &idx->netif, &idx->netifs)
+	    || ocon_hash_create(db->ocontexts[OCON_FSUSE], &idx->fs_use, &idx->fs_uses) || genfs_trie_create(db, &idx->genfs)) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		qpol_ocon_index_destroy(&idx);
+		errno = error;
+		return STATUS_ERR;
+	}
+
+	*index = idx;
+	return STATUS_SUCCESS;
+}
+
+void qpol_ocon_index_destroy(qpol_ocon_index_t ** index)
+{
+	if (!index || !(*index))
+		return;
+	free((*index)->port.ports);
+	free((*index)->port.max_high);
+	node_trie_destroy(&(*index)->node[QPOL_IPV4]);
+	node_trie_destroy(&(*index)->node[QPOL_IPV6]);
+	name_hash_destroy(&(*index)->netif);
+	free((*index)->netifs);
+	name_hash_destroy(&(*index)->fs_use);
+	free((*index)->fs_uses);
+	genfs_trie_destroy(&(*index)->genfs);
+	free(*index);
+	*index = NULL;
+}
+
+/**
+ * Sort found entries into policy order and copy out their statements.
+ */
+static int ocon_index_return(ocon_entry_t * found, size_t num, ocontext_t *** ocons, size_t * num_ocons)
+{
+	size_t i;
+
+	qsort(found, num, sizeof(ocon_entry_t), ocon_entry_pos_comp);
+	if (!(*ocons = malloc((num + 1) * sizeof(ocontext_t *))))
+		return -1;
+	for (i = 0; i < num; i++)
+		(*ocons)[i] = found[i].ocon;
+	*num_ocons = num;
+	return 0;
+}
+
+int qpol_ocon_index_find_ports(const qpol_ocon_index_t * index, uint8_t protocol, uint16_t port, ocontext_t *** ocons,
+			       size_t * num)
+{
+	const port_index_t *pi = &index->port;
+	ocon_entry_t *found = NULL;
+	size_t lo = pi->proto_start[protocol], hi = pi->proto_start[protocol + 1], count = 0;
+	int retv;
+
+	*ocons = NULL;
+	*num = 0;
+	if (!(found = malloc((hi - lo + 1) * sizeof(ocon_entry_t))))
+		return -1;
+	port_index_stab(pi, lo, hi, port, found, &count);
+	retv = ocon_index_return(found, count, ocons, num);
+	free(found);
+	return retv;
+}
+
+int qpol_ocon_index_find_nodes(const qpol_ocon_index_t * index, const uint32_t addr[4], unsigned char protocol,
+			       ocontext_t *** ocons, size_t * num)
+{
+	const node_trie_t *trie;
+	ocon_entry_t *found = NULL;
+	uint32_t *ocon_addr, *ocon_mask;
+	size_t words, n, e, i, count = 0;
+	int bit = 0, bits, retv;
+
+	*ocons = NULL;
+	*num = 0;
+	if (protocol != QPOL_IPV4 && protocol != QPOL_IPV6) {
+		errno = EINVAL;
+		return -1;
+	}
+	trie = &index->node[protocol];
+	words = (protocol == QPOL_IPV6 ? 4 : 1);
+	bits = (int)words * 32;
+	if (!(found = malloc((trie->num_entries + trie->num_odd + 1) * sizeof(ocon_entry_t))))
+		return -1;
+
+	/* every prefix along the address's path through the trie covers it */
+	for (n = 0;;) {
+		for (e = trie->head[n]; e; e = trie->next[e - 1])
+			found[count++] = trie->entries[e - 1];
+		if (bit >= bits || !(n = trie->child[2 * n + node_addr_bit(addr, bit)]))
+			break;
+		bit++;
+	}
+	for (i = 0; i < trie->num_odd; i++) {
+		node_get_addr_mask(trie->odd[i].ocon, protocol == QPOL_IPV6, &ocon_addr, &ocon_mask);
+		if (node_covers(ocon_addr, ocon_mask, addr, words))
+			found[count++] = trie->odd[i];
+	}
+
+	retv = ocon_index_return(found, count, ocons, num);
+	free(found);
+	return retv;
+}
+
+ocontext_t *qpol_ocon_index_find_netif(const qpol_ocon_index_t * index, const char *name)
+{
+	size_t i = name_hash_find(&index->netif, name);
+
+	return i ? index->netifs[i - 1] : NULL;
+}
+
+ocontext_t *qpol_ocon_index_find_fs_use(const qpol_ocon_index_t * index, const char *name)
+{
+	size_t i = name_hash_find(&index->fs_use, name);
+
+	return i ? index->fs_uses[i - 1] : NULL;
+}
+
+ocontext_t *qpol_ocon_index_find_genfs(const qpol_ocon_index_t * index, const char *fs_name, const char *path, uint32_t sclass,
+				       genfs_t ** genfs)
+{
+	const genfs_trie_t *trie = &index->genfs;
+	ocontext_t *best = NULL;
+	size_t i, n, e;
+	const char *c = path;
+
+	if (genfs)
+		*genfs = NULL;
+	if (!(i = name_hash_find(&trie->fstypes, fs_name)))
+		return NULL;
+
+	/* every node along the path is a prefix of it; the deepest
+	 * statement that applies to the class wins */
+	for (n = trie->roots[i - 1];;) {
+		for (e = trie->head[n]; e; e = trie->next[e - 1]) {
+			if (!trie->entries[e - 1]->v.sclass || trie->entries[e - 1]->v.sclass == sclass) {
+				best = trie->entries[e - 1];
+				break;
+			}
+		}
+		if (!*c || !(n = genfs_trie_find_child(trie, n, (unsigned char)*c)))
+			break;
+		c++;
+	}
+
+	if (best && genfs)
+		*genfs = trie->genfs[i - 1];
+	return best;
+}
+
+int ocon_array_state_next(qpol_iterator_t * iter)
+{
+	ocon_array_state_t *state;
+
+	if (iter == NULL || (state = qpol_iterator_state(iter)) == NULL) {
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	if (state->cur >= state->num) {
+		errno = ERANGE;
+		return STATUS_ERR;
+	}
+	state->cur++;
+	return STATUS_SUCCESS;
+}
+
+int ocon_array_state_end(const qpol_iterator_t * iter)
+{
+	ocon_array_state_t *state;
+
+	if (iter == NULL || (state = qpol_iterator_state(iter)) == NULL) {
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	return (state->cur >= state->num);
+}
+
+size_t ocon_array_state_size(const qpol_iterator_t * iter)
+{
+	ocon_array_state_t *state;
+
+	if (iter == NULL || (state = qpol_iterator_state(iter)) == NULL) {
+		errno = EINVAL;
+		return 0;
+	}
+	return state->num;
+}
+
+void ocon_array_state_free(void *state)
+{
+	if (!state)
+		return;
+	free(((ocon_array_state_t *) state)->ocons);
+	free(state);
+}
@@ -0,0 +1,157 @@
+/**
+ * @file
+ *
+ * Private interface to the indexes over a policy's network and file
+ * system labeling statements: an interval tree of port ranges for each
+ * protocol, a longest-prefix radix tree of nodecon addresses for each
+ * IP version, hashes of netifcon interface names and fs_use file
+ * system names, and a path trie of genfscon statements for each file
+ * system.  With them, finding the statements that label a given port,
+ * address, interface, or file no longer walks the whole ocontext list.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QPOL_OCON_INDEX_H
+#define QPOL_OCON_INDEX_H
+
+#ifdef	__cplusplus
+extern "C"
+{
+#endif
+
+#include <qpol/policy.h>
+#include <qpol/iterator.h>
+#include <sepol/policydb/policydb.h>
+
+	typedef struct qpol_ocon_index qpol_ocon_index_t;
+
+/**
+ * Build the indexes over a policy's portcon, nodecon, netifcon,
+ * fs_use, and genfscon statements.
+ * @param policy Policy whose statements to index.
+ * @param index Reference pointer to the created index.
+ * @return 0 on success and < 0 on failure; if the call fails,
+ * errno will be set and *index will be NULL.
+ */
+	int qpol_ocon_index_create(const qpol_policy_t * policy, qpol_ocon_index_t ** index);
+
+/**
+ * Free all memory used by an index and set it to NULL.
+ * @param index Reference pointer to the index to destroy.
+ */
+	void qpol_ocon_index_destroy(qpol_ocon_index_t ** index);
+
+/**
+ * Get the policy's index, building it the first time it is needed.
+ * The index is stored with the policy's extended image and is
+ * discarded whenever that image is.  (Implemented in policy_extend.c.)
+ * @param policy Policy whose index to get.
+ * @param index Pointer in which to store the index.  The caller
+ * should not free this pointer.
+ * @return 0 on success and < 0 on failure; if the call fails,
+ * errno will be set and *index will be NULL.
+ */
+	int qpol_ocon_index_get(const qpol_policy_t * policy, const qpol_ocon_index_t ** index);
+
+/**
+ * Find the portcon statements whose port range contains a port.
+ * @param index Index to search.
+ * @param protocol Protocol of the port (IPPROTO_TCP, etc.).
+ * @param port Port number.
+ * @param ocons Pointer in which to store a newly allocated array of
+ * the matching statements, in policy order.  The caller must free()
+ * the array.
+ * @param num Pointer in which to store the number of matches.
+ * @return 0 on success and < 0 on failure; if the call fails,
+ * errno will be set and *ocons will be NULL.
+ */
+	int qpol_ocon_index_find_ports(const qpol_ocon_index_t * index, uint8_t protocol, uint16_t port, ocontext_t *** ocons,
+				       size_t * num);
+
+/**
+ * Find the nodecon statements whose address and mask cover an
+ * address.
+ * @param index Index to search.
+ * @param addr Address, in network byte order; only addr[0] is used
+ * for IPv4.
+ * @param protocol QPOL_IPV4 or QPOL_IPV6.
+ * @param ocons Pointer in which to store a newly allocated array of
+ * the matching statements, in policy order.  The caller must free()
+ * the array.
+ * @param num Pointer in which to store the number of matches.
+ * @return 0 on success and < 0 on failure; if the call fails,
+ * errno will be set and *ocons will be NULL.
+ */
+	int qpol_ocon_index_find_nodes(const qpol_ocon_index_t * index, const uint32_t addr[4], unsigned char protocol,
+				       ocontext_t *** ocons, size_t * num);
+
+/**
+ * Find the first netifcon statement for an interface.
+ * @param index Index to search.
+ * @param name Name of the interface.
+ * @return The statement, or NULL if there is none.
+ */
+	ocontext_t *qpol_ocon_index_find_netif(const qpol_ocon_index_t * index, const char *name);
+
+/**
+ * Find the first fs_use statement for a file system.
+ * @param index Index to search.
+ * @param name Name of the file system.
+ * @return The statement, or NULL if there is none.
+ */
+	ocontext_t *qpol_ocon_index_find_fs_use(const qpol_ocon_index_t * index, const char *name);
+
+/**
+ * Find the genfscon statement that labels a file: of the statements
+ * for the file system whose paths are a prefix of the file's path and
+ * that apply to its class, the one with the longest path.
+ * @param index Index to search.
+ * @param fs_name Name of the file system.
+ * @param path Path of the file, relative to the file system's root.
+ * @param sclass Class value of the file; statements for all classes
+ * and for this class apply.
+ * @param genfs If not NULL, pointer in which to store the file
+ * system's genfs entry, or NULL if there is no match.
+ * @return The statement, or NULL if there is none.
+ */
+	ocontext_t *qpol_ocon_index_find_genfs(const qpol_ocon_index_t * index, const char *fs_name, const char *path,
+					       uint32_t sclass, genfs_t ** genfs);
+
+/**
+ * State of an iterator over an array of statements found in an
+ * index.  The iterator owns the array.
+ */
+	typedef struct ocon_array_state
+	{
+		ocontext_t **ocons;
+		size_t num;
+		size_t cur;
+		/** QPOL_IPV4 or QPOL_IPV6 for nodecon statements */
+		unsigned char protocol;
+	} ocon_array_state_t;
+
+	int ocon_array_state_next(qpol_iterator_t * iter);
+	int ocon_array_state_end(const qpol_iterator_t * iter);
+	size_t ocon_array_state_size(const qpol_iterator_t * iter);
+	void ocon_array_state_free(void *state);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif				       /* QPOL_OCON_INDEX_H */
@@ -36,6 +36,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
 #include <asm/types.h>
 
 #include <sepol/debug.h>
@@ -55,23 +58,16 @@
 #include "expand.h"
 #include "queue.h"
 #include "iterator_internal.h"
+#include "policy_scan.h"
+#include "cond_index.h"
 
-/* redefine input so we can read from a string */
-/* borrowed from O'Reilly lex and yacc pg 157 */
-char *qpol_src_originalinput;
-char *qpol_src_input;
-char *qpol_src_inputptr;	       /* current position in qpol_src_input */
-char *qpol_src_inputlim;	       /* end of data */
-
-extern void init_scanner(void);
-extern int yyparse(void);
-extern void init_parser(int, int);
-extern queue_t id_queue;
-extern unsigned int policydb_errors;
-extern unsigned long policydb_lineno;
-extern char source_file[];
-extern policydb_t *policydbp;
-extern int mlspol;
+/* parser state; see policy_scan.h */
+extern __thread queue_t id_queue;
+extern __thread unsigned int policydb_errors;
+extern __thread unsigned long policydb_lineno;
+extern __thread char source_file[];
+extern __thread policydb_t *policydbp;
+extern __thread int mlspol;
 
 #if __BYTE_ORDER == __LITTLE_ENDIAN
 #define cpu_to_le16(x) (x)
@@ -89,14 +85,6 @@ extern int mlspol;
 #define le64_to_cpu(x) bswap_64(x)
 #endif
 
-/* buffer for reading from file */
-typedef struct fbuf
-{
-	char *buf;
-	size_t sz;
-	int err;
-} qpol_fbuf_t;
-
 static void qpol_handle_route_to_callback(void *varg
 					  __attribute__ ((unused)), const qpol_policy_t * p, int level, const char *fmt,
 					  va_list va_args)
@@ -172,8 +160,18 @@ static void qpol_handle_default_callback(void *varg __attribute__ ((unused)), co
 	fprintf(stderr, "\n");
 }
 
+/**
+ *  Parse the source policy stored within policy->file_data.  The
+ *  scanner and parser state are private to the calling thread, so
+ *  distinct threads may read distinct policies at the same time.
+ *  @param qpolicy Policy whose file_data is to be parsed.
+ *  @param progname Name to use when reporting parse errors.
+ *  @param options Options used to open the policy.
+ *  @return 0 on success, < 0 on error.
+ */
 static int read_source_policy(qpol_policy_t * qpolicy, char *progname, int options)
 {
+	qpol_src_input_t input;
 	int load_rules = 1;
 	if (options & QPOL_POLICY_OPTION_NO_RULES)
 		load_rules = 0;
@@ -185,28 +183,47 @@ static int read_source_policy(qpol_policy_t * qpolicy, char *progname, int optio
 	policydbp = &qpolicy->p->p;
 	mlspol = policydbp->mls;
 
+	input.originalinput = qpolicy->file_data;
+	input.inputptr = input.originalinput;
+	input.inputlim = input.originalinput + qpolicy->file_data_sz - 1;
+
 	INFO(qpolicy, "%s", "Parsing policy. (Step 1 of 5)");
-	init_scanner();
+	if (init_scanner(&input)) {
+		ERR(qpolicy, "%s", strerror(ENOMEM));
+		queue_destroy(id_queue);
+		id_queue = NULL;
+		return -1;
+	}
 	init_parser(1, load_rules);
 	errno = 0;
 	if (yyparse() || policydb_errors) {
 		ERR(qpolicy, "%s:  error(s) encountered while parsing configuration\n", progname);
+		destroy_scanner();
 		queue_destroy(id_queue);
 		id_queue = NULL;
 //		errno = EIO;
 		return -1;
 	}
+	destroy_scanner();
 	/* rewind the pointer */
-	qpol_src_inputptr = qpol_src_originalinput;
+	input.inputptr = input.originalinput;
+	if (init_scanner(&input)) {
+		ERR(qpolicy, "%s", strerror(ENOMEM));
+		queue_destroy(id_queue);
+		id_queue = NULL;
+		return -1;
+	}
 	init_parser(2, load_rules);
 	source_file[0] = '\0';
 	if (yyparse() || policydb_errors) {
 		ERR(qpolicy, "%s:  error(s) encountered while parsing configuration\n", progname);
+		destroy_scanner();
 		queue_destroy(id_queue);
 		id_queue = NULL;
 //		errno = EIO;
 		return -1;
 	}
+	destroy_scanner();
 	queue_destroy(id_queue);
 	id_queue = NULL;
 	if (policydb_errors) {
@@ -216,125 +233,112 @@ static int read_source_policy(qpol_policy_t * qpolicy, char *progname, int optio
 	return 0;
 }
 
-static int qpol_init_fbuf(qpol_fbuf_t ** fb)
+/**
+ *  Parse and link the source policy stored within policy->file_data,
+ *  or read the already linked policy from its snapshot.
+ *  @param policy Source policy to load.
+ *  @param progname Name to use when reporting parse errors.
+ *  @return 0 on success, < 0 on error; if the call fails, errno will
+ *  be set.
+ */
+static int load_source_policy(qpol_policy_t * policy, char *progname)
 {
-	if (fb == NULL)
-		return -1;
-	*fb = (qpol_fbuf_t *) malloc(sizeof(qpol_fbuf_t));
-	if (*fb == NULL)
+	int rt;
+
+	if ((rt = qpol_snapshot_read(policy)) < 0)
 		return -1;
-	(*fb)->buf = NULL;
-	(*fb)->sz = 0;
-	(*fb)->err = 0;
-	return 0;
-}
+	if (rt == 0) {
+		policy->p->p.policy_type = POLICY_BASE;
+		if (read_source_policy(policy, progname, policy->options) < 0)
+			return -1;
 
-static void qpol_free_fbuf(qpol_fbuf_t ** fb)
-{
-	if (*fb == NULL)
-		return;
-	if ((*fb)->sz > 0 && (*fb)->buf != NULL)
-		free((*fb)->buf);
-	free(*fb);
-	return;
+		/* link the source */
+		INFO(policy, "%s", "Linking source policy. (Step 2 of 5)");
+		if (sepol_link_modules(policy->sh, policy->p, NULL, 0, 0)) {
+			errno = EIO;
+			return -1;
+		}
+		/* a snapshot is only an optimization; ignore failures */
+		qpol_snapshot_write(policy);
+	}
+	avtab_destroy(&(policy->p->p.te_avtab));
+	avtab_destroy(&(policy->p->p.te_cond_avtab));
+	avtab_init(&(policy->p->p.te_avtab));
+	avtab_init(&(policy->p->p.te_cond_avtab));
+	return 0;
 }
 
-static void *qpol_read_fbuf(qpol_fbuf_t * fb, size_t bytes, FILE * fp)
+/**
+ * Read the rest of a stream that cannot be mapped into an allocated
+ * buffer.
+ */
+static int read_stream(int fd, char **data, size_t * size)
 {
-	size_t sz;
-
-	assert(fb != NULL && fp != NULL);
-	assert(!(fb->sz > 0 && fb->buf == NULL));
-
-	if (fb->sz == 0) {
-		fb->buf = (char *)malloc(bytes + 1);
-		fb->sz = bytes + 1;
-	} else if (bytes + 1 > fb->sz) {
-		fb->buf = (char *)realloc(fb->buf, bytes + 1);
-		fb->sz = bytes + 1;
-	}
-
-	if (fb->buf == NULL) {
-		fb->err = -1;
-		return NULL;
-	}
-
-	sz = fread(fb->buf, bytes, 1, fp);
-	if (sz != 1) {
-		fb->err = -3;
-		return NULL;
+	size_t cap = 65536, len = 0;
+	char *buf = NULL, *tmp;
+	ssize_t n;
+	int error;
+
+	for (;;) {
+		if (!buf || len == cap) {
+			if (buf)
+				cap *= 2;
+			if (!(tmp = realloc(buf, cap))) {
+				error = errno;
+				free(buf);
+				errno = error;
+				return -1;
+			}
+			buf = tmp;
+		}
+		n = read(fd, buf + len, cap - len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			error = errno;
+			free(buf);
+			errno = error;
+			return -1;
+		}
+		if (n == 0)
+			break;
+		len += n;
 	}
-	fb->err = 0;
-	return fb->buf;
+	*data = buf;
+	*size = len;
+	return 0;
 }
 
-int qpol_binpol_version(FILE * fp)
+int qpol_mmap_file(int fd, char **data, size_t * size, int *data_type)
 {
-	__u32 *buf;
-	int rt, len;
-	qpol_fbuf_t *fb;
-
-	if (fp == NULL)
-		return -1;
+	struct stat sb;
+	void *map;
 
-	if (qpol_init_fbuf(&fb) != 0)
+	*data = NULL;
+	*size = 0;
+	if (fstat(fd, &sb) < 0)
 		return -1;
-
-	/* magic # and sz of policy string */
-	buf = qpol_read_fbuf(fb, sizeof(__u32) * 2, fp);
-	if (buf == NULL) {
-		rt = fb->err;
-		goto err_return;
-	}
-	buf[0] = le32_to_cpu(buf[0]);
-	if (buf[0] != SELINUX_MAGIC) {
-		rt = -2;
-		goto err_return;
-	}
-
-	len = le32_to_cpu(buf[1]);
-	if (len < 0) {
-		rt = -3;
-		goto err_return;
-	}
-	/* skip over the policy string */
-	if (fseek(fp, sizeof(char) * len, SEEK_CUR) != 0) {
-		rt = -3;
-		goto err_return;
-	}
-
-	/* Read the version, config, and table sizes. */
-	buf = qpol_read_fbuf(fb, sizeof(__u32) * 1, fp);
-	if (buf == NULL) {
-		rt = fb->err;
-		goto err_return;
+	if (!S_ISREG(sb.st_mode) || sb.st_size == 0) {
+		if (read_stream(fd, data, size))
+			return -1;
+		*data_type = QPOL_POLICY_FILE_DATA_TYPE_MEM;
+		return 0;
 	}
-	buf[0] = le32_to_cpu(buf[0]);
-
-	rt = buf[0];
-      err_return:
-	rewind(fp);
-	qpol_free_fbuf(&fb);
-	return rt;
+	map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		return -1;
+	*data = map;
+	*size = sb.st_size;
+	*data_type = QPOL_POLICY_FILE_DATA_TYPE_MMAP;
+	return 0;
 }
 
-int qpol_is_file_binpol(FILE * fp)
+void qpol_unmap_file(char *data, size_t size, int data_type)
 {
-	int rt;
-	size_t sz;
-	__u32 ubuf;
-
-	sz = fread(&ubuf, sizeof(__u32), 1, fp);
-	if (sz != 1)
-		rt = 0;
-
-	ubuf = le32_to_cpu(ubuf);
-	if (ubuf == SELINUX_MAGIC)
-		rt = 1;
-	else
-		rt = 0;
-	rewind(fp);
-	return rt;
+	if (data_type == QPOL_POLICY_FILE_DATA_TYPE_MEM)
+		free(data);
+	else if (data_type == QPOL_POLICY_FILE_DATA_TYPE_MMAP && data != NULL)
+		munmap(data, size);
 }
 
 int qpol_is_data_mod_pkg(char * data)
@@ -351,26 +355,6 @@ int qpol_is_data_mod_pkg(char * data)
 	return 0;
 }
 
-int qpol_is_file_mod_pkg(FILE * fp)
-{
-	size_t sz;
-	__u32 ubuf;
-	int rt;
-
-	sz = fread(&ubuf, sizeof(__u32), 1, fp);
-
-	if (sz != 1)
-		rt = 0;		       /* problem reading file */
-
-	ubuf = le32_to_cpu(ubuf);
-	if (ubuf == SEPOL_MODULE_PACKAGE_MAGIC)
-		rt = 1;
-	else
-		rt = 0;
-	rewind(fp);
-	return rt;
-}
-
 static int infer_policy_version(qpol_policy_t * policy)
 {
 	policydb_t *db = NULL;
@@ -735,6 +719,83 @@ __asm__(".symver qpol_policy_rebuild_old,qpol_policy_rebuild@");
 __asm__(".symver qpol_policy_rebuild_opt,qpol_policy_rebuild@@VERS_1.3");
 #endif
 
+uint64_t qpol_hash_bytes(uint64_t hash, const void *data, size_t sz)
+{
+	const unsigned char *p = data;
+	size_t i;
+
+	for (i = 0; i < sz; i++) {
+		hash ^= p[i];
+		hash *= QPOL_HASH_PRIME;
+	}
+	return hash;
+}
+
+/**
+ * Fold an integer into a fingerprint, least significant byte first so
+ * that the fingerprint does not depend upon the host's byte order.
+ */
+static uint64_t policy_fingerprint_add_int(uint64_t hash, uint64_t value)
+{
+	unsigned char buf[8];
+	size_t i;
+
+	for (i = 0; i < sizeof(buf); i++) {
+		buf[i] = (unsigned char)(value >> (8 * i));
+	}
+	return qpol_hash_bytes(hash, buf, sizeof(buf));
+}
+
+/**
+ * Fold an image into a fingerprint, preceded by its length so that
+ * a sequence of images is hashed unambiguously.
+ */
+static uint64_t policy_fingerprint_add_image(uint64_t hash, const char *data, size_t sz)
+{
+	hash = policy_fingerprint_add_int(hash, sz);
+	return qpol_hash_bytes(hash, data, sz);
+}
+
+/**
+ * Set a policy's fingerprint from the library version, its type, the
+ * options that change its contents, and the images from which it was
+ * loaded.
+ * @param policy Policy just loaded or rebuilt.
+ * @param data Image of a kernel binary or source policy, or NULL for
+ * a modular policy, whose base and enabled modules are hashed in
+ * order instead.
+ * @param sz Number of bytes in data.
+ */
+static void policy_set_fingerprint(qpol_policy_t * policy, const char *data, size_t sz)
+{
+	uint64_t hash = QPOL_HASH_BASIS;
+	const qpol_module_t *mod;
+	size_t i;
+
+	/* as with snapshot keys, results computed by another version of
+	 * the library are not to be trusted */
+	hash = policy_fingerprint_add_image(hash, LIBQPOL_VERSION_STRING, strlen(LIBQPOL_VERSION_STRING));
+	hash = policy_fingerprint_add_int(hash, (uint64_t) policy->type);
+	hash = policy_fingerprint_add_int(hash,
+					  (uint64_t) (policy->options &
+						      (QPOL_POLICY_OPTION_NO_NEVERALLOWS | QPOL_POLICY_OPTION_NO_RULES)));
+	if (data != NULL) {
+		hash = policy_fingerprint_add_image(hash, data, sz);
+	} else {
+		for (i = 0; i < policy->num_modules; i++) {
+			mod = policy->modules[i];
+			/* the first module is the base, which is always linked */
+			if (i > 0 && !mod->enabled)
+				continue;
+			/* the image itself may have been dropped, but its
+			 * hash was taken when the module was read */
+			hash = policy_fingerprint_add_int(hash, (uint64_t) mod->image_sz);
+			hash = policy_fingerprint_add_int(hash, mod->image_hash);
+		}
+	}
+	policy->fingerprint = hash;
+}
+
 /**
  * @brief Internal version of qpol_policy_rebuild() version 1.3
  *
@@ -749,6 +810,10 @@ int qpol_policy_rebuild_opt(qpol_policy_t * policy, const int options)
 	qpol_module_t *base = NULL;
 	size_t num_modules = 0, i;
 	int error = 0, old_options;
+	qpol_load_clock_t clock;
+	qpol_load_stats_t old_stats;
+	uint64_t old_fingerprint;
+	double elapsed;
 
 	if (!policy) {
 		ERR(NULL, "%s", strerror(EINVAL));
@@ -756,6 +821,8 @@ int qpol_policy_rebuild_opt(qpol_policy_t * policy, const int options)
 		return STATUS_ERR;
 	}
 
+	QPOL_FAIL_IF_FROZEN(policy, STATUS_ERR);
+
 	/* if kernel binary do nothing */
 	if (policy->type == QPOL_POLICY_KERNEL_BINARY)
 		return STATUS_SUCCESS;
@@ -771,11 +838,15 @@ int qpol_policy_rebuild_opt(qpol_policy_t * policy, const int options)
 	policy->ext = NULL;
 	old_options = policy->options;
 	policy->options = options;
+	old_stats = policy->load_stats;
+	old_fingerprint = policy->fingerprint;
+	qpol_load_stats_reset(policy);
 
 	/* QPOL_POLICY_OPTION_NO_RULES implies QPOL_POLICY_OPTION_NO_NEVERALLOWS */
 	if (policy->options & QPOL_POLICY_OPTION_NO_RULES)
 		policy->options |= QPOL_POLICY_OPTION_NO_NEVERALLOWS;
 
+	qpol_load_clock_start(&clock);
 	if (policy->type == QPOL_POLICY_MODULE_BINARY) {
 		/* allocate enough space for all modules then fill with list of enabled ones only */
 		if (!(modules = calloc(policy->num_modules, sizeof(sepol_policydb_t *)))) {
@@ -789,8 +860,8 @@ int qpol_policy_rebuild_opt(qpol_policy_t * policy, const int options)
 				modules[num_modules++] = (policy->modules[i])->p;
 			}
 		}
-		/* have to reopen the base since link alters it */
-		if (qpol_module_create_from_file((policy->modules[0])->path, &base)) {
+		/* have to read the base again since link alters it */
+		if (qpol_module_reread(policy->modules[0], &base)) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
 			goto err;
@@ -799,11 +870,14 @@ int qpol_policy_rebuild_opt(qpol_policy_t * policy, const int options)
 		policy->p = base->p;
 		base->p = NULL;
 		qpol_module_destroy(&base);
+		INFO(policy, "Read base module in %.3f seconds.", qpol_load_clock_stop(policy, QPOL_LOAD_PHASE_PARSE, &clock));
 		if (sepol_link_modules(policy->sh, policy->p, modules, num_modules, 0)) {
 			error = EIO;
 			goto err;
 		}
 		free(modules);
+		INFO(policy, "Linked %zu modules in %.3f seconds.", num_modules,
+		     qpol_load_clock_stop(policy, QPOL_LOAD_PHASE_LINK, &clock));
 	} else {
 		/* repeat open process as if qpol_policy_open_from_memory() */
 		if (sepol_policydb_create(&(policy->p))) {
@@ -811,55 +885,48 @@ int qpol_policy_rebuild_opt(qpol_policy_t * policy, const int options)
 			goto err;
 		}
 
-		qpol_src_input = policy->file_data;
-		qpol_src_inputptr = qpol_src_input;
-		qpol_src_inputlim = qpol_src_inputptr + policy->file_data_sz - 1;
-		qpol_src_originalinput = qpol_src_input;
-
-		/* read in source */
-		policy->p->p.policy_type = POLICY_BASE;
-		if (read_source_policy(policy, "parse", policy->options) < 0) {
+		/* read in and link source */
+		if (load_source_policy(policy, "parse") < 0) {
 			error = errno;
 			goto err;
 		}
-
-		/* link the source */
-		INFO(policy, "%s", "Linking source policy. (Step 2 of 5)");
-		if (sepol_link_modules(policy->sh, policy->p, NULL, 0, 0)) {
-			error = EIO;
-			goto err;
-		}
-		avtab_destroy(&(policy->p->p.te_avtab));
-		avtab_destroy(&(policy->p->p.te_cond_avtab));
-		avtab_init(&(policy->p->p.te_avtab));
-		avtab_init(&(policy->p->p.te_cond_avtab));
+		INFO(policy, "Parsed source policy in %.3f seconds.", qpol_load_clock_stop(policy, QPOL_LOAD_PHASE_PARSE, &clock));
 	}
 
 	if (prune_disabled_symbols(policy)) {
 		error = errno;
 		goto err;
 	}
+	elapsed = qpol_load_clock_stop(policy, QPOL_LOAD_PHASE_PRUNE_DISABLED_SYMBOLS, &clock);
 
 	if (union_multiply_declared_symbols(policy)) {
 		error = errno;
 		goto err;
 	}
+	elapsed += qpol_load_clock_stop(policy, QPOL_LOAD_PHASE_UNION_MULTIPLY_DECLARED_SYMBOLS, &clock);
+	INFO(policy, "Resolved symbols in %.3f seconds.", elapsed);
 
 	if (qpol_expand_module(policy, !(policy->options & (QPOL_POLICY_OPTION_NO_NEVERALLOWS)))) {
 		error = errno;
 		goto err;
 	}
+	INFO(policy, "Expanded policy in %.3f seconds.", qpol_load_clock_stop(policy, QPOL_LOAD_PHASE_EXPAND, &clock));
 
 	if (infer_policy_version(policy)) {
 		error = errno;
 		goto err;
 	}
+	qpol_load_clock_stop(policy, QPOL_LOAD_PHASE_INFER_POLICY_VERSION, &clock);
 
 	if (policy_extend(policy)) {
 		error = errno;
 		goto err;
 	}
+	INFO(policy, "Built extended policy image in %.3f seconds.",
+	     qpol_load_clock_stop(policy, QPOL_LOAD_PHASE_POLICY_EXTEND, &clock));
 	qpol_extended_image_destroy(&ext);
+	policy_set_fingerprint(policy, (policy->type == QPOL_POLICY_MODULE_BINARY ? NULL : policy->file_data),
+			       policy->file_data_sz);
 
 	sepol_policydb_free(old_p);
 
@@ -871,6 +938,8 @@ int qpol_policy_rebuild_opt(qpol_policy_t * policy, const int options)
 	policy->p = old_p;
 	policy->ext = ext;
 	policy->options = old_options;
+	policy->load_stats = old_stats;
+	policy->fingerprint = old_fingerprint;
 	errno = error;
 	return STATUS_ERR;
 }
@@ -921,8 +990,10 @@ int qpol_policy_open_from_file_opt(const char *path, qpol_policy_t ** policy, qp
 	FILE *infile = NULL;
 	sepol_policy_file_t *pfile = NULL;
 	qpol_module_t *mod = NULL;
-	int fd = 0;
-	struct stat sb;
+	char *file_data = NULL;
+	size_t file_data_sz = 0;
+	int file_data_type = QPOL_POLICY_FILE_DATA_TYPE_BIN;
+	qpol_load_clock_t clock;
 
 	if (policy != NULL)
 		*policy = NULL;
@@ -980,23 +1051,52 @@ int qpol_policy_open_from_file_opt(const char *path, qpol_policy_t ** policy, qp
 
 	sepol_policy_file_set_handle(pfile, (*policy)->sh);
 
+	/* map (or read) the file once; every kind of policy is probed
+	 * for and read from its contents */
+	if (qpol_mmap_file(fileno(infile), &file_data, &file_data_sz, &file_data_type)) {
+		error = errno;
+		ERR(*policy, "Can't read '%s':  %s\n", path, strerror(errno));
+		goto err;
+	}
+	(*policy)->file_data = file_data;
+	(*policy)->file_data_sz = file_data_sz;
+	(*policy)->file_data_type = file_data_type;
+
     errno=0;
-	if (qpol_is_file_binpol(infile)) {
+	qpol_load_clock_start(&clock);
+	if (qpol_is_data_binpol(file_data, file_data_sz)) {
 		(*policy)->type = retv = QPOL_POLICY_KERNEL_BINARY;
-		sepol_policy_file_set_fp(pfile, infile);
+		sepol_policy_file_set_mem(pfile, file_data, file_data_sz);
 		if (sepol_policydb_read((*policy)->p, pfile)) {
 //			error = EIO;
 			goto err;
 		}
+		qpol_load_clock_stop(*policy, QPOL_LOAD_PHASE_PARSE, &clock);
 		/* By definition, binary policy cannot have neverallow rules and all other rules are always loaded. */
 		(*policy)->options |= QPOL_POLICY_OPTION_NO_NEVERALLOWS;
 		(*policy)->options &= ~(QPOL_POLICY_OPTION_NO_RULES);
+		policy_set_fingerprint(*policy, file_data, file_data_sz);
+		/* sepol copied everything it needs; a kernel binary is
+		 * never rebuilt, so release the contents now */
+		qpol_unmap_file(file_data, file_data_sz, file_data_type);
+		(*policy)->file_data = NULL;
+		(*policy)->file_data_sz = 0;
+		(*policy)->file_data_type = QPOL_POLICY_FILE_DATA_TYPE_BIN;
 		if (policy_extend(*policy)) {
 			error = errno;
 			goto err;
 		}
-	} else if (qpol_module_create_from_file(path, &mod) == STATUS_SUCCESS) {
+		qpol_load_clock_stop(*policy, QPOL_LOAD_PHASE_POLICY_EXTEND, &clock);
+	} else if (qpol_module_create_from_data(path, file_data, file_data_sz, file_data_type, &mod) ==
+		   STATUS_SUCCESS || qpol_module_create_from_file(path, &mod) == STATUS_SUCCESS) {
 		(*policy)->type = retv = QPOL_POLICY_MODULE_BINARY;
+		/* either the module now owns the contents, or the file was
+		 * compressed and they are of no further use */
+		if (mod->file_data != file_data)
+			qpol_unmap_file(file_data, file_data_sz, file_data_type);
+		(*policy)->file_data = NULL;
+		(*policy)->file_data_sz = 0;
+		(*policy)->file_data_type = QPOL_POLICY_FILE_DATA_TYPE_BIN;
 
 		if (qpol_policy_append_module(*policy, mod)) {
 			error = errno;
@@ -1010,73 +1110,44 @@ int qpol_policy_open_from_file_opt(const char *path, qpol_policy_t ** policy, qp
 		}
 	} else {
 		(*policy)->type = retv = QPOL_POLICY_KERNEL_SOURCE;
-		fd = fileno(infile);
-		if (fd < 0) {
-			error = errno;
-			goto err;
-		}
-		if (fstat(fd, &sb) < 0) {
-			error = errno;
-			ERR(*policy, "Can't stat '%s':	%s\n", path, strerror(errno));
-			goto err;
-		}
-		qpol_src_input = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
-		if (qpol_src_input == MAP_FAILED) {
-			error = errno;
-			ERR(*policy, "Can't map '%s':  %s\n", path, strerror(errno));
 
-			goto err;
-		}
-		qpol_src_inputptr = qpol_src_input;
-		qpol_src_inputlim = &qpol_src_inputptr[sb.st_size - 1];
-		qpol_src_originalinput = qpol_src_input;
-
-		/* store mmaped version for rebuild() */
-		(*policy)->file_data = qpol_src_originalinput;
-		(*policy)->file_data_sz = sb.st_size;
-		(*policy)->file_data_type = QPOL_POLICY_FILE_DATA_TYPE_MMAP;
-
-		(*policy)->p->p.policy_type = POLICY_BASE;
-		if (read_source_policy(*policy, "libqpol", (*policy)->options) < 0) {
+		/* the mapping is kept for rebuild() */
+		if (load_source_policy(*policy, "libqpol") < 0) {
 			error = errno;
 			goto err;
 		}
-
-		/* link the source */
-		INFO(*policy, "%s", "Linking source policy. (Step 2 of 5)");
-		if (sepol_link_modules((*policy)->sh, (*policy)->p, NULL, 0, 0)) {
-			error = EIO;
-			goto err;
-		}
-		avtab_destroy(&((*policy)->p->p.te_avtab));
-		avtab_destroy(&((*policy)->p->p.te_cond_avtab));
-		avtab_init(&((*policy)->p->p.te_avtab));
-		avtab_init(&((*policy)->p->p.te_cond_avtab));
+		qpol_load_clock_stop(*policy, QPOL_LOAD_PHASE_PARSE, &clock);
 
 		if (prune_disabled_symbols(*policy)) {
 			error = errno;
 			goto err;
 		}
+		qpol_load_clock_stop(*policy, QPOL_LOAD_PHASE_PRUNE_DISABLED_SYMBOLS, &clock);
 
 		if (union_multiply_declared_symbols(*policy)) {
 			error = errno;
 			goto err;
 		}
+		qpol_load_clock_stop(*policy, QPOL_LOAD_PHASE_UNION_MULTIPLY_DECLARED_SYMBOLS, &clock);
 
 		/* expand */
 		if (qpol_expand_module(*policy, !(options & (QPOL_POLICY_OPTION_NO_NEVERALLOWS)))) {
 			error = errno;
 			goto err;
 		}
+		qpol_load_clock_stop(*policy, QPOL_LOAD_PHASE_EXPAND, &clock);
 
 		if (infer_policy_version(*policy)) {
 			error = errno;
 			goto err;
 		}
+		qpol_load_clock_stop(*policy, QPOL_LOAD_PHASE_INFER_POLICY_VERSION, &clock);
 		if (policy_extend(*policy)) {
 			error = errno;
 			goto err;
 		}
+		qpol_load_clock_stop(*policy, QPOL_LOAD_PHASE_POLICY_EXTEND, &clock);
+		policy_set_fingerprint(*policy, file_data, file_data_sz);
 	}
 
 	fclose(infile);
@@ -1116,6 +1187,7 @@ int qpol_policy_open_from_memory_opt(qpol_policy_t ** policy, const char *fileda
 				     const int options)
 {
 	int error = 0;
+	qpol_load_clock_t clock;
 	if (policy == NULL || filedata == NULL)
 		return -1;
 	*policy = NULL;
@@ -1151,12 +1223,7 @@ int qpol_policy_open_from_memory_opt(qpol_policy_t ** policy, const char *fileda
 		goto err;
 	}
 
-	qpol_src_input = (char *)filedata;
-	qpol_src_inputptr = qpol_src_input;
-	qpol_src_inputlim = qpol_src_inputptr + size - 1;
-	qpol_src_originalinput = qpol_src_input;
-
-	/* store filedata for rebuild() */
+	/* store filedata for rebuild(); the copy is also what gets parsed */
 	if (!((*policy)->file_data = malloc(size))) {
 		error = errno;
 		goto err;
@@ -1165,37 +1232,33 @@ int qpol_policy_open_from_memory_opt(qpol_policy_t ** policy, const char *fileda
 	(*policy)->file_data_sz = size;
 	(*policy)->file_data_type = QPOL_POLICY_FILE_DATA_TYPE_MEM;
 
-	/* read in source */
-	(*policy)->p->p.policy_type = POLICY_BASE;
-	if (read_source_policy(*policy, "parse", (*policy)->options) < 0)
-		exit(1);
-
-	/* link the source */
-	INFO(*policy, "%s", "Linking source policy. (Step 2 of 5)");
-	if (sepol_link_modules((*policy)->sh, (*policy)->p, NULL, 0, 0)) {
-		error = EIO;
+	/* read in and link source */
+	qpol_load_clock_start(&clock);
+	if (load_source_policy(*policy, "parse") < 0) {
+		error = errno;
 		goto err;
 	}
-	avtab_destroy(&((*policy)->p->p.te_avtab));
-	avtab_destroy(&((*policy)->p->p.te_cond_avtab));
-	avtab_init(&((*policy)->p->p.te_avtab));
-	avtab_init(&((*policy)->p->p.te_cond_avtab));
+	qpol_load_clock_stop(*policy, QPOL_LOAD_PHASE_PARSE, &clock);
 
 	if (prune_disabled_symbols(*policy)) {
 		error = errno;
 		goto err;
 	}
+	qpol_load_clock_stop(*policy, QPOL_LOAD_PHASE_PRUNE_DISABLED_SYMBOLS, &clock);
 
 	if (union_multiply_declared_symbols(*policy)) {
 		error = errno;
 		goto err;
 	}
+	qpol_load_clock_stop(*policy, QPOL_LOAD_PHASE_UNION_MULTIPLY_DECLARED_SYMBOLS, &clock);
 
 	/* expand */
 	if (qpol_expand_module(*policy, !(options & (QPOL_POLICY_OPTION_NO_NEVERALLOWS)))) {
 		error = errno;
 		goto err;
 	}
+	qpol_load_clock_stop(*policy, QPOL_LOAD_PHASE_EXPAND, &clock);
+	policy_set_fingerprint(*policy, (*policy)->file_data, (*policy)->file_data_sz);
 
 	return 0;
       err:
@@ -1246,11 +1309,7 @@ void qpol_policy_destroy(qpol_policy_t ** policy)
 			}
 			free((*policy)->modules);
 		}
-		if ((*policy)->file_data_type == QPOL_POLICY_FILE_DATA_TYPE_MEM) {
-			free((*policy)->file_data);
-		} else if ((*policy)->file_data_type == QPOL_POLICY_FILE_DATA_TYPE_MMAP) {
-			munmap((*policy)->file_data, (*policy)->file_data_sz);
-		}
+		qpol_unmap_file((*policy)->file_data, (*policy)->file_data_sz, (*policy)->file_data_type);
 		free(*policy);
 		*policy = NULL;
 	}
@@ -1260,7 +1319,6 @@ int qpol_policy_reevaluate_conds(qpol_policy_t * policy)
 {
 	policydb_t *db = NULL;
 	cond_node_t *cond = NULL;
-	cond_av_list_t *list_ptr = NULL;
 
 	if (!policy) {
 		ERR(policy, "%s", strerror(EINVAL));
@@ -1268,6 +1326,8 @@ int qpol_policy_reevaluate_conds(qpol_policy_t * policy)
 		return STATUS_ERR;
 	}
 
+	QPOL_FAIL_IF_FROZEN(policy, STATUS_ERR);
+
 	db = &policy->p->p;
 
 	for (cond = db->cond_list; cond; cond = cond->next) {
@@ -1278,27 +1338,9 @@ int qpol_policy_reevaluate_conds(qpol_policy_t * policy)
 			errno = EILSEQ;
 			return STATUS_ERR;
 		}
-
-		/* walk true list */
-		for (list_ptr = cond->true_list; list_ptr; list_ptr = list_ptr->next) {
-			/* field not used (except by write),
-			 * now storing list and enabled flags */
-			if (cond->cur_state)
-				list_ptr->node->merged |= QPOL_COND_RULE_ENABLED;
-			else
-				list_ptr->node->merged &= ~(QPOL_COND_RULE_ENABLED);
-		}
-
-		/* walk false list */
-		for (list_ptr = cond->false_list; list_ptr; list_ptr = list_ptr->next) {
-			/* field not used (except by write),
-			 * now storing list and enabled flags */
-			if (!cond->cur_state)
-				list_ptr->node->merged |= QPOL_COND_RULE_ENABLED;
-			else
-				list_ptr->node->merged &= ~(QPOL_COND_RULE_ENABLED);
-		}
+		qpol_cond_update_rules(cond);
 	}
+	policy->conds_outdated = 0;
 
 	return STATUS_SUCCESS;
 }
@@ -1313,6 +1355,7 @@ int qpol_policy_append_module(qpol_policy_t * policy, qpol_module_t * module)
 		errno = EINVAL;
 		return STATUS_ERR;
 	}
+	QPOL_FAIL_IF_FROZEN(policy, STATUS_ERR);
 
 	if (!(tmp = realloc(policy->modules, (1 + policy->num_modules) * sizeof(qpol_module_t *)))) {
 		error = errno;
@@ -1485,6 +1528,22 @@ int qpol_policy_get_policy_handle_unknown(const qpol_policy_t * policy, unsigned
 	return STATUS_SUCCESS;
 }
 
+int qpol_policy_get_fingerprint(const qpol_policy_t * policy, uint64_t * fingerprint)
+{
+	if (fingerprint != NULL)
+		*fingerprint = 0;
+
+	if (policy == NULL || fingerprint == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	*fingerprint = policy->fingerprint;
+
+	return STATUS_SUCCESS;
+}
+
 int qpol_policy_get_type(const qpol_policy_t * policy, int *type)
 {
 	if (!policy || !type) {
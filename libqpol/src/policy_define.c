@@ -66,23 +66,25 @@
 #include "module_compiler.h"
 #include "policy_define.h"
 
-policydb_t *policydbp;
-queue_t id_queue = 0;
-unsigned int pass;
-static int load_rules;
-static unsigned int num_rules = 0;
-char *curfile = 0;
-int mlspol = 0;
-
-extern unsigned long policydb_lineno;
-extern unsigned long source_lineno;
-extern unsigned int policydb_errors;
+/* parser state is per thread so that several policies may be parsed
+ * concurrently; see init_parser() */
+__thread policydb_t *policydbp;
+__thread queue_t id_queue = 0;
+__thread unsigned int pass;
+static __thread int load_rules;
+static __thread unsigned int num_rules = 0;
+__thread char *curfile = 0;
+__thread int mlspol = 0;
+
+extern __thread unsigned long policydb_lineno;
+extern __thread unsigned long source_lineno;
+extern __thread unsigned int policydb_errors;
 
 extern int yywarn(char *msg);
 extern int yyerror(char *msg);
 
 #define ERRORMSG_LEN 255
-static char errormsg[ERRORMSG_LEN + 1] = { 0 };
+static __thread char errormsg[ERRORMSG_LEN + 1] = { 0 };
 
 static int id_has_dot(char *id);
 static int parse_security_context(context_struct_t * c);
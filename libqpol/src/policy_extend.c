@@ -44,9 +44,15 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "qpol_internal.h"
 #include "iterator_internal.h"
 #include "syn_rule_internal.h"
+#include "access_matrix_internal.h"
+#include "avtab_index.h"
+#include "cond_index.h"
+#include "ocon_index.h"
+#include "symbol_index.h"
 
 #ifdef SETOOLS_DEBUG
 #include <math.h>
@@ -54,24 +60,12 @@
 
 #define OBJECT_R "object_r"
 
-#define QPOL_SYN_RULE_TABLE_BITS 16
-#define QPOL_SYN_RULE_TABLE_SIZE (1 << QPOL_SYN_RULE_TABLE_BITS)
-#define QPOL_SYN_RULE_TABLE_MASK (QPOL_SYN_RULE_TABLE_SIZE - 1)
-
-/* original hashing function below */
-/*
-#define QPOL_SYN_RULE_TABLE_HASH(rule_key) \
-((rule_key->class_val + \
- (rule_key->target_val << 2) +\
- (rule_key->source_val << 9)) & \
- QPOL_SYN_RULE_TABLE_MASK)
-*/
-
-/* new hashing function, introduced in SETools 3.3 */
-#define QPOL_SYN_RULE_TABLE_HASH(rule_key) \
-(((((rule_key->source_val & 0xff) << 8) | (rule_key->target_val & 0xff)) ^ \
- (rule_key->class_val & 0xf) ^ \
- ((int) ((size_t) rule_key->cond) & 0xfff0)) & QPOL_SYN_RULE_TABLE_MASK)
+/* smallest number of buckets in the syntactic rule table; the table
+ * doubles whenever it holds more nodes than buckets */
+#define QPOL_SYN_RULE_TABLE_MIN_BUCKETS 1024
+
+/* nodes and list entries are carved out of chunks of this many bytes */
+#define QPOL_SYN_RULE_ARENA_CHUNK (64 * 1024)
 
 typedef struct qpol_syn_rule_key
 {
@@ -95,9 +89,42 @@ typedef struct qpol_syn_rule_node
 	struct qpol_syn_rule_node *next;
 } qpol_syn_rule_node_t;
 
+/**
+ * Chunk of memory from which the table's nodes and list entries are
+ * allocated.  They are never freed individually; all chunks are freed
+ * together with the table.
+ */
+typedef struct qpol_syn_rule_chunk
+{
+	struct qpol_syn_rule_chunk *next;
+	size_t used;
+	size_t size;
+	/* storage follows, aligned as below */
+	union
+	{
+		void *p;
+		uint64_t u;
+		double d;
+	} data[1];
+} qpol_syn_rule_chunk_t;
+
 typedef struct qpol_syn_rule_table
 {
 	qpol_syn_rule_node_t **buckets;
+	/** always a power of 2 */
+	size_t num_buckets;
+	size_t num_nodes;
+	qpol_syn_rule_chunk_t *chunks;
+	/** non-zero if keys are added one source type at a time */
+	int lazy;
+	/** for lazy tables, the syntactic rules whose sources include
+	 *  the type with value v are src_rules[src_start[v - 1]] through
+	 *  src_rules[src_start[v] - 1]; src_loaded[v - 1] is set once
+	 *  their keys are in the table */
+	uint32_t num_types;
+	size_t *src_start;
+	struct qpol_syn_rule **src_rules;
+	unsigned char *src_loaded;
 } qpol_syn_rule_table_t;
 
 typedef struct qpol_extended_image
@@ -105,6 +132,11 @@ typedef struct qpol_extended_image
 	qpol_syn_rule_table_t *syn_rule_table;
 	struct qpol_syn_rule **syn_rule_master_list;
 	size_t master_list_sz;
+	qpol_avtab_index_t *avtab_index;
+	qpol_cond_index_t *cond_index;
+	qpol_ocon_index_t *ocon_index;
+	qpol_access_matrix_t *access_matrix;
+	qpol_symbol_index_t *symbol_index;
 } qpol_extended_image_t;
 
 struct extend_bogus_alias_struct
@@ -641,6 +673,7 @@ static int qpol_policy_add_cond_rule_traceback(qpol_policy_t * policy)
 				list_ptr->node->merged |= QPOL_COND_RULE_ENABLED;
 		}
 	}
+	policy->conds_outdated = 0;
 
 	return 0;
 }
@@ -659,60 +692,137 @@ static void qpol_syn_rule_destroy(struct qpol_syn_rule **r)
 }
 
 /**
- *  Free all memory used by a syn rule list.
- *  @param list Reference pointer to the head node of
- *  the syn rule list to destroy. All nodes in the list will
- *  be destroyed.
+ *  Allocate zeroed memory for a node or list entry of the syntactic
+ *  rule table from the table's arena.
+ *  @param table The table from which to allocate.
+ *  @param size Number of bytes to allocate.
+ *  @return Pointer to the memory, or NULL on failure with errno set.
  */
-static void qpol_syn_rule_list_destroy(qpol_syn_rule_list_t ** list)
+static void *qpol_syn_rule_table_alloc(qpol_syn_rule_table_t * table, size_t size)
 {
-	qpol_syn_rule_list_t *cur = NULL, *next = NULL;
-
-	if (!list || !(*list))
-		return;
-
-	for (cur = *list; cur; cur = next) {
-		next = cur->next;
-		free(cur);
-	}
+	qpol_syn_rule_chunk_t *chunk = table->chunks;
+	size_t units = (size + sizeof(chunk->data[0]) - 1) / sizeof(chunk->data[0]);
+	void *mem;
+
+	if (!chunk || chunk->used + units > chunk->size) {
+		size_t chunk_units = QPOL_SYN_RULE_ARENA_CHUNK / sizeof(chunk->data[0]);
+		if (chunk_units < units)
+			chunk_units = units;
+		if (!(chunk = malloc(sizeof(*chunk) + (chunk_units - 1) * sizeof(chunk->data[0]))))
+			return NULL;
+		chunk->used = 0;
+		chunk->size = chunk_units;
+		chunk->next = table->chunks;
+		table->chunks = chunk;
+	}
+	mem = &chunk->data[chunk->used];
+	chunk->used += units;
+	memset(mem, 0, units * sizeof(chunk->data[0]));
+	return mem;
 }
 
 /**
- *  Free all memory used by a syn rule node in the rule table.
- *  @param node Reference pointer to the first node in the chain.
- *  All nodes in the chain will be destroyed.
+ *  Free all memory used by the syntactic rule table.
+ * @param t Reference pointer to the table to destroy.
  */
-static void qpol_syn_rule_node_destroy(qpol_syn_rule_node_t ** node)
+static void qpol_syn_rule_table_destroy(qpol_syn_rule_table_t ** t)
 {
-	qpol_syn_rule_node_t *cur = NULL, *next = NULL;
+	qpol_syn_rule_chunk_t *chunk = NULL, *next = NULL;
 
-	if (!node || !(*node))
+	if (!t || !(*t))
 		return;
 
-	for (cur = *node; cur; cur = next) {
-		next = cur->next;
-		qpol_syn_rule_list_destroy(&cur->rules);
-		free(cur);
+	for (chunk = (*t)->chunks; chunk; chunk = next) {
+		next = chunk->next;
+		free(chunk);
 	}
+
+	free((*t)->buckets);
+	free((*t)->src_start);
+	free((*t)->src_rules);
+	free((*t)->src_loaded);
+	free(*t);
+	*t = NULL;
 }
 
 /**
- *  Free all memory used by the syntactic rule table.
- * @param t Reference pointer to the table to destroy.
+ *  Map a syntactic rule type to the value under which it is stored
+ *  in the table.  Semantic dontaudit rules are stored as auditdeny,
+ *  so both kinds of syntactic rule share one key.
  */
-static void qpol_syn_rule_table_destroy(qpol_syn_rule_table_t ** t)
+static uint32_t qpol_syn_rule_key_type(uint32_t rule_type)
 {
-	size_t i = 0;
+	if (rule_type & (AVRULE_AUDITDENY | AVRULE_DONTAUDIT))
+		return AVRULE_AUDITDENY | AVRULE_DONTAUDIT;
+	return rule_type;
+}
 
-	if (!t || !(*t))
-		return;
+/**
+ *  Hash all fields of a syntactic rule key.  Each field is folded in
+ *  with a 64-bit multiply-xorshift mix, so that every bit of the
+ *  type, class, and conditional values affects the bucket chosen.
+ *  @param key The key to hash.
+ *  @param mask One less than the number of buckets.
+ *  @return Bucket for the key.
+ */
+static size_t qpol_syn_rule_table_hash(const qpol_syn_rule_key_t * key, size_t mask)
+{
+	uint64_t h = qpol_syn_rule_key_type(key->rule_type);
+
+	h = (h << 32) ^ key->class_val;
+	h = (h ^ (h >> 33)) * UINT64_C(0xff51afd7ed558ccd);
+	h ^= ((uint64_t) key->source_val << 32) | key->target_val;
+	h = (h ^ (h >> 33)) * UINT64_C(0xc4ceb9fe1a85ec53);
+	h ^= (uint64_t) (uintptr_t) key->cond;
+	h = (h ^ (h >> 33)) * UINT64_C(0xff51afd7ed558ccd);
+	h ^= h >> 33;
+	return (size_t) h & mask;
+}
 
-	for (i = 0; i < QPOL_SYN_RULE_TABLE_SIZE; i++)
-		qpol_syn_rule_node_destroy(&((*t)->buckets[i]));
+/**
+ *  Allocate the buckets of a syntactic rule table.
+ *  @param table The table whose buckets to allocate.
+ *  @param expected Number of nodes the table is expected to hold.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set.
+ */
+static int qpol_syn_rule_table_init_buckets(qpol_syn_rule_table_t * table, size_t expected)
+{
+	table->num_buckets = QPOL_SYN_RULE_TABLE_MIN_BUCKETS;
+	while (table->num_buckets < expected && table->num_buckets < ((size_t) 1 << (sizeof(size_t) * 8 - 2)))
+		table->num_buckets <<= 1;
+	table->num_nodes = 0;
+	if (!(table->buckets = calloc(table->num_buckets, sizeof(qpol_syn_rule_node_t *))))
+		return -1;
+	return 0;
+}
 
-	free((*t)->buckets);
-	free(*t);
-	*t = NULL;
+/**
+ *  Double the number of buckets of a syntactic rule table, moving
+ *  each node to its new bucket.
+ *  @param table The table to grow.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and the table is unchanged.
+ */
+static int qpol_syn_rule_table_grow(qpol_syn_rule_table_t * table)
+{
+	qpol_syn_rule_node_t **buckets = NULL, *node = NULL, *next = NULL;
+	size_t num_buckets = table->num_buckets << 1, i, hash;
+
+	if (!(buckets = calloc(num_buckets, sizeof(qpol_syn_rule_node_t *))))
+		return -1;
+	for (i = 0; i < table->num_buckets; i++) {
+		for (node = table->buckets[i]; node; node = next) {
+			next = node->next;
+			hash = qpol_syn_rule_table_hash(&node->key, num_buckets - 1);
+			node->next = buckets[hash];
+			buckets[hash] = node;
+		}
+	}
+	free(table->buckets);
+	table->buckets = buckets;
+	table->num_buckets = num_buckets;
+	return 0;
 }
 
 /**
@@ -725,9 +835,12 @@ static qpol_syn_rule_node_t *qpol_syn_rule_table_find_node_by_key(const qpol_syn
 								  const qpol_syn_rule_key_t * key)
 {
 	qpol_syn_rule_node_t *node = NULL;
+	uint32_t rule_type = qpol_syn_rule_key_type(key->rule_type);
 
-	for (node = table->buckets[QPOL_SYN_RULE_TABLE_HASH(key)]; node; node = node->next) {
-		if ((node->key.rule_type & key->rule_type) &&
+	if (!table || !table->buckets)
+		return NULL;
+	for (node = table->buckets[qpol_syn_rule_table_hash(key, table->num_buckets - 1)]; node; node = node->next) {
+		if ((node->key.rule_type == rule_type) &&
 		    (node->key.source_val == key->source_val) &&
 		    (node->key.target_val == key->target_val) &&
 		    (node->key.class_val == key->class_val) && (node->key.cond == key->cond))
@@ -739,8 +852,7 @@ static qpol_syn_rule_node_t *qpol_syn_rule_table_find_node_by_key(const qpol_syn
 
 /**
  *  Given a syn rule key and a syn rule, adds the key/rule pair to the
- *  syn rule table.  Note that this function takes ownership of the
- *  key.
+ *  syn rule table.
  *
  *  @param policy Policy associated with the rule.
  *  @param table The table to which to add the rule.
@@ -755,8 +867,9 @@ static int qpol_syn_rule_table_insert_entry(qpol_policy_t * policy,
 	int error = 0;
 	qpol_syn_rule_node_t *table_node = NULL;
 	qpol_syn_rule_list_t *list_entry = NULL;
+	size_t hash;
 
-	if (!(list_entry = malloc(sizeof(qpol_syn_rule_list_t)))) {
+	if (!(list_entry = qpol_syn_rule_table_alloc(table, sizeof(qpol_syn_rule_list_t)))) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		return -1;
@@ -769,48 +882,77 @@ static int qpol_syn_rule_table_insert_entry(qpol_policy_t * policy,
 		table_node->rules = list_entry;
 	} else {
 		list_entry->next = NULL;
-		if (!(table_node = malloc(sizeof(qpol_syn_rule_node_t)))) {
+		if (table->num_nodes >= table->num_buckets && qpol_syn_rule_table_grow(table)) {
+			error = errno;
+			ERR(policy, "%s", strerror(error));
+			return -1;
+		}
+		if (!(table_node = qpol_syn_rule_table_alloc(table, sizeof(qpol_syn_rule_node_t)))) {
 			error = errno;
 			ERR(policy, "%s", strerror(error));
-			free(list_entry);
 			return -1;
 		}
 		table_node->key = *key;
+		table_node->key.rule_type = qpol_syn_rule_key_type(key->rule_type);
 		table_node->rules = list_entry;
-		size_t hash = QPOL_SYN_RULE_TABLE_HASH(key);
+		hash = qpol_syn_rule_table_hash(key, table->num_buckets - 1);
 		table_node->next = table->buckets[hash];
 		table->buckets[hash] = table_node;
+		table->num_nodes++;
+	}
+	return 0;
+}
+
+/**
+ *  Expand a type set into all of the types it names, whether or not
+ *  its attributes are expanded.
+ *  @param policy Policy associated with the type set.
+ *  @param set The type set to expand.
+ *  @param types Bitmap in which to store the types.  The caller must
+ *  call ebitmap_destroy() afterwards.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and the bitmap will be empty.
+ */
+static int qpol_syn_rule_expand_type_set(qpol_policy_t * policy, type_set_t * set, ebitmap_t * types)
+{
+	ebitmap_t types2;
+
+	ebitmap_init(types);
+	ebitmap_init(&types2);
+	if (type_set_expand(set, types, &policy->p->p, 0) || type_set_expand(set, &types2, &policy->p->p, 1) ||
+	    ebitmap_union(types, &types2)) {
+		ebitmap_destroy(types);
+		ebitmap_destroy(&types2);
+		ERR(policy, "%s", strerror(ENOMEM));
+		errno = ENOMEM;
+		return -1;
 	}
+	ebitmap_destroy(&types2);
 	return 0;
 }
 
 /**
- *  Add a syntactic rule (sepol's avrule_t) to the syntactic rule table.
+ *  Append a syntactic rule (sepol's avrule_t) to the policy's master
+ *  list of syntactic rules.
  *  @param policy Policy associated with the rule.
- *  @param table The table to which to add the rule.
  *  @param rule The rule to add.
  *  @param cond The conditional associated with the rule (NULL if
- *  unconditional).  with the rule (needed for conditional tracking).
+ *  unconditional).
  *  @param branch If the rule is conditional, then 0 if in the true
  *  branch, 1 if in else.
- *  @return 0 on success and < 0 on failure; if the call fails,
- *  errno will be set and the table may be in an inconsistent state.
+ *  @return The new entry in the master list, or NULL on failure; if
+ *  the call fails, errno will be set.
  */
-static int qpol_syn_rule_table_insert_sepol_avrule(qpol_policy_t * policy, qpol_syn_rule_table_t * table, avrule_t * rule,
-						   cond_node_t * cond, int branch)
+static struct qpol_syn_rule *qpol_syn_rule_create(qpol_policy_t * policy, avrule_t * rule, cond_node_t * cond, int branch)
 {
-	int error = 0;
-	qpol_syn_rule_key_t key = { 0, 0, 0, 0, NULL };
 	struct qpol_syn_rule *new_rule = NULL;
-	ebitmap_t source_types, source_types2, target_types, target_types2;
-	ebitmap_node_t *snode = NULL, *tnode = NULL;
-	unsigned int i, j;
-	class_perm_node_t *class_node = NULL;
+	int error = 0;
 
 	if (!(new_rule = malloc(sizeof(struct qpol_syn_rule)))) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
-		goto err;
+		errno = error;
+		return NULL;
 	}
 	new_rule->rule = rule;
 	new_rule->cond = cond;
@@ -819,32 +961,44 @@ static int qpol_syn_rule_table_insert_sepol_avrule(qpol_policy_t * policy, qpol_
 	policy->ext->syn_rule_master_list[policy->ext->master_list_sz] = new_rule;
 	policy->ext->master_list_sz++;
 
-	if (type_set_expand(&rule->stypes, &source_types, &policy->p->p, 0) ||
-	    type_set_expand(&rule->stypes, &source_types2, &policy->p->p, 1)) {
-		ERR(policy, "%s", strerror(ENOMEM));
-		error = ENOMEM;
-		goto err;
-	}
-	if (type_set_expand(&rule->ttypes, &target_types, &policy->p->p, 0) ||
-	    type_set_expand(&rule->ttypes, &target_types2, &policy->p->p, 1)) {
-		ERR(policy, "%s", strerror(ENOMEM));
-		error = ENOMEM;
-		goto err;
-	}
-	if (ebitmap_union(&source_types, &source_types2) || ebitmap_union(&target_types, &target_types2)) {
-		ERR(policy, "%s", strerror(ENOMEM));
-		error = ENOMEM;
-		goto err;
+	return new_rule;
+}
+
+/**
+ *  Add the keys of a syntactic rule to the syntactic rule table.
+ *  @param policy Policy associated with the rule.
+ *  @param table The table to which to add the rule.
+ *  @param new_rule The rule to add.
+ *  @param source_val If non-zero, add only the keys whose source is
+ *  the type with this value.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set and the table may be in an inconsistent state.
+ */
+static int qpol_syn_rule_table_insert_syn_rule(qpol_policy_t * policy, qpol_syn_rule_table_t * table,
+					       struct qpol_syn_rule *new_rule, uint32_t source_val)
+{
+	avrule_t *rule = new_rule->rule;
+	qpol_syn_rule_key_t key = { 0, 0, 0, 0, NULL };
+	ebitmap_t source_types, target_types;
+	ebitmap_node_t *snode = NULL, *tnode = NULL;
+	unsigned int i, j;
+	class_perm_node_t *class_node = NULL;
+
+	if (qpol_syn_rule_expand_type_set(policy, &rule->stypes, &source_types))
+		return -1;
+	if (qpol_syn_rule_expand_type_set(policy, &rule->ttypes, &target_types)) {
+		ebitmap_destroy(&source_types);
+		return -1;
 	}
 	ebitmap_for_each_bit(&source_types, snode, i) {
-		if (!ebitmap_get_bit(&source_types, i))
+		if (!ebitmap_get_bit(&source_types, i) || (source_val && i + 1 != source_val))
 			continue;
 		if (rule->flags & RULE_SELF) {
 			for (class_node = rule->perms; class_node; class_node = class_node->next) {
 				key.rule_type = rule->specified;
 				key.source_val = key.target_val = i + 1;
 				key.class_val = class_node->class;
-				key.cond = cond;
+				key.cond = new_rule->cond;
 				if (qpol_syn_rule_table_insert_entry(policy, table, &key, new_rule))
 					goto err;
 			}
@@ -857,7 +1011,7 @@ static int qpol_syn_rule_table_insert_sepol_avrule(qpol_policy_t * policy, qpol_
 				key.source_val = i + 1;
 				key.target_val = j + 1;
 				key.class_val = class_node->class;
-				key.cond = cond;
+				key.cond = new_rule->cond;
 				if (qpol_syn_rule_table_insert_entry(policy, table, &key, new_rule))
 					goto err;
 			}
@@ -865,32 +1019,186 @@ static int qpol_syn_rule_table_insert_sepol_avrule(qpol_policy_t * policy, qpol_
 	}
 
 	ebitmap_destroy(&source_types);
-	ebitmap_destroy(&source_types2);
 	ebitmap_destroy(&target_types);
-	ebitmap_destroy(&target_types2);
 	return 0;
 
       err:
 	ebitmap_destroy(&source_types);
-	ebitmap_destroy(&source_types2);
 	ebitmap_destroy(&target_types);
-	ebitmap_destroy(&target_types2);
 	return -1;
 }
 
-int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
+/**
+ *  Index the master list of syntactic rules by source type, so that a
+ *  lazily built table can add the keys of one source type without
+ *  examining every syntactic rule.
+ *  @param policy Policy whose master list to index.
+ *  @param table The table in which to store the index.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set.
+ */
+static int qpol_syn_rule_table_index_sources(qpol_policy_t * policy, qpol_syn_rule_table_t * table)
+{
+	struct qpol_syn_rule *rule = NULL;
+	ebitmap_t types;
+	ebitmap_node_t *node = NULL;
+	unsigned int bit;
+	size_t *fill = NULL, i;
+	uint32_t v;
+	int pass, error = 0;
+
+	table->num_types = policy->p->p.p_types.nprim;
+	if (!(table->src_start = calloc(table->num_types + 1, sizeof(size_t))) ||
+	    !(table->src_loaded = calloc(table->num_types + 1, sizeof(unsigned char))) ||
+	    !(fill = malloc((table->num_types + 1) * sizeof(size_t)))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		goto err;
+	}
+
+	/* count the rules for each source type, then place them */
+	for (pass = 0; pass < 2; pass++) {
+		if (pass == 1) {
+			for (v = 1; v <= table->num_types; v++)
+				table->src_start[v] += table->src_start[v - 1];
+			if (!(table->src_rules = malloc((table->src_start[table->num_types] + 1) * sizeof(struct qpol_syn_rule *)))) {
+				error = errno;
+				ERR(policy, "%s", strerror(error));
+				goto err;
+			}
+			memcpy(fill, table->src_start, (table->num_types + 1) * sizeof(size_t));
+		}
+		for (i = 0; i < policy->ext->master_list_sz; i++) {
+			rule = policy->ext->syn_rule_master_list[i];
+			if (qpol_syn_rule_expand_type_set(policy, &rule->rule->stypes, &types)) {
+				error = errno;
+				goto err;
+			}
+			ebitmap_for_each_bit(&types, node, bit) {
+				if (!ebitmap_node_get_bit(node, bit) || bit >= table->num_types)
+					continue;
+				if (pass == 0)
+					table->src_start[bit + 1]++;
+				else
+					table->src_rules[fill[bit]++] = rule;
+			}
+			ebitmap_destroy(&types);
+		}
+	}
+
+	free(fill);
+	return 0;
+
+      err:
+	free(fill);
+	errno = error;
+	return -1;
+}
+
+/**
+ *  Remove from a lazily built table every key whose source is the
+ *  given type, undoing a load of that type which failed partway.
+ *  Only a load adds keys of a type, so the keys removed are exactly
+ *  those it added; their memory stays in the table's chunks until the
+ *  table is destroyed.
+ *  @param table The table from which to remove keys.
+ *  @param source_val Value of the source type.
+ */
+static void qpol_syn_rule_table_unload_source(qpol_syn_rule_table_t * table, uint32_t source_val)
+{
+	qpol_syn_rule_node_t **link, *node;
+	size_t i;
+
+	for (i = 0; i < table->num_buckets; i++) {
+		for (link = &table->buckets[i]; (node = *link) != NULL;) {
+			if (node->key.source_val == source_val) {
+				*link = node->next;
+				table->num_nodes--;
+			} else {
+				link = &node->next;
+			}
+		}
+	}
+}
+
+/**
+ *  For a lazily built table, add the keys of every syntactic rule
+ *  whose source is the given type, unless they were added before.
+ *  Does nothing for a table that was fully built.
+ *  @param policy Policy associated with the table.
+ *  @param table The table to which to add keys.
+ *  @param source_val Value of the source type.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set.
+ */
+static int qpol_syn_rule_table_load_source(qpol_policy_t * policy, qpol_syn_rule_table_t * table, uint32_t source_val)
+{
+	size_t i;
+	int error;
+
+	if (!table || !table->lazy || source_val < 1 || source_val > table->num_types || table->src_loaded[source_val - 1])
+		return 0;
+
+	for (i = table->src_start[source_val - 1]; i < table->src_start[source_val]; i++) {
+		if (qpol_syn_rule_table_insert_syn_rule(policy, table, table->src_rules[i], source_val)) {
+			error = errno;
+			qpol_syn_rule_table_unload_source(table, source_val);
+			errno = error;
+			return -1;
+		}
+	}
+	table->src_loaded[source_val - 1] = 1;
+
+	return 0;
+}
+
+/**
+ *  Find the node of a policy's syntactic rule table with the given
+ *  key.  The table is a cache of the syntactic rules, so a lazily
+ *  built table gets the keys of the key's source type on first use,
+ *  even through a const policy.
+ *  @param policy Policy whose table to search.
+ *  @param key The key for which to search.
+ *  @return The node, or NULL on failure; if the call fails, errno
+ *  will be set (ENOENT if no syntactic rule has the key).
+ */
+static qpol_syn_rule_node_t *qpol_syn_rule_table_lookup(const qpol_policy_t * policy, const qpol_syn_rule_key_t * key)
+{
+	qpol_syn_rule_node_t *node;
+
+	if (qpol_syn_rule_table_load_source((qpol_policy_t *) policy, policy->ext->syn_rule_table, key->source_val))
+		return NULL;
+	if (!(node = qpol_syn_rule_table_find_node_by_key(policy->ext->syn_rule_table, key)))
+		errno = ENOENT;
+	return node;
+}
+
+/**
+ *  Build the table of syntactic rules for a policy.
+ *  @param policy The policy for which to build the table.
+ *  @param lazy If non-zero, only list and index the syntactic rules
+ *  now, deferring the keys of each source type until a lookup first
+ *  needs them.
+ *  @return 0 on success and < 0 on error; if the call fails,
+ *  errno will be set.
+ */
+static int qpol_policy_build_syn_rule_table_mode(qpol_policy_t * policy, int lazy)
 {
 	int error = 0, created = 0;
 	avrule_block_t *cur_block = NULL;
 	avrule_decl_t *decl = NULL;
 	avrule_t *cur_rule = NULL;
 	cond_node_t *cur_cond = NULL, *remapped_cond;
+	struct qpol_syn_rule *new_rule = NULL;
+	qpol_syn_rule_table_t *table = NULL;
+	qpol_load_clock_t clock;
 
 	if (!policy) {
 		ERR(policy, "%s", strerror(EINVAL));
 		errno = EINVAL;
 		return -1;
 	}
+	qpol_load_clock_start(&clock);
 
 	if (!policy->ext) {
 		policy->ext = calloc(1, sizeof(qpol_extended_image_t));
@@ -904,14 +1212,8 @@ int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
 	if (policy->ext->syn_rule_table)
 		return 0;	       /* already built */
 
-	policy->ext->syn_rule_table = calloc(1, sizeof(qpol_syn_rule_table_t));
-	if (!policy->ext->syn_rule_table) {
-		error = errno;
-		ERR(policy, "%s", strerror(error));
-		goto err;
-	}
-	policy->ext->syn_rule_table->buckets = calloc(QPOL_SYN_RULE_TABLE_SIZE, sizeof(qpol_syn_rule_node_t *));
-	if (!policy->ext->syn_rule_table->buckets) {
+	table = policy->ext->syn_rule_table = calloc(1, sizeof(qpol_syn_rule_table_t));
+	if (!table) {
 		error = errno;
 		ERR(policy, "%s", strerror(error));
 		goto err;
@@ -941,7 +1243,15 @@ int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
 		return 0;	       /* policy is not a source policy */
 	}
 
-	INFO(policy, "%s", "Building syntactic rules tables.");
+	INFO(policy, "%s", (lazy ? "Indexing syntactic rules." : "Building syntactic rules tables."));
+
+	/* every syntactic rule yields at least one key; the table grows
+	 * from there as rules over sets of types are expanded */
+	if (qpol_syn_rule_table_init_buckets(table, (lazy ? 0 : policy->ext->master_list_sz))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		goto err;
+	}
 
 	policy->ext->syn_rule_master_list = calloc(policy->ext->master_list_sz, sizeof(struct qpol_syn_rule *));
 	if (!policy->ext->syn_rule_master_list) {
@@ -959,7 +1269,8 @@ int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
 			continue;
 
 		for (cur_rule = decl->avrules; cur_rule; cur_rule = cur_rule->next) {
-			if (qpol_syn_rule_table_insert_sepol_avrule(policy, policy->ext->syn_rule_table, cur_rule, NULL, 0)) {
+			if (!(new_rule = qpol_syn_rule_create(policy, cur_rule, NULL, 0)) ||
+			    (!lazy && qpol_syn_rule_table_insert_syn_rule(policy, table, new_rule, 0))) {
 				error = errno;
 				goto err;
 			}
@@ -976,15 +1287,15 @@ int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
 				goto err;
 			}
 			for (cur_rule = cur_cond->avtrue_list; cur_rule; cur_rule = cur_rule->next) {
-				if (qpol_syn_rule_table_insert_sepol_avrule
-				    (policy, policy->ext->syn_rule_table, cur_rule, remapped_cond, 0)) {
+				if (!(new_rule = qpol_syn_rule_create(policy, cur_rule, remapped_cond, 0)) ||
+				    (!lazy && qpol_syn_rule_table_insert_syn_rule(policy, table, new_rule, 0))) {
 					error = errno;
 					goto err;
 				}
 			}
 			for (cur_rule = cur_cond->avfalse_list; cur_rule; cur_rule = cur_rule->next) {
-				if (qpol_syn_rule_table_insert_sepol_avrule
-				    (policy, policy->ext->syn_rule_table, cur_rule, remapped_cond, 1)) {
+				if (!(new_rule = qpol_syn_rule_create(policy, cur_rule, remapped_cond, 1)) ||
+				    (!lazy && qpol_syn_rule_table_insert_syn_rule(policy, table, new_rule, 0))) {
 					error = errno;
 					goto err;
 				}
@@ -992,6 +1303,16 @@ int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
 		}
 	}
 
+	if (lazy) {
+		if (qpol_syn_rule_table_index_sources(policy, table)) {
+			error = errno;
+			goto err;
+		}
+		table->lazy = 1;
+		qpol_load_clock_stop(policy, QPOL_LOAD_PHASE_SYN_RULE_TABLE, &clock);
+		return 0;
+	}
+
 #ifdef SETOOLS_DEBUG
 	/*
 	 * Debugging code to measure the how well the syntactic rules
@@ -1000,20 +1321,12 @@ int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
 	 */
 	size_t bucket;
 	float o2 = 0.0f;
-	long total_entries = 0;
-	for (bucket = 0; bucket < QPOL_SYN_RULE_TABLE_SIZE; bucket++) {
-		qpol_syn_rule_node_t *n = policy->ext->syn_rule_table->buckets[bucket];
-		while (n != NULL) {
-			total_entries++;
-			n = n->next;
-		}
-	}
-	float expected_value = total_entries * 1.0f / QPOL_SYN_RULE_TABLE_SIZE;
-	size_t min_items = total_entries;
+	float expected_value = table->num_nodes * 1.0f / table->num_buckets;
+	size_t min_items = table->num_nodes;
 	size_t max_items = 0;
-	for (bucket = 0; bucket < QPOL_SYN_RULE_TABLE_SIZE; bucket++) {
+	for (bucket = 0; bucket < table->num_buckets; bucket++) {
 		size_t num_items = 0;
-		qpol_syn_rule_node_t *n = policy->ext->syn_rule_table->buckets[bucket];
+		qpol_syn_rule_node_t *n = table->buckets[bucket];
 		while (n != NULL) {
 			num_items++;
 			n = n->next;
@@ -1026,12 +1339,13 @@ int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
 		}
 		o2 += (num_items - expected_value) * (num_items - expected_value);
 	}
-	float stddev = sqrtf(o2 / (QPOL_SYN_RULE_TABLE_SIZE - 1));
-	fprintf(stderr, "libqpol synrule table %d bits:  total entries %lu, expected %g\n", QPOL_SYN_RULE_TABLE_BITS, total_entries,
+	float stddev = sqrtf(o2 / (table->num_buckets - 1));
+	fprintf(stderr, "libqpol synrule table %zu buckets:  total entries %zu, expected %g\n", table->num_buckets, table->num_nodes,
 		expected_value);
-	fprintf(stderr, "                        min %zd, max %zd, stddev %g\n", min_items, max_items, stddev);
+	fprintf(stderr, "                        min %zu, max %zu, stddev %g\n", min_items, max_items, stddev);
 #endif
 
+	qpol_load_clock_stop(policy, QPOL_LOAD_PHASE_SYN_RULE_TABLE, &clock);
 	return 0;
 
       err:
@@ -1041,6 +1355,205 @@ int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
 	return -1;
 }
 
+int qpol_policy_build_syn_rule_table(qpol_policy_t * policy)
+{
+	return qpol_policy_build_syn_rule_table_mode(policy, 0);
+}
+
+int qpol_policy_build_syn_rule_table_lazy(qpol_policy_t * policy)
+{
+	return qpol_policy_build_syn_rule_table_mode(policy, 1);
+}
+
+int qpol_syn_rule_get_master_list(const qpol_policy_t * policy, struct qpol_syn_rule *const **list, size_t * num)
+{
+	if (list)
+		*list = NULL;
+	if (num)
+		*num = 0;
+	if (!policy || !list || !num) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+	if (!policy->ext || !policy->ext->syn_rule_table) {
+		ERR(policy, "%s", "Syntactic rules table has not been built");
+		errno = EINVAL;
+		return -1;
+	}
+
+	*list = policy->ext->syn_rule_master_list;
+	*num = policy->ext->master_list_sz;
+	return 0;
+}
+
+int qpol_policy_freeze(qpol_policy_t * policy)
+{
+	const qpol_avtab_index_t *avtab_index;
+	const qpol_cond_index_t *cond_index;
+	const qpol_ocon_index_t *ocon_index;
+	qpol_syn_rule_table_t *table;
+	uint32_t i;
+
+	if (!policy) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	if (policy->frozen)
+		return STATUS_SUCCESS;
+
+	if (policy->conds_outdated && qpol_policy_reevaluate_conds(policy))
+		return STATUS_ERR;
+
+	/* build every structure that a query would otherwise build on
+	 * first use; a lazily built syntactic rule table has the rest
+	 * of its sources loaded */
+	if (qpol_policy_has_capability(policy, QPOL_CAP_SYN_RULES) && qpol_policy_has_capability(policy, QPOL_CAP_RULES_LOADED) &&
+	    qpol_policy_build_syn_rule_table(policy))
+		return STATUS_ERR;
+	if (policy->ext && (table = policy->ext->syn_rule_table) != NULL && table->lazy) {
+		for (i = 1; i <= table->num_types; i++) {
+			if (qpol_syn_rule_table_load_source(policy, table, i))
+				return STATUS_ERR;
+		}
+	}
+	if (qpol_avtab_index_get(policy, &avtab_index) || qpol_cond_index_get(policy, &cond_index) ||
+	    qpol_ocon_index_get(policy, &ocon_index))
+		return STATUS_ERR;
+
+	policy->frozen = 1;
+	return STATUS_SUCCESS;
+}
+
+int qpol_policy_is_frozen(const qpol_policy_t * policy)
+{
+	return (policy != NULL && policy->frozen);
+}
+
+const qpol_symbol_index_t *qpol_symbol_index_get(const qpol_policy_t * policy)
+{
+	if (!policy || !policy->ext)
+		return NULL;
+	return policy->ext->symbol_index;
+}
+
+int qpol_avtab_index_get(const qpol_policy_t * policy, const qpol_avtab_index_t ** index)
+{
+	qpol_policy_t *p = (qpol_policy_t *) policy;
+	int error = 0;
+
+	if (index)
+		*index = NULL;
+	if (!policy || !index) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* the index is a cache of the (otherwise unchanged) rule
+	 * tables, so build it on first use even for const handles */
+	if (!p->ext) {
+		p->ext = calloc(1, sizeof(qpol_extended_image_t));
+		if (!p->ext) {
+			error = errno;
+			ERR(policy, "%s", strerror(error));
+			errno = error;
+			return -1;
+		}
+	}
+	if (!p->ext->avtab_index) {
+		INFO(policy, "%s", "Building rule index.");
+		if (qpol_avtab_index_create(policy, &p->ext->avtab_index))
+			return -1;
+	}
+
+	*index = p->ext->avtab_index;
+	return 0;
+}
+
+int qpol_cond_index_get(const qpol_policy_t * policy, const qpol_cond_index_t ** index)
+{
+	qpol_policy_t *p = (qpol_policy_t *) policy;
+	int error = 0;
+
+	if (index)
+		*index = NULL;
+	if (!policy || !index) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* as with the rule index, the conditionals do not change once
+	 * loaded, so build on first use even for const handles */
+	if (!p->ext) {
+		p->ext = calloc(1, sizeof(qpol_extended_image_t));
+		if (!p->ext) {
+			error = errno;
+			ERR(policy, "%s", strerror(error));
+			errno = error;
+			return -1;
+		}
+	}
+	if (!p->ext->cond_index) {
+		if (qpol_cond_index_create(policy, &p->ext->cond_index))
+			return -1;
+	}
+
+	*index = p->ext->cond_index;
+	return 0;
+}
+
+int qpol_ocon_index_get(const qpol_policy_t * policy, const qpol_ocon_index_t ** index)
+{
+	qpol_policy_t *p = (qpol_policy_t *) policy;
+	int error = 0;
+
+	if (index)
+		*index = NULL;
+	if (!policy || !index) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (!p->ext) {
+		p->ext = calloc(1, sizeof(qpol_extended_image_t));
+		if (!p->ext) {
+			error = errno;
+			ERR(policy, "%s", strerror(error));
+			errno = error;
+			return -1;
+		}
+	}
+	if (!p->ext->ocon_index) {
+		if (qpol_ocon_index_create(policy, &p->ext->ocon_index))
+			return -1;
+	}
+
+	*index = p->ext->ocon_index;
+	return 0;
+}
+
+qpol_access_matrix_t **qpol_access_matrix_slot(const qpol_policy_t * policy, int create)
+{
+	qpol_policy_t *p = (qpol_policy_t *) policy;
+
+	if (!policy) {
+		errno = EINVAL;
+		return NULL;
+	}
+	if (!p->ext) {
+		if (!create)
+			return NULL;
+		p->ext = calloc(1, sizeof(qpol_extended_image_t));
+		if (!p->ext)
+			return NULL;
+	}
+	return &p->ext->access_matrix;
+}
+
 /**
  *  Free all memory used by a qpol extended image and set it to NULL.
  *  @param ext The extended image to destroy.
@@ -1059,6 +1572,12 @@ void qpol_extended_image_destroy(qpol_extended_image_t ** ext)
 	}
 	free((*ext)->syn_rule_master_list);
 
+	qpol_avtab_index_destroy(&((*ext)->avtab_index));
+	qpol_cond_index_destroy(&((*ext)->cond_index));
+	qpol_ocon_index_destroy(&((*ext)->ocon_index));
+	qpol_access_matrix_destroy(&((*ext)->access_matrix));
+	qpol_symbol_index_destroy(&((*ext)->symbol_index));
+
 	free(*ext);
 	*ext = NULL;
 }
@@ -1111,6 +1630,18 @@ int policy_extend(qpol_policy_t * policy)
 		goto err;
 	}
 
+	/* the symbol tables are final now, so index them for lookups */
+	if (!policy->ext && !(policy->ext = calloc(1, sizeof(qpol_extended_image_t)))) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		goto err;
+	}
+	qpol_symbol_index_destroy(&policy->ext->symbol_index);
+	if (qpol_symbol_index_create(policy, &policy->ext->symbol_index)) {
+		error = errno;
+		goto err;
+	}
+
 	if (policy->options & QPOL_POLICY_OPTION_NO_RULES)
 		return STATUS_SUCCESS;
 
@@ -1269,10 +1800,10 @@ int qpol_avrule_get_syn_avrule_iter(const qpol_policy_t * policy, const struct q
 		goto err;
 	}
 
-	srs->node = qpol_syn_rule_table_find_node_by_key(policy->ext->syn_rule_table, key);
-	if (!srs->node) {
-		ERR(policy, "%s", "Unable to locate syntactic rules for semantic av rule");
-		errno = ENOENT;
+	if (!(srs->node = qpol_syn_rule_table_lookup(policy, key))) {
+		error = errno;
+		if (error == ENOENT)
+			ERR(policy, "%s", "Unable to locate syntactic rules for semantic av rule");
 		goto err;
 	}
 	srs->cur = srs->node->rules;
@@ -1370,10 +1901,10 @@ int qpol_terule_get_syn_terule_iter(const qpol_policy_t * policy, const struct q
 		goto err;
 	}
 
-	srs->node = qpol_syn_rule_table_find_node_by_key(policy->ext->syn_rule_table, key);
-	if (!srs->node) {
-		ERR(policy, "%s", "Unable to locate syntactic rules for semantic te rule");
-		error = ENOENT;
+	if (!(srs->node = qpol_syn_rule_table_lookup(policy, key))) {
+		error = errno;
+		if (error == ENOENT)
+			ERR(policy, "%s", "Unable to locate syntactic rules for semantic te rule");
 		goto err;
 	}
 	srs->cur = srs->node->rules;
@@ -64,24 +64,22 @@
 #include "module_compiler.h"
 #include "policy_define.h"
 
-extern policydb_t *policydbp;
-extern unsigned int pass;
+extern __thread policydb_t *policydbp;
+extern __thread unsigned int pass;
 
-extern char yytext[];
-extern int yylex(void);
+/* the scanner is reentrant; these operate upon the calling thread's
+ * scanner as set up by init_scanner() */
+extern char *qpol_src_yytext(void);
+extern int yylex(void *lvalp);
 extern int yywarn(char *msg);
 extern int yyerror(char *msg);
 
 typedef int (* require_func_t)();
 
-/* redefine input so we can read from a string */
-/* borrowed from O'Reilly lex and yacc pg 157 */
-extern char qpol_src_input[];
-extern char *qpol_src_inputptr;/* current position in qpol_src_input */
-extern char *qpol_src_inputlim;/* end of data */
-
 %}
 
+%define api.pure
+
 %union {
 	unsigned int val;
 	uintptr_t valptr;
@@ -685,7 +683,7 @@ genfs_context_def	: GENFSCON identifier path '-' identifier security_context_def
 			{if (define_genfs_context(0)) return -1;}
 			;
 ipv4_addr_def		: IPV4_ADDR
-			{ if (insert_id(yytext,0)) return -1; }
+			{ if (insert_id(qpol_src_yytext(),0)) return -1; }
 			;
 security_context_def	: identifier ':' identifier ':' identifier opt_mls_range_def
 	                ;
@@ -741,7 +739,7 @@ identifier_list_push	: identifier_push
 			| identifier_list_push identifier_push
 			;
 identifier_push		: IDENTIFIER
-			{ if (insert_id(yytext, 1)) return -1; }
+			{ if (insert_id(qpol_src_yytext(), 1)) return -1; }
 			;
 identifier_list		: identifier
 			| identifier_list identifier
@@ -753,19 +751,19 @@ nested_id_list          : nested_id_element | nested_id_list nested_id_element
 nested_id_element       : identifier | '-' { if (insert_id("-", 0)) return -1; } identifier | nested_id_set
                         ;
 identifier		: IDENTIFIER
-			{ if (insert_id(yytext,0)) return -1; }
+			{ if (insert_id(qpol_src_yytext(),0)) return -1; }
 			;
 path     		: PATH
-			{ if (insert_id(yytext,0)) return -1; }
+			{ if (insert_id(qpol_src_yytext(),0)) return -1; }
 			;
 filename		: FILENAME
-			{ yytext[strlen(yytext) - 1] = '\0'; if (insert_id(yytext + 1,0)) return -1; }
+			{ char *id = qpol_src_yytext(); id[strlen(id) - 1] = '\0'; if (insert_id(id + 1,0)) return -1; }
 			;
 number			: NUMBER 
-			{ $$ = strtoul(yytext,NULL,0); }
+			{ $$ = strtoul(qpol_src_yytext(),NULL,0); }
 			;
 ipv6_addr		: IPV6_ADDR
-			{ if (insert_id(yytext,0)) return -1; }
+			{ if (insert_id(qpol_src_yytext(),0)) return -1; }
 			;
 policycap_def		: POLICYCAP identifier ';'
 			{if (define_polcap()) return -1;}
@@ -784,7 +782,7 @@ module_def              : MODULE identifier version_identifier ';'
                         { if (define_policy(pass, 1) == -1) return -1; }
                         ;
 version_identifier      : VERSION_IDENTIFIER
-                        { if (insert_id(yytext,0)) return -1; }
+                        { if (insert_id(qpol_src_yytext(),0)) return -1; }
                         | ipv4_addr_def /* version can look like ipv4 address */
                         ;
 avrules_block           : avrule_decls avrule_user_defs
@@ -0,0 +1,86 @@
+/**
+ * @file
+ *
+ * Interface between libqpol and its reentrant source policy scanner.
+ * Each load of a source policy owns its own input cursor and scanner;
+ * all other parser state is kept per thread, so that distinct threads
+ * may parse distinct policies at the same time.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QPOL_POLICY_SCAN_H
+#define QPOL_POLICY_SCAN_H
+
+#ifdef	__cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Input cursor for one load of a source policy.  The scanner reads
+ * from this buffer instead of from a FILE.
+ */
+	typedef struct qpol_src_input
+	{
+		/** start of the policy text */
+		char *originalinput;
+		/** current position within the policy text */
+		char *inputptr;
+		/** end of data */
+		char *inputlim;
+	} qpol_src_input_t;
+
+/**
+ * Create a scanner for the calling thread that reads from the given
+ * input.  Every successful call must be paired with a call to
+ * destroy_scanner() from the same thread.
+ *
+ * @param input Input cursor to scan; the caller retains ownership and
+ * must keep it valid until destroy_scanner() is called.
+ * @return 0 on success, < 0 on error.
+ */
+	extern int init_scanner(qpol_src_input_t * input);
+
+/**
+ * Destroy the calling thread's scanner created by init_scanner().
+ * Does nothing if the thread has no scanner.
+ */
+	extern void destroy_scanner(void);
+
+/**
+ * Initialize the calling thread's parser state prior to calling
+ * yyparse().
+ *
+ * @param pass_number Parser pass, either 1 or 2.
+ * @param do_rules If non-zero then load rules, else skip them.
+ */
+	extern void init_parser(int pass_number, int do_rules);
+
+/**
+ * Parse the input given to init_scanner() using the calling thread's
+ * scanner and parser state.
+ *
+ * @return 0 on success, non-zero on error.
+ */
+	extern int yyparse(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif				       /* QPOL_POLICY_SCAN_H */
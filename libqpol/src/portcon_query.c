@@ -34,6 +34,7 @@
 #include <sepol/policydb/policydb.h>
 #include "qpol_internal.h"
 #include "iterator_internal.h"
+#include "ocon_index.h"
 
 int qpol_policy_get_portcon_by_port(const qpol_policy_t * policy, uint16_t low, uint16_t high, uint8_t protocol,
 				    const qpol_portcon_t ** ocon)
@@ -103,6 +104,95 @@ int qpol_policy_get_portcon_iter(const qpol_policy_t * policy, qpol_iterator_t *
 	return STATUS_SUCCESS;
 }
 
+static void *ocon_array_state_get_cur_port(const qpol_iterator_t * iter)
+{
+	ocon_array_state_t *state;
+
+	if (iter == NULL || (state = qpol_iterator_state(iter)) == NULL || state->cur >= state->num) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return state->ocons[state->cur];
+}
+
+int qpol_policy_get_portcon_iter_by_port(const qpol_policy_t * policy, uint8_t protocol, uint16_t port, qpol_iterator_t ** iter)
+{
+	const qpol_ocon_index_t *index = NULL;
+	ocon_array_state_t *os = NULL;
+	int error = 0;
+
+	if (iter != NULL)
+		*iter = NULL;
+
+	if (policy == NULL || iter == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (qpol_ocon_index_get(policy, &index))
+		return STATUS_ERR;
+
+	os = calloc(1, sizeof(ocon_array_state_t));
+	if (os == NULL) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		errno = error;
+		return STATUS_ERR;
+	}
+	if (qpol_ocon_index_find_ports(index, protocol, port, &os->ocons, &os->num)) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		free(os);
+		errno = error;
+		return STATUS_ERR;
+	}
+
+	if (qpol_iterator_create(policy, (void *)os, ocon_array_state_get_cur_port,
+				 ocon_array_state_next, ocon_array_state_end, ocon_array_state_size, ocon_array_state_free, iter)) {
+		ocon_array_state_free(os);
+		return STATUS_ERR;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+int qpol_policy_lookup_portcon(const qpol_policy_t * policy, uint8_t protocol, uint16_t port, const qpol_portcon_t ** ocon)
+{
+	const qpol_ocon_index_t *index = NULL;
+	ocontext_t **found = NULL;
+	size_t num = 0;
+	int error = 0;
+
+	if (ocon != NULL)
+		*ocon = NULL;
+
+	if (policy == NULL || ocon == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	if (qpol_ocon_index_get(policy, &index))
+		return STATUS_ERR;
+	if (qpol_ocon_index_find_ports(index, protocol, port, &found, &num)) {
+		error = errno;
+		ERR(policy, "%s", strerror(error));
+		errno = error;
+		return STATUS_ERR;
+	}
+	if (num > 0)
+		*ocon = (qpol_portcon_t *) found[0];
+	free(found);
+
+	if (*ocon == NULL) {
+		errno = ENOENT;
+		return STATUS_ERR;
+	}
+
+	return STATUS_SUCCESS;
+}
+
 int qpol_portcon_get_protocol(const qpol_policy_t * policy, const qpol_portcon_t * ocon, uint8_t * protocol)
 {
 	ocontext_t *internal_ocon = NULL;
@@ -33,6 +33,7 @@ extern "C"
 #include <sepol/handle.h>
 #include <qpol/policy.h>
 #include <stdio.h>
+#include <sys/time.h>
 
 #define STATUS_SUCCESS  0
 #define STATUS_ERR     -1
@@ -54,6 +55,16 @@ extern "C"
 		struct sepol_policydb *p;
 		int enabled;
 		struct qpol_policy *parent;
+		/* contents of the module's file, kept so that the
+		 * module may be read again without reopening it; one of
+		 * the QPOL_POLICY_FILE_DATA_TYPE_* values below */
+		char *file_data;
+		size_t file_data_sz;
+		int file_data_type;
+		/* size and hash of the (decompressed) module image,
+		 * kept even if file_data is not */
+		size_t image_sz;
+		uint64_t image_hash;
 	};
 
 	struct qpol_policy
@@ -65,12 +76,22 @@ extern "C"
 		int options;
 		int type;
 		int modified;
+		/* non-zero if a boolean has been set without
+		 * re-evaluating the conditionals */
+		int conds_outdated;
 		struct qpol_extended_image *ext;
 		struct qpol_module **modules;
 		size_t num_modules;
 		char *file_data;
 		size_t file_data_sz;
 		int file_data_type;
+		/* statistics for the most recent load or rebuild */
+		qpol_load_stats_t load_stats;
+		/* hash of the images the policy was loaded from; see
+		 * qpol_policy_get_fingerprint() */
+		uint64_t fingerprint;
+		/* non-zero once qpol_policy_freeze() has been called */
+		int frozen;
 	};
 /* qpol_policy_t.file_data_type will be one of the following to denote
  * the proper method of destroying the data:
@@ -93,17 +114,77 @@ extern "C"
  */
 	int policy_extend(qpol_policy_t * policy);
 
+/**
+ *  Replace the policydb of a source policy with the one recorded in
+ *  its snapshot, if snapshots are enabled and a snapshot exists for
+ *  the policy's file_data.  See snapshot.c.
+ *  @param policy Source policy whose file_data has been set.
+ *  @return 1 if the policy was read from a snapshot, 0 if no usable
+ *  snapshot exists, or < 0 on error.  If the call fails, errno will
+ *  be set.
+ */
+	int qpol_snapshot_read(qpol_policy_t * policy);
+
+/**
+ *  Write a snapshot of a parsed and linked source policy, if
+ *  snapshots are enabled.
+ *  @param policy Source policy that has just been linked.
+ *  @return 0 on success and < 0 on failure; if the call fails,
+ *  errno will be set.  The policy is never modified.
+ */
+	int qpol_snapshot_write(qpol_policy_t * policy);
+
 	extern void qpol_handle_msg(const qpol_policy_t * policy, int level, const char *fmt, ...);
-	int qpol_is_file_binpol(FILE * fp);
-	int qpol_is_file_mod_pkg(FILE * fp);
+
+/* FNV-1a, 64 bit */
+#define QPOL_HASH_BASIS 0xcbf29ce484222325ULL
+#define QPOL_HASH_PRIME 0x100000001b3ULL
+
+/**
+ * Fold a block of bytes into a 64-bit FNV-1a hash.
+ * @param hash Hash so far; QPOL_HASH_BASIS to begin a new hash.
+ * @param data Bytes to add.
+ * @param sz Number of bytes to add.
+ * @return The updated hash.
+ */
+	uint64_t qpol_hash_bytes(uint64_t hash, const void *data, size_t sz);
+
+/**
+ * Map the whole of an open file into memory, read only.  Pipes,
+ * FIFOs and files that report no size cannot be mapped, so they are
+ * read from their current position into an allocated buffer instead.
+ * @param fd Descriptor of the file to map.
+ * @param data Pointer in which to store the start of the contents,
+ * which the caller must release with qpol_unmap_file().
+ * @param size Pointer in which to store the size of the contents.
+ * @param data_type Pointer in which to store how the contents are
+ * held: QPOL_POLICY_FILE_DATA_TYPE_MMAP or _MEM.
+ * @return 0 on success, < 0 on error; if the call fails, errno will
+ * be set and *data will be NULL.
+ */
+	int qpol_mmap_file(int fd, char **data, size_t * size, int *data_type);
+
+/**
+ * Release file contents according to how they are held.
+ * @param data Contents to release; may be NULL.
+ * @param size Size of the contents.
+ * @param data_type One of the QPOL_POLICY_FILE_DATA_TYPE_* values.
+ */
+	void qpol_unmap_file(char *data, size_t size, int data_type);
+
+/**
+ * Returns true if the data begins with a binary policy.
+ * @return Returns 1 for binary policies, 0 otherwise.
+ */
+	int qpol_is_data_binpol(const char *data, size_t size);
+
 /**
- * Returns the version number of the binary policy.  Note that this
- * will rewind the file pointer.
+ * Returns the version number of the binary policy held in memory.
  *
  * @return Non-negative policy version, or -1 general error for, -2
  * wrong magic number for file, or -3 problem reading file.
  */
-	int qpol_binpol_version(FILE * fp);
+	int qpol_binpol_version(const char *data, size_t size);
 
 /**
  * Returns true if the file is a module package.
@@ -111,6 +192,78 @@ extern "C"
  */
 	int qpol_is_data_mod_pkg(char * data);
 
+/**
+ * Create a module from the contents of a module package file.
+ * @param path Path from which the data was read.
+ * @param data Contents of the file, uncompressed.  On success the
+ * module takes ownership of this buffer.
+ * @param size Number of bytes in data.
+ * @param data_type QPOL_POLICY_FILE_DATA_TYPE_MMAP if the module
+ * should munmap() data when destroyed, _MEM if it should free() it,
+ * or _BIN if the caller retains ownership.
+ * @param module Pointer in which to store the newly created module.
+ * @return 0 on success, < 0 on error; if the call fails, errno will
+ * be set, *module will be NULL, and the caller still owns data.
+ */
+	int qpol_module_create_from_data(const char *path, char *data, size_t size, int data_type, qpol_module_t ** module);
+
+/**
+ * Read a module again, yielding a new and unlinked copy of it.  The
+ * contents kept from the module's file are used if available;
+ * otherwise the module's file is reopened.
+ * @param module Module to read again.
+ * @param copy Pointer in which to store the new module.
+ * @return 0 on success, < 0 on error; if the call fails, errno will
+ * be set and *copy will be NULL.
+ */
+	int qpol_module_reread(const qpol_module_t * module, qpol_module_t ** copy);
+
+/**
+ * Point at which a load phase began; see load_stats.c.
+ */
+	typedef struct qpol_load_clock
+	{
+		struct timeval wall;
+		struct timeval cpu;
+		size_t mem;
+	} qpol_load_clock_t;
+
+/**
+ * Forget the statistics of a policy's previous load or rebuild.
+ * @param policy Policy about to be loaded or rebuilt.
+ */
+	void qpol_load_stats_reset(qpol_policy_t * policy);
+
+/**
+ * Begin timing a load phase.
+ * @param clock Clock to start.
+ */
+	void qpol_load_clock_start(qpol_load_clock_t * clock);
+
+/**
+ * Add the time and memory used since a clock was started to a phase
+ * of a policy's load statistics, and restart the clock for the next
+ * phase.
+ * @param policy Policy being loaded.
+ * @param phase Phase that just ended.
+ * @param clock Clock started at the beginning of the phase.
+ * @return Elapsed wall clock time of the phase, in seconds.
+ */
+	double qpol_load_clock_stop(qpol_policy_t * policy, qpol_load_phase_e phase, qpol_load_clock_t * clock);
+
+/**
+ * Fail with EPERM, after reporting an error, if a policy is frozen;
+ * used by the functions that would modify it.
+ */
+#define QPOL_FAIL_IF_FROZEN(policy, retv) \
+	do { \
+		if ((policy) != NULL && (policy)->frozen) { \
+			ERR((policy), "%s", "The policy is frozen and may not be modified."); \
+			errno = EPERM; \
+			return (retv); \
+		} \
+	} while (0)
+
 #define ERR(policy, format, ...) qpol_handle_msg(policy, QPOL_MSG_ERR, format, __VA_ARGS__)
 #define WARN(policy, format, ...) qpol_handle_msg(policy, QPOL_MSG_WARN, format, __VA_ARGS__)
 #define INFO(policy, format, ...) qpol_handle_msg(policy, QPOL_MSG_INFO, format, __VA_ARGS__)
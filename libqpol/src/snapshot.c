@@ -0,0 +1,367 @@
+/**
+ *  @file
+ *  Implementation of persistent snapshots of linked source policies.
+ *
+ *  Parsing and linking a large policy.conf dominates the time needed
+ *  to open it.  When the environment variable SETOOLS_SNAPSHOT_DIR
+ *  names a directory, libqpol writes the linked policy there in
+ *  libsepol's binary module format, keyed by a hash of the policy
+ *  source and the options that affect parsing.  Subsequent opens of
+ *  identical source then read that image (through a read-only
+ *  mapping) instead of running the parser and linker.
+ *
+ *  The module format does not record the line numbers of rules, so
+ *  they are appended to the image and applied to the syntactic rules
+ *  after reading.
+ *
+ *  Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include "qpol_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <sepol/policydb.h>
+#include <sepol/policydb/policydb.h>
+#include <sepol/policydb/avrule_block.h>
+#include <sepol/policydb/conditional.h>
+
+#define QPOL_SNAPSHOT_DIR_ENV "SETOOLS_SNAPSHOT_DIR"
+#define QPOL_SNAPSHOT_MAGIC "QPOLSNAP"
+#define QPOL_SNAPSHOT_FORMAT 1
+#define QPOL_SNAPSHOT_BYTE_ORDER 0x01020304
+
+/** Options that change the result of parsing and linking. */
+#define QPOL_SNAPSHOT_OPTIONS_MASK QPOL_POLICY_OPTION_NO_RULES
+
+typedef struct qpol_snapshot_header
+{
+	char magic[8];
+	uint32_t format;
+	uint32_t byte_order;
+	/** content hash of the policy source, options, and library version */
+	uint64_t key;
+	/** number of bytes of the libsepol image following the header */
+	uint64_t image_sz;
+	/** number of line numbers following the image */
+	uint32_t num_lines;
+	uint32_t options;
+} qpol_snapshot_header_t;
+
+typedef struct snapshot_lines
+{
+	uint32_t *lines;
+	size_t num_lines;
+	size_t cur;
+} snapshot_lines_t;
+
+/**
+ *  Compute the snapshot key for a source policy.
+ *  @param policy Source policy whose file_data has been set.
+ *  @return The key.
+ */
+static uint64_t snapshot_key(const qpol_policy_t * policy)
+{
+	uint64_t hash = QPOL_HASH_BASIS;
+	uint32_t format = QPOL_SNAPSHOT_FORMAT;
+	uint32_t options = policy->options & QPOL_SNAPSHOT_OPTIONS_MASK;
+
+	hash = qpol_hash_bytes(hash, LIBQPOL_VERSION_STRING, strlen(LIBQPOL_VERSION_STRING));
+	hash = qpol_hash_bytes(hash, &format, sizeof(format));
+	hash = qpol_hash_bytes(hash, &options, sizeof(options));
+	hash = qpol_hash_bytes(hash, policy->file_data, policy->file_data_sz);
+	return hash;
+}
+
+/**
+ *  Build the path to the snapshot for a policy.
+ *  @param key Snapshot key for the policy.
+ *  @param path Buffer of PATH_MAX bytes into which to write the path.
+ *  @return 0 on success, < 0 if snapshots are disabled or the path
+ *  is too long.
+ */
+static int snapshot_path(uint64_t key, char *path)
+{
+	const char *dir = getenv(QPOL_SNAPSHOT_DIR_ENV);
+	int len;
+
+	if (dir == NULL || dir[0] == '\0')
+		return -1;
+	len = snprintf(path, PATH_MAX, "%s/%016" PRIx64 ".qsnap", dir, key);
+	if (len < 0 || len >= PATH_MAX)
+		return -1;
+	return 0;
+}
+
+/**
+ *  Invoke a callback upon every syntactic av and te rule within a
+ *  policy, in the order in which libsepol writes them.
+ *  @param db Policy whose rules to visit.
+ *  @param fn Callback to invoke; a non-zero return value stops the walk.
+ *  @param arg Argument to pass to the callback.
+ *  @return 0 on success, or the first non-zero value returned by fn.
+ */
+static int snapshot_walk_avrules(policydb_t * db, int (*fn) (avrule_t * rule, void *arg), void *arg)
+{
+	avrule_block_t *block;
+	avrule_decl_t *decl;
+	avrule_t *rule;
+	cond_node_t *cond;
+	int retv;
+
+	for (block = db->global; block; block = block->next) {
+		for (decl = block->branch_list; decl; decl = decl->next) {
+			for (rule = decl->avrules; rule; rule = rule->next) {
+				if ((retv = fn(rule, arg)) != 0)
+					return retv;
+			}
+			for (cond = decl->cond_list; cond; cond = cond->next) {
+				for (rule = cond->avtrue_list; rule; rule = rule->next) {
+					if ((retv = fn(rule, arg)) != 0)
+						return retv;
+				}
+				for (rule = cond->avfalse_list; rule; rule = rule->next) {
+					if ((retv = fn(rule, arg)) != 0)
+						return retv;
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+static int snapshot_count_line(avrule_t * rule __attribute__ ((unused)), void *arg)
+{
+	snapshot_lines_t *sl = arg;
+	sl->num_lines++;
+	return 0;
+}
+
+static int snapshot_get_line(avrule_t * rule, void *arg)
+{
+	snapshot_lines_t *sl = arg;
+	sl->lines[sl->cur++] = (uint32_t) rule->line;
+	return 0;
+}
+
+static int snapshot_set_line(avrule_t * rule, void *arg)
+{
+	snapshot_lines_t *sl = arg;
+	if (sl->cur >= sl->num_lines)
+		return -1;
+	rule->line = sl->lines[sl->cur++];
+	return 0;
+}
+
+int qpol_snapshot_read(qpol_policy_t * policy)
+{
+	char path[PATH_MAX];
+	qpol_snapshot_header_t hdr;
+	sepol_policydb_t *p = NULL;
+	sepol_policy_file_t *pfile = NULL;
+	snapshot_lines_t sl = { NULL, 0, 0 };
+	char *data = MAP_FAILED;
+	struct stat sb;
+	uint64_t key;
+	int fd = -1, retv = 0;
+
+	if (policy == NULL || policy->file_data == NULL) {
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	key = snapshot_key(policy);
+	if (snapshot_path(key, path) < 0)
+		return 0;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return 0;	       /* no snapshot yet */
+	if (fstat(fd, &sb) < 0 || (size_t) sb.st_size < sizeof(hdr))
+		goto cleanup;
+	data = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED)
+		goto cleanup;
+
+	memcpy(&hdr, data, sizeof(hdr));
+	if (memcmp(hdr.magic, QPOL_SNAPSHOT_MAGIC, sizeof(hdr.magic)) || hdr.format != QPOL_SNAPSHOT_FORMAT ||
+	    hdr.byte_order != QPOL_SNAPSHOT_BYTE_ORDER || hdr.key != key ||
+	    hdr.options != (uint32_t) (policy->options & QPOL_SNAPSHOT_OPTIONS_MASK) ||
+	    (uint64_t) sb.st_size != sizeof(hdr) + hdr.image_sz + (uint64_t) hdr.num_lines * sizeof(uint32_t)) {
+		WARN(policy, "Ignoring invalid policy snapshot %s.", path);
+		goto cleanup;
+	}
+
+	INFO(policy, "Reading policy snapshot %s. (Steps 1 and 2 of 5)", path);
+	if (sepol_policydb_create(&p) || sepol_policy_file_create(&pfile)) {
+		retv = STATUS_ERR;
+		goto cleanup;
+	}
+	sepol_policy_file_set_mem(pfile, data + sizeof(hdr), hdr.image_sz);
+	sepol_policy_file_set_handle(pfile, policy->sh);
+	if (sepol_policydb_read(p, pfile) || p->p.policy_type != POLICY_BASE) {
+		WARN(policy, "Ignoring unreadable policy snapshot %s.", path);
+		goto cleanup;
+	}
+
+	/* restore line numbers, which the module format does not keep */
+	snapshot_walk_avrules(&p->p, snapshot_count_line, &sl);
+	if (sl.num_lines != hdr.num_lines) {
+		WARN(policy, "Ignoring inconsistent policy snapshot %s.", path);
+		goto cleanup;
+	}
+	if (sl.num_lines > 0) {
+		if (!(sl.lines = malloc(sl.num_lines * sizeof(uint32_t)))) {
+			retv = STATUS_ERR;
+			goto cleanup;
+		}
+		memcpy(sl.lines, data + sizeof(hdr) + hdr.image_sz, sl.num_lines * sizeof(uint32_t));
+		snapshot_walk_avrules(&p->p, snapshot_set_line, &sl);
+	}
+
+	/* the version is inferred later, exactly as for parsed source */
+	p->p.policyvers = 0;
+
+	sepol_policydb_free(policy->p);
+	policy->p = p;
+	p = NULL;
+	retv = 1;
+
+      cleanup:
+	if (retv == STATUS_ERR) {
+		int error = errno;
+		ERR(policy, "%s", strerror(error));
+		errno = error;
+	}
+	free(sl.lines);
+	sepol_policydb_free(p);
+	sepol_policy_file_free(pfile);
+	if (data != MAP_FAILED)
+		munmap(data, sb.st_size);
+	if (fd >= 0)
+		close(fd);
+	return retv;
+}
+
+int qpol_snapshot_write(qpol_policy_t * policy)
+{
+	char path[PATH_MAX], tmp_path[PATH_MAX];
+	qpol_snapshot_header_t hdr;
+	sepol_policy_file_t *pfile = NULL;
+	snapshot_lines_t sl = { NULL, 0, 0 };
+	policydb_t *db;
+	FILE *fp = NULL;
+	long image_end;
+	unsigned int old_vers;
+	int fd = -1, created = 0, retv = STATUS_ERR;
+
+	if (policy == NULL || policy->file_data == NULL) {
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.key = snapshot_key(policy);
+	if (snapshot_path(hdr.key, path) < 0)
+		return STATUS_SUCCESS;
+	if (snprintf(tmp_path, PATH_MAX, "%s.XXXXXX", path) >= PATH_MAX)
+		return STATUS_SUCCESS;
+	if (mkdir(getenv(QPOL_SNAPSHOT_DIR_ENV), 0700) < 0 && errno != EEXIST)
+		goto cleanup;
+
+	db = &policy->p->p;
+	snapshot_walk_avrules(db, snapshot_count_line, &sl);
+	if (sl.num_lines > 0 && !(sl.lines = malloc(sl.num_lines * sizeof(uint32_t))))
+		goto cleanup;
+	snapshot_walk_avrules(db, snapshot_get_line, &sl);
+
+	memcpy(hdr.magic, QPOL_SNAPSHOT_MAGIC, sizeof(hdr.magic));
+	hdr.format = QPOL_SNAPSHOT_FORMAT;
+	hdr.byte_order = QPOL_SNAPSHOT_BYTE_ORDER;
+	hdr.num_lines = (uint32_t) sl.num_lines;
+	hdr.options = policy->options & QPOL_SNAPSHOT_OPTIONS_MASK;
+
+	/* write to a temporary file and then rename it, so that
+	 * concurrent readers never see a partial snapshot */
+	if ((fd = mkstemp(tmp_path)) < 0)
+		goto cleanup;
+	created = 1;
+	if (!(fp = fdopen(fd, "wb")))
+		goto cleanup;
+	fd = -1;
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1)
+		goto cleanup;
+
+	if (sepol_policy_file_create(&pfile))
+		goto cleanup;
+	sepol_policy_file_set_fp(pfile, fp);
+	sepol_policy_file_set_handle(pfile, policy->sh);
+	/* a parsed base has no version until it is inferred after
+	 * expansion; write it as the newest module format */
+	old_vers = db->policyvers;
+	db->policyvers = MOD_POLICYDB_VERSION_MAX;
+	if (sepol_policydb_write(policy->p, pfile)) {
+		db->policyvers = old_vers;
+		errno = EIO;
+		goto cleanup;
+	}
+	db->policyvers = old_vers;
+
+	if ((image_end = ftell(fp)) < 0)
+		goto cleanup;
+	hdr.image_sz = image_end - sizeof(hdr);
+	if (sl.num_lines > 0 && fwrite(sl.lines, sizeof(uint32_t), sl.num_lines, fp) != sl.num_lines)
+		goto cleanup;
+	if (fseek(fp, 0, SEEK_SET) || fwrite(&hdr, sizeof(hdr), 1, fp) != 1)
+		goto cleanup;
+	if (fclose(fp)) {
+		fp = NULL;
+		goto cleanup;
+	}
+	fp = NULL;
+	if (rename(tmp_path, path))
+		goto cleanup;
+	created = 0;
+	INFO(policy, "Wrote policy snapshot %s.", path);
+	retv = STATUS_SUCCESS;
+
+      cleanup:
+	if (retv != STATUS_SUCCESS) {
+		int error = errno;
+		WARN(policy, "Could not write policy snapshot %s: %s", path, strerror(error));
+		if (created)
+			unlink(tmp_path);
+		errno = error;
+	}
+	if (fp != NULL)
+		fclose(fp);
+	if (fd >= 0)
+		close(fd);
+	sepol_policy_file_free(pfile);
+	free(sl.lines);
+	return retv;
+}
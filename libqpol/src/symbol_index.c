@@ -0,0 +1,157 @@
+/**
+ * @file
+ *
+ * Implementation of the index over a policy's symbol tables.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include "symbol_index.h"
+#include "qpol_internal.h"
+#include <sepol/policydb/hashtab.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** One name of a namespace; a slot is empty if its name is NULL. */
+typedef struct symbol_slot
+{
+	size_t hash;
+	const char *name;
+	hashtab_datum_t datum;
+} symbol_slot_t;
+
+/**
+ * Open addressing table of one namespace's names, probed linearly.
+ * num_slots is a power of 2 at least twice the number of names, so
+ * that a probe rarely passes more than one slot.
+ */
+typedef struct symbol_table
+{
+	symbol_slot_t *slots;
+	size_t num_slots;
+} symbol_table_t;
+
+struct qpol_symbol_index
+{
+	symbol_table_t tables[SYM_NUM];
+};
+
+static size_t symbol_hash_name(const char *name)
+{
+	size_t h = 5381;
+
+	for (; *name; name++)
+		h = h * 33 + (unsigned char)*name;
+	return h;
+}
+
+static int symbol_table_insert(hashtab_key_t key, hashtab_datum_t datum, void *data)
+{
+	symbol_table_t *table = data;
+	size_t hash = symbol_hash_name(key), mask = table->num_slots - 1, h;
+
+	for (h = hash & mask; table->slots[h].name; h = (h + 1) & mask) ;
+	table->slots[h].hash = hash;
+	table->slots[h].name = key;
+	table->slots[h].datum = datum;
+	return 0;
+}
+
+static int symbol_table_create(hashtab_t hashtab, symbol_table_t * table)
+{
+	size_t num = (hashtab ? hashtab->nel : 0);
+
+	for (table->num_slots = 16; table->num_slots < 2 * num;)
+		table->num_slots <<= 1;
+	if (!(table->slots = calloc(table->num_slots, sizeof(symbol_slot_t))))
+		return -1;
+	if (hashtab)
+		hashtab_map(hashtab, symbol_table_insert, table);
+	return 0;
+}
+
+static hashtab_datum_t symbol_table_find(const symbol_table_t * table, const char *name)
+{
+	size_t hash = symbol_hash_name(name), mask = table->num_slots - 1, h;
+	const symbol_slot_t *slot;
+
+	for (h = hash & mask; (slot = &table->slots[h])->name; h = (h + 1) & mask) {
+		if (slot->hash == hash && !strcmp(slot->name, name))
+			return slot->datum;
+	}
+	return NULL;
+}
+
+int qpol_symbol_index_create(const qpol_policy_t * policy, qpol_symbol_index_t ** index)
+{
+	const policydb_t *db;
+	qpol_symbol_index_t *idx = NULL;
+	uint32_t sym;
+	int error = 0;
+
+	if (index)
+		*index = NULL;
+	if (!policy || !index) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+
+	db = &policy->p->p;
+	if (!(idx = calloc(1, sizeof(*idx))))
+		goto err;
+	for (sym = 0; sym < SYM_NUM; sym++) {
+		if (symbol_table_create(db->symtab[sym].table, &idx->tables[sym]))
+			goto err;
+	}
+
+	*index = idx;
+	return STATUS_SUCCESS;
+
+      err:
+	error = errno;
+	ERR(policy, "%s", strerror(error));
+	qpol_symbol_index_destroy(&idx);
+	errno = error;
+	return STATUS_ERR;
+}
+
+void qpol_symbol_index_destroy(qpol_symbol_index_t ** index)
+{
+	uint32_t sym;
+
+	if (!index || !(*index))
+		return;
+	for (sym = 0; sym < SYM_NUM; sym++)
+		free((*index)->tables[sym].slots);
+	free(*index);
+	*index = NULL;
+}
+
+hashtab_datum_t qpol_symbol_find(const qpol_policy_t * policy, uint32_t sym, const char *name)
+{
+	const qpol_symbol_index_t *index = qpol_symbol_index_get(policy);
+
+	if (sym >= SYM_NUM)
+		return NULL;
+	if (index)
+		return symbol_table_find(&index->tables[sym], name);
+	return hashtab_search(policy->p->p.symtab[sym].table, (const hashtab_key_t)name);
+}
@@ -0,0 +1,80 @@
+/**
+ * @file
+ *
+ * Private interface to the index over a policy's symbol tables.  For
+ * each namespace (commons, classes, roles, types, users, booleans,
+ * levels and categories) the index holds a static open addressing
+ * table, built once the policy is extended and never changed after,
+ * so that by-name lookups need neither libsepol's chained hashtabs
+ * nor any locking.
+ *
+ * Copyright (C) 2006-2008 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef QPOL_SYMBOL_INDEX_H
+#define QPOL_SYMBOL_INDEX_H
+
+#ifdef	__cplusplus
+extern "C"
+{
+#endif
+
+#include <qpol/policy.h>
+#include <sepol/policydb/policydb.h>
+
+	typedef struct qpol_symbol_index qpol_symbol_index_t;
+
+/**
+ * Build the index over a policy's symbol tables.
+ * @param policy Policy whose symbols to index.
+ * @param index Reference pointer to the created index.
+ * @return 0 on success and < 0 on failure; if the call fails,
+ * errno will be set and *index will be NULL.
+ */
+	int qpol_symbol_index_create(const qpol_policy_t * policy, qpol_symbol_index_t ** index);
+
+/**
+ * Free all memory used by an index and set it to NULL.
+ * @param index Reference pointer to the index to destroy.
+ */
+	void qpol_symbol_index_destroy(qpol_symbol_index_t ** index);
+
+/**
+ * Get the policy's index.  The index is built by policy_extend() and
+ * is discarded whenever the extended image is.  (Implemented in
+ * policy_extend.c.)
+ * @param policy Policy whose index to get.
+ * @return The index, or NULL if it has not been built.  The caller
+ * should not free this pointer.
+ */
+	const qpol_symbol_index_t *qpol_symbol_index_get(const qpol_policy_t * policy);
+
+/**
+ * Find a symbol by name, using the policy's index if it has been built
+ * and the symbol table itself otherwise.
+ * @param policy Policy in which to look.
+ * @param sym Namespace of the symbol (SYM_TYPES, etc.).
+ * @param name Name of the symbol.
+ * @return The symbol's datum, or NULL if there is none by that name.
+ */
+	hashtab_datum_t qpol_symbol_find(const qpol_policy_t * policy, uint32_t sym, const char *name);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif				       /* QPOL_SYMBOL_INDEX_H */
@@ -40,6 +40,19 @@ extern "C"
 /*	char *mod_name; for later use */
 	};
 
+/**
+ * Get the master list of syntactic rules of a policy, in policy
+ * order.  The syntactic rules table must have already been built,
+ * lazily or in full.  (Implemented in policy_extend.c.)
+ * @param policy Policy whose rules to get.
+ * @param list Pointer in which to store the list.  The caller should
+ * not free this pointer.
+ * @param num Pointer in which to store the number of rules.
+ * @return 0 on success and < 0 on failure; if the call fails,
+ * errno will be set, *list will be NULL and *num will be 0.
+ */
+	int qpol_syn_rule_get_master_list(const qpol_policy_t * policy, struct qpol_syn_rule *const **list, size_t * num);
+
 #ifdef	__cplusplus
 }
 #endif
@@ -32,6 +32,7 @@
 #include <sepol/policydb/util.h>
 #include <stdlib.h>
 #include "qpol_internal.h"
+#include "avtab_index.h"
 
 int qpol_policy_get_terule_iter(const qpol_policy_t * policy, uint32_t rule_type_mask, qpol_iterator_t ** iter)
 {
@@ -79,6 +80,82 @@ int qpol_policy_get_terule_iter(const qpol_policy_t * policy, uint32_t rule_type
 	return STATUS_SUCCESS;
 }
 
+int qpol_policy_get_terule_iter_sorted(const qpol_policy_t * policy, uint32_t rule_type_mask, qpol_iterator_t ** iter)
+{
+	if (iter) {
+		*iter = NULL;
+	}
+	if (policy == NULL || iter == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	if (!qpol_policy_has_capability(policy, QPOL_CAP_RULES_LOADED)) {
+		ERR(policy, "%s", "Cannot get terules: Rules not loaded");
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+	return qpol_avtab_index_get_sorted_iter(policy, rule_type_mask, iter);
+}
+
+int qpol_policy_get_terule_iter_part(const qpol_policy_t * policy, uint32_t rule_type_mask, size_t part, size_t num_parts,
+				     qpol_iterator_t ** iter)
+{
+	if (iter) {
+		*iter = NULL;
+	}
+	if (policy == NULL || iter == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	if (!qpol_policy_has_capability(policy, QPOL_CAP_RULES_LOADED)) {
+		ERR(policy, "%s", "Cannot get terules: Rules not loaded");
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+	return avtab_state_create_part(policy, rule_type_mask, part, num_parts, iter);
+}
+
+/**
+ *  Check that the rules needed for an indexed type rule iterator are
+ *  available.
+ *  @return 0 if they are, < 0 (with errno set) if not.
+ */
+static int terule_check_iter_args(const qpol_policy_t * policy, const qpol_type_t * type, qpol_iterator_t ** iter)
+{
+	if (iter) {
+		*iter = NULL;
+	}
+	if (policy == NULL || type == NULL || iter == NULL) {
+		ERR(policy, "%s", strerror(EINVAL));
+		errno = EINVAL;
+		return STATUS_ERR;
+	}
+	if (!qpol_policy_has_capability(policy, QPOL_CAP_RULES_LOADED)) {
+		ERR(policy, "%s", "Cannot get terules: Rules not loaded");
+		errno = ENOTSUP;
+		return STATUS_ERR;
+	}
+	return STATUS_SUCCESS;
+}
+
+int qpol_policy_get_terule_iter_by_source(const qpol_policy_t * policy, uint32_t rule_type_mask, const qpol_type_t * source,
+					  qpol_iterator_t ** iter)
+{
+	if (terule_check_iter_args(policy, source, iter))
+		return STATUS_ERR;
+	return qpol_avtab_index_get_iter(policy, rule_type_mask, source, QPOL_AVTAB_INDEX_SOURCE, iter);
+}
+
+int qpol_policy_get_terule_iter_by_target(const qpol_policy_t * policy, uint32_t rule_type_mask, const qpol_type_t * target,
+					  qpol_iterator_t ** iter)
+{
+	if (terule_check_iter_args(policy, target, iter))
+		return STATUS_ERR;
+	return qpol_avtab_index_get_iter(policy, rule_type_mask, target, QPOL_AVTAB_INDEX_TARGET, iter);
+}
+
 int qpol_terule_get_source_type(const qpol_policy_t * policy, const qpol_terule_t * rule, const qpol_type_t ** source)
 {
 	policydb_t *db = NULL;
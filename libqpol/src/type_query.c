@@ -34,11 +34,11 @@
 #include "iterator_internal.h"
 #include <qpol/type_query.h>
 #include "qpol_internal.h"
+#include "symbol_index.h"
 
 int qpol_policy_get_type_by_name(const qpol_policy_t * policy, const char *name, const qpol_type_t ** datum)
 {
 	hashtab_datum_t internal_datum;
-	policydb_t *db;
 
 	if (policy == NULL || name == NULL || datum == NULL) {
 		if (datum != NULL)
@@ -48,8 +48,7 @@ int qpol_policy_get_type_by_name(const qpol_policy_t * policy, const char *name,
 		return STATUS_ERR;
 	}
 
-	db = &policy->p->p;
-	internal_datum = hashtab_search(db->p_types.table, (const hashtab_key_t)name);
+	internal_datum = qpol_symbol_find(policy, SYM_TYPES, name);
 	if (internal_datum == NULL) {
 		*datum = NULL;
 		ERR(policy, "could not find datum for type %s", name);
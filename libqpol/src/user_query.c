@@ -38,11 +38,11 @@
 #include <qpol/user_query.h>
 #include "iterator_internal.h"
 #include "qpol_internal.h"
+#include "symbol_index.h"
 
 int qpol_policy_get_user_by_name(const qpol_policy_t * policy, const char *name, const qpol_user_t ** datum)
 {
 	hashtab_datum_t internal_datum;
-	policydb_t *db;
 
 	if (policy == NULL || name == NULL || datum == NULL) {
 		if (datum != NULL)
@@ -52,8 +52,7 @@ int qpol_policy_get_user_by_name(const qpol_policy_t * policy, const char *name,
 		return STATUS_ERR;
 	}
 
-	db = &policy->p->p;
-	internal_datum = hashtab_search(db->p_users.table, (const hashtab_key_t)name);
+	internal_datum = qpol_symbol_find(policy, SYM_USERS, name);
 	if (internal_datum == NULL) {
 		*datum = NULL;
 		ERR(policy, "could not find datum for user %s", name);
@@ -65,20 +65,27 @@ static int search_policy_source_file(char **path)
 static int get_binpol_version(const char *policy_fname)
 {
 	FILE *policy_fp = NULL;
-	int ret_version, error;
+	char *data = NULL;
+	size_t size;
+	int ret_version, error, data_type;
 
 	policy_fp = fopen(policy_fname, "r");
 	if (policy_fp == NULL) {
 		return -1;
 	}
-	if (!qpol_is_file_binpol(policy_fp)) {
+	if (qpol_mmap_file(fileno(policy_fp), &data, &size, &data_type)) {
 		error = errno;
 		fclose(policy_fp);
 		errno = error;
 		return -1;
 	}
-	ret_version = qpol_binpol_version(policy_fp);
 	fclose(policy_fp);
+	if (!qpol_is_data_binpol(data, size)) {
+		qpol_unmap_file(data, size, data_type);
+		return -1;
+	}
+	ret_version = qpol_binpol_version(data, size);
+	qpol_unmap_file(data, size, data_type);
 	return ret_version;
 }
 
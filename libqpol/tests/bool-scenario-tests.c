@@ -0,0 +1,237 @@
+/**
+ *  @file
+ *
+ *  Test that setting one boolean re-evaluates the policy's
+ *  conditionals correctly, and that boolean scenarios agree with the
+ *  policy without modifying it.
+ *
+ *  Copyright (C) 2007 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <CUnit/CUnit.h>
+#include <qpol/policy.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SOURCE_POLICY TEST_POLICIES "/snapshots/fc4_targeted.policy.conf"
+
+#define AVRULE_MASK (QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT)
+#define TERULE_MASK (QPOL_RULE_TYPE_TRANS | QPOL_RULE_TYPE_CHANGE | QPOL_RULE_TYPE_MEMBER)
+
+static qpol_policy_t *qp = NULL;
+
+/**
+ * Record the enabled state of every conditional av and type rule, in
+ * iteration order, into a newly allocated array.
+ */
+static unsigned char *get_rule_states(size_t * num)
+{
+	qpol_iterator_t *iter = NULL;
+	unsigned char *states = NULL;
+	size_t av_size, te_size, i = 0;
+	void *rule;
+	const qpol_cond_t *cond;
+	uint32_t is_enabled;
+
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(qp, AVRULE_MASK, &iter) == 0);
+	CU_ASSERT_FATAL(qpol_iterator_get_size(iter, &av_size) == 0);
+	qpol_iterator_destroy(&iter);
+	CU_ASSERT_FATAL(qpol_policy_get_terule_iter(qp, TERULE_MASK, &iter) == 0);
+	CU_ASSERT_FATAL(qpol_iterator_get_size(iter, &te_size) == 0);
+	qpol_iterator_destroy(&iter);
+	states = calloc(av_size + te_size + 1, 1);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(states);
+
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(qp, AVRULE_MASK, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &rule) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_cond(qp, rule, &cond) == 0);
+		if (cond != NULL) {
+			CU_ASSERT_FATAL(qpol_avrule_get_is_enabled(qp, rule, &is_enabled) == 0);
+			states[i++] = is_enabled;
+		}
+	}
+	qpol_iterator_destroy(&iter);
+	CU_ASSERT_FATAL(qpol_policy_get_terule_iter(qp, TERULE_MASK, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &rule) == 0);
+		CU_ASSERT_FATAL(qpol_terule_get_cond(qp, rule, &cond) == 0);
+		if (cond != NULL) {
+			CU_ASSERT_FATAL(qpol_terule_get_is_enabled(qp, rule, &is_enabled) == 0);
+			states[i++] = is_enabled;
+		}
+	}
+	qpol_iterator_destroy(&iter);
+	*num = i;
+	return states;
+}
+
+/**
+ * Check that the incremental update performed by
+ * qpol_bool_set_state() leaves every rule as a full re-evaluation
+ * would.
+ */
+static void bool_scenario_incremental(void)
+{
+	qpol_iterator_t *iter = NULL;
+	unsigned char *incremental, *full;
+	size_t num_incremental, num_full;
+	void *b;
+	int state;
+
+	CU_ASSERT_FATAL(qpol_policy_get_bool_iter(qp, &iter) == 0);
+	CU_ASSERT(!qpol_iterator_end(iter));
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &b) == 0);
+		CU_ASSERT_FATAL(qpol_bool_get_state(qp, b, &state) == 0);
+		CU_ASSERT_FATAL(qpol_bool_set_state(qp, b, !state) == 0);
+		incremental = get_rule_states(&num_incremental);
+		CU_ASSERT_FATAL(qpol_policy_reevaluate_conds(qp) == 0);
+		full = get_rule_states(&num_full);
+		CU_ASSERT(num_incremental == num_full);
+		CU_ASSERT(memcmp(incremental, full, num_full) == 0);
+		free(incremental);
+		free(full);
+		CU_ASSERT_FATAL(qpol_bool_set_state(qp, b, state) == 0);
+	}
+	qpol_iterator_destroy(&iter);
+
+	/* a boolean set without evaluation must still be accounted for
+	 * by the next qpol_bool_set_state() */
+	CU_ASSERT_FATAL(qpol_policy_get_bool_iter(qp, &iter) == 0);
+	CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &b) == 0);
+	CU_ASSERT_FATAL(qpol_bool_get_state(qp, b, &state) == 0);
+	CU_ASSERT_FATAL(qpol_bool_set_state_no_eval(qp, b, !state) == 0);
+	qpol_iterator_next(iter);
+	if (!qpol_iterator_end(iter)) {
+		void *other;
+		int other_state;
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &other) == 0);
+		CU_ASSERT_FATAL(qpol_bool_get_state(qp, other, &other_state) == 0);
+		CU_ASSERT_FATAL(qpol_bool_set_state(qp, other, other_state) == 0);
+	}
+	incremental = get_rule_states(&num_incremental);
+	CU_ASSERT_FATAL(qpol_policy_reevaluate_conds(qp) == 0);
+	full = get_rule_states(&num_full);
+	CU_ASSERT(num_incremental == num_full);
+	CU_ASSERT(memcmp(incremental, full, num_full) == 0);
+	free(incremental);
+	free(full);
+	CU_ASSERT_FATAL(qpol_bool_set_state(qp, b, state) == 0);
+	qpol_iterator_destroy(&iter);
+}
+
+/**
+ * Check that a scenario agrees with the policy for each single
+ * boolean flipped, and that the policy is not changed by it.
+ */
+static void bool_scenario_agrees(void)
+{
+	qpol_bool_scenario_t *scenario = NULL;
+	qpol_iterator_t *iter = NULL, *rule_iter = NULL;
+	unsigned char *before, *after;
+	size_t num_before, num_after;
+	void *b, *rule;
+	int state, scenario_state;
+	uint32_t policy_enabled, scenario_enabled, is_true;
+	const qpol_cond_t *cond;
+
+	CU_ASSERT_FATAL(qpol_bool_scenario_create(qp, &scenario) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_bool_iter(qp, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &b) == 0);
+		CU_ASSERT_FATAL(qpol_bool_get_state(qp, b, &state) == 0);
+
+		/* flipping a boolean in the scenario leaves the policy alone */
+		before = get_rule_states(&num_before);
+		CU_ASSERT_FATAL(qpol_bool_scenario_set_state(scenario, b, !state) == 0);
+		CU_ASSERT_FATAL(qpol_bool_scenario_get_state(scenario, b, &scenario_state) == 0);
+		CU_ASSERT(scenario_state == !state);
+		after = get_rule_states(&num_after);
+		CU_ASSERT(num_before == num_after);
+		CU_ASSERT(memcmp(before, after, num_after) == 0);
+		free(before);
+		free(after);
+
+		/* the scenario now predicts the policy with the boolean flipped */
+		CU_ASSERT_FATAL(qpol_bool_set_state(qp, b, !state) == 0);
+		CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(qp, AVRULE_MASK, &rule_iter) == 0);
+		for (; !qpol_iterator_end(rule_iter); qpol_iterator_next(rule_iter)) {
+			CU_ASSERT_FATAL(qpol_iterator_get_item(rule_iter, &rule) == 0);
+			CU_ASSERT_FATAL(qpol_avrule_get_is_enabled(qp, rule, &policy_enabled) == 0);
+			CU_ASSERT_FATAL(qpol_bool_scenario_avrule_get_is_enabled(scenario, rule, &scenario_enabled) == 0);
+			CU_ASSERT(policy_enabled == scenario_enabled);
+		}
+		qpol_iterator_destroy(&rule_iter);
+		CU_ASSERT_FATAL(qpol_policy_get_terule_iter(qp, TERULE_MASK, &rule_iter) == 0);
+		for (; !qpol_iterator_end(rule_iter); qpol_iterator_next(rule_iter)) {
+			CU_ASSERT_FATAL(qpol_iterator_get_item(rule_iter, &rule) == 0);
+			CU_ASSERT_FATAL(qpol_terule_get_is_enabled(qp, rule, &policy_enabled) == 0);
+			CU_ASSERT_FATAL(qpol_bool_scenario_terule_get_is_enabled(scenario, rule, &scenario_enabled) == 0);
+			CU_ASSERT(policy_enabled == scenario_enabled);
+			CU_ASSERT_FATAL(qpol_terule_get_cond(qp, rule, &cond) == 0);
+			if (cond != NULL) {
+				uint32_t policy_true;
+				CU_ASSERT_FATAL(qpol_cond_eval(qp, cond, &policy_true) == 0);
+				CU_ASSERT_FATAL(qpol_bool_scenario_cond_eval(scenario, cond, &is_true) == 0);
+				CU_ASSERT(policy_true == is_true);
+			}
+		}
+		qpol_iterator_destroy(&rule_iter);
+
+		CU_ASSERT_FATAL(qpol_bool_set_state(qp, b, state) == 0);
+		CU_ASSERT_FATAL(qpol_bool_scenario_set_state(scenario, b, state) == 0);
+	}
+	qpol_iterator_destroy(&iter);
+
+	/* reset returns to the policy's states */
+	CU_ASSERT_FATAL(qpol_policy_get_bool_iter(qp, &iter) == 0);
+	CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &b) == 0);
+	CU_ASSERT_FATAL(qpol_bool_get_state(qp, b, &state) == 0);
+	CU_ASSERT_FATAL(qpol_bool_scenario_set_state(scenario, b, !state) == 0);
+	CU_ASSERT_FATAL(qpol_bool_scenario_reset(scenario) == 0);
+	CU_ASSERT_FATAL(qpol_bool_scenario_get_state(scenario, b, &scenario_state) == 0);
+	CU_ASSERT(scenario_state == !!state);
+	qpol_iterator_destroy(&iter);
+
+	qpol_bool_scenario_destroy(&scenario);
+	CU_ASSERT(scenario == NULL);
+}
+
+CU_TestInfo bool_scenario_tests[] = {
+	{"incremental re-evaluation", bool_scenario_incremental}
+	,
+	{"scenarios agree with policy", bool_scenario_agrees}
+	,
+	CU_TEST_INFO_NULL
+};
+
+int bool_scenario_init()
+{
+	if (qpol_policy_open_from_file(SOURCE_POLICY, &qp, NULL, NULL, 0) < 0) {
+		return 1;
+	}
+	return 0;
+}
+
+int bool_scenario_cleanup()
+{
+	qpol_policy_destroy(&qp);
+	return 0;
+}
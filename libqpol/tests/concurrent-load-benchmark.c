@@ -0,0 +1,106 @@
+/**
+ *  @file
+ *
+ *  Report how source policy load throughput scales with the number of
+ *  threads loading at once.  This is built by "make check" but not run
+ *  as one of its tests; run it by hand as
+ *  ./concurrent-load-benchmark [policy file].
+ *
+ *  Copyright (C) 2007 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <qpol/policy.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/time.h>
+
+#define SOURCE_POLICY TEST_POLICIES "/snapshots/fc4_targeted.policy.conf"
+
+#define MAX_THREADS 8
+#define LOADS_PER_THREAD 2
+
+struct load_arg
+{
+	const char *path;
+	/* number of loads that failed */
+	int num_failed;
+};
+
+static void *load_thread(void *varg)
+{
+	struct load_arg *arg = varg;
+	qpol_policy_t *qp;
+	int i;
+	for (i = 0; i < LOADS_PER_THREAD; i++) {
+		qp = NULL;
+		if (qpol_policy_open_from_file(arg->path, &qp, NULL, NULL, 0) < 0)
+			arg->num_failed++;
+		qpol_policy_destroy(&qp);
+	}
+	return NULL;
+}
+
+/**
+ * Load the policy LOADS_PER_THREAD times from each of num_threads
+ * threads.  Returns the elapsed wall time in seconds, or < 0 if a
+ * thread could not be started or a load failed.
+ */
+static double run_threads(size_t num_threads, const char *path)
+{
+	pthread_t threads[MAX_THREADS];
+	struct load_arg args[MAX_THREADS];
+	struct timeval start, end;
+	size_t i, num_started;
+	int num_failed = 0;
+
+	gettimeofday(&start, NULL);
+	for (num_started = 0; num_started < num_threads; num_started++) {
+		args[num_started].path = path;
+		args[num_started].num_failed = 0;
+		if (pthread_create(&threads[num_started], NULL, load_thread, &args[num_started]) != 0) {
+			num_failed++;
+			break;
+		}
+	}
+	for (i = 0; i < num_started; i++) {
+		pthread_join(threads[i], NULL);
+		num_failed += args[i].num_failed;
+	}
+	gettimeofday(&end, NULL);
+	if (num_failed)
+		return -1.0;
+	return (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = (argc > 1 ? argv[1] : SOURCE_POLICY);
+	size_t num_threads;
+	double elapsed;
+
+	for (num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
+		if ((elapsed = run_threads(num_threads, path)) < 0.0) {
+			fprintf(stderr, "Could not load %s from %zu thread(s).\n", path, num_threads);
+			return 1;
+		}
+		printf("%zu thread(s): %d loads in %.2f s, %.2f loads/s\n", num_threads,
+		       (int)num_threads * LOADS_PER_THREAD, elapsed, elapsed > 0.0 ? num_threads * LOADS_PER_THREAD / elapsed : 0.0);
+	}
+	return 0;
+}
@@ -0,0 +1,271 @@
+/**
+ *  @file
+ *
+ *  Test that source policies may be loaded from several threads at
+ *  once.
+ *
+ *  Copyright (C) 2007 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <CUnit/CUnit.h>
+#include <qpol/policy.h>
+#include <qpol/policy_extend.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+
+#define SOURCE_POLICY TEST_POLICIES "/snapshots/fc4_targeted.policy.conf"
+#define MLS_SOURCE_POLICY TEST_POLICIES "/setools-3.3/rules/rules-mls.conf"
+#define MODULE_A TEST_POLICIES "/policy-versions/base-6.pp"
+#define MODULE_B TEST_POLICIES "/policy-versions/base-8.pp"
+#define NUM_MODULE_PATHS 16
+
+#define MAX_THREADS 8
+#define LOADS_PER_THREAD 2
+
+struct load_arg
+{
+	const char *path;
+	int num_loads;
+	/* results from the last load, or 0 if any load failed */
+	size_t num_types, num_avrules;
+};
+
+/* reference sizes, from a load made by the main thread */
+static size_t ref_num_types, ref_num_avrules;
+static size_t ref_mls_num_types, ref_mls_num_avrules;
+
+static int count_policy(const char *path, size_t * num_types, size_t * num_avrules)
+{
+	qpol_policy_t *qp = NULL;
+	qpol_iterator_t *iter = NULL;
+	int retv = -1;
+	*num_types = *num_avrules = 0;
+	if (qpol_policy_open_from_file(path, &qp, NULL, NULL, 0) < 0) {
+		return -1;
+	}
+	if (qpol_policy_get_type_iter(qp, &iter) || qpol_iterator_get_size(iter, num_types)) {
+		goto cleanup;
+	}
+	qpol_iterator_destroy(&iter);
+	if (qpol_policy_get_avrule_iter(qp, QPOL_RULE_ALLOW, &iter) || qpol_iterator_get_size(iter, num_avrules)) {
+		goto cleanup;
+	}
+	retv = 0;
+      cleanup:
+	qpol_iterator_destroy(&iter);
+	qpol_policy_destroy(&qp);
+	return retv;
+}
+
+static void *load_thread(void *varg)
+{
+	struct load_arg *arg = varg;
+	int i;
+	for (i = 0; i < arg->num_loads; i++) {
+		if (count_policy(arg->path, &arg->num_types, &arg->num_avrules) < 0) {
+			arg->num_types = arg->num_avrules = 0;
+			break;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Load with the given number of threads, each loading the policy
+ * LOADS_PER_THREAD times.  Returns 0 once every thread has finished,
+ * or < 0 if a thread could not be started.
+ */
+static int run_threads(size_t num_threads, const char **paths, struct load_arg *args)
+{
+	pthread_t threads[MAX_THREADS];
+	size_t i;
+
+	for (i = 0; i < num_threads; i++) {
+		args[i].path = paths[i % 2];
+		args[i].num_loads = LOADS_PER_THREAD;
+		args[i].num_types = args[i].num_avrules = 0;
+		if (pthread_create(&threads[i], NULL, load_thread, &args[i]) != 0) {
+			size_t j;
+			for (j = 0; j < i; j++) {
+				pthread_join(threads[j], NULL);
+			}
+			return -1;
+		}
+	}
+	for (i = 0; i < num_threads; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	return 0;
+}
+
+/**
+ * Load two different source policies from several threads at once,
+ * and check that every thread's policy matches a serial load.
+ */
+static void concurrent_load_correctness(void)
+{
+	const char *paths[2] = { SOURCE_POLICY, MLS_SOURCE_POLICY };
+	struct load_arg args[4];
+	size_t i;
+
+	CU_ASSERT_FATAL(run_threads(4, paths, args) == 0);
+	for (i = 0; i < 4; i++) {
+		if (i % 2 == 0) {
+			CU_ASSERT(args[i].num_types == ref_num_types);
+			CU_ASSERT(args[i].num_avrules == ref_num_avrules);
+		} else {
+			CU_ASSERT(args[i].num_types == ref_mls_num_types);
+			CU_ASSERT(args[i].num_avrules == ref_mls_num_avrules);
+		}
+	}
+}
+
+/**
+ * Read the same module packages from a pool of threads and check that
+ * each is read as if alone, in order; then check that a bad path is
+ * reported.
+ */
+static void concurrent_load_modules(void)
+{
+	const char *paths[NUM_MODULE_PATHS];
+	qpol_module_t *modules[NUM_MODULE_PATHS];
+	const char *path;
+	size_t i, failed = 0;
+	int type;
+
+	for (i = 0; i < NUM_MODULE_PATHS; i++) {
+		paths[i] = (i % 2 ? MODULE_B : MODULE_A);
+	}
+	CU_ASSERT_FATAL(qpol_module_create_from_files(paths, NUM_MODULE_PATHS, 4, modules, &failed) == 0);
+	for (i = 0; i < NUM_MODULE_PATHS; i++) {
+		CU_ASSERT_PTR_NOT_NULL_FATAL(modules[i]);
+		CU_ASSERT(qpol_module_get_path(modules[i], &path) == 0 && strcmp(path, paths[i]) == 0);
+		CU_ASSERT(qpol_module_get_type(modules[i], &type) == 0 && type == QPOL_MODULE_BASE);
+		qpol_module_destroy(&modules[i]);
+	}
+
+	paths[NUM_MODULE_PATHS / 2] = TEST_POLICIES "/no-such-module.pp";
+	CU_ASSERT(qpol_module_create_from_files(paths, NUM_MODULE_PATHS, 4, modules, &failed) < 0);
+	CU_ASSERT(failed == NUM_MODULE_PATHS / 2);
+	for (i = 0; i < NUM_MODULE_PATHS; i++) {
+		CU_ASSERT_PTR_NULL(modules[i]);
+	}
+}
+
+struct query_arg
+{
+	const qpol_policy_t *policy;
+	/* number of allow rules, and of syntactic rules behind them */
+	size_t num_avrules, num_syn_avrules;
+};
+
+static void *query_thread(void *varg)
+{
+	struct query_arg *arg = varg;
+	qpol_iterator_t *iter = NULL, *syn_iter = NULL;
+	qpol_avrule_t *rule;
+	size_t num_syn;
+
+	arg->num_avrules = arg->num_syn_avrules = 0;
+	if (qpol_policy_get_avrule_iter(arg->policy, QPOL_RULE_ALLOW, &iter)) {
+		return NULL;
+	}
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		if (qpol_iterator_get_item(iter, (void **)&rule) ||
+		    qpol_avrule_get_syn_avrule_iter(arg->policy, rule, &syn_iter) || qpol_iterator_get_size(syn_iter, &num_syn)) {
+			qpol_iterator_destroy(&syn_iter);
+			arg->num_avrules = 0;
+			break;
+		}
+		qpol_iterator_destroy(&syn_iter);
+		arg->num_avrules++;
+		arg->num_syn_avrules += num_syn;
+	}
+	qpol_iterator_destroy(&iter);
+	return NULL;
+}
+
+/**
+ * Freeze a policy, check that it can no longer be modified, and then
+ * query it from several threads at once.
+ */
+static void concurrent_load_frozen_queries(void)
+{
+	qpol_policy_t *qp = NULL;
+	qpol_iterator_t *iter = NULL;
+	qpol_bool_t *b;
+	pthread_t threads[MAX_THREADS];
+	struct query_arg args[MAX_THREADS];
+	size_t i;
+
+	CU_ASSERT_FATAL(qpol_policy_open_from_file(SOURCE_POLICY, &qp, NULL, NULL, 0) >= 0);
+	CU_ASSERT(!qpol_policy_is_frozen(qp));
+	CU_ASSERT_FATAL(qpol_policy_freeze(qp) == 0);
+	CU_ASSERT(qpol_policy_is_frozen(qp));
+	CU_ASSERT(qpol_policy_freeze(qp) == 0);
+
+	CU_ASSERT(qpol_policy_reevaluate_conds(qp) < 0 && errno == EPERM);
+	CU_ASSERT_FATAL(qpol_policy_get_bool_iter(qp, &iter) == 0);
+	if (!qpol_iterator_end(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, (void **)&b) == 0);
+		CU_ASSERT(qpol_bool_set_state(qp, b, 1) < 0 && errno == EPERM);
+	}
+	qpol_iterator_destroy(&iter);
+
+	for (i = 0; i < MAX_THREADS; i++) {
+		args[i].policy = qp;
+		CU_ASSERT_FATAL(pthread_create(&threads[i], NULL, query_thread, &args[i]) == 0);
+	}
+	for (i = 0; i < MAX_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	for (i = 0; i < MAX_THREADS; i++) {
+		CU_ASSERT(args[i].num_avrules == ref_num_avrules);
+		CU_ASSERT(args[i].num_syn_avrules == args[0].num_syn_avrules);
+	}
+	CU_ASSERT(args[0].num_syn_avrules >= ref_num_avrules);
+	qpol_policy_destroy(&qp);
+}
+
+CU_TestInfo concurrent_load_tests[] = {
+	{"concurrent source loads", concurrent_load_correctness}
+	,
+	{"concurrent module reads", concurrent_load_modules}
+	,
+	{"frozen policy queries", concurrent_load_frozen_queries}
+	,
+	CU_TEST_INFO_NULL
+};
+
+int concurrent_load_init()
+{
+	if (count_policy(SOURCE_POLICY, &ref_num_types, &ref_num_avrules) < 0) {
+		return 1;
+	}
+	if (count_policy(MLS_SOURCE_POLICY, &ref_mls_num_types, &ref_mls_num_avrules) < 0) {
+		return 1;
+	}
+	return 0;
+}
+
+int concurrent_load_cleanup()
+{
+	return 0;
+}
@@ -27,11 +27,17 @@
 
 #include <CUnit/CUnit.h>
 #include <qpol/policy.h>
+#include <qpol/policy_extend.h>
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define SOURCE_POLICY TEST_POLICIES "/snapshots/fc4_targeted.policy.conf"
 
 static qpol_policy_t *qp = NULL;
+/* the same policy, but with rules loaded */
+static qpol_policy_t *rp = NULL;
 
 static void iterators_alias(void)
 {
@@ -65,9 +71,574 @@ static void iterators_alias(void)
 	qpol_iterator_destroy(&iter);
 }
 
+/**
+ * Check that the indexed av and te rule iterators return exactly the
+ * rules that a full scan finds for each source and target type.
+ */
+static void iterators_indexed_rules(void)
+{
+	qpol_iterator_t *iter = NULL, *type_iter = NULL;
+	const uint32_t av_mask = QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT;
+	const uint32_t te_mask = QPOL_RULE_TYPE_TRANS | QPOL_RULE_TYPE_MEMBER | QPOL_RULE_TYPE_CHANGE;
+	size_t num_types, *src_count, *tgt_count;
+	int pass;
+
+	CU_ASSERT_FATAL(qpol_policy_get_type_iter(rp, &type_iter) == 0);
+	CU_ASSERT_FATAL(qpol_iterator_get_size(type_iter, &num_types) == 0);
+	qpol_iterator_destroy(&type_iter);
+
+	for (pass = 0; pass < 2; pass++) {
+		src_count = calloc(num_types + 1, sizeof(size_t));
+		tgt_count = calloc(num_types + 1, sizeof(size_t));
+		CU_ASSERT_FATAL(src_count != NULL && tgt_count != NULL);
+
+		if (pass == 0) {
+			CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(rp, av_mask, &iter) == 0);
+		} else {
+			CU_ASSERT_FATAL(qpol_policy_get_terule_iter(rp, te_mask, &iter) == 0);
+		}
+		for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+			void *rule;
+			const qpol_type_t *source, *target;
+			uint32_t sval, tval;
+			CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &rule) == 0);
+			if (pass == 0) {
+				CU_ASSERT_FATAL(qpol_avrule_get_source_type(rp, rule, &source) == 0);
+				CU_ASSERT_FATAL(qpol_avrule_get_target_type(rp, rule, &target) == 0);
+			} else {
+				CU_ASSERT_FATAL(qpol_terule_get_source_type(rp, rule, &source) == 0);
+				CU_ASSERT_FATAL(qpol_terule_get_target_type(rp, rule, &target) == 0);
+			}
+			CU_ASSERT_FATAL(qpol_type_get_value(rp, source, &sval) == 0 && sval <= num_types);
+			CU_ASSERT_FATAL(qpol_type_get_value(rp, target, &tval) == 0 && tval <= num_types);
+			src_count[sval]++;
+			tgt_count[tval]++;
+		}
+		qpol_iterator_destroy(&iter);
+
+		CU_ASSERT_FATAL(qpol_policy_get_type_iter(rp, &type_iter) == 0);
+		for (; !qpol_iterator_end(type_iter); qpol_iterator_next(type_iter)) {
+			void *v;
+			const qpol_type_t *type, *other;
+			uint32_t val, other_val;
+			size_t n;
+			CU_ASSERT_FATAL(qpol_iterator_get_item(type_iter, &v) == 0);
+			type = (const qpol_type_t *)v;
+			CU_ASSERT_FATAL(qpol_type_get_value(rp, type, &val) == 0);
+
+			if (pass == 0) {
+				CU_ASSERT_FATAL(qpol_policy_get_avrule_iter_by_source(rp, av_mask, type, &iter) == 0);
+			} else {
+				CU_ASSERT_FATAL(qpol_policy_get_terule_iter_by_source(rp, te_mask, type, &iter) == 0);
+			}
+			CU_ASSERT_FATAL(qpol_iterator_get_size(iter, &n) == 0);
+			CU_ASSERT(n == src_count[val]);
+			for (n = 0; !qpol_iterator_end(iter); qpol_iterator_next(iter), n++) {
+				void *rule;
+				CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &rule) == 0);
+				if (pass == 0) {
+					CU_ASSERT_FATAL(qpol_avrule_get_source_type(rp, rule, &other) == 0);
+				} else {
+					CU_ASSERT_FATAL(qpol_terule_get_source_type(rp, rule, &other) == 0);
+				}
+				CU_ASSERT_FATAL(qpol_type_get_value(rp, other, &other_val) == 0);
+				CU_ASSERT(other_val == val);
+			}
+			CU_ASSERT(n == src_count[val]);
+			qpol_iterator_destroy(&iter);
+
+			if (pass == 0) {
+				CU_ASSERT_FATAL(qpol_policy_get_avrule_iter_by_target(rp, av_mask, type, &iter) == 0);
+			} else {
+				CU_ASSERT_FATAL(qpol_policy_get_terule_iter_by_target(rp, te_mask, type, &iter) == 0);
+			}
+			for (n = 0; !qpol_iterator_end(iter); qpol_iterator_next(iter), n++) {
+				void *rule;
+				CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &rule) == 0);
+				if (pass == 0) {
+					CU_ASSERT_FATAL(qpol_avrule_get_target_type(rp, rule, &other) == 0);
+				} else {
+					CU_ASSERT_FATAL(qpol_terule_get_target_type(rp, rule, &other) == 0);
+				}
+				CU_ASSERT_FATAL(qpol_type_get_value(rp, other, &other_val) == 0);
+				CU_ASSERT(other_val == val);
+			}
+			CU_ASSERT(n == tgt_count[val]);
+			qpol_iterator_destroy(&iter);
+		}
+		qpol_iterator_destroy(&type_iter);
+		free(src_count);
+		free(tgt_count);
+	}
+}
+
+/**
+ * Check that the sorted av rule iterator returns the same rules as a
+ * full scan, in (source, target, class, rule type) order.
+ */
+static void iterators_sorted_rules(void)
+{
+	qpol_iterator_t *iter = NULL;
+	const uint32_t av_mask = QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT;
+	const qpol_type_t *type;
+	const qpol_class_t *obj_class;
+	uint32_t key[4], prev[4] = { 0, 0, 0, 0 };
+	size_t num, sorted_num, i;
+	int cmp;
+
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(rp, av_mask, &iter) == 0);
+	CU_ASSERT_FATAL(qpol_iterator_get_size(iter, &num) == 0);
+	qpol_iterator_destroy(&iter);
+
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter_sorted(rp, av_mask, &iter) == 0);
+	CU_ASSERT_FATAL(qpol_iterator_get_size(iter, &sorted_num) == 0);
+	CU_ASSERT(sorted_num == num);
+	for (sorted_num = 0; !qpol_iterator_end(iter); qpol_iterator_next(iter), sorted_num++) {
+		void *rule;
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &rule) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_source_type(rp, rule, &type) == 0);
+		CU_ASSERT_FATAL(qpol_type_get_value(rp, type, &key[0]) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_target_type(rp, rule, &type) == 0);
+		CU_ASSERT_FATAL(qpol_type_get_value(rp, type, &key[1]) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_object_class(rp, rule, &obj_class) == 0);
+		CU_ASSERT_FATAL(qpol_class_get_value(rp, obj_class, &key[2]) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_rule_type(rp, rule, &key[3]) == 0);
+		for (i = 0, cmp = 0; i < 4 && cmp == 0; i++)
+			cmp = (prev[i] < key[i] ? -1 : (prev[i] > key[i]));
+		CU_ASSERT(cmp <= 0);
+		for (i = 0; i < 4; i++)
+			prev[i] = key[i];
+	}
+	CU_ASSERT(sorted_num == num);
+	qpol_iterator_destroy(&iter);
+}
+
+/**
+ * Check that an av rule's permission mask holds exactly the bits of
+ * the permissions named by its permission iterator.
+ */
+static void iterators_perm_mask(void)
+{
+	qpol_iterator_t *iter = NULL, *perm_iter = NULL;
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(rp, QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		void *rule;
+		const qpol_class_t *obj_class;
+		uint32_t mask, perm_mask, expected = 0;
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &rule) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_object_class(rp, rule, &obj_class) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_perm_mask(rp, rule, &mask) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_perm_iter(rp, rule, &perm_iter) == 0);
+		for (; !qpol_iterator_end(perm_iter); qpol_iterator_next(perm_iter)) {
+			char *perm;
+			CU_ASSERT_FATAL(qpol_iterator_get_item(perm_iter, (void **)&perm) == 0);
+			CU_ASSERT_FATAL(qpol_class_get_perm_mask(rp, obj_class, perm, &perm_mask) == 0);
+			CU_ASSERT(perm_mask != 0);
+			CU_ASSERT((perm_mask & expected) == 0);
+			expected |= perm_mask;
+			free(perm);
+		}
+		qpol_iterator_destroy(&perm_iter);
+		CU_ASSERT(mask == expected);
+		CU_ASSERT_FATAL(qpol_class_get_perm_mask(rp, obj_class, "no_such_permission", &perm_mask) == 0);
+		CU_ASSERT(perm_mask == 0);
+	}
+	qpol_iterator_destroy(&iter);
+}
+
+/**
+ * Check that fetching items in batches of the given size from iter
+ * yields the same items, in the same order, as walking ref one item
+ * at a time.  Both iterators are destroyed.
+ */
+static void check_batched_items(qpol_iterator_t ** iter, qpol_iterator_t ** ref, size_t batch_size)
+{
+	void *items[7], *item;
+	size_t num, i, total = 0, ref_size;
+	CU_ASSERT_FATAL(batch_size <= sizeof(items) / sizeof(items[0]));
+	CU_ASSERT_FATAL(qpol_iterator_get_size(*ref, &ref_size) == 0);
+	do {
+		CU_ASSERT_FATAL(qpol_iterator_get_items(*iter, items, batch_size, &num) == 0);
+		CU_ASSERT(num <= batch_size);
+		for (i = 0; i < num; i++) {
+			CU_ASSERT_FATAL(!qpol_iterator_end(*ref));
+			CU_ASSERT_FATAL(qpol_iterator_get_item(*ref, &item) == 0);
+			CU_ASSERT(items[i] == item);
+			qpol_iterator_next(*ref);
+		}
+		total += num;
+		if (num < batch_size) {
+			CU_ASSERT(qpol_iterator_end(*iter));
+		}
+	} while (num == batch_size);
+	CU_ASSERT(qpol_iterator_end(*ref));
+	CU_ASSERT(total == ref_size);
+	CU_ASSERT(qpol_iterator_get_items(*iter, items, batch_size, &num) == 0 && num == 0);
+	qpol_iterator_destroy(iter);
+	qpol_iterator_destroy(ref);
+}
+
+static void iterators_batched_items(void)
+{
+	qpol_iterator_t *iter = NULL, *ref = NULL;
+	const qpol_type_t *attr = NULL;
+	size_t batch_size;
+
+	/* find some attribute whose types to iterate over */
+	CU_ASSERT_FATAL(qpol_policy_get_type_iter(qp, &iter) == 0);
+	for (; attr == NULL && !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		void *type;
+		unsigned char isattr;
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &type) == 0);
+		CU_ASSERT_FATAL(qpol_type_get_isattr(qp, type, &isattr) == 0);
+		if (isattr) {
+			attr = type;
+		}
+	}
+	qpol_iterator_destroy(&iter);
+	CU_ASSERT_FATAL(attr != NULL);
+
+	for (batch_size = 1; batch_size <= 7; batch_size += 3) {
+		/* avtab */
+		CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(rp, QPOL_RULE_ALLOW | QPOL_RULE_DONTAUDIT, &iter) == 0);
+		CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(rp, QPOL_RULE_ALLOW | QPOL_RULE_DONTAUDIT, &ref) == 0);
+		check_batched_items(&iter, &ref, batch_size);
+		/* per-type index */
+		CU_ASSERT_FATAL(qpol_policy_get_avrule_iter_by_source(rp, QPOL_RULE_ALLOW, attr, &iter) == 0);
+		CU_ASSERT_FATAL(qpol_policy_get_avrule_iter_by_source(rp, QPOL_RULE_ALLOW, attr, &ref) == 0);
+		check_batched_items(&iter, &ref, batch_size);
+		/* hash table */
+		CU_ASSERT_FATAL(qpol_policy_get_type_iter(qp, &iter) == 0);
+		CU_ASSERT_FATAL(qpol_policy_get_type_iter(qp, &ref) == 0);
+		check_batched_items(&iter, &ref, batch_size);
+		/* ebitmap */
+		CU_ASSERT_FATAL(qpol_type_get_type_iter(qp, attr, &iter) == 0);
+		CU_ASSERT_FATAL(qpol_type_get_type_iter(qp, attr, &ref) == 0);
+		check_batched_items(&iter, &ref, batch_size);
+		/* ocontext list */
+		CU_ASSERT_FATAL(qpol_policy_get_portcon_iter(qp, &iter) == 0);
+		CU_ASSERT_FATAL(qpol_policy_get_portcon_iter(qp, &ref) == 0);
+		check_batched_items(&iter, &ref, batch_size);
+		/* conditionals use the generic fallback */
+		CU_ASSERT_FATAL(qpol_policy_get_cond_iter(rp, &iter) == 0);
+		CU_ASSERT_FATAL(qpol_policy_get_cond_iter(rp, &ref) == 0);
+		check_batched_items(&iter, &ref, batch_size);
+	}
+}
+
+/**
+ * Get the first type that a type or attribute stands for.
+ */
+static const qpol_type_t *first_member_type(qpol_policy_t * p, const qpol_type_t * type)
+{
+	qpol_iterator_t *iter = NULL;
+	unsigned char isattr;
+	void *member = NULL;
+
+	CU_ASSERT_FATAL(qpol_type_get_isattr(p, type, &isattr) == 0);
+	if (!isattr)
+		return type;
+	CU_ASSERT_FATAL(qpol_type_get_type_iter(p, type, &iter) == 0);
+	if (!qpol_iterator_end(iter))
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &member) == 0);
+	qpol_iterator_destroy(&iter);
+	return member;
+}
+
+/**
+ * Check that the access matrix holds the permissions of every allow
+ * rule for a pair of types it covers, attributes included, and that
+ * the memory budget is honored.
+ */
+static void iterators_access_matrix(void)
+{
+	qpol_iterator_t *iter = NULL;
+	qpol_access_entry_t *entries;
+	size_t num_entries, i;
+
+	CU_ASSERT(qpol_policy_build_access_matrix(rp, 1) < 0 && errno == ENOMEM);
+	CU_ASSERT(!qpol_policy_has_access_matrix(rp));
+	CU_ASSERT_FATAL(qpol_policy_build_access_matrix(rp, 0) == 0);
+	CU_ASSERT(qpol_policy_has_access_matrix(rp));
+
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(rp, QPOL_RULE_ALLOW, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		void *rule;
+		const qpol_type_t *source, *target, *s_type, *t_type;
+		const qpol_class_t *obj_class;
+		const qpol_cond_t *cond;
+		uint32_t mask;
+		int found = 0;
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &rule) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_source_type(rp, rule, &source) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_target_type(rp, rule, &target) == 0);
+		if (source != (s_type = first_member_type(rp, source)) || target != (t_type = first_member_type(rp, target))) {
+			CU_ASSERT(qpol_policy_lookup_access(rp, source, target, &entries, &num_entries) < 0);
+			CU_ASSERT_PTR_NULL(entries);
+		}
+		if (s_type == NULL || t_type == NULL)
+			continue;
+		CU_ASSERT_FATAL(qpol_avrule_get_object_class(rp, rule, &obj_class) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_cond(rp, rule, &cond) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_perm_mask(rp, rule, &mask) == 0);
+		CU_ASSERT_FATAL(qpol_policy_lookup_access(rp, s_type, t_type, &entries, &num_entries) == 0);
+		CU_ASSERT_FATAL(num_entries > 0);
+		for (i = 0; i < num_entries; i++) {
+			if (entries[i].obj_class == obj_class && entries[i].rule_type == QPOL_RULE_ALLOW && entries[i].cond == cond &&
+			    (mask & ~entries[i].perm_mask) == 0) {
+				found = 1;
+			}
+		}
+		CU_ASSERT(found);
+		free(entries);
+	}
+	qpol_iterator_destroy(&iter);
+
+	qpol_policy_drop_access_matrix(rp);
+	CU_ASSERT(!qpol_policy_has_access_matrix(rp));
+}
+
+/**
+ * Check that every semantic rule maps back to at least one syntactic
+ * rule.
+ */
+static void iterators_syn_rules(void)
+{
+	qpol_iterator_t *iter = NULL, *syn_iter = NULL;
+	size_t n;
+
+	CU_ASSERT_FATAL(qpol_policy_build_syn_rule_table(rp) == 0);
+
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(rp, QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		void *rule;
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &rule) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_syn_avrule_iter(rp, rule, &syn_iter) == 0);
+		CU_ASSERT_FATAL(qpol_iterator_get_size(syn_iter, &n) == 0);
+		CU_ASSERT(n > 0);
+		qpol_iterator_destroy(&syn_iter);
+	}
+	qpol_iterator_destroy(&iter);
+	CU_ASSERT_FATAL(qpol_policy_get_terule_iter(rp, QPOL_RULE_TYPE_TRANS | QPOL_RULE_TYPE_CHANGE | QPOL_RULE_TYPE_MEMBER, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		void *rule;
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &rule) == 0);
+		CU_ASSERT_FATAL(qpol_terule_get_syn_terule_iter(rp, rule, &syn_iter) == 0);
+		CU_ASSERT_FATAL(qpol_iterator_get_size(syn_iter, &n) == 0);
+		CU_ASSERT(n > 0);
+		qpol_iterator_destroy(&syn_iter);
+	}
+	qpol_iterator_destroy(&iter);
+}
+
+/**
+ * Sum the line numbers of the syntactic rules behind an av rule.
+ */
+static unsigned long syn_avrule_lineno_sum(qpol_policy_t * p, const qpol_avrule_t * rule, size_t * num)
+{
+	qpol_iterator_t *syn_iter = NULL;
+	unsigned long sum = 0, lineno;
+	*num = 0;
+	CU_ASSERT_FATAL(qpol_avrule_get_syn_avrule_iter(p, rule, &syn_iter) == 0);
+	for (; !qpol_iterator_end(syn_iter); qpol_iterator_next(syn_iter)) {
+		void *syn;
+		CU_ASSERT_FATAL(qpol_iterator_get_item(syn_iter, &syn) == 0);
+		CU_ASSERT_FATAL(qpol_syn_avrule_get_lineno(p, syn, &lineno) == 0);
+		sum += lineno;
+		(*num)++;
+	}
+	qpol_iterator_destroy(&syn_iter);
+	return sum;
+}
+
+/**
+ * Check that a lazily built syntactic rule table gives the same
+ * answers as a fully built one.  Both policies are loaded from the
+ * same file, so their rules are iterated in the same order.
+ */
+static void iterators_lazy_syn_rules(void)
+{
+	qpol_policy_t *lp = NULL;
+	qpol_iterator_t *iter = NULL, *lazy_iter = NULL;
+	size_t n, lazy_n;
+
+	CU_ASSERT_FATAL(qpol_policy_open_from_file(SOURCE_POLICY, &lp, NULL, NULL, 0) >= 0);
+	CU_ASSERT_FATAL(qpol_policy_build_syn_rule_table_lazy(lp) == 0);
+	CU_ASSERT_FATAL(qpol_policy_build_syn_rule_table(rp) == 0);
+
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(rp, QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT, &iter) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(lp, QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT, &lazy_iter) ==
+			0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter), qpol_iterator_next(lazy_iter)) {
+		void *rule, *lazy_rule;
+		CU_ASSERT_FATAL(!qpol_iterator_end(lazy_iter));
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, &rule) == 0);
+		CU_ASSERT_FATAL(qpol_iterator_get_item(lazy_iter, &lazy_rule) == 0);
+		CU_ASSERT(syn_avrule_lineno_sum(rp, rule, &n) == syn_avrule_lineno_sum(lp, lazy_rule, &lazy_n));
+		CU_ASSERT(n == lazy_n);
+	}
+	CU_ASSERT(qpol_iterator_end(lazy_iter));
+	qpol_iterator_destroy(&iter);
+	qpol_iterator_destroy(&lazy_iter);
+
+	qpol_policy_destroy(&lp);
+}
+
+/**
+ * Check whether a nodecon statement's address and mask cover an
+ * address of the given protocol.
+ */
+static int nodecon_covers(const qpol_nodecon_t * nodecon, const uint32_t * addr, unsigned char proto)
+{
+	uint32_t *ocon_addr, *ocon_mask;
+	unsigned char ocon_proto;
+	size_t i, n;
+
+	if (qpol_nodecon_get_addr(qp, nodecon, &ocon_addr, &ocon_proto) ||
+	    qpol_nodecon_get_mask(qp, nodecon, &ocon_mask, &ocon_proto) || ocon_proto != proto)
+		return 0;
+	n = (proto == QPOL_IPV4 ? 1 : 4);
+	for (i = 0; i < n; i++) {
+		if ((ocon_addr[i] & ocon_mask[i]) != (addr[i] & ocon_mask[i]))
+			return 0;
+	}
+	return 1;
+}
+
+/**
+ * Check that looking up network statements through the indexes finds
+ * the same statements, in the same order, as scanning them all.
+ */
+static void iterators_ocon_index(void)
+{
+	qpol_iterator_t *iter = NULL, *found = NULL, *all = NULL;
+	const qpol_portcon_t *first = NULL;
+	const qpol_netifcon_t *netif = NULL;
+	size_t num_found;
+
+	CU_ASSERT_FATAL(qpol_policy_get_portcon_iter(qp, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		qpol_portcon_t *portcon, *item, *expected;
+		uint16_t low;
+		uint8_t proto;
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, (void **)&portcon) == 0);
+		CU_ASSERT_FATAL(qpol_portcon_get_low_port(qp, portcon, &low) == 0);
+		CU_ASSERT_FATAL(qpol_portcon_get_protocol(qp, portcon, &proto) == 0);
+		CU_ASSERT_FATAL(qpol_policy_get_portcon_iter_by_port(qp, proto, low, &found) == 0);
+		CU_ASSERT_FATAL(qpol_policy_get_portcon_iter(qp, &all) == 0);
+		num_found = 0;
+		first = NULL;
+		for (; !qpol_iterator_end(all); qpol_iterator_next(all)) {
+			uint16_t l, h;
+			uint8_t p;
+			CU_ASSERT_FATAL(qpol_iterator_get_item(all, (void **)&expected) == 0);
+			CU_ASSERT_FATAL(qpol_portcon_get_low_port(qp, expected, &l) == 0);
+			CU_ASSERT_FATAL(qpol_portcon_get_high_port(qp, expected, &h) == 0);
+			CU_ASSERT_FATAL(qpol_portcon_get_protocol(qp, expected, &p) == 0);
+			if (p != proto || l > low || h < low)
+				continue;
+			CU_ASSERT_FATAL(!qpol_iterator_end(found));
+			CU_ASSERT_FATAL(qpol_iterator_get_item(found, (void **)&item) == 0);
+			CU_ASSERT(item == expected);
+			if (first == NULL)
+				first = expected;
+			qpol_iterator_next(found);
+			num_found++;
+		}
+		CU_ASSERT(qpol_iterator_end(found));
+		CU_ASSERT(num_found > 0);
+		qpol_iterator_destroy(&found);
+		qpol_iterator_destroy(&all);
+		CU_ASSERT_FATAL(qpol_policy_lookup_portcon(qp, proto, low, (const qpol_portcon_t **)&item) == 0);
+		CU_ASSERT(item == first);
+	}
+	qpol_iterator_destroy(&iter);
+
+	CU_ASSERT_FATAL(qpol_policy_get_nodecon_iter(qp, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		qpol_nodecon_t *nodecon, *item, *expected;
+		uint32_t *addr, *item_addr, *expected_addr, *first_addr = NULL;
+		unsigned char proto;
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, (void **)&nodecon) == 0);
+		CU_ASSERT_FATAL(qpol_nodecon_get_addr(qp, nodecon, &addr, &proto) == 0);
+		/* the index must give exactly the statements that a scan
+		 * of every nodecon finds to cover the address, in order */
+		CU_ASSERT_FATAL(qpol_policy_get_nodecon_iter_by_addr(qp, addr, proto, &found) == 0);
+		CU_ASSERT_FATAL(qpol_policy_get_nodecon_iter(qp, &all) == 0);
+		num_found = 0;
+		for (; !qpol_iterator_end(all); qpol_iterator_next(all)) {
+			CU_ASSERT_FATAL(qpol_iterator_get_item(all, (void **)&expected) == 0);
+			if (!nodecon_covers(expected, addr, proto)) {
+				free(expected);
+				continue;
+			}
+			CU_ASSERT_FATAL(qpol_nodecon_get_addr(qp, expected, &expected_addr, &proto) == 0);
+			if (first_addr == NULL)
+				first_addr = expected_addr;
+			free(expected);
+			CU_ASSERT_FATAL(!qpol_iterator_end(found));
+			CU_ASSERT_FATAL(qpol_iterator_get_item(found, (void **)&item) == 0);
+			CU_ASSERT_FATAL(qpol_nodecon_get_addr(qp, item, &item_addr, &proto) == 0);
+			CU_ASSERT(item_addr == expected_addr);
+			free(item);
+			qpol_iterator_next(found);
+			num_found++;
+		}
+		CU_ASSERT(qpol_iterator_end(found));
+		CU_ASSERT(num_found > 0);
+		qpol_iterator_destroy(&found);
+		qpol_iterator_destroy(&all);
+		CU_ASSERT_FATAL(qpol_policy_lookup_nodecon(qp, addr, proto, &item) == 0);
+		CU_ASSERT_FATAL(qpol_nodecon_get_addr(qp, item, &item_addr, &proto) == 0);
+		CU_ASSERT(item_addr == first_addr);
+		free(item);
+		free(nodecon);
+	}
+	qpol_iterator_destroy(&iter);
+
+	CU_ASSERT_FATAL(qpol_policy_get_netifcon_iter(qp, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		const qpol_netifcon_t *netifcon, *item, *first = NULL;
+		const char *name, *item_name;
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, (void **)&netifcon) == 0);
+		CU_ASSERT_FATAL(qpol_netifcon_get_name(qp, netifcon, &name) == 0);
+		/* a repeated interface name is labeled by its first statement */
+		CU_ASSERT_FATAL(qpol_policy_get_netifcon_iter(qp, &all) == 0);
+		for (; first == NULL && !qpol_iterator_end(all); qpol_iterator_next(all)) {
+			CU_ASSERT_FATAL(qpol_iterator_get_item(all, (void **)&item) == 0);
+			CU_ASSERT_FATAL(qpol_netifcon_get_name(qp, item, &item_name) == 0);
+			if (strcmp(item_name, name) == 0)
+				first = item;
+		}
+		qpol_iterator_destroy(&all);
+		CU_ASSERT_FATAL(qpol_policy_get_netifcon_by_name(qp, name, &item) == 0);
+		CU_ASSERT(item == first);
+	}
+	qpol_iterator_destroy(&iter);
+	CU_ASSERT(qpol_policy_get_netifcon_by_name(qp, "no-such-interface", &netif) < 0);
+	CU_ASSERT(errno == ENOENT);
+	CU_ASSERT_PTR_NULL(netif);
+}
+
 CU_TestInfo iterators_tests[] = {
 	{"alias iterator", iterators_alias}
 	,
+	{"indexed rule iterators", iterators_indexed_rules}
+	,
+	{"sorted rule iterator", iterators_sorted_rules}
+	,
+	{"av rule permission masks", iterators_perm_mask}
+	,
+	{"batched items", iterators_batched_items}
+	,
+	{"access matrix", iterators_access_matrix}
+	,
+	{"syntactic rule lookups", iterators_syn_rules}
+	,
+	{"lazy syntactic rule lookups", iterators_lazy_syn_rules}
+	,
+	{"network statement indexes", iterators_ocon_index}
+	,
 	CU_TEST_INFO_NULL
 };
 
@@ -77,11 +648,15 @@ int iterators_init()
 	if (policy_type < 0) {
 		return 1;
 	}
+	if (qpol_policy_open_from_file(SOURCE_POLICY, &rp, NULL, NULL, 0) < 0) {
+		return 1;
+	}
 	return 0;
 }
 
 int iterators_cleanup()
 {
 	qpol_policy_destroy(&qp);
+	qpol_policy_destroy(&rp);
 	return 0;
 }
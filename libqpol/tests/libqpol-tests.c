@@ -28,9 +28,12 @@
 #include <CUnit/CUnit.h>
 #include <CUnit/Basic.h>
 
+#include "bool-scenario-tests.h"
 #include "capabilities-tests.h"
+#include "concurrent-load-tests.h"
 #include "iterators-tests.h"
 #include "policy-features-tests.h"
+#include "snapshot-tests.h"
 
 int main(void)
 {
@@ -39,12 +42,18 @@ int main(void)
 	}
 
 	CU_SuiteInfo suites[] = {
+		{"Boolean Scenarios", bool_scenario_init, bool_scenario_cleanup, bool_scenario_tests}
+		,
 		{"Capabilities", capabilities_init, capabilities_cleanup, capabilities_tests}
 		,
+		{"Concurrent Loading", concurrent_load_init, concurrent_load_cleanup, concurrent_load_tests}
+		,
 		{"Iterators", iterators_init, iterators_cleanup, iterators_tests}
 		,
 		{"Policy Featurens", policy_features_init, policy_features_cleanup, policy_features_tests}
 		,
+		{"Snapshots", snapshot_init, snapshot_cleanup, snapshot_tests}
+		,
 		CU_SUITE_INFO_NULL
 	};
 
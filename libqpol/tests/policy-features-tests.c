@@ -27,12 +27,48 @@
 
 #include <CUnit/CUnit.h>
 #include <qpol/policy.h>
+#include <qpol/policy_extend.h>
 #include "../src/qpol_internal.h"
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #define BROKEN_ALIAS_POLICY TEST_POLICIES "/setools-3.3/policy-features/broken-alias-mod.21"
 #define NOT_BROKEN_ALIAS_POLICY TEST_POLICIES "/setools-3.3/policy-features/not-broken-alias-mod.21"
 #define NOGENFS_POLICY TEST_POLICIES "/setools-3.3/policy-features/nogenfscon-policy.21"
+#define SOURCE_POLICY TEST_POLICIES "/snapshots/fc4_targeted.policy.conf"
+
+/* an MLS policy with one statement of each kind the constraint engine
+ * evaluates */
+#define CONSTRAINT_POLICY \
+	"class process\nclass file\nsid kernel\n" \
+	"class process { transition }\nclass file { read write }\n" \
+	"sensitivity s0;\nsensitivity s1;\ndominance { s0 s1 }\ncategory c0;\nlevel s0:c0;\nlevel s1:c0;\n" \
+	"mlsconstrain file read ( l1 dom l2 );\nmlsconstrain file write ( l1 eq l2 );\n" \
+	"type kernel_t;\ntype user_t;\ntype file_t;\n" \
+	"role system_r types { kernel_t file_t };\nrole user_r types { user_t file_t };\n" \
+	"user system_u roles system_r level s0 range s0 - s1:c0;\n" \
+	"user user_u roles user_r level s0 range s0 - s1:c0;\n" \
+	"constrain process transition ( u1 == u2 or t1 == kernel_t );\n" \
+	"validatetrans file ( u1 == u2 or t3 == kernel_t );\n" \
+	"sid kernel system_u:system_r:kernel_t:s0 - s1:c0\n"
+
+/* a policy whose second neverallow, on line 15, is violated by the
+ * allow rule of kernel_t on shadow_t */
+#define NEVERALLOW_POLICY \
+	"class process\nclass file\nsid kernel\n" \
+	"class process { transition }\nclass file { read write getattr }\n" \
+	"attribute domain;\ntype kernel_t, domain;\ntype user_t, domain;\ntype file_t;\ntype shadow_t;\n" \
+	"role system_r types { kernel_t user_t };\n" \
+	"allow domain file_t : file { read getattr };\nallow kernel_t shadow_t : file { read write getattr };\n" \
+	"neverallow user_t shadow_t : file write;\nneverallow domain shadow_t : file { read write };\n" \
+	"user system_u roles system_r;\nsid kernel system_u:system_r:kernel_t\n"
+
+/* types on each side of the attribute rule of the access matrix
+ * test; expanded, the rule would cover ACCESS_TYPES^2 pairs */
+#define ACCESS_TYPES 2000
 
 static void policy_features_alias_count(void *varg, const qpol_policy_t * policy
 					__attribute__ ((unused)), int level, const char *fmt, va_list va_args)
@@ -126,11 +162,555 @@ static void policy_features_nogenfscon_iter(void)
 	qpol_policy_destroy(&qp);
 }
 
+/** Test that looking up the genfscon statement for a path finds a
+ *  statement for that path, and that the statement for a path below
+ *  it is the same or longer. */
+static void policy_features_genfscon_lookup(void)
+{
+	qpol_policy_t *qp = NULL;
+	qpol_iterator_t *iter = NULL;
+	qpol_genfscon_t *genfscon = NULL, *found = NULL;
+	const qpol_context_t *context, *contexts[2];
+	const char *name, *path, *found_path, *paths[2];
+	char *subpath;
+	uint32_t obj_class;
+
+	int policy_type = qpol_policy_open_from_file(NOGENFS_POLICY, &qp, NULL, NULL, QPOL_POLICY_OPTION_NO_RULES);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_BINARY);
+	CU_ASSERT(qpol_policy_lookup_genfscon(qp, "proc", "/", QPOL_CLASS_ALL, &found) < 0 && errno == ENOENT);
+	qpol_policy_destroy(&qp);
+
+	policy_type = qpol_policy_open_from_file(NOT_BROKEN_ALIAS_POLICY, &qp, NULL, NULL, QPOL_POLICY_OPTION_NO_RULES);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_BINARY);
+
+	CU_ASSERT_FATAL(qpol_policy_get_genfscon_iter(qp, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, (void **)&genfscon) == 0);
+		CU_ASSERT_FATAL(qpol_genfscon_get_name(qp, genfscon, &name) == 0);
+		CU_ASSERT_FATAL(qpol_genfscon_get_path(qp, genfscon, &path) == 0);
+		CU_ASSERT_FATAL(qpol_genfscon_get_class(qp, genfscon, &obj_class) == 0);
+
+		CU_ASSERT_FATAL(qpol_policy_lookup_genfscon(qp, name, path, obj_class, &found) == 0);
+		CU_ASSERT_FATAL(qpol_genfscon_get_path(qp, found, &found_path) == 0);
+		CU_ASSERT_STRING_EQUAL(found_path, path);
+		CU_ASSERT_FATAL(qpol_genfscon_get_context(qp, found, &context) == 0);
+		free(found);
+
+		CU_ASSERT_FATAL(asprintf(&subpath, "%s/setools", path) >= 0);
+		CU_ASSERT_FATAL(qpol_policy_lookup_genfscon(qp, name, subpath, obj_class, &found) == 0);
+		CU_ASSERT_FATAL(qpol_genfscon_get_path(qp, found, &found_path) == 0);
+		CU_ASSERT(strlen(found_path) >= strlen(path) && strncmp(found_path, subpath, strlen(found_path)) == 0);
+		free(found);
+
+		paths[0] = path;
+		paths[1] = subpath;
+		CU_ASSERT_FATAL(qpol_policy_lookup_genfscon_contexts(qp, name, paths, 2, obj_class, contexts) == 0);
+		CU_ASSERT(contexts[0] == context);
+		CU_ASSERT(contexts[1] != NULL);
+		free(subpath);
+		free(genfscon);
+	}
+	qpol_iterator_destroy(&iter);
+	qpol_policy_destroy(&qp);
+}
+
+/**
+ * Open a source policy given as text.  The text goes through a
+ * temporary file so that it is loaded, and extended, as any other
+ * source policy is.
+ */
+static qpol_policy_t *open_source_text(const char *text)
+{
+	char path[] = "/tmp/libqpol-tests.XXXXXX";
+	qpol_policy_t *qp = NULL;
+	size_t len = strlen(text);
+	int fd, policy_type;
+
+	CU_ASSERT_FATAL((fd = mkstemp(path)) >= 0);
+	CU_ASSERT_FATAL(write(fd, text, len) == (ssize_t) len);
+	close(fd);
+	policy_type = qpol_policy_open_from_file(path, &qp, NULL, NULL, 0);
+	unlink(path);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_SOURCE);
+	return qp;
+}
+
+/** Test that a policy can be read from a pipe, which cannot be
+ *  mapped, as with sesearch -A <(zcat policy.conf.gz). */
+static void policy_features_open_pipe(void)
+{
+	char path[64];
+	qpol_policy_t *qp = NULL;
+	const qpol_type_t *type;
+	size_t len = strlen(NEVERALLOW_POLICY);
+	int fds[2], policy_type;
+
+	/* the policy is small enough to fit in the pipe's buffer */
+	CU_ASSERT_FATAL(pipe(fds) == 0);
+	CU_ASSERT_FATAL(write(fds[1], NEVERALLOW_POLICY, len) == (ssize_t) len);
+	close(fds[1]);
+	snprintf(path, sizeof(path), "/dev/fd/%d", fds[0]);
+	policy_type = qpol_policy_open_from_file(path, &qp, NULL, NULL, 0);
+	close(fds[0]);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_SOURCE);
+	CU_ASSERT(qpol_policy_get_type_by_name(qp, "shadow_t", &type) == 0);
+	qpol_policy_destroy(&qp);
+}
+
+/** Test that the constraint engine compiles a policy's statements,
+ *  that an access requesting no permissions is never denied, and that
+ *  a denial names a constraint of the access's class. */
+static void policy_features_constraint_engine(void)
+{
+	qpol_policy_t *qp = NULL;
+	qpol_iterator_t *iter = NULL, *class_iter = NULL;
+	qpol_constraint_engine_t *engine = NULL;
+	qpol_constraint_ctx_t *ctxs[8];
+	qpol_constraint_tuple_t tuple;
+	const qpol_constraint_t *denied;
+	const qpol_class_t *denied_class;
+	qpol_isid_t *isid;
+	const qpol_context_t *context;
+	uint32_t denied_perms;
+	size_t num_ctxs = 0, i, j;
+
+	int policy_type = qpol_policy_open_from_file(NOT_BROKEN_ALIAS_POLICY, &qp, NULL, NULL, QPOL_POLICY_OPTION_NO_RULES);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_BINARY);
+	CU_ASSERT_FATAL(qpol_constraint_engine_create(qp, &engine) == 0);
+
+	CU_ASSERT_FATAL(qpol_policy_get_isid_iter(qp, &iter) == 0);
+	for (; !qpol_iterator_end(iter) && num_ctxs < 8; qpol_iterator_next(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, (void **)&isid) == 0);
+		CU_ASSERT_FATAL(qpol_isid_get_context(qp, isid, &context) == 0);
+		CU_ASSERT_FATAL(qpol_constraint_ctx_create(engine, context, &ctxs[num_ctxs]) == 0);
+		num_ctxs++;
+	}
+	qpol_iterator_destroy(&iter);
+
+	CU_ASSERT_FATAL(qpol_policy_get_class_iter(qp, &class_iter) == 0);
+	for (; !qpol_iterator_end(class_iter); qpol_iterator_next(class_iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(class_iter, (void **)&tuple.obj_class) == 0);
+		for (i = 0; i < num_ctxs; i++) {
+			for (j = 0; j < num_ctxs; j++) {
+				tuple.scontext = ctxs[i];
+				tuple.tcontext = ctxs[j];
+				tuple.perms = 0;
+				CU_ASSERT_FATAL(qpol_constraint_engine_check(engine, &tuple, 1, &denied, &denied_perms) == 0);
+				CU_ASSERT(denied == NULL && denied_perms == 0);
+
+				tuple.perms = ~0U;
+				CU_ASSERT_FATAL(qpol_constraint_engine_check(engine, &tuple, 1, &denied, &denied_perms) == 0);
+				if (denied != NULL) {
+					CU_ASSERT(denied_perms != 0);
+					CU_ASSERT_FATAL(qpol_constraint_get_class(qp, denied, &denied_class) == 0);
+					CU_ASSERT(denied_class == tuple.obj_class);
+				} else {
+					CU_ASSERT(denied_perms == 0);
+				}
+			}
+		}
+	}
+	qpol_iterator_destroy(&class_iter);
+
+	for (i = 0; i < num_ctxs; i++)
+		qpol_constraint_ctx_destroy(&ctxs[i]);
+	qpol_constraint_engine_destroy(&engine);
+	CU_ASSERT(engine == NULL);
+	qpol_policy_destroy(&qp);
+}
+
+/** Test the constraint engine's decisions on accesses and
+ *  transitions known to be allowed or denied by a constrain, an
+ *  mlsconstrain and a validatetrans statement. */
+static void policy_features_constraint_decisions(void)
+{
+	qpol_policy_t *qp = open_source_text(CONSTRAINT_POLICY);
+	qpol_constraint_engine_t *engine = NULL;
+	qpol_constraint_ctx_t *sys, *usr, *usr_hi, *usr_file, *sys_file;
+	const qpol_constraint_t *denied[5];
+	const qpol_validatetrans_t *vdenied[3];
+	const qpol_class_t *process, *file, *denied_class;
+	const qpol_user_t *user;
+	const qpol_role_t *role;
+	const qpol_type_t *type;
+	const qpol_level_t *level;
+	const qpol_cat_t *cat;
+	uint32_t system_u, user_u, system_r, user_r, kernel_t, user_t, file_t, c0;
+	uint32_t transition, read, write, denied_perms[5];
+	qpol_constraint_level_t s0 = { 0, NULL, 0 }, s1_c0 = { 0, &c0, 1 };
+
+	CU_ASSERT_FATAL(qpol_policy_get_user_by_name(qp, "system_u", &user) == 0 && qpol_user_get_value(qp, user, &system_u) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_user_by_name(qp, "user_u", &user) == 0 && qpol_user_get_value(qp, user, &user_u) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_role_by_name(qp, "system_r", &role) == 0 && qpol_role_get_value(qp, role, &system_r) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_role_by_name(qp, "user_r", &role) == 0 && qpol_role_get_value(qp, role, &user_r) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_type_by_name(qp, "kernel_t", &type) == 0 && qpol_type_get_value(qp, type, &kernel_t) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_type_by_name(qp, "user_t", &type) == 0 && qpol_type_get_value(qp, type, &user_t) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_type_by_name(qp, "file_t", &type) == 0 && qpol_type_get_value(qp, type, &file_t) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_level_by_name(qp, "s0", &level) == 0 && qpol_level_get_value(qp, level, &s0.sens) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_level_by_name(qp, "s1", &level) == 0 && qpol_level_get_value(qp, level, &s1_c0.sens) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_cat_by_name(qp, "c0", &cat) == 0 && qpol_cat_get_value(qp, cat, &c0) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_class_by_name(qp, "process", &process) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_class_by_name(qp, "file", &file) == 0);
+	CU_ASSERT_FATAL(qpol_class_get_perm_mask(qp, process, "transition", &transition) == 0);
+	CU_ASSERT_FATAL(qpol_class_get_perm_mask(qp, file, "read", &read) == 0);
+	CU_ASSERT_FATAL(qpol_class_get_perm_mask(qp, file, "write", &write) == 0);
+
+	CU_ASSERT_FATAL(qpol_constraint_engine_create(qp, &engine) == 0);
+	CU_ASSERT_FATAL(qpol_constraint_ctx_create_from_values(engine, system_u, system_r, kernel_t, &s0, &s1_c0, &sys) == 0);
+	CU_ASSERT_FATAL(qpol_constraint_ctx_create_from_values(engine, user_u, user_r, user_t, &s0, NULL, &usr) == 0);
+	CU_ASSERT_FATAL(qpol_constraint_ctx_create_from_values(engine, user_u, user_r, user_t, &s1_c0, NULL, &usr_hi) == 0);
+	CU_ASSERT_FATAL(qpol_constraint_ctx_create_from_values(engine, user_u, user_r, file_t, &s0, NULL, &usr_file) == 0);
+	CU_ASSERT_FATAL(qpol_constraint_ctx_create_from_values(engine, system_u, system_r, file_t, &s1_c0, NULL, &sys_file) == 0);
+
+	qpol_constraint_tuple_t tuples[] = {
+		/* u1 == u2 or t1 == kernel_t */
+		{usr, sys, process, transition},
+		{sys, usr, process, transition},
+		/* l1 dom l2 for read, l1 eq l2 for write */
+		{usr, usr_file, file, read | write},
+		{usr, sys_file, file, read | write},
+		{usr_hi, usr_file, file, read | write}
+	};
+	CU_ASSERT_FATAL(qpol_constraint_engine_check(engine, tuples, 5, denied, denied_perms) == 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(denied[0]);
+	CU_ASSERT(qpol_constraint_get_class(qp, denied[0], &denied_class) == 0 && denied_class == process);
+	CU_ASSERT(denied_perms[0] == transition);
+	CU_ASSERT(denied[1] == NULL && denied_perms[1] == 0);
+	CU_ASSERT(denied[2] == NULL && denied_perms[2] == 0);
+	CU_ASSERT(denied[3] != NULL && denied_perms[3] == (read | write));
+	CU_ASSERT(denied[4] != NULL && denied_perms[4] == write);
+
+	/* u1 == u2 or t3 == kernel_t; old, new and task contexts */
+	qpol_validatetrans_tuple_t vtuples[] = {
+		{usr_file, sys_file, usr, file},
+		{usr_file, sys_file, sys, file},
+		{usr_file, usr_file, usr, file}
+	};
+	CU_ASSERT_FATAL(qpol_constraint_engine_validatetrans(engine, vtuples, 3, vdenied) == 0);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(vdenied[0]);
+	CU_ASSERT(qpol_validatetrans_get_class(qp, vdenied[0], &denied_class) == 0 && denied_class == file);
+	CU_ASSERT_PTR_NULL(vdenied[1]);
+	CU_ASSERT_PTR_NULL(vdenied[2]);
+
+	qpol_constraint_ctx_destroy(&sys);
+	qpol_constraint_ctx_destroy(&usr);
+	qpol_constraint_ctx_destroy(&usr_hi);
+	qpol_constraint_ctx_destroy(&usr_file);
+	qpol_constraint_ctx_destroy(&sys_file);
+	qpol_constraint_engine_destroy(&engine);
+	qpol_policy_destroy(&qp);
+}
+
+/** Test that loading a policy records the phases it went through. */
+static void policy_features_load_stats(void)
+{
+	qpol_policy_t *qp = NULL;
+	qpol_load_stats_t stats;
+	size_t i;
+
+	int policy_type = qpol_policy_open_from_file(NOT_BROKEN_ALIAS_POLICY, &qp, NULL, NULL, QPOL_POLICY_OPTION_NO_RULES);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_BINARY);
+	CU_ASSERT_FATAL(qpol_policy_get_load_stats(qp, &stats) == 0);
+
+	/* a binary policy is read and extended, but never linked or expanded */
+	CU_ASSERT(stats.phases[QPOL_LOAD_PHASE_PARSE].count == 1);
+	CU_ASSERT(stats.phases[QPOL_LOAD_PHASE_POLICY_EXTEND].count == 1);
+	CU_ASSERT(stats.phases[QPOL_LOAD_PHASE_LINK].count == 0);
+	CU_ASSERT(stats.phases[QPOL_LOAD_PHASE_EXPAND].count == 0);
+	for (i = 0; i < QPOL_LOAD_PHASE_NUM; i++) {
+		CU_ASSERT(stats.phases[i].wall_time >= 0 && stats.phases[i].cpu_time >= 0);
+		CU_ASSERT_PTR_NOT_NULL(qpol_load_phase_get_name(i));
+	}
+	CU_ASSERT(stats.avtab_bytes > 0);
+	CU_ASSERT(stats.peak_resident_bytes >= stats.resident_bytes || stats.peak_resident_bytes == 0);
+	CU_ASSERT_PTR_NULL(qpol_load_phase_get_name(QPOL_LOAD_PHASE_NUM));
+	qpol_policy_destroy(&qp);
+}
+
+/** Test that policies loaded from the same file share a fingerprint
+ *  and that those loaded from different files do not. */
+static void policy_features_fingerprint(void)
+{
+	qpol_policy_t *qp = NULL, *qp2 = NULL;
+	uint64_t fp, fp2;
+
+	int policy_type = qpol_policy_open_from_file(NOT_BROKEN_ALIAS_POLICY, &qp, NULL, NULL, QPOL_POLICY_OPTION_NO_RULES);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_BINARY);
+	policy_type = qpol_policy_open_from_file(NOT_BROKEN_ALIAS_POLICY, &qp2, NULL, NULL, 0);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_BINARY);
+	CU_ASSERT_FATAL(qpol_policy_get_fingerprint(qp, &fp) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_fingerprint(qp2, &fp2) == 0);
+	/* binary policies always load their rules, so the options do not matter */
+	CU_ASSERT(fp != 0 && fp == fp2);
+	qpol_policy_destroy(&qp2);
+
+	policy_type = qpol_policy_open_from_file(NOGENFS_POLICY, &qp2, NULL, NULL, QPOL_POLICY_OPTION_NO_RULES);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_BINARY);
+	CU_ASSERT_FATAL(qpol_policy_get_fingerprint(qp2, &fp2) == 0);
+	CU_ASSERT(fp != fp2);
+	qpol_policy_destroy(&qp2);
+	qpol_policy_destroy(&qp);
+}
+
+/** Test that a shipped policy, which checkpolicy accepted, violates
+ *  none of its neverallow rules, and that checking requires them. */
+static void policy_features_neverallow(void)
+{
+	qpol_policy_t *qp = NULL;
+	qpol_iterator_t *iter = NULL, *syn_iter = NULL;
+	qpol_avrule_t *rule;
+	qpol_syn_avrule_t *syn_rule;
+	qpol_neverallow_violation_t *violations = NULL;
+	size_t num = 1;
+
+	int policy_type = qpol_policy_open_from_file(SOURCE_POLICY, &qp, NULL, NULL, 0);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_SOURCE);
+	CU_ASSERT_FATAL(qpol_policy_check_neverallows(qp, &violations, &num) == 0);
+	CU_ASSERT(num == 0);
+	free(violations);
+
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(qp, QPOL_RULE_NEVERALLOW, &iter) == 0);
+	CU_ASSERT_FATAL(!qpol_iterator_end(iter));
+	CU_ASSERT_FATAL(qpol_iterator_get_item(iter, (void **)&rule) == 0);
+	CU_ASSERT_FATAL(qpol_avrule_get_syn_avrule_iter(qp, rule, &syn_iter) == 0);
+	CU_ASSERT_FATAL(!qpol_iterator_end(syn_iter));
+	CU_ASSERT_FATAL(qpol_iterator_get_item(syn_iter, (void **)&syn_rule) == 0);
+	num = 1;
+	CU_ASSERT(qpol_policy_check_neverallow(qp, syn_rule, &violations, &num) == 0);
+	CU_ASSERT(num == 0);
+	free(violations);
+	qpol_iterator_destroy(&syn_iter);
+	qpol_iterator_destroy(&iter);
+
+	/* only neverallow rules may be checked */
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(qp, QPOL_RULE_ALLOW, &iter) == 0);
+	CU_ASSERT_FATAL(qpol_iterator_get_item(iter, (void **)&rule) == 0);
+	CU_ASSERT_FATAL(qpol_avrule_get_syn_avrule_iter(qp, rule, &syn_iter) == 0);
+	CU_ASSERT_FATAL(qpol_iterator_get_item(syn_iter, (void **)&syn_rule) == 0);
+	CU_ASSERT(qpol_policy_check_neverallow(qp, syn_rule, &violations, &num) < 0 && errno == EINVAL);
+	CU_ASSERT_PTR_NULL(violations);
+	qpol_iterator_destroy(&syn_iter);
+	qpol_iterator_destroy(&iter);
+	qpol_policy_destroy(&qp);
+
+	/* binary policies carry no neverallow rules to check */
+	policy_type = qpol_policy_open_from_file(NOT_BROKEN_ALIAS_POLICY, &qp, NULL, NULL, 0);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_BINARY);
+	CU_ASSERT(qpol_policy_check_neverallows(qp, &violations, &num) < 0 && errno == ENOTSUP);
+	qpol_policy_destroy(&qp);
+}
+
+/** Test that the version probe reads a binary policy's version, and
+ *  that it rejects headers too short to hold one without reading past
+ *  their end. */
+static void policy_features_binpol_version(void)
+{
+	/* magic, a 2 byte policy string, then version 21 */
+	static const unsigned char header[] = {
+		0x8c, 0xff, 0x7c, 0xf9, 0x02, 0x00, 0x00, 0x00, 'S', 'E', 0x15, 0x00, 0x00, 0x00
+	};
+	char *data;
+	size_t size;
+
+	CU_ASSERT(qpol_binpol_version((const char *)header, sizeof(header)) == 21);
+	/* a policy string running past the end of the data */
+	CU_ASSERT(qpol_binpol_version((const char *)header, sizeof(header) - 1) == -3);
+	/* too short for the version after even an empty string; each
+	 * buffer is exactly as long as the header so that a read past it
+	 * is caught by memory checkers */
+	for (size = 8; size < 12; size++) {
+		CU_ASSERT_FATAL((data = malloc(size)) != NULL);
+		memset(data, 0, size);
+		memcpy(data, header, 4);
+		CU_ASSERT(qpol_binpol_version(data, size) == -3);
+		free(data);
+	}
+	CU_ASSERT(qpol_binpol_version((const char *)header, 4) == -3);
+	CU_ASSERT(qpol_binpol_version(NULL, sizeof(header)) == -1);
+}
+
+/** Test that a violated neverallow is reported with the allow rule
+ *  that violates it and the permissions the two share, and that one
+ *  that is not violated is not reported. */
+static void policy_features_neverallow_violation(void)
+{
+	qpol_policy_t *qp = open_source_text(NEVERALLOW_POLICY);
+	qpol_iterator_t *iter = NULL, *syn_iter = NULL;
+	qpol_avrule_t *rule;
+	qpol_syn_avrule_t *syn_rule;
+	qpol_neverallow_violation_t *violations = NULL;
+	const qpol_type_t *type;
+	const qpol_class_t *obj_class;
+	const char *name;
+	unsigned long lineno;
+	uint32_t rule_type, read, write;
+	size_t num = 0;
+
+	CU_ASSERT_FATAL(qpol_policy_get_class_by_name(qp, "file", &obj_class) == 0);
+	CU_ASSERT_FATAL(qpol_class_get_perm_mask(qp, obj_class, "read", &read) == 0);
+	CU_ASSERT_FATAL(qpol_class_get_perm_mask(qp, obj_class, "write", &write) == 0);
+
+	CU_ASSERT_FATAL(qpol_policy_check_neverallows(qp, &violations, &num) == 0);
+	CU_ASSERT_FATAL(num == 1);
+	CU_ASSERT(qpol_syn_avrule_get_lineno(qp, violations[0].neverallow, &lineno) == 0 && lineno == 15);
+	CU_ASSERT(qpol_avrule_get_rule_type(qp, violations[0].allow, &rule_type) == 0 && rule_type == QPOL_RULE_ALLOW);
+	CU_ASSERT_FATAL(qpol_avrule_get_source_type(qp, violations[0].allow, &type) == 0);
+	CU_ASSERT(qpol_type_get_name(qp, type, &name) == 0 && strcmp(name, "kernel_t") == 0);
+	CU_ASSERT_FATAL(qpol_avrule_get_target_type(qp, violations[0].allow, &type) == 0);
+	CU_ASSERT(qpol_type_get_name(qp, type, &name) == 0 && strcmp(name, "shadow_t") == 0);
+	CU_ASSERT(qpol_avrule_get_object_class(qp, violations[0].allow, &obj_class) == 0);
+	CU_ASSERT(qpol_class_get_name(qp, obj_class, &name) == 0 && strcmp(name, "file") == 0);
+	/* getattr is granted but not forbidden */
+	CU_ASSERT(violations[0].perms == (read | write));
+	free(violations);
+
+	/* each neverallow alone: the first, on user_t, is not violated */
+	CU_ASSERT_FATAL(qpol_policy_get_avrule_iter(qp, QPOL_RULE_NEVERALLOW, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, (void **)&rule) == 0);
+		CU_ASSERT_FATAL(qpol_avrule_get_syn_avrule_iter(qp, rule, &syn_iter) == 0);
+		for (; !qpol_iterator_end(syn_iter); qpol_iterator_next(syn_iter)) {
+			CU_ASSERT_FATAL(qpol_iterator_get_item(syn_iter, (void **)&syn_rule) == 0);
+			CU_ASSERT_FATAL(qpol_syn_avrule_get_lineno(qp, syn_rule, &lineno) == 0);
+			CU_ASSERT_FATAL(qpol_policy_check_neverallow(qp, syn_rule, &violations, &num) == 0);
+			CU_ASSERT(num == (lineno == 15 ? 1 : 0));
+			free(violations);
+		}
+		qpol_iterator_destroy(&syn_iter);
+	}
+	qpol_iterator_destroy(&iter);
+	qpol_policy_destroy(&qp);
+}
+
+/** Test that every type, class, role and user is found by its name. */
+static void policy_features_symbol_lookup(void)
+{
+	qpol_policy_t *qp = NULL;
+	qpol_iterator_t *iter = NULL;
+	const qpol_type_t *type, *found_type;
+	const qpol_class_t *obj_class, *found_class;
+	const qpol_role_t *role, *found_role;
+	const qpol_user_t *user, *found_user;
+	const char *name;
+
+	int policy_type = qpol_policy_open_from_file(NOT_BROKEN_ALIAS_POLICY, &qp, NULL, NULL, QPOL_POLICY_OPTION_NO_RULES);
+	CU_ASSERT_FATAL(policy_type == QPOL_POLICY_KERNEL_BINARY);
+
+	CU_ASSERT_FATAL(qpol_policy_get_type_iter(qp, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, (void **)&type) == 0);
+		CU_ASSERT_FATAL(qpol_type_get_name(qp, type, &name) == 0);
+		CU_ASSERT(qpol_policy_get_type_by_name(qp, name, &found_type) == 0 && found_type == type);
+	}
+	qpol_iterator_destroy(&iter);
+
+	CU_ASSERT_FATAL(qpol_policy_get_class_iter(qp, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, (void **)&obj_class) == 0);
+		CU_ASSERT_FATAL(qpol_class_get_name(qp, obj_class, &name) == 0);
+		CU_ASSERT(qpol_policy_get_class_by_name(qp, name, &found_class) == 0 && found_class == obj_class);
+	}
+	qpol_iterator_destroy(&iter);
+
+	CU_ASSERT_FATAL(qpol_policy_get_role_iter(qp, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, (void **)&role) == 0);
+		CU_ASSERT_FATAL(qpol_role_get_name(qp, role, &name) == 0);
+		CU_ASSERT(qpol_policy_get_role_by_name(qp, name, &found_role) == 0 && found_role == role);
+	}
+	qpol_iterator_destroy(&iter);
+
+	CU_ASSERT_FATAL(qpol_policy_get_user_iter(qp, &iter) == 0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		CU_ASSERT_FATAL(qpol_iterator_get_item(iter, (void **)&user) == 0);
+		CU_ASSERT_FATAL(qpol_user_get_name(qp, user, &name) == 0);
+		CU_ASSERT(qpol_policy_get_user_by_name(qp, name, &found_user) == 0 && found_user == user);
+	}
+	qpol_iterator_destroy(&iter);
+
+	CU_ASSERT(qpol_policy_get_type_by_name(qp, "no_such_type_t", &found_type) < 0 && errno == ENOENT);
+	CU_ASSERT_PTR_NULL(found_type);
+	qpol_policy_destroy(&qp);
+}
+
+/** Test that an access matrix of a policy whose attribute rules cover
+ *  millions of type pairs fits in a small budget, and that lookups
+ *  merge the rules on attributes with those on the types. */
+static void policy_features_access_matrix_attributes(void)
+{
+	size_t size = 4096 + 2 * ACCESS_TYPES * 32, len = 0, num_entries;
+	char *text = malloc(size);
+	qpol_policy_t *qp;
+	const qpol_type_t *d0, *d_last, *f0, *f_last;
+	const qpol_class_t *file;
+	qpol_access_entry_t *entries;
+	uint32_t read, write;
+	int i;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(text);
+	len += snprintf(text + len, size - len, "class process\nclass file\nsid kernel\n"
+			"class process { transition }\nclass file { read write }\n" "attribute domain;\nattribute file_type;\n");
+	for (i = 0; i < ACCESS_TYPES; i++)
+		len += snprintf(text + len, size - len, "type d%d, domain;\ntype f%d, file_type;\n", i, i);
+	len += snprintf(text + len, size - len, "role system_r types domain;\n"
+			"allow domain file_type : file read;\nallow d0 f0 : file write;\n"
+			"user system_u roles system_r;\nsid kernel system_u:system_r:d0\n");
+	CU_ASSERT_FATAL(len < size);
+	qp = open_source_text(text);
+	free(text);
+
+	CU_ASSERT_FATAL(qpol_policy_build_access_matrix(qp, 1024 * 1024) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_type_by_name(qp, "d0", &d0) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_type_by_name(qp, "d1999", &d_last) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_type_by_name(qp, "f0", &f0) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_type_by_name(qp, "f1999", &f_last) == 0);
+	CU_ASSERT_FATAL(qpol_policy_get_class_by_name(qp, "file", &file) == 0);
+	CU_ASSERT_FATAL(qpol_class_get_perm_mask(qp, file, "read", &read) == 0);
+	CU_ASSERT_FATAL(qpol_class_get_perm_mask(qp, file, "write", &write) == 0);
+
+	CU_ASSERT_FATAL(qpol_policy_lookup_access(qp, d_last, f_last, &entries, &num_entries) == 0);
+	CU_ASSERT_FATAL(num_entries == 1);
+	CU_ASSERT(entries[0].obj_class == file && entries[0].rule_type == QPOL_RULE_ALLOW && entries[0].perm_mask == read);
+	free(entries);
+
+	/* the rule on the types and the one on their attributes merge */
+	CU_ASSERT_FATAL(qpol_policy_lookup_access(qp, d0, f0, &entries, &num_entries) == 0);
+	CU_ASSERT_FATAL(num_entries == 1);
+	CU_ASSERT(entries[0].perm_mask == (read | write));
+	free(entries);
+
+	CU_ASSERT(qpol_policy_lookup_access(qp, f0, d0, &entries, &num_entries) == 0);
+	CU_ASSERT(num_entries == 0 && entries == NULL);
+	qpol_policy_destroy(&qp);
+}
+
 CU_TestInfo policy_features_tests[] = {
 	{"invalid alias", policy_features_invalid_alias}
 	,
 	{"No genfscon", policy_features_nogenfscon_iter}
 	,
+	{"genfscon lookup", policy_features_genfscon_lookup}
+	,
+	{"constraint engine", policy_features_constraint_engine}
+	,
+	{"constraint decisions", policy_features_constraint_decisions}
+	,
+	{"load statistics", policy_features_load_stats}
+	,
+	{"fingerprint", policy_features_fingerprint}
+	,
+	{"neverallow check", policy_features_neverallow}
+	,
+	{"neverallow violation", policy_features_neverallow_violation}
+	,
+	{"symbol lookup", policy_features_symbol_lookup}
+	,
+	{"binary policy version", policy_features_binpol_version}
+	,
+	{"policy from a pipe", policy_features_open_pipe}
+	,
+	{"access matrix attributes", policy_features_access_matrix_attributes}
+	,
 	CU_TEST_INFO_NULL
 };
 
@@ -0,0 +1,359 @@
+/**
+ *  @file
+ *
+ *  Test that source policies are read back from their snapshots, and
+ *  that damaged or mismatched snapshots fall back to parsing.
+ *
+ *  Copyright (C) 2007 Tresys Technology, LLC
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <config.h>
+
+#include <CUnit/CUnit.h>
+#include <qpol/policy.h>
+#include <qpol/policy_extend.h>
+#include <dirent.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SOURCE_POLICY TEST_POLICIES "/snapshots/fc4_targeted.policy.conf"
+#define MLS_SOURCE_POLICY TEST_POLICIES "/setools-3.3/rules/rules-mls.conf"
+#define SNAPSHOT_DIR_ENV "SETOOLS_SNAPSHOT_DIR"
+
+/* the libsepol image follows a snapshot's 40-byte header */
+#define SNAPSHOT_HEADER_SIZE 40
+
+#define AVRULE_MASK (QPOL_RULE_ALLOW | QPOL_RULE_AUDITALLOW | QPOL_RULE_DONTAUDIT)
+#define TERULE_MASK (QPOL_RULE_TYPE_TRANS | QPOL_RULE_TYPE_CHANGE | QPOL_RULE_TYPE_MEMBER)
+
+/** What the library said about snapshots while opening a policy. */
+typedef struct snapshot_msgs
+{
+	int read, ignored, wrote;
+} snapshot_msgs_t;
+
+/** Enough of a policy to tell whether two loads of it agree. */
+typedef struct summary
+{
+	size_t num_types, num_avrules, num_terules;
+	/* for each av rule in iteration order, the sum of the line
+	 * numbers of its syntactic rules */
+	unsigned long *lines;
+} summary_t;
+
+static char snapshot_dir[] = "/tmp/qpol-snapshot-XXXXXX";
+
+/* reference summaries, from loads made without snapshots */
+static summary_t ref, ref_mls;
+
+static void snapshot_msg(void *varg, const qpol_policy_t * policy __attribute__ ((unused)), int level
+			 __attribute__ ((unused)), const char *fmt, va_list va_args)
+{
+	snapshot_msgs_t *msgs = varg;
+	char buf[PATH_MAX + 64];
+
+	vsnprintf(buf, sizeof(buf), fmt, va_args);
+	if (strstr(buf, "Reading policy snapshot"))
+		msgs->read = 1;
+	if (strstr(buf, "Ignoring"))
+		msgs->ignored = 1;
+	if (strstr(buf, "Wrote policy snapshot"))
+		msgs->wrote = 1;
+}
+
+static void summary_free(summary_t * s)
+{
+	free(s->lines);
+	s->lines = NULL;
+}
+
+/**
+ * Open a policy and summarize its types and rules, recording what
+ * was said about snapshots in msgs.  Returns 0 on success, < 0 on
+ * failure.
+ */
+static int summarize_policy(const char *path, summary_t * s, snapshot_msgs_t * msgs)
+{
+	qpol_policy_t *qp = NULL;
+	qpol_iterator_t *iter = NULL, *syn_iter = NULL;
+	void *rule, *syn;
+	unsigned long lineno;
+	size_t i;
+	int retv = -1;
+
+	memset(s, 0, sizeof(*s));
+	memset(msgs, 0, sizeof(*msgs));
+	if (qpol_policy_open_from_file(path, &qp, snapshot_msg, msgs, 0) < 0) {
+		return -1;
+	}
+	if (qpol_policy_build_syn_rule_table(qp)) {
+		goto cleanup;
+	}
+	if (qpol_policy_get_type_iter(qp, &iter) || qpol_iterator_get_size(iter, &s->num_types)) {
+		goto cleanup;
+	}
+	qpol_iterator_destroy(&iter);
+	if (qpol_policy_get_terule_iter(qp, TERULE_MASK, &iter) || qpol_iterator_get_size(iter, &s->num_terules)) {
+		goto cleanup;
+	}
+	qpol_iterator_destroy(&iter);
+	if (qpol_policy_get_avrule_iter(qp, AVRULE_MASK, &iter) || qpol_iterator_get_size(iter, &s->num_avrules)) {
+		goto cleanup;
+	}
+	if (!(s->lines = calloc(s->num_avrules + 1, sizeof(unsigned long)))) {
+		goto cleanup;
+	}
+	for (i = 0; !qpol_iterator_end(iter) && i < s->num_avrules; qpol_iterator_next(iter), i++) {
+		if (qpol_iterator_get_item(iter, &rule) || qpol_avrule_get_syn_avrule_iter(qp, rule, &syn_iter)) {
+			goto cleanup;
+		}
+		for (; !qpol_iterator_end(syn_iter); qpol_iterator_next(syn_iter)) {
+			if (qpol_iterator_get_item(syn_iter, &syn) || qpol_syn_avrule_get_lineno(qp, syn, &lineno)) {
+				goto cleanup;
+			}
+			s->lines[i] += lineno;
+		}
+		qpol_iterator_destroy(&syn_iter);
+	}
+	retv = 0;
+      cleanup:
+	if (retv < 0) {
+		summary_free(s);
+	}
+	qpol_iterator_destroy(&syn_iter);
+	qpol_iterator_destroy(&iter);
+	qpol_policy_destroy(&qp);
+	return retv;
+}
+
+static int summaries_equal(const summary_t * a, const summary_t * b)
+{
+	return a->num_types == b->num_types && a->num_avrules == b->num_avrules && a->num_terules == b->num_terules &&
+		memcmp(a->lines, b->lines, a->num_avrules * sizeof(unsigned long)) == 0;
+}
+
+/**
+ * Remove every file from the snapshot directory.  Returns 0 on
+ * success, < 0 if the directory could not be read.
+ */
+static int remove_snapshots(void)
+{
+	char path[PATH_MAX];
+	DIR *dir;
+	struct dirent *ent;
+
+	if ((dir = opendir(snapshot_dir)) == NULL) {
+		return -1;
+	}
+	while ((ent = readdir(dir)) != NULL) {
+		if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+			continue;
+		}
+		snprintf(path, sizeof(path), "%s/%s", snapshot_dir, ent->d_name);
+		unlink(path);
+	}
+	closedir(dir);
+	return 0;
+}
+
+/**
+ * Find a snapshot within the snapshot directory, other than the one
+ * named by skip (which may be NULL), and write its path into path.
+ * Returns 0 if one was found, < 0 if not.
+ */
+static int find_snapshot(char *path, const char *skip)
+{
+	DIR *dir;
+	struct dirent *ent;
+	size_t len;
+	int retv = -1;
+
+	if ((dir = opendir(snapshot_dir)) == NULL) {
+		return -1;
+	}
+	while (retv < 0 && (ent = readdir(dir)) != NULL) {
+		len = strlen(ent->d_name);
+		if (len < 6 || strcmp(ent->d_name + len - 6, ".qsnap") != 0) {
+			continue;
+		}
+		snprintf(path, PATH_MAX, "%s/%s", snapshot_dir, ent->d_name);
+		if (skip == NULL || strcmp(path, skip) != 0) {
+			retv = 0;
+		}
+	}
+	closedir(dir);
+	return retv;
+}
+
+static int read_file(const char *path, char **data, size_t * sz)
+{
+	FILE *fp;
+	long len;
+
+	*data = NULL;
+	if ((fp = fopen(path, "rb")) == NULL) {
+		return -1;
+	}
+	if (fseek(fp, 0, SEEK_END) || (len = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) ||
+	    (*data = malloc(len + 1)) == NULL || fread(*data, 1, len, fp) != (size_t) len) {
+		free(*data);
+		*data = NULL;
+		fclose(fp);
+		return -1;
+	}
+	*sz = len;
+	fclose(fp);
+	return 0;
+}
+
+static int write_file(const char *path, const char *data, size_t sz)
+{
+	FILE *fp;
+	int retv = 0;
+
+	if ((fp = fopen(path, "wb")) == NULL) {
+		return -1;
+	}
+	if (fwrite(data, 1, sz, fp) != sz) {
+		retv = -1;
+	}
+	if (fclose(fp)) {
+		retv = -1;
+	}
+	return retv;
+}
+
+/**
+ * Open a policy whose snapshot is not usable, and check that it is
+ * parsed instead, giving the same policy, and that a new snapshot
+ * is written in place of the bad one.
+ */
+static void check_fallback(const char *path, const summary_t * expected)
+{
+	summary_t s;
+	snapshot_msgs_t msgs;
+
+	CU_ASSERT_FATAL(summarize_policy(path, &s, &msgs) == 0);
+	CU_ASSERT(msgs.ignored);
+	CU_ASSERT(msgs.wrote);
+	CU_ASSERT(summaries_equal(&s, expected));
+	summary_free(&s);
+}
+
+/**
+ * Open a source policy twice; check that the second open reads the
+ * snapshot left by the first and gives the same policy.
+ */
+static void snapshot_reuse(void)
+{
+	char path[PATH_MAX];
+	summary_t s;
+	snapshot_msgs_t msgs;
+
+	CU_ASSERT_FATAL(remove_snapshots() == 0);
+	CU_ASSERT(find_snapshot(path, NULL) < 0);
+	CU_ASSERT_FATAL(summarize_policy(SOURCE_POLICY, &s, &msgs) == 0);
+	CU_ASSERT(!msgs.read);
+	CU_ASSERT(msgs.wrote);
+	CU_ASSERT(summaries_equal(&s, &ref));
+	summary_free(&s);
+	CU_ASSERT_FATAL(find_snapshot(path, NULL) == 0);
+
+	CU_ASSERT_FATAL(summarize_policy(SOURCE_POLICY, &s, &msgs) == 0);
+	CU_ASSERT(msgs.read);
+	CU_ASSERT(!msgs.ignored);
+	CU_ASSERT(!msgs.wrote);
+	CU_ASSERT(summaries_equal(&s, &ref));
+	summary_free(&s);
+}
+
+/**
+ * Check that truncated and corrupted snapshots, and a snapshot of a
+ * different policy, are ignored.
+ */
+static void snapshot_fallback(void)
+{
+	char path[PATH_MAX], mls_path[PATH_MAX];
+	char *data;
+	size_t sz;
+	summary_t s;
+	snapshot_msgs_t msgs;
+
+	CU_ASSERT_FATAL(remove_snapshots() == 0);
+	CU_ASSERT_FATAL(summarize_policy(SOURCE_POLICY, &s, &msgs) == 0);
+	summary_free(&s);
+	CU_ASSERT_FATAL(find_snapshot(path, NULL) == 0);
+	CU_ASSERT_FATAL(read_file(path, &data, &sz) == 0);
+	CU_ASSERT_FATAL(sz > SNAPSHOT_HEADER_SIZE + 64);
+
+	CU_ASSERT_FATAL(write_file(path, data, sz / 2) == 0);
+	check_fallback(SOURCE_POLICY, &ref);
+
+	/* the snapshot of one policy, under the name of another */
+	CU_ASSERT_FATAL(summarize_policy(MLS_SOURCE_POLICY, &s, &msgs) == 0);
+	summary_free(&s);
+	CU_ASSERT_FATAL(find_snapshot(mls_path, path) == 0);
+	CU_ASSERT_FATAL(write_file(mls_path, data, sz) == 0);
+	check_fallback(MLS_SOURCE_POLICY, &ref_mls);
+
+	/* a valid header, but the image's magic number overwritten */
+	memset(data + SNAPSHOT_HEADER_SIZE, 0xff, 64);
+	CU_ASSERT_FATAL(write_file(path, data, sz) == 0);
+	check_fallback(SOURCE_POLICY, &ref);
+
+	free(data);
+}
+
+CU_TestInfo snapshot_tests[] = {
+	{"snapshot reuse", snapshot_reuse}
+	,
+	{"snapshot fallback", snapshot_fallback}
+	,
+	CU_TEST_INFO_NULL
+};
+
+int snapshot_init()
+{
+	snapshot_msgs_t msgs;
+
+	unsetenv(SNAPSHOT_DIR_ENV);
+	if (summarize_policy(SOURCE_POLICY, &ref, &msgs) < 0) {
+		return 1;
+	}
+	if (summarize_policy(MLS_SOURCE_POLICY, &ref_mls, &msgs) < 0) {
+		return 1;
+	}
+	if (mkdtemp(snapshot_dir) == NULL || setenv(SNAPSHOT_DIR_ENV, snapshot_dir, 1) < 0) {
+		return 1;
+	}
+	return 0;
+}
+
+int snapshot_cleanup()
+{
+	unsetenv(SNAPSHOT_DIR_ENV);
+	if (remove_snapshots() == 0) {
+		rmdir(snapshot_dir);
+	}
+	summary_free(&ref);
+	summary_free(&ref_mls);
+	return 0;
+}
@@ -21,7 +21,11 @@ TCONTEXT = 'tcontext'
 PERMS = 'permlist'
 CLASS = 'class'
 
-def sesearch(types, info):
+def sesearch(types, info, callback=None):
+    """Search the av rules of the default policy.  If callback is
+    given, each matching rule is passed to it as a dict as the rule is
+    found, rather than all of them being returned as a list; the search
+    stops early if callback returns False."""
     valid_types = [ALLOW, AUDITALLOW, NEVERALLOW, DONTAUDIT]
     for type in types:
         if type not in valid_types:
@@ -33,6 +37,13 @@ def sesearch(types, info):
         perms = info[PERMS]
         info[PERMS] = ",".join(info[PERMS])
      
+    if callback is not None:
+        def filter_callback(dict):
+            if len(perms) != 0 and not dict_has_perms(dict, perms):
+                return True
+            return callback(dict)
+        _sesearch.sesearch(info, filter_callback)
+        return None
     
     dict_list = _sesearch.sesearch(info)
     if dict_list and len(perms) != 0:
@@ -94,21 +94,117 @@ typedef struct options
 	apol_vector_t *perm_vector;
 } options_t;
 
-static int perform_av_query(const apol_policy_t * policy, const options_t * opt, apol_vector_t ** v)
+/** Where the results of an av rule search go, one dict per rule. */
+typedef struct av_results
+{
+	/** list to which to append each dict, if there is no callback */
+	PyObject *list;
+	/** callable to which to pass each dict instead, or NULL */
+	PyObject *callback;
+	/** number of rules found, whether enabled or not */
+	size_t num_rules;
+} av_results_t;
+
+static PyObject* av_rule_to_dict(qpol_policy_t * q, const qpol_avrule_t * rule)
+{
+	const qpol_type_t *type;
+	const char *tmp_name;
+	uint32_t rule_type = 0;
+	const qpol_class_t *obj_class = NULL;
+	qpol_iterator_t *iter = NULL;
+
+	PyObject *dict = PyDict_New(); 
+
+	qpol_avrule_get_rule_type(q, rule, &rule_type);
+	tmp_name = apol_rule_type_to_str(rule_type);
+	PyObject *obj = PyString_FromString(tmp_name);
+	PyDict_SetItemString(dict, "type", obj);
+	Py_DECREF(obj);
+	// source
+	qpol_avrule_get_source_type(q, rule, &type);
+	qpol_type_get_name(q, type, &tmp_name);
+	obj = PyString_FromString(tmp_name);
+	PyDict_SetItemString(dict, "scontext", obj);
+	Py_DECREF(obj);
+
+	qpol_avrule_get_target_type(q, rule, &type);
+	qpol_type_get_name(q, type, &tmp_name);
+	obj = PyString_FromString(tmp_name);
+	PyDict_SetItemString(dict, "tcontext", obj);
+	Py_DECREF(obj);
+
+	qpol_avrule_get_object_class(q, rule, &obj_class);
+	qpol_type_get_name(q, type, &tmp_name);
+	obj = PyString_FromString(tmp_name);
+	PyDict_SetItemString(dict, "class", obj);
+	Py_DECREF(obj);
+	qpol_avrule_get_perm_iter(q, rule, &iter);
+	PyObject *permlist = PyList_New(0);
+	for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
+		const char *perm_name = NULL;
+		qpol_iterator_get_item(iter, (void **)&perm_name);
+		obj = PyString_FromString(perm_name);
+		PyList_Append(permlist, obj);
+		Py_DECREF(obj);
+	}
+	qpol_iterator_destroy(&iter);
+	PyDict_SetItemString(dict, "permlist", permlist);
+	Py_DECREF(permlist);
+	return dict;
+}
+
+/**
+ * Pass one rule found by the search, as a dict, to the caller's
+ * callback or append it to the list of results.  The search stops if
+ * the callback returns False or raises an exception.
+ */
+static int add_av_result(const apol_policy_t * policy, void *result, void *arg)
+{
+	av_results_t *results = arg;
+	qpol_policy_t *q = apol_policy_get_qpol(policy);
+	const qpol_avrule_t *rule = result;
+	uint32_t enabled = 0;
+	PyObject *dict, *ret;
+	int retval = 0;
+
+	results->num_rules++;
+	if (qpol_avrule_get_is_enabled(q, rule, &enabled))
+		return -1;
+	if (!enabled)
+		return 0;
+
+	if ((dict = av_rule_to_dict(q, rule)) == NULL)
+		return -1;
+	if (results->callback) {
+		if ((ret = PyObject_CallFunctionObjArgs(results->callback, dict, NULL)) == NULL) {
+			retval = -1;
+		} else {
+			retval = (ret == Py_False);
+			Py_DECREF(ret);
+		}
+	} else {
+		PyList_Append(results->list, dict); 
+	}
+	Py_DECREF(dict);
+	return retval;
+}
+
+static int perform_av_query(const apol_policy_t * policy, const options_t * opt, av_results_t * results)
 {
 	apol_avrule_query_t *avq = NULL;
 	unsigned int rules = 0;
-	int error = 0;
+	int error = 0, ret = 0;
 	char *tmp = NULL, *tok = NULL, *s = NULL;
+	apol_vector_t *v = NULL;
+	size_t i;
 
-	if (!policy || !opt || !v) {
+	if (!policy || !opt || !results) {
 		PyErr_SetString(PyExc_RuntimeError,strerror(EINVAL));
 		errno = EINVAL;
 		return -1;
 	}
 
 	if (!opt->all && !opt->allow && !opt->nallow && !opt->auditallow && !opt->dontaudit) {
-		*v = NULL;
 		return 0;	       /* no search to do */
 	}
 
@@ -173,123 +269,41 @@ static int perform_av_query(const apol_policy_t * policy, const options_t * opt,
 	}
 
 	if (!(opt->semantic) && qpol_policy_has_capability(apol_policy_get_qpol(policy), QPOL_CAP_SYN_RULES)) {
-		if (apol_syn_avrule_get_by_query(policy, avq, v)) {
+		if (apol_syn_avrule_get_by_query(policy, avq, &v)) {
 			error = errno;
 			goto err;
 		}
-	} else {
-		if (apol_avrule_get_by_query(policy, avq, v)) {
-			error = errno;
-			goto err;
+		for (i = 0; i < apol_vector_get_size(v); i++) {
+			if ((ret = add_av_result(policy, apol_vector_get_element(v, i), results)) != 0)
+				break;
 		}
+	} else {
+		/* pass each rule on as it is found, rather than gathering
+		 * what may be millions of them first */
+		ret = apol_avrule_foreach_by_query(policy, avq, add_av_result, results);
+	}
+	if (ret < 0) {
+		error = errno;
+		goto err;
 	}
 
+	apol_vector_destroy(&v);
 	apol_avrule_query_destroy(&avq);
 	return 0;
 
       err:
-	apol_vector_destroy(v);
+	apol_vector_destroy(&v);
 	apol_avrule_query_destroy(&avq);
 	free(tmp);
 	free(s);
-	PyErr_SetString(PyExc_RuntimeError,strerror(error));
+	/* leave any exception raised by the callback in place */
+	if (!PyErr_Occurred())
+		PyErr_SetString(PyExc_RuntimeError,strerror(error));
 	errno = error;
 	return -1;
 }
 
 
-
-static PyObject* get_av_results(const apol_policy_t * policy, const options_t * opt, const apol_vector_t * v)
-{
-	int retval = -1;
-	PyObject *list = PyList_New(0);
-	qpol_policy_t *q = apol_policy_get_qpol(policy);
-	size_t i, num_rules = 0;
-	const qpol_avrule_t *rule = NULL;
-	char *tmp = NULL, *rule_str = NULL, *expr = NULL;
-	char enable_char = ' ', branch_char = ' ';
-	qpol_iterator_t *iter = NULL;
-	uint32_t enabled = 0;
-
-	if (!policy || !v)
-		return NULL;
-
-	if (!(num_rules = apol_vector_get_size(v)))
-		return NULL;
-
-	for (i = 0; i < num_rules; i++) {
-		enable_char = branch_char = ' ';
-		if (!(rule = apol_vector_get_element(v, i)))
-			goto cleanup;
-		
-		if (qpol_avrule_get_is_enabled(q, rule, &enabled))
-			goto cleanup;
-		if (!enabled)
-			continue;
-        
-		const qpol_type_t *type;
-		const char *tmp_name;
-		uint32_t rule_type = 0;
-		
-		const qpol_class_t *obj_class = NULL;
-		
-		PyObject *dict = PyDict_New(); 
-		
-		qpol_avrule_get_rule_type(q, rule, &rule_type);
-		tmp_name = apol_rule_type_to_str(rule_type);
-		PyObject *obj = PyString_FromString(tmp_name);
-		PyDict_SetItemString(dict, "type", obj);
-		Py_DECREF(obj);
-		// source
-		qpol_avrule_get_source_type(q, rule, &type);
-		qpol_type_get_name(q, type, &tmp_name);
-		obj = PyString_FromString(tmp_name);
-		PyDict_SetItemString(dict, "scontext", obj);
-		Py_DECREF(obj);
-		
-		qpol_avrule_get_target_type(q, rule, &type);
-		qpol_type_get_name(q, type, &tmp_name);
-		obj = PyString_FromString(tmp_name);
-		PyDict_SetItemString(dict, "tcontext", obj);
-		Py_DECREF(obj);
-		
-		qpol_avrule_get_object_class(q, rule, &obj_class);
-		qpol_type_get_name(q, type, &tmp_name);
-		obj = PyString_FromString(tmp_name);
-		PyDict_SetItemString(dict, "class", obj);
-		Py_DECREF(obj);
-		qpol_avrule_get_perm_iter(q, rule, &iter);
-		PyObject *permlist = PyList_New(0);
-		for (; !qpol_iterator_end(iter); qpol_iterator_next(iter)) {
-			const char *perm_name = NULL;
-			qpol_iterator_get_item(iter, (void **)&perm_name);
-			obj = PyString_FromString(perm_name);
-			PyList_Append(permlist, obj);
-			Py_DECREF(obj);
-		}
-		PyDict_SetItemString(dict, "permlist", permlist);
-		Py_DECREF(permlist);
-		PyList_Append(list, dict); 
-		Py_DECREF(dict);
-		
-		free(rule_str);
-		rule_str = NULL;
-		free(expr);
-		expr = NULL;
-	}
-	retval = 0;
-      cleanup:
-	free(tmp);
-	free(rule_str);
-	free(expr);
-	if (retval) {
-		Py_DECREF(list);
-		return NULL;
-	}
-	return list;
-}
-
-
 PyObject* sesearch(bool allow,
              bool neverallow, 
              bool auditallow,
@@ -297,15 +311,16 @@ PyObject* sesearch(bool allow,
              const char *src_name,
              const char *tgt_name,
              const char *class_name,
-             const char *permlist
+             const char *permlist,
+             PyObject *callback
              )
 {
 	options_t cmd_opts;
 	int rt = -1;
 	PyObject *output = NULL;
+	av_results_t results;
 	
 	apol_policy_t *policy = NULL;
-	apol_vector_t *v = NULL;
 	apol_policy_path_t *pol_path = NULL;
 	apol_vector_t *mod_paths = NULL;
 	apol_policy_path_type_e path_type = APOL_POLICY_PATH_TYPE_MONOLITHIC;
@@ -396,7 +411,7 @@ PyObject* sesearch(bool allow,
 	}
 
 	if (!cmd_opts.semantic && qpol_policy_has_capability(apol_policy_get_qpol(policy), QPOL_CAP_SYN_RULES)) {
-		if (qpol_policy_build_syn_rule_table(apol_policy_get_qpol(policy))) {
+		if (qpol_policy_build_syn_rule_table_lazy(apol_policy_get_qpol(policy))) {
 			apol_policy_destroy(&policy);
 			PyErr_SetString(PyExc_RuntimeError,"Query failed");
 			goto cleanup;
@@ -412,13 +427,18 @@ PyObject* sesearch(bool allow,
 	if (cmd_opts.semantic || !qpol_policy_has_capability(apol_policy_get_qpol(policy), QPOL_CAP_LINE_NUMBERS)) {
 		cmd_opts.lineno = 0;
 	}
-	if (perform_av_query(policy, &cmd_opts, &v)) {
+	memset(&results, 0, sizeof(results));
+	results.callback = callback;
+	if (!callback && (results.list = PyList_New(0)) == NULL)
+		goto cleanup;
+	if (perform_av_query(policy, &cmd_opts, &results)) {
+		Py_XDECREF(results.list);
 		goto cleanup;
 	}
-	if (v) {
-		output =  get_av_results(policy, &cmd_opts, v);
-	}
-	apol_vector_destroy(&v);
+	if (results.list && results.num_rules > 0)
+		output = results.list;
+	else
+		Py_XDECREF(results.list);
       cleanup:
 	apol_policy_destroy(&policy);
 	apol_policy_path_destroy(&pol_path);
@@ -433,6 +453,7 @@ PyObject* sesearch(bool allow,
 	apol_vector_destroy(&cmd_opts.class_vector);
 
 	if (output) return output;
+	if (PyErr_Occurred()) return NULL;
 	return Py_None;
 }
 static int Dict_ContainsInt(PyObject *dict, const char *key){
@@ -450,9 +471,15 @@ static const char *Dict_ContainsString(PyObject *dict, const char *key){
 }
 
 PyObject *wrap_sesearch(PyObject *self, PyObject *args){
-    PyObject *dict;
-    if (!PyArg_ParseTuple(args, "O", &dict))
+    PyObject *dict, *callback = NULL;
+    if (!PyArg_ParseTuple(args, "O|O", &dict, &callback))
+        return NULL;
+    if (callback == Py_None)
+        callback = NULL;
+    if (callback && !PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable");
         return NULL;
+    }
     int allow = Dict_ContainsInt(dict, "allow");
     int neverallow = Dict_ContainsInt(dict, "neverallow");
     int auditallow = Dict_ContainsInt(dict, "auditallow");
@@ -463,7 +490,7 @@ PyObject *wrap_sesearch(PyObject *self, PyObject *args){
     const char *class_name = Dict_ContainsString(dict, "class");
     const char *permlist = Dict_ContainsString(dict, "permlist");
     
-    return Py_BuildValue("O",sesearch(allow, neverallow, auditallow, dontaudit, src_name, tgt_name, class_name, permlist));
+    return Py_BuildValue("O",sesearch(allow, neverallow, auditallow, dontaudit, src_name, tgt_name, class_name, permlist, callback));
 
 }
 
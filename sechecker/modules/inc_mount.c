@@ -169,10 +169,12 @@ int inc_mount_run(sechk_module_t * mod, apol_policy_t * policy, void *arg __attr
 	bool both = false, add_proof = false;
 	int error = 0;
 	char *tmp = NULL;
-	apol_vector_t *mount_vector;
-	apol_vector_t *mounton_vector;
+	apol_vector_t *mount_vector = NULL;
+	apol_vector_t *mounton_vector = NULL;
 	apol_avrule_query_t *mount_avrule_query = NULL;
 	apol_avrule_query_t *mounton_avrule_query = NULL;
+	apol_avrule_query_t *queries[2];
+	apol_vector_t *results[2];
 	qpol_policy_t *q = apol_policy_get_qpol(policy);
 
 	if (!mod || !policy) {
@@ -225,13 +227,21 @@ int inc_mount_run(sechk_module_t * mod, apol_policy_t * policy, void *arg __attr
 	apol_avrule_query_set_rules(policy, mount_avrule_query, QPOL_RULE_ALLOW);
 	apol_avrule_query_append_class(policy, mount_avrule_query, "filesystem");
 	apol_avrule_query_append_perm(policy, mount_avrule_query, "mount");
-	apol_avrule_get_by_query(policy, mount_avrule_query, &mount_vector);
 
 	/* Get avrules for dir mounton */
 	apol_avrule_query_set_rules(policy, mounton_avrule_query, QPOL_RULE_ALLOW);
 	apol_avrule_query_append_class(policy, mounton_avrule_query, "dir");
 	apol_avrule_query_append_perm(policy, mounton_avrule_query, "mounton");
-	apol_avrule_get_by_query(policy, mounton_avrule_query, &mounton_vector);
+
+	/* both in one pass over the rules */
+	queries[0] = mount_avrule_query;
+	queries[1] = mounton_avrule_query;
+	if (apol_avrule_get_by_queries(policy, queries, 2, results)) {
+		error = errno;
+		goto inc_mount_run_fail;
+	}
+	mount_vector = results[0];
+	mounton_vector = results[1];
 
 	for (i = 0; i < apol_vector_get_size(mount_vector); i++) {
 		const qpol_avrule_t *mount_rule;
@@ -55,7 +55,7 @@ enum opt_values
 {
 	RULE_NEVERALLOW = 256, RULE_AUDIT, RULE_AUDITALLOW, RULE_DONTAUDIT,
 	RULE_ROLE_ALLOW, RULE_ROLE_TRANS, RULE_RANGE_TRANS, RULE_ALL,
-	EXPR_ROLE_SOURCE, EXPR_ROLE_TARGET
+	EXPR_ROLE_SOURCE, EXPR_ROLE_TARGET, OPT_THREADS, OPT_STREAM
 };
 
 static struct option const longopts[] = {
@@ -84,6 +84,8 @@ static struct option const longopts[] = {
 	{"linenum", no_argument, NULL, 'n'},
 	{"semantic", no_argument, NULL, 'S'},
 	{"show_cond", no_argument, NULL, 'C'},
+	{"threads", required_argument, NULL, OPT_THREADS},
+	{"stream", no_argument, NULL, OPT_STREAM},
 	{"help", no_argument, NULL, 'h'},
 	{"version", no_argument, NULL, 'V'},
 	{NULL, 0, NULL, 0}
@@ -114,9 +116,14 @@ typedef struct options
 	bool role_trans;
 	bool useregex;
 	bool show_cond;
+	bool stream;
+	size_t threads;
 	apol_vector_t *perm_vector;
 } options_t;
 
+static int print_av_results(const apol_policy_t * policy, const options_t * opt, const apol_avrule_query_t * avq);
+static int print_te_results(const apol_policy_t * policy, const options_t * opt, const apol_terule_query_t * teq);
+
 void usage(const char *program_name, int brief)
 {
 	printf("Usage: %s [OPTIONS] RULE_TYPE [RULE_TYPE ...] [EXPESSION] [POLICY ...]\n\n", program_name);
@@ -151,6 +158,10 @@ void usage(const char *program_name, int brief)
 	printf("  -n, --linenum             show line number for each rule if available\n");
 	printf("  -S, --semantic            search rules semantically instead of syntactically\n");
 	printf("  -C, --show_cond           show conditional expression for conditional rules\n");
+	printf("  --threads=N               search av and te rules with N threads (0 for one\n");
+	printf("                            per processor)\n");
+	printf("  --stream                  print semantic av and te rules as they are found,\n");
+	printf("                            followed by their number\n");
 	printf("  -h, --help                print this help text and exit\n");
 	printf("  -V, --version             print version information and exit\n");
 	printf("\n");
@@ -196,6 +207,7 @@ static int perform_av_query(const apol_policy_t * policy, const options_t * opt,
 	if (rules != 0)					// Setting rules = 0 means you want all the rules
 		apol_avrule_query_set_rules(policy, avq, rules);
 	apol_avrule_query_set_regex(policy, avq, opt->useregex);
+	apol_avrule_query_set_threads(policy, avq, opt->threads);
 	if (opt->src_name)
 		apol_avrule_query_set_source(policy, avq, opt->src_name, opt->indirect);
 	if (opt->tgt_name)
@@ -244,10 +256,11 @@ static int perform_av_query(const apol_policy_t * policy, const options_t * opt,
 			goto err;
 		}
 	} else {
-		if (apol_avrule_get_by_query(policy, avq, v)) {
+		if (print_av_results(policy, opt, avq)) {
 			error = errno;
 			goto err;
 		}
+		fprintf(stdout, "\n");
 	}
 
 	apol_avrule_query_destroy(&avq);
@@ -327,64 +340,89 @@ static void print_syn_av_results(const apol_policy_t * policy, const options_t *
 	free(expr);
 }
 
-static void print_av_results(const apol_policy_t * policy, const options_t * opt, const apol_vector_t * v)
+/** State shared by the rules printed for one query. */
+typedef struct print_state
+{
+	const options_t *opt;
+	size_t num_rules;
+} print_state_t;
+
+static int print_av_rule(const apol_policy_t * policy, void *result, void *arg)
 {
+	print_state_t *state = arg;
+	const options_t *opt = state->opt;
 	qpol_policy_t *q = apol_policy_get_qpol(policy);
-	size_t i, num_rules = 0;
-	const qpol_avrule_t *rule = NULL;
+	const qpol_avrule_t *rule = result;
 	char *tmp = NULL, *rule_str = NULL, *expr = NULL;
 	char enable_char = ' ', branch_char = ' ';
-	qpol_iterator_t *iter = NULL;
 	const qpol_cond_t *cond = NULL;
 	uint32_t enabled = 0, list = 0;
+	int retval = -1;
 
-	if (!policy || !v)
-		return;
-
-	if (!(num_rules = apol_vector_get_size(v)))
-		return;
-
-	fprintf(stdout, "Found %zd semantic av rules:\n", num_rules);
-
-	for (i = 0; i < num_rules; i++) {
-		enable_char = branch_char = ' ';
-		if (!(rule = apol_vector_get_element(v, i)))
+	if (opt->show_cond) {
+		if (qpol_avrule_get_cond(q, rule, &cond))
 			goto cleanup;
-		if (opt->show_cond) {
-			if (qpol_avrule_get_cond(q, rule, &cond))
+		if (qpol_avrule_get_is_enabled(q, rule, &enabled))
+			goto cleanup;
+		if (cond) {
+			if (qpol_avrule_get_which_list(q, rule, &list))
 				goto cleanup;
-			if (qpol_avrule_get_is_enabled(q, rule, &enabled))
+			tmp = apol_cond_expr_render(policy, cond);
+			enable_char = (enabled ? 'E' : 'D');
+			branch_char = (list ? 'T' : 'F');
+			if (asprintf(&expr, "[ %s ]", tmp) < 0) {
+				expr = NULL;
 				goto cleanup;
-			if (cond) {
-				if (qpol_avrule_get_which_list(q, rule, &list))
-					goto cleanup;
-				tmp = apol_cond_expr_render(policy, cond);
-				qpol_iterator_destroy(&iter);
-				enable_char = (enabled ? 'E' : 'D');
-				branch_char = (list ? 'T' : 'F');
-				if (asprintf(&expr, "[ %s ]", tmp) < 0) {
-					expr = NULL;
-					goto cleanup;
-				}
-				free(tmp);
-				tmp = NULL;
-				if (!expr)
-					goto cleanup;
 			}
 		}
-		if (!(rule_str = apol_avrule_render(policy, rule)))
-			goto cleanup;
-		fprintf(stdout, "%c%c %s %s\n", enable_char, branch_char, rule_str, expr ? expr : "");
-		free(rule_str);
-		rule_str = NULL;
-		free(expr);
-		expr = NULL;
 	}
+	if (!(rule_str = apol_avrule_render(policy, rule)))
+		goto cleanup;
+	fprintf(stdout, "%c%c %s %s\n", enable_char, branch_char, rule_str, expr ? expr : "");
+	state->num_rules++;
+	retval = 0;
 
       cleanup:
 	free(tmp);
 	free(rule_str);
 	free(expr);
+	return retval;
+}
+
+/**
+ * Print the semantic rules matching a query.  Normally the rules are
+ * gathered first so that their number can head them.  With --stream
+ * each rule is printed as soon as it is found, for a low time to the
+ * first result and constant memory, and their number follows them.
+ */
+static int print_av_results(const apol_policy_t * policy, const options_t * opt, const apol_avrule_query_t * avq)
+{
+	print_state_t state = { opt, 0 };
+	apol_vector_t *v = NULL;
+	size_t i;
+	int retval = -1;
+
+	if (opt->stream) {
+		if (apol_avrule_foreach_by_query(policy, avq, print_av_rule, &state))
+			return -1;
+		if (state.num_rules > 0)
+			fprintf(stdout, "Found %zd semantic av rules.\n", state.num_rules);
+		return 0;
+	}
+
+	if (apol_avrule_get_by_query(policy, avq, &v))
+		return -1;
+	if (apol_vector_get_size(v) > 0)
+		fprintf(stdout, "Found %zd semantic av rules:\n", apol_vector_get_size(v));
+	for (i = 0; i < apol_vector_get_size(v); i++) {
+		if (print_av_rule(policy, apol_vector_get_element(v, i), &state))
+			goto cleanup;
+	}
+	retval = 0;
+
+      cleanup:
+	apol_vector_destroy(&v);
+	return retval;
 }
 
 static int perform_te_query(const apol_policy_t * policy, const options_t * opt, apol_vector_t ** v)
@@ -415,6 +453,7 @@ static int perform_te_query(const apol_policy_t * policy, const options_t * opt,
 
 	apol_terule_query_set_rules(policy, teq, rules);
 	apol_terule_query_set_regex(policy, teq, opt->useregex);
+	apol_terule_query_set_threads(policy, teq, opt->threads);
 	if (opt->src_name)
 		apol_terule_query_set_source(policy, teq, opt->src_name, opt->indirect);
 	if (opt->tgt_name)
@@ -449,10 +488,11 @@ static int perform_te_query(const apol_policy_t * policy, const options_t * opt,
 			goto err;
 		}
 	} else {
-		if (apol_terule_get_by_query(policy, teq, v)) {
+		if (print_te_results(policy, opt, teq)) {
 			error = errno;
 			goto err;
 		}
+		fprintf(stdout, "\n");
 	}
 
 	apol_terule_query_destroy(&teq);
@@ -530,66 +570,82 @@ static void print_syn_te_results(const apol_policy_t * policy, const options_t *
 	free(expr);
 }
 
-static void print_te_results(const apol_policy_t * policy, const options_t * opt, const apol_vector_t * v)
+static int print_te_rule(const apol_policy_t * policy, void *result, void *arg)
 {
+	print_state_t *state = arg;
+	const options_t *opt = state->opt;
 	qpol_policy_t *q = apol_policy_get_qpol(policy);
-	size_t i, num_rules = 0;
-	const qpol_terule_t *rule = NULL;
+	const qpol_terule_t *rule = result;
 	char *tmp = NULL, *rule_str = NULL, *expr = NULL;
 	char enable_char = ' ', branch_char = ' ';
-	qpol_iterator_t *iter = NULL;
 	const qpol_cond_t *cond = NULL;
 	uint32_t enabled = 0, list = 0;
+	int retval = -1;
 
-	if (!policy || !v)
-		goto cleanup;
-
-	if (!(num_rules = apol_vector_get_size(v)))
-		goto cleanup;
-
-	fprintf(stdout, "Found %zd semantic te rules:\n", num_rules);
-
-	for (i = 0; i < num_rules; i++) {
-		enable_char = branch_char = ' ';
-		if (!(rule = apol_vector_get_element(v, i)))
+	if (opt->show_cond) {
+		if (qpol_terule_get_cond(q, rule, &cond))
 			goto cleanup;
-		if (opt->show_cond) {
-			if (qpol_terule_get_cond(q, rule, &cond))
+		if (qpol_terule_get_is_enabled(q, rule, &enabled))
+			goto cleanup;
+		if (cond) {
+			if (qpol_terule_get_which_list(q, rule, &list))
 				goto cleanup;
-			if (qpol_terule_get_is_enabled(q, rule, &enabled))
+			tmp = apol_cond_expr_render(policy, cond);
+			enable_char = (enabled ? 'E' : 'D');
+			branch_char = (list ? 'T' : 'F');
+			if (asprintf(&expr, "[ %s ]", tmp) < 0) {
+				expr = NULL;
 				goto cleanup;
-			if (cond) {
-				if (qpol_terule_get_which_list(q, rule, &list))
-					goto cleanup;
-				if (qpol_cond_get_expr_node_iter(q, cond, &iter))
-					goto cleanup;
-				tmp = apol_cond_expr_render(policy, cond);
-				qpol_iterator_destroy(&iter);
-				enable_char = (enabled ? 'E' : 'D');
-				branch_char = (list ? 'T' : 'F');
-				if (asprintf(&expr, "[ %s ]", tmp) < 0) {
-					expr = NULL;
-					goto cleanup;
-				}
-				free(tmp);
-				tmp = NULL;
-				if (!expr)
-					goto cleanup;
 			}
 		}
-		if (!(rule_str = apol_terule_render(policy, rule)))
-			goto cleanup;
-		fprintf(stdout, "%c%c %s %s\n", enable_char, branch_char, rule_str, expr ? expr : "");
-		free(rule_str);
-		rule_str = NULL;
-		free(expr);
-		expr = NULL;
 	}
+	if (!(rule_str = apol_terule_render(policy, rule)))
+		goto cleanup;
+	fprintf(stdout, "%c%c %s %s\n", enable_char, branch_char, rule_str, expr ? expr : "");
+	state->num_rules++;
+	retval = 0;
 
       cleanup:
 	free(tmp);
 	free(rule_str);
 	free(expr);
+	return retval;
+}
+
+/**
+ * Print the semantic rules matching a query.  Normally the rules are
+ * gathered first so that their number can head them.  With --stream
+ * each rule is printed as soon as it is found, for a low time to the
+ * first result and constant memory, and their number follows them.
+ */
+static int print_te_results(const apol_policy_t * policy, const options_t * opt, const apol_terule_query_t * teq)
+{
+	print_state_t state = { opt, 0 };
+	apol_vector_t *v = NULL;
+	size_t i;
+	int retval = -1;
+
+	if (opt->stream) {
+		if (apol_terule_foreach_by_query(policy, teq, print_te_rule, &state))
+			return -1;
+		if (state.num_rules > 0)
+			fprintf(stdout, "Found %zd semantic te rules.\n", state.num_rules);
+		return 0;
+	}
+
+	if (apol_terule_get_by_query(policy, teq, &v))
+		return -1;
+	if (apol_vector_get_size(v) > 0)
+		fprintf(stdout, "Found %zd semantic te rules:\n", apol_vector_get_size(v));
+	for (i = 0; i < apol_vector_get_size(v); i++) {
+		if (print_te_rule(policy, apol_vector_get_element(v, i), &state))
+			goto cleanup;
+	}
+	retval = 0;
+
+      cleanup:
+	apol_vector_destroy(&v);
+	return retval;
 }
 
 static int perform_ft_query(const apol_policy_t * policy, const options_t * opt, apol_vector_t ** v)
@@ -973,6 +1029,7 @@ int main(int argc, char **argv)
 
 	memset(&cmd_opts, 0, sizeof(cmd_opts));
 	cmd_opts.indirect = true;
+	cmd_opts.threads = 1;
 	while ((optc = getopt_long(argc, argv, "ATs:t:c:p:b:dD:RnSChV", longopts, NULL)) != -1) {
 		switch (optc) {
 		case 0:
@@ -1120,6 +1177,22 @@ int main(int argc, char **argv)
 		case 'C':
 			cmd_opts.show_cond = true;
 			break;
+		case OPT_THREADS:
+		{
+			char *end = NULL;
+			unsigned long threads;
+			errno = 0;
+			threads = strtoul(optarg, &end, 10);
+			if (*optarg == '\0' || *optarg == '-' || *end != '\0' || errno != 0) {
+				fprintf(stderr, "Invalid number of threads: %s\n", optarg);
+				exit(1);
+			}
+			cmd_opts.threads = threads;
+			break;
+		}
+		case OPT_STREAM:
+			cmd_opts.stream = true;
+			break;
 		case 'h':	       /* help */
 			usage(argv[0], 0);
 			exit(0);
@@ -1233,12 +1306,18 @@ int main(int argc, char **argv)
 	}
 
 	if (!cmd_opts.semantic && qpol_policy_has_capability(apol_policy_get_qpol(policy), QPOL_CAP_SYN_RULES)) {
-		if (qpol_policy_build_syn_rule_table(apol_policy_get_qpol(policy))) {
+		if (qpol_policy_build_syn_rule_table_lazy(apol_policy_get_qpol(policy))) {
 			apol_policy_destroy(&policy);
 			exit(1);
 		}
 	}
 
+	/* searching with several threads needs a read only policy */
+	if (cmd_opts.threads != 1 && qpol_policy_freeze(apol_policy_get_qpol(policy))) {
+		apol_policy_destroy(&policy);
+		exit(1);
+	}
+
 	/* if syntactic rules are not available always do semantic search */
 	if (!qpol_policy_has_capability(apol_policy_get_qpol(policy), QPOL_CAP_SYN_RULES)) {
 		cmd_opts.semantic = 1;
@@ -1254,10 +1333,7 @@ int main(int argc, char **argv)
 		goto cleanup;
 	}
 	if (v) {
-		if (!cmd_opts.semantic && qpol_policy_has_capability(apol_policy_get_qpol(policy), QPOL_CAP_SYN_RULES))
-			print_syn_av_results(policy, &cmd_opts, v);
-		else
-			print_av_results(policy, &cmd_opts, v);
+		print_syn_av_results(policy, &cmd_opts, v);
 		fprintf(stdout, "\n");
 	}
 	apol_vector_destroy(&v);
@@ -1266,10 +1342,7 @@ int main(int argc, char **argv)
 		goto cleanup;
 	}
 	if (v) {
-		if (!cmd_opts.semantic && qpol_policy_has_capability(apol_policy_get_qpol(policy), QPOL_CAP_SYN_RULES))
-			print_syn_te_results(policy, &cmd_opts, v);
-		else
-			print_te_results(policy, &cmd_opts, v);
+		print_syn_te_results(policy, &cmd_opts, v);
 		fprintf(stdout, "\n");
 	}
 